@@ -0,0 +1,318 @@
+// alarm.c
+// This file implements the limit and alarm engine.
+// The limits are turned into four thresholds per channel (raise and clear, high and low), with
+// unused limits set to infinity, so evaluating a channel is two float comparisons and a
+// counter update with no special cases. New limits are staged under a spinlock and picked up
+// by the acquisition task at its next frame, signalled by one atomic flag; the evaluation
+// itself takes no lock. Its cost is measured with the CPU cycle counter on every frame.
+
+#include "alarm.h"
+#include <math.h>              // For INFINITY and isfinite
+#include <stdatomic.h>         // For the reload flag
+#include <string.h>            // For memset
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For the alarm task
+#include "freertos/queue.h"    // For the event queue
+#include "esp_cpu.h"           // For esp_cpu_get_cycle_count
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "nvs.h"               // For storing the limits
+
+// --- Module Constants ---
+static const char *TAG = "alarm";
+
+#define NAMESPACE "app_settings"         // Same NVS namespace as the other settings.
+#define KEY_CONFIG "alarms"              // Key of the limits blob.
+#define ALARM_QUEUE_LENGTH 16            // State changes buffered for the alarm task.
+#define ALARM_TASK_STACK_SIZE 4096       // Stack size of the alarm task (the callback writes to the card).
+#define ALARM_TASK_PRIORITY 4            // Below the acquisition (5) and the log writer (6).
+#define ALARM_AVG_SHIFT 4                // Moving average of the cost over ~16 frames.
+
+/**
+ * @struct threshold_t
+ * @brief Precomputed thresholds of one channel.
+ */
+typedef struct {
+    float raise_high;    // Above this the channel goes high (+INFINITY if the high limit is off).
+    float clear_high;    // A high channel returns to normal at or below this.
+    float raise_low;     // Below this the channel goes low (-INFINITY if the low limit is off).
+    float clear_low;     // A low channel returns to normal at or above this.
+    uint16_t debounce;   // Consecutive frames required for a change.
+} threshold_t;
+
+/**
+ * @struct channel_state_t
+ * @brief Evaluation state of one channel (acquisition task only).
+ */
+typedef struct {
+    uint8_t state;       // alarm_state_t
+    uint8_t pending;     // State the channel is moving to.
+    uint16_t count;      // Consecutive frames in the pending state.
+} channel_state_t;
+
+static const char *const state_names[] = {"normal", "high", "low"};
+
+// --- Static Variables ---
+static alarm_config_t config;                       // Stored limits (protected by config_lock).
+static threshold_t staged[NUM_CHANNELS];            // New thresholds waiting for the acquisition task (config_lock).
+static portMUX_TYPE config_lock = portMUX_INITIALIZER_UNLOCKED;
+static _Atomic bool reload = false;                 // Set when staged holds new thresholds.
+static threshold_t thresholds[NUM_CHANNELS];        // Thresholds in use (acquisition task only).
+static channel_state_t channels[NUM_CHANNELS];      // Written by the acquisition task only.
+static uint32_t active_mask = 0;                    // Channels in alarm.
+static QueueHandle_t event_queue = NULL;
+static alarm_event_cb_t event_cb = NULL;
+static volatile uint32_t events = 0;
+static volatile uint32_t dropped = 0;
+static volatile uint32_t frames = 0;
+static volatile uint32_t cycles_last = 0;
+static volatile uint32_t cycles_max = 0;
+static volatile uint32_t cycles_avg = 0;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Builds the thresholds of a configuration.
+ */
+static void build_thresholds(const alarm_config_t *c, threshold_t *out)
+{
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const alarm_limit_t *l = &c->channels[i];
+        out[i].raise_high = l->high_enabled ? l->high : INFINITY;
+        out[i].clear_high = l->high_enabled ? l->high - l->hysteresis : INFINITY;
+        out[i].raise_low = l->low_enabled ? l->low : -INFINITY;
+        out[i].clear_low = l->low_enabled ? l->low + l->hysteresis : -INFINITY;
+        out[i].debounce = l->debounce;
+    }
+}
+
+static void set_default_config(alarm_config_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        c->channels[i].debounce = 1;
+    }
+}
+
+static bool config_is_valid(const alarm_config_t *c)
+{
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const alarm_limit_t *l = &c->channels[i];
+        if (l->debounce < 1 || l->debounce > ALARM_DEBOUNCE_MAX)
+            return false;
+        if (!isfinite(l->hysteresis) || l->hysteresis < 0.0f)
+            return false;
+        if ((l->high_enabled && !isfinite(l->high)) || (l->low_enabled && !isfinite(l->low)))
+            return false;
+        if (l->high_enabled && l->low_enabled && l->low >= l->high)
+            return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Changes the state of a channel and queues the event (acquisition task only).
+ */
+static void change_state(int channel, uint8_t next, float value, float limit, int64_t frame_us)
+{
+    alarm_event_t ev = {
+        .channel = (uint8_t)channel,
+        .state = next,
+        .previous = channels[channel].state,
+        .value = value,
+        .limit = limit,
+        .frame_us = frame_us,
+    };
+    channels[channel].state = next;
+    channels[channel].pending = next;
+    channels[channel].count = 0;
+    if (next == ALARM_STATE_NORMAL)
+        active_mask &= ~(1u << channel);
+    else
+        active_mask |= 1u << channel;
+    ev.active_mask = active_mask;
+    events++;
+    if (xQueueSend(event_queue, &ev, 0) != pdTRUE)
+        dropped++;
+}
+
+/**
+ * @brief FreeRTOS task that hands queued state changes to the callback.
+ * @param pvParam Task parameters (not used).
+ */
+static void alarm_task(void *pvParam)
+{
+    alarm_event_t ev;
+    while (1)
+    {
+        xQueueReceive(event_queue, &ev, portMAX_DELAY);
+        ESP_LOGW(TAG, "Channel %u: %s -> %s (value %.4f, limit %.4f)", ev.channel, state_names[ev.previous],
+                 state_names[ev.state], ev.value, ev.limit);
+        if (event_cb)
+            event_cb(&ev);
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t alarm_init(alarm_event_cb_t on_event)
+{
+    event_cb = on_event;
+    set_default_config(&config);
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK)
+    {
+        alarm_config_t stored;
+        size_t size = sizeof(stored);
+        if (nvs_get_blob(nvs_handle, KEY_CONFIG, &stored, &size) == ESP_OK &&
+            size == sizeof(stored) && config_is_valid(&stored))
+        {
+            config = stored;
+            ESP_LOGI(TAG, "Alarm limits loaded from NVS");
+        }
+        nvs_close(nvs_handle);
+    }
+    build_thresholds(&config, thresholds);
+
+    event_queue = xQueueCreate(ALARM_QUEUE_LENGTH, sizeof(alarm_event_t));
+    if (!event_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create the event queue");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(alarm_task, "alarm", ALARM_TASK_STACK_SIZE, NULL, ALARM_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the alarm task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+uint32_t alarm_evaluate(const float *values, int64_t frame_us)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+
+    if (atomic_load_explicit(&reload, memory_order_acquire))
+    {
+        portENTER_CRITICAL(&config_lock);
+        memcpy(thresholds, staged, sizeof(thresholds));
+        atomic_store_explicit(&reload, false, memory_order_relaxed);
+        portEXIT_CRITICAL(&config_lock);
+        // Restart every channel in the normal state; active alarms are cleared with an event.
+        for (int i = 0; i < NUM_CHANNELS; i++)
+        {
+            if (channels[i].state != ALARM_STATE_NORMAL)
+                change_state(i, ALARM_STATE_NORMAL, values[i], NAN, frame_us);
+            channels[i].pending = ALARM_STATE_NORMAL;
+            channels[i].count = 0;
+        }
+    }
+
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const threshold_t *t = &thresholds[i];
+        channel_state_t *ch = &channels[i];
+        float v = values[i];
+        uint8_t next;
+
+        switch (ch->state)
+        {
+        case ALARM_STATE_HIGH:
+            next = v > t->clear_high ? ALARM_STATE_HIGH : v < t->raise_low ? ALARM_STATE_LOW : ALARM_STATE_NORMAL;
+            break;
+        case ALARM_STATE_LOW:
+            next = v < t->clear_low ? ALARM_STATE_LOW : v > t->raise_high ? ALARM_STATE_HIGH : ALARM_STATE_NORMAL;
+            break;
+        default:
+            next = v > t->raise_high ? ALARM_STATE_HIGH : v < t->raise_low ? ALARM_STATE_LOW : ALARM_STATE_NORMAL;
+            break;
+        }
+
+        if (next == ch->state)
+        {
+            ch->count = 0;
+            continue;
+        }
+        if (next != ch->pending)
+        {
+            ch->pending = next;
+            ch->count = 0;
+        }
+        if (++ch->count < t->debounce)
+            continue;
+
+        // Debounce complete: change the state and queue the event.
+        float limit = next == ALARM_STATE_HIGH ? t->raise_high
+                    : next == ALARM_STATE_LOW  ? t->raise_low
+                    : ch->state == ALARM_STATE_HIGH ? t->clear_high : t->clear_low;
+        change_state(i, next, v, limit, frame_us);
+    }
+
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    cycles_last = cycles;
+    if (cycles > cycles_max)
+        cycles_max = cycles;
+    cycles_avg = frames == 0 ? cycles : cycles_avg + ((int32_t)(cycles - cycles_avg) >> ALARM_AVG_SHIFT);
+    frames++;
+    return active_mask;
+}
+
+void alarm_get_config(alarm_config_t *out)
+{
+    portENTER_CRITICAL(&config_lock);
+    *out = config;
+    portEXIT_CRITICAL(&config_lock);
+}
+
+esp_err_t alarm_set_config(const alarm_config_t *new_config)
+{
+    if (!config_is_valid(new_config))
+        return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_set_blob(nvs_handle, KEY_CONFIG, new_config, sizeof(*new_config));
+    if (err == ESP_OK)
+        err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to store alarm limits: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    threshold_t built[NUM_CHANNELS];
+    build_thresholds(new_config, built);
+    portENTER_CRITICAL(&config_lock);
+    config = *new_config;
+    memcpy(staged, built, sizeof(staged));
+    atomic_store_explicit(&reload, true, memory_order_release);
+    portEXIT_CRITICAL(&config_lock);
+    ESP_LOGI(TAG, "Alarm limits updated");
+    return ESP_OK;
+}
+
+void alarm_get_status(alarm_status_t *out)
+{
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        out->states[i] = channels[i].state;
+    }
+    out->active_mask = active_mask;
+    out->events = events;
+    out->dropped = dropped;
+    out->frames = frames;
+    out->cycles_last = cycles_last;
+    out->cycles_max = cycles_max;
+    out->cycles_avg = cycles_avg;
+}
+
+const char *alarm_state_name(alarm_state_t state)
+{
+    return state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "?";
+}
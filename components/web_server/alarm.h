@@ -0,0 +1,141 @@
+// alarm.h
+// This header defines the public API for the limit and alarm engine.
+// Every channel can have a high and a low limit. A channel enters the alarm state after its
+// value has been beyond a limit for `debounce` consecutive frames, and leaves it after it has
+// been back inside by more than `hysteresis` for as many frames. The acquisition task evaluates
+// every frame with alarm_evaluate(), which only compares against precomputed thresholds and
+// never blocks. State changes are queued and handed to a callback in the engine's own task,
+// where they can be shown, logged and signalled without delaying the acquisition.
+// The limits are stored in NVS.
+
+#ifndef ALARM_H_
+#define ALARM_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+#include "settings.h"  // For NUM_CHANNELS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def ALARM_DEBOUNCE_MAX
+ * @brief Largest debounce count (frames).
+ */
+#define ALARM_DEBOUNCE_MAX 1000
+
+/**
+ * @enum alarm_state_t
+ * @brief Alarm state of one channel.
+ */
+typedef enum {
+    ALARM_STATE_NORMAL = 0,  ///< Inside the limits.
+    ALARM_STATE_HIGH,        ///< Above the high limit.
+    ALARM_STATE_LOW,         ///< Below the low limit.
+} alarm_state_t;
+
+/**
+ * @struct alarm_limit_t
+ * @brief Limits of one channel, in the scaled unit of the channel.
+ */
+typedef struct {
+    bool high_enabled;     ///< True if the high limit is checked.
+    bool low_enabled;      ///< True if the low limit is checked.
+    float high;            ///< High limit.
+    float low;             ///< Low limit (below high if both are enabled).
+    float hysteresis;      ///< Distance inside a limit the value must return to clear the alarm (>= 0).
+    uint16_t debounce;     ///< Consecutive frames required to raise or clear an alarm (1-ALARM_DEBOUNCE_MAX).
+} alarm_limit_t;
+
+/**
+ * @struct alarm_config_t
+ * @brief All limits, as stored in NVS.
+ */
+typedef struct {
+    alarm_limit_t channels[NUM_CHANNELS];
+} alarm_config_t;
+
+/**
+ * @struct alarm_event_t
+ * @brief One state change.
+ */
+typedef struct {
+    uint8_t channel;       ///< Channel number.
+    uint8_t state;         ///< New state (alarm_state_t).
+    uint8_t previous;      ///< Previous state (alarm_state_t).
+    float value;           ///< Value of the frame that completed the debounce.
+    float limit;           ///< Limit that was crossed (the clearing threshold when returning to normal).
+    int64_t frame_us;      ///< Sampling instant of that frame (esp_timer time).
+    uint32_t active_mask;  ///< Channels in alarm after this change (bit N = channel N).
+} alarm_event_t;
+
+/**
+ * @struct alarm_status_t
+ * @brief Engine state and cost, for the status API.
+ */
+typedef struct {
+    uint8_t states[NUM_CHANNELS];  ///< Current state of each channel (alarm_state_t).
+    uint32_t active_mask;          ///< Channels in alarm.
+    uint32_t events;               ///< State changes since boot.
+    uint32_t dropped;              ///< State changes lost to a full event queue.
+    uint32_t frames;               ///< Frames evaluated.
+    uint32_t cycles_last;          ///< CPU cycles of the last evaluation.
+    uint32_t cycles_max;           ///< Largest evaluation cost since boot.
+    uint32_t cycles_avg;           ///< Moving average of the evaluation cost (about 16 frames).
+} alarm_status_t;
+
+/**
+ * @brief Callback invoked from the alarm task for every state change.
+ * @param event The change.
+ */
+typedef void (*alarm_event_cb_t)(const alarm_event_t *event);
+
+/**
+ * @brief Loads the limits from NVS and starts the alarm task.
+ * NVS must already be initialized (settings_init()).
+ * @param on_event Callback for state changes.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the queue or task could not be created.
+ */
+esp_err_t alarm_init(alarm_event_cb_t on_event);
+
+/**
+ * @brief Evaluates one frame. Call from the acquisition task only; never blocks.
+ * @param values Scaled channel values (NUM_CHANNELS of them).
+ * @param frame_us Sampling instant of the frame.
+ * @return uint32_t Channels in alarm after this frame (bit N = channel N).
+ */
+uint32_t alarm_evaluate(const float *values, int64_t frame_us);
+
+/**
+ * @brief Copies the stored limits.
+ * @param out Destination.
+ */
+void alarm_get_config(alarm_config_t *out);
+
+/**
+ * @brief Validates, stores and applies new limits. The acquisition task picks them up at its
+ * next frame; all channels restart in the normal state.
+ * @param config New limits.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for invalid limits,
+ *         or the NVS error if they could not be stored.
+ */
+esp_err_t alarm_set_config(const alarm_config_t *config);
+
+/**
+ * @brief Copies the engine state and counters.
+ * @param out Destination.
+ */
+void alarm_get_status(alarm_status_t *out);
+
+/**
+ * @brief Returns the name of a state ("normal", "high", "low").
+ */
+const char *alarm_state_name(alarm_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ALARM_H_ */
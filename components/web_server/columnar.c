@@ -0,0 +1,295 @@
+// columnar.c
+// This file implements the columnar log reader.
+// Chunks are visited in file order: first through the directory sidecar, then by following
+// chunk headers from the end of the last indexed chunk, so files that were never closed
+// properly are still readable up to their last complete chunk. For each chunk, only the
+// timestamp block and the selected column blocks are read, each with one seek and one read.
+
+#include "columnar.h"
+#include <stdio.h>             // For FILE, fopen, fseek, snprintf
+#include <stdlib.h>            // For malloc, free, strtol
+#include <string.h>            // For memcmp, strlen
+#include <sys/stat.h>          // For stat
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "sd_io.h"             // For throttled reads
+
+// --- Module Constants ---
+static const char *TAG = "columnar";
+
+#define COLUMNAR_DIR_BATCH 32          // Directory records read at once.
+#define COLUMNAR_OUT_BUFFER_SIZE 4096  // CSV text collected before it is handed to the callback.
+#define COLUMNAR_ROW_MAX 160           // Longest CSV row (timestamp and 8 values).
+
+/**
+ * @struct columnar_reader_t
+ * @brief State of one pass over the chunks of a file.
+ */
+typedef struct {
+    FILE *file;                                       // The log file.
+    FILE *dir;                                        // Directory sidecar, NULL once exhausted or if missing.
+    columnar_dir_entry_t entries[COLUMNAR_DIR_BATCH]; // Directory records read ahead.
+    size_t entry_count;                               // Valid records in entries.
+    size_t entry_pos;                                 // Next record to use.
+    uint32_t file_size;                               // Size of the log file.
+    uint32_t channels;                                // Channels per chunk (from the file header).
+    uint32_t next_offset;                             // Offset right after the last visited chunk.
+    sd_io_session_t io;                               // Read statistics.
+} columnar_reader_t;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Reads exactly len bytes at offset through the SD I/O scheduler.
+ * @return bool True if all bytes were read.
+ */
+static bool read_at(columnar_reader_t *r, uint32_t offset, void *buf, size_t len)
+{
+    if (fseek(r->file, offset, SEEK_SET) != 0)
+    {
+        return false;
+    }
+    size_t total = 0;
+    while (total < len)
+    {
+        size_t n = sd_io_read(&r->io, (uint8_t *)buf + total, len - total, r->file);
+        if (n == 0)
+        {
+            return false;
+        }
+        total += n;
+    }
+    return true;
+}
+
+/**
+ * @brief Takes the next chunk from the directory sidecar.
+ * @return bool True if a usable record was found; false once the directory is exhausted.
+ */
+static bool next_from_dir(columnar_reader_t *r, uint32_t *offset, uint32_t *frames)
+{
+    while (r->dir)
+    {
+        if (r->entry_pos == r->entry_count)
+        {
+            r->entry_count = sd_io_read(&r->io, r->entries, sizeof(r->entries), r->dir) / sizeof(columnar_dir_entry_t);
+            r->entry_pos = 0;
+            if (r->entry_count == 0)
+            {
+                break;
+            }
+        }
+        const columnar_dir_entry_t *e = &r->entries[r->entry_pos++];
+        // A record must continue where the previous chunk ended and lie inside the file.
+        if (e->offset != r->next_offset || e->frames == 0 || e->frames > COLUMNAR_MAX_FRAMES ||
+            e->offset + columnar_chunk_size(e->frames, r->channels) > r->file_size)
+        {
+            ESP_LOGW(TAG, "Directory record at offset %lu does not match the file, scanning from there",
+                     (unsigned long)e->offset);
+            break;
+        }
+        *offset = e->offset;
+        *frames = e->frames;
+        return true;
+    }
+    if (r->dir)
+    {
+        fclose(r->dir);
+        r->dir = NULL;
+    }
+    return false;
+}
+
+/**
+ * @brief Finds the next chunk by reading its header at the end of the previous one.
+ * @return bool True if a complete chunk was found.
+ */
+static bool next_by_scan(columnar_reader_t *r, uint32_t *offset, uint32_t *frames)
+{
+    columnar_chunk_header_t hdr;
+    if (r->next_offset + sizeof(hdr) > r->file_size || !read_at(r, r->next_offset, &hdr, sizeof(hdr)))
+    {
+        return false;
+    }
+    if (hdr.magic != COLUMNAR_CHUNK_MAGIC || hdr.frames == 0 || hdr.frames > COLUMNAR_MAX_FRAMES ||
+        r->next_offset + columnar_chunk_size(hdr.frames, r->channels) > r->file_size)
+    {
+        return false; // Torn or missing last chunk.
+    }
+    *offset = r->next_offset;
+    *frames = hdr.frames;
+    return true;
+}
+
+// --- Public Function Implementations ---
+
+bool columnar_is_file(const char *path)
+{
+    size_t len = path ? strlen(path) : 0;
+    size_t ext_len = strlen(COLUMNAR_EXTENSION);
+    return len > ext_len && strcmp(path + len - ext_len, COLUMNAR_EXTENSION) == 0;
+}
+
+esp_err_t columnar_dir_path(const char *log_path, char *out, size_t out_len)
+{
+    int len = snprintf(out, out_len, "%s" COLUMNAR_DIR_SUFFIX, log_path);
+    if (len < 0 || (size_t)len >= out_len)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t columnar_parse_channels(const char *list, uint32_t *out_mask)
+{
+    uint32_t mask = 0;
+    const char *p = list;
+    while (p && *p)
+    {
+        char *end;
+        long ch = strtol(p, &end, 10);
+        if (end == p || ch < 0 || ch >= COLUMNAR_MAX_CHANNELS || (*end != ',' && *end != '\0'))
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        mask |= 1u << ch;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    if (mask == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *out_mask = mask;
+    return ESP_OK;
+}
+
+esp_err_t columnar_extract_csv(const char *log_path, uint32_t channel_mask, columnar_emit_cb_t emit,
+                               void *ctx, columnar_extract_stats_t *stats)
+{
+    columnar_extract_stats_t local_stats = {0};
+    struct stat st;
+    if (stat(log_path, &st) != 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    columnar_reader_t *r = calloc(1, sizeof(columnar_reader_t));
+    uint32_t *timestamps = malloc(COLUMNAR_MAX_FRAMES * sizeof(uint32_t));
+    float *column = malloc(COLUMNAR_MAX_CHANNELS * COLUMNAR_MAX_FRAMES * sizeof(float));
+    char *out = malloc(COLUMNAR_OUT_BUFFER_SIZE);
+    if (!r || !timestamps || !column || !out)
+    {
+        free(r);
+        free(timestamps);
+        free(column);
+        free(out);
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = ESP_OK;
+    r->file_size = (uint32_t)st.st_size;
+    r->file = fopen(log_path, "rb");
+    columnar_file_header_t fh;
+    if (!r->file)
+    {
+        ret = ESP_ERR_NOT_FOUND;
+        goto cleanup;
+    }
+    if (!read_at(r, 0, &fh, sizeof(fh)) || memcmp(fh.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) != 0 ||
+        fh.version != COLUMNAR_VERSION || fh.channels == 0 || fh.channels > COLUMNAR_MAX_CHANNELS)
+    {
+        ret = ESP_ERR_INVALID_VERSION;
+        goto cleanup;
+    }
+    if (channel_mask >> fh.channels)
+    {
+        ret = ESP_ERR_INVALID_ARG;
+        goto cleanup;
+    }
+    r->channels = fh.channels;
+    r->next_offset = sizeof(fh);
+
+    char dir_path[256];
+    if (columnar_dir_path(log_path, dir_path, sizeof(dir_path)) == ESP_OK)
+    {
+        r->dir = fopen(dir_path, "rb"); // Optional; without it every chunk header is read.
+    }
+
+    // CSV header with the selected columns only.
+    size_t pos = snprintf(out, COLUMNAR_OUT_BUFFER_SIZE, "timestamp");
+    for (uint32_t c = 0; c < r->channels; c++)
+    {
+        if (channel_mask & (1u << c))
+            pos += snprintf(out + pos, COLUMNAR_OUT_BUFFER_SIZE - pos, ";adc%lu", (unsigned long)c);
+    }
+    out[pos++] = '\n';
+
+    uint32_t offset, frames;
+    while (ret == ESP_OK)
+    {
+        if (next_from_dir(r, &offset, &frames))
+        {
+            local_stats.indexed++;
+        }
+        else if (!next_by_scan(r, &offset, &frames))
+        {
+            break;
+        }
+        r->next_offset = offset + columnar_chunk_size(frames, r->channels);
+
+        // Timestamp block, then one seek and read per selected column.
+        uint32_t block = frames * sizeof(uint32_t);
+        uint32_t data = offset + sizeof(columnar_chunk_header_t);
+        if (!read_at(r, data, timestamps, block))
+        {
+            break;
+        }
+        bool ok = true;
+        for (uint32_t c = 0; c < r->channels && ok; c++)
+        {
+            if (channel_mask & (1u << c))
+                ok = read_at(r, data + block * (1 + c), column + c * COLUMNAR_MAX_FRAMES, block);
+        }
+        if (!ok)
+        {
+            break;
+        }
+
+        for (uint32_t f = 0; f < frames && ret == ESP_OK; f++)
+        {
+            pos += snprintf(out + pos, COLUMNAR_OUT_BUFFER_SIZE - pos, "%lu", (unsigned long)timestamps[f]);
+            for (uint32_t c = 0; c < r->channels; c++)
+            {
+                if (channel_mask & (1u << c))
+                    pos += snprintf(out + pos, COLUMNAR_OUT_BUFFER_SIZE - pos, ";%.6f", column[c * COLUMNAR_MAX_FRAMES + f]);
+            }
+            out[pos++] = '\n';
+            if (pos > COLUMNAR_OUT_BUFFER_SIZE - COLUMNAR_ROW_MAX)
+            {
+                ret = emit(out, pos, ctx);
+                pos = 0;
+            }
+        }
+        local_stats.chunks++;
+        local_stats.frames += frames;
+    }
+    if (ret == ESP_OK && pos > 0)
+    {
+        ret = emit(out, pos, ctx);
+    }
+
+cleanup:
+    if (r->dir)
+        fclose(r->dir);
+    if (r->file)
+        fclose(r->file);
+    local_stats.bytes_read = r->io.bytes;
+    local_stats.throttled = r->io.throttled;
+    local_stats.file_size = r->file_size;
+    if (stats)
+        *stats = local_stats;
+    free(r);
+    free(timestamps);
+    free(column);
+    free(out);
+    return ret;
+}
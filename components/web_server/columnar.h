@@ -0,0 +1,139 @@
+// columnar.h
+// This header defines the columnar chunked log format and its reader.
+// A columnar log (".col") starts with a file header followed by chunks, each covering a fixed
+// time span. Inside a chunk, the timestamps of all frames come first, then the values of
+// channel 0 for all frames, then channel 1, and so on. Extracting one channel therefore reads
+// the timestamp block and one column block per chunk (2/9 of the file with 8 channels).
+// When logging ends, the chunk offsets are written to a directory sidecar "<log file>.dir";
+// chunks not covered by the directory (e.g. after a power loss) are found by scanning chunk headers.
+// All fields are little-endian.
+
+#ifndef COLUMNAR_H_
+#define COLUMNAR_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COLUMNAR_EXTENSION ".col"      ///< Extension of columnar log files.
+#define COLUMNAR_DIR_SUFFIX ".dir"     ///< Suffix appended to a log file's path to get its directory sidecar.
+#define COLUMNAR_MAGIC "ADSCOL1"       ///< File magic (8 bytes including the null terminator).
+#define COLUMNAR_VERSION 1             ///< Format version written to the file header.
+#define COLUMNAR_CHUNK_MAGIC 0x4B4E4843 ///< "CHNK" as a little-endian uint32.
+#define COLUMNAR_MAX_CHANNELS 8        ///< Largest number of channels in a file.
+#define COLUMNAR_MAX_FRAMES 256        ///< Largest number of frames in one chunk.
+
+/**
+ * @struct columnar_file_header_t
+ * @brief File header (32 bytes, no padding).
+ */
+typedef struct __attribute__((packed)) {
+    char magic[8];         ///< COLUMNAR_MAGIC.
+    uint16_t version;      ///< COLUMNAR_VERSION.
+    uint16_t channels;     ///< Number of channel columns per chunk.
+    uint32_t chunk_ms;     ///< Nominal time span of one chunk.
+    int64_t start_epoch;   ///< System clock at the start of the file (seconds, 0 if not set).
+    uint32_t reserved[2];  ///< Zero.
+} columnar_file_header_t;
+
+/**
+ * @struct columnar_chunk_header_t
+ * @brief Chunk header (16 bytes, no padding), followed by uint32 timestamp_ms[frames] and
+ * float value[channels][frames].
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;        ///< COLUMNAR_CHUNK_MAGIC.
+    uint32_t index;        ///< Chunk number, counting from 0.
+    uint32_t frames;       ///< Number of frames in the chunk (1 to COLUMNAR_MAX_FRAMES).
+    uint32_t reserved;     ///< Zero.
+} columnar_chunk_header_t;
+
+/**
+ * @struct columnar_dir_entry_t
+ * @brief One record of the directory sidecar (16 bytes, no padding).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t offset;       ///< Offset of the chunk header in the log file.
+    uint32_t frames;       ///< Number of frames in the chunk.
+    uint32_t t_first_ms;   ///< Timestamp of the first frame.
+    uint32_t t_last_ms;    ///< Timestamp of the last frame.
+} columnar_dir_entry_t;
+
+/**
+ * @struct columnar_extract_stats_t
+ * @brief Statistics of one extraction.
+ */
+typedef struct {
+    uint32_t chunks;       ///< Chunks extracted.
+    uint32_t frames;       ///< Rows emitted.
+    uint32_t indexed;      ///< Chunks located through the directory sidecar (the rest were scanned).
+    uint32_t bytes_read;   ///< Bytes read from the card.
+    uint32_t file_size;    ///< Size of the log file.
+    uint32_t throttled;    ///< Number of times the reads were paused for the log writer.
+} columnar_extract_stats_t;
+
+/**
+ * @brief Callback receiving the CSV output of an extraction.
+ * @param data CSV text.
+ * @param len Length of the text in bytes.
+ * @param ctx User context.
+ * @return esp_err_t ESP_OK to continue, any other value aborts the extraction.
+ */
+typedef esp_err_t (*columnar_emit_cb_t)(const char *data, size_t len, void *ctx);
+
+/**
+ * @brief Returns the size in bytes of a chunk (header, timestamps and all columns).
+ */
+static inline size_t columnar_chunk_size(uint32_t frames, uint32_t channels)
+{
+    return sizeof(columnar_chunk_header_t) + (size_t)frames * sizeof(uint32_t) * (1 + channels);
+}
+
+/**
+ * @brief Checks whether a file name has the columnar extension.
+ */
+bool columnar_is_file(const char *path);
+
+/**
+ * @brief Builds the directory sidecar path for a columnar log file.
+ * @param log_path Path of the log file.
+ * @param out Buffer receiving the sidecar path.
+ * @param out_len Length of the out buffer.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if the buffer is too small.
+ */
+esp_err_t columnar_dir_path(const char *log_path, char *out, size_t out_len);
+
+/**
+ * @brief Parses a comma separated channel list (e.g. "2,5") into a bit mask.
+ * @param list Channel list.
+ * @param out_mask Receives the mask (bit N = channel N).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for an empty list or a channel out of range.
+ */
+esp_err_t columnar_parse_channels(const char *list, uint32_t *out_mask);
+
+/**
+ * @brief Streams the selected channels of a columnar log as CSV ("timestamp;adcN;...").
+ * Only the timestamp block and the selected column blocks of each chunk are read.
+ * Reads go through the SD I/O scheduler, so a running log writer has priority.
+ * @param log_path Full path of the columnar log file.
+ * @param channel_mask Channels to extract (bit N = channel N).
+ * @param emit Callback receiving the CSV text in pieces.
+ * @param ctx User context passed to emit.
+ * @param stats Receives the extraction statistics, or NULL.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the file cannot be opened,
+ *         ESP_ERR_INVALID_VERSION if it is not a columnar log, ESP_ERR_INVALID_ARG if a selected
+ *         channel is not in the file, ESP_ERR_NO_MEM, or the error returned by emit.
+ */
+esp_err_t columnar_extract_csv(const char *log_path, uint32_t channel_mask, columnar_emit_cb_t emit,
+                               void *ctx, columnar_extract_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLUMNAR_H_ */
@@ -0,0 +1,39 @@
+// conn_budget.c
+// This file implements the budget of long-lived HTTP connections: one counter under a spinlock,
+// taken by the HTTP task when a stream or follow starts and returned by whichever task ends it.
+
+#include "conn_budget.h"
+#include "freertos/FreeRTOS.h" // For the spinlock
+
+// --- Static Variables ---
+static portMUX_TYPE budget_lock = portMUX_INITIALIZER_UNLOCKED; // Protects in_use.
+static uint32_t in_use = 0;                                     // Places taken.
+
+// --- Public Function Implementations ---
+
+bool conn_budget_take(void)
+{
+    bool taken;
+    portENTER_CRITICAL(&budget_lock);
+    taken = in_use < CONN_BUDGET_LONG_LIVED;
+    if (taken)
+        in_use++;
+    portEXIT_CRITICAL(&budget_lock);
+    return taken;
+}
+
+void conn_budget_give(void)
+{
+    portENTER_CRITICAL(&budget_lock);
+    if (in_use > 0)
+        in_use--;
+    portEXIT_CRITICAL(&budget_lock);
+}
+
+uint32_t conn_budget_in_use(void)
+{
+    portENTER_CRITICAL(&budget_lock);
+    uint32_t n = in_use;
+    portEXIT_CRITICAL(&budget_lock);
+    return n;
+}
@@ -0,0 +1,43 @@
+// conn_budget.h
+// This header defines the public API for the budget of long-lived HTTP connections.
+// Live streams, followers of the active log file and a running /api/verify or /api/capture keep
+// their server socket for as long as the client stays connected (or the check or burst runs). All of them take their
+// place from this one budget, so together they never hold more than CONN_BUDGET_LONG_LIVED
+// sockets, and the server (configured with CONN_BUDGET_SOCKETS) always has CONN_BUDGET_CLIENTS
+// left for pages, /adc and the API.
+
+#ifndef CONN_BUDGET_H_
+#define CONN_BUDGET_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONN_BUDGET_LONG_LIVED 4   ///< Sockets that streams and followers may hold together.
+#define CONN_BUDGET_CLIENTS 6      ///< Sockets always left for ordinary requests.
+#define CONN_BUDGET_SOCKETS (CONN_BUDGET_LONG_LIVED + CONN_BUDGET_CLIENTS) ///< The server's max_open_sockets.
+
+/**
+ * @brief Takes a place for a long-lived connection. Never blocks.
+ * @return bool True if a place was taken; it must be returned with conn_budget_give().
+ */
+bool conn_budget_take(void);
+
+/**
+ * @brief Returns a place taken with conn_budget_take().
+ */
+void conn_budget_give(void);
+
+/**
+ * @brief Returns the number of long-lived connections currently open.
+ */
+uint32_t conn_budget_in_use(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONN_BUDGET_H_ */
@@ -0,0 +1,420 @@
+// file_catalog.c
+// Implements the in-memory catalog of files on the SD card. Every /list request used to
+// re-run opendir/readdir over the FAT volume, which costs SPI sector reads that compete
+// with the log writer. The catalog is scanned once at mount and then updated incrementally.
+
+#include "file_catalog.h"
+#include <stdio.h>             // For snprintf
+#include <string.h>            // For strncpy, strcmp, strlen, memcpy
+#include <stdlib.h>            // For atoi
+#include <dirent.h>            // For opendir, readdir, closedir
+#include <sys/stat.h>          // For stat
+#include <errno.h>             // For errno
+#include "esp_log.h"           // For ESP-IDF logging
+#include "esp_timer.h"         // For esp_timer_get_time (scan duration)
+#include "esp_heap_caps.h"     // For PSRAM-preferring allocations
+#include "freertos/FreeRTOS.h" // FreeRTOS base
+#include "freertos/semphr.h"   // For the catalog mutex
+
+// --- Module Constants ---
+static const char *TAG = "file_catalog";
+#define CATALOG_INITIAL_CAPACITY 32 // Number of entries allocated on the first insertion.
+#define CATALOG_PATH_MAX 256        // Maximum length of a full path (mount point + name).
+#define CATALOG_MAX_DEPTH 3         // Deepest directory level scanned (YYYY/MM/DD for the date-partitioned layout).
+
+// --- Module State ---
+static SemaphoreHandle_t catalog_mutex = NULL;  // Protects all fields below.
+static file_catalog_entry_t *entries = NULL;    // Dynamic array of catalog entries.
+static size_t entry_count = 0;                  // Number of used entries.
+static size_t entry_capacity = 0;               // Number of allocated entries.
+static size_t last_hit = 0;                     // Index of the last looked-up entry (the log writer updates the same file repeatedly).
+static bool catalog_ready = false;              // True after a successful scan.
+static uint32_t last_scan_ms = 0;               // Duration of the last full scan.
+static char mount_prefix[32] = "";              // Mount point, used to strip full paths to relative names.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Converts a full path under the mount point into a name relative to it.
+ * Names that are already relative are returned unchanged.
+ */
+static const char *relative_name(const char *name)
+{
+    size_t prefix_len = strlen(mount_prefix);
+    if (prefix_len > 0 && strncmp(name, mount_prefix, prefix_len) == 0 && name[prefix_len] == '/')
+    {
+        return name + prefix_len + 1;
+    }
+    return name;
+}
+
+/**
+ * @brief Allocates an array for entries, preferring PSRAM so large catalogs do not use internal RAM.
+ */
+static file_catalog_entry_t *alloc_entries(file_catalog_entry_t *old, size_t capacity)
+{
+    return heap_caps_realloc_prefer(old, capacity * sizeof(file_catalog_entry_t), 2,
+                                    MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+}
+
+/**
+ * @brief Finds the index of an entry by name. Must be called with the mutex held.
+ * @return The index, or -1 if the name is not in the catalog.
+ */
+static int find_locked(const char *name)
+{
+    if (last_hit < entry_count && strcmp(entries[last_hit].name, name) == 0)
+    {
+        return (int)last_hit;
+    }
+    for (size_t i = 0; i < entry_count; i++)
+    {
+        if (strcmp(entries[i].name, name) == 0)
+        {
+            last_hit = i;
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Scratch state for a (recursive) scan, kept separate from the shared catalog.
+ */
+typedef struct {
+    file_catalog_entry_t *list; // Entries found so far.
+    size_t count;               // Number of used entries.
+    size_t capacity;            // Number of allocated entries.
+    bool truncated;             // Set when the scan ran out of memory.
+} scan_ctx_t;
+
+/**
+ * @brief Reads one directory (and its subdirectories) into the scan context.
+ * Subdirectories are needed for the date-partitioned log layout (YYYY/MM/DD).
+ * @param rel_dir Directory relative to the mount point ("" for the root).
+ * @param depth Remaining recursion depth.
+ */
+static esp_err_t scan_directory(scan_ctx_t *ctx, const char *rel_dir, int depth)
+{
+    char path[CATALOG_PATH_MAX];
+    if (rel_dir[0])
+    {
+        snprintf(path, sizeof(path), "%s/%s", mount_prefix, rel_dir);
+    }
+    else
+    {
+        snprintf(path, sizeof(path), "%s", mount_prefix);
+    }
+
+    DIR *dir = opendir(path);
+    if (!dir)
+    {
+        ESP_LOGE(TAG, "Failed to open directory %s (%s)", path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    char rel_name[FILE_CATALOG_NAME_MAX];
+    struct dirent *entry;
+    struct stat st;
+
+    while (!ctx->truncated && (entry = readdir(dir)) != NULL)
+    {
+        if (rel_dir[0])
+        {
+            snprintf(rel_name, sizeof(rel_name), "%s/%s", rel_dir, entry->d_name);
+        }
+        else
+        {
+            snprintf(rel_name, sizeof(rel_name), "%s", entry->d_name);
+        }
+
+        if (entry->d_type == DT_DIR)
+        {
+            // Descend into log directories, but not into FAT system folders.
+            if (depth > 0 && entry->d_name[0] != '.' && strcmp(entry->d_name, "System Volume Information") != 0)
+            {
+                scan_directory(ctx, rel_name, depth - 1);
+            }
+            continue;
+        }
+        if (entry->d_type != DT_REG)
+        {
+            continue; // Only regular files are catalogued.
+        }
+        if (ctx->count == ctx->capacity)
+        {
+            size_t new_capacity = ctx->capacity ? ctx->capacity * 2 : CATALOG_INITIAL_CAPACITY;
+            file_catalog_entry_t *grown = alloc_entries(ctx->list, new_capacity);
+            if (!grown)
+            {
+                ESP_LOGE(TAG, "Out of memory while scanning, stopped at %u files", (unsigned)ctx->count);
+                ctx->truncated = true;
+                break;
+            }
+            ctx->list = grown;
+            ctx->capacity = new_capacity;
+        }
+
+        file_catalog_entry_t *e = &ctx->list[ctx->count];
+        strncpy(e->name, rel_name, FILE_CATALOG_NAME_MAX - 1);
+        e->name[FILE_CATALOG_NAME_MAX - 1] = '\0';
+        snprintf(path, sizeof(path), "%s/%s", mount_prefix, rel_name);
+        if (stat(path, &st) == 0)
+        {
+            e->size = (uint32_t)st.st_size;
+            e->mtime = st.st_mtime;
+        }
+        else
+        {
+            e->size = 0;
+            e->mtime = 0;
+        }
+        ctx->count++;
+    }
+    closedir(dir);
+    return ESP_OK;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t file_catalog_init(const char *mount_point)
+{
+    if (!mount_point)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (catalog_mutex == NULL)
+    {
+        catalog_mutex = xSemaphoreCreateMutex();
+        if (catalog_mutex == NULL)
+        {
+            ESP_LOGE(TAG, "Failed to create catalog mutex!");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    strncpy(mount_prefix, mount_point, sizeof(mount_prefix) - 1);
+    mount_prefix[sizeof(mount_prefix) - 1] = '\0';
+    return file_catalog_rescan();
+}
+
+bool file_catalog_is_ready(void)
+{
+    return catalog_ready;
+}
+
+esp_err_t file_catalog_rescan(void)
+{
+    if (catalog_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // The directory is read without holding the lock, so the log writer can keep
+    // updating its entry while a (potentially slow) scan of a large card runs.
+    int64_t start_us = esp_timer_get_time();
+    scan_ctx_t ctx = {0};
+    esp_err_t err = scan_directory(&ctx, "", CATALOG_MAX_DEPTH);
+    uint32_t elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+    if (err == ESP_OK && ctx.truncated)
+    {
+        // A partial list would make missing files look deleted and give out taken indexes,
+        // so the previous state (not ready after the initial scan) is kept instead.
+        err = ESP_ERR_NO_MEM;
+    }
+    if (err != ESP_OK)
+    {
+        heap_caps_free(ctx.list);
+        return err;
+    }
+    size_t count = ctx.count;
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    file_catalog_entry_t *old = entries;
+    entries = ctx.list;
+    entry_count = ctx.count;
+    entry_capacity = ctx.capacity;
+    last_hit = 0;
+    catalog_ready = true;
+    last_scan_ms = elapsed_ms;
+    xSemaphoreGive(catalog_mutex);
+
+    heap_caps_free(old);
+    ESP_LOGI(TAG, "Catalog built: %u files in %lu ms", (unsigned)count, (unsigned long)elapsed_ms);
+    return ESP_OK;
+}
+
+esp_err_t file_catalog_upsert(const char *name, uint32_t size, time_t mtime)
+{
+    if (!name || catalog_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    const char *rel = relative_name(name);
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    int idx = find_locked(rel);
+    if (idx < 0)
+    {
+        if (entry_count == entry_capacity)
+        {
+            size_t new_capacity = entry_capacity ? entry_capacity * 2 : CATALOG_INITIAL_CAPACITY;
+            file_catalog_entry_t *grown = alloc_entries(entries, new_capacity);
+            if (!grown)
+            {
+                xSemaphoreGive(catalog_mutex);
+                ESP_LOGE(TAG, "Out of memory adding '%s' to the catalog", rel);
+                return ESP_ERR_NO_MEM;
+            }
+            entries = grown;
+            entry_capacity = new_capacity;
+        }
+        idx = (int)entry_count++;
+        strncpy(entries[idx].name, rel, FILE_CATALOG_NAME_MAX - 1);
+        entries[idx].name[FILE_CATALOG_NAME_MAX - 1] = '\0';
+        last_hit = (size_t)idx;
+    }
+    entries[idx].size = size;
+    entries[idx].mtime = mtime;
+    xSemaphoreGive(catalog_mutex);
+    return ESP_OK;
+}
+
+esp_err_t file_catalog_refresh(const char *name)
+{
+    if (!name)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *rel = relative_name(name);
+    char path[CATALOG_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", mount_prefix, rel);
+
+    struct stat st;
+    if (stat(path, &st) != 0)
+    {
+        file_catalog_remove(rel);
+        return ESP_ERR_NOT_FOUND;
+    }
+    return file_catalog_upsert(rel, (uint32_t)st.st_size, st.st_mtime);
+}
+
+void file_catalog_remove(const char *name)
+{
+    if (!name || catalog_mutex == NULL)
+    {
+        return;
+    }
+    const char *rel = relative_name(name);
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    int idx = find_locked(rel);
+    if (idx >= 0)
+    {
+        // Order is not significant, so the last entry simply takes the freed slot.
+        entry_count--;
+        if ((size_t)idx != entry_count)
+        {
+            memcpy(&entries[idx], &entries[entry_count], sizeof(file_catalog_entry_t));
+        }
+        last_hit = 0;
+    }
+    xSemaphoreGive(catalog_mutex);
+}
+
+bool file_catalog_contains(const char *name)
+{
+    if (!name || catalog_mutex == NULL)
+    {
+        return false;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    bool found = find_locked(relative_name(name)) >= 0;
+    xSemaphoreGive(catalog_mutex);
+    return found;
+}
+
+size_t file_catalog_count(void)
+{
+    if (catalog_mutex == NULL)
+    {
+        return 0;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    size_t count = entry_count;
+    xSemaphoreGive(catalog_mutex);
+    return count;
+}
+
+size_t file_catalog_snapshot(file_catalog_entry_t **out_entries)
+{
+    *out_entries = NULL;
+    if (catalog_mutex == NULL)
+    {
+        return 0;
+    }
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    size_t count = entry_count;
+    if (count > 0)
+    {
+        *out_entries = heap_caps_malloc_prefer(count * sizeof(file_catalog_entry_t), 2,
+                                               MALLOC_CAP_SPIRAM, MALLOC_CAP_DEFAULT);
+        if (*out_entries)
+        {
+            memcpy(*out_entries, entries, count * sizeof(file_catalog_entry_t));
+        }
+        else
+        {
+            count = 0;
+        }
+    }
+    xSemaphoreGive(catalog_mutex);
+    return count;
+}
+
+int file_catalog_max_index(const char *dir, const char *stem)
+{
+    if (!dir || !stem || catalog_mutex == NULL)
+    {
+        return -1;
+    }
+    const char *rel_dir = relative_name(dir);
+    size_t dir_len = strlen(rel_dir);
+    size_t stem_len = strlen(stem);
+    int max_index = 0;
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < entry_count; i++)
+    {
+        const char *name = entries[i].name;
+        // The entry must live directly in 'dir' ...
+        if (dir_len > 0)
+        {
+            if (strncmp(name, rel_dir, dir_len) != 0 || name[dir_len] != '/')
+            {
+                continue;
+            }
+            name += dir_len + 1;
+        }
+        if (strchr(name, '/') != NULL)
+        {
+            continue;
+        }
+        // ... and be named <stem><N>.<ext>.
+        if (strncmp(name, stem, stem_len) != 0)
+        {
+            continue;
+        }
+        int index = atoi(name + stem_len);
+        if (index > max_index)
+        {
+            max_index = index;
+        }
+    }
+    xSemaphoreGive(catalog_mutex);
+    return max_index;
+}
+
+uint32_t file_catalog_last_scan_ms(void)
+{
+    return last_scan_ms;
+}
@@ -0,0 +1,125 @@
+// file_catalog.h
+// This header defines the public API for the in-memory catalog of files on the SD card.
+// The catalog is built once when the card is mounted and then kept up to date by the
+// components that create, grow or remove files (log writer, upload and delete handlers),
+// so the web interface can list the card contents without touching the FAT volume.
+
+#ifndef FILE_CATALOG_H_
+#define FILE_CATALOG_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include <time.h>      // For time_t
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def FILE_CATALOG_NAME_MAX
+ * @brief Maximum length (including null terminator) of a file name stored in the catalog.
+ * Names are stored relative to the mount point and may contain directories
+ * (e.g. "2025/06/30/session_1.csv"). The limit matches the 128 character
+ * file name limit enforced by the upload handler.
+ */
+#define FILE_CATALOG_NAME_MAX 129
+
+/**
+ * @struct file_catalog_entry_t
+ * @brief Describes a single regular file on the SD card.
+ */
+typedef struct {
+    char name[FILE_CATALOG_NAME_MAX]; ///< File name relative to the mount point (e.g. "log_1.csv").
+    uint32_t size;                    ///< File size in bytes as last reported to the catalog.
+    time_t mtime;                     ///< Last modification time.
+} file_catalog_entry_t;
+
+/**
+ * @brief Initializes the catalog and performs the initial scan of the mount point.
+ * Must be called once after the SD card has been mounted successfully.
+ * @param mount_point Mount point of the SD card (e.g. "/sdcard").
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the card holds more files than fit in
+ *         memory (the catalog then stays not ready), or an error code if the directory could not be scanned.
+ */
+esp_err_t file_catalog_init(const char *mount_point);
+
+/**
+ * @brief Checks whether the catalog holds a valid view of the card.
+ * @return bool True after a successful scan, false if the card was never scanned.
+ */
+bool file_catalog_is_ready(void);
+
+/**
+ * @brief Discards the catalog and rebuilds it from the card.
+ * Intended for manual card changes (files added or removed outside of the firmware).
+ * If the scan fails or runs out of memory, the previous catalog is kept.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the files did not fit in memory,
+ *         or an error code if the directory could not be scanned.
+ */
+esp_err_t file_catalog_rescan(void);
+
+/**
+ * @brief Adds a file to the catalog or updates an existing entry.
+ * @param name File name, either relative to the mount point or a full path under it.
+ * @param size Current file size in bytes.
+ * @param mtime Last modification time.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the catalog could not grow.
+ */
+esp_err_t file_catalog_upsert(const char *name, uint32_t size, time_t mtime);
+
+/**
+ * @brief Re-reads a single file's metadata from the card and updates the catalog.
+ * If the file no longer exists, it is removed from the catalog.
+ * @param name File name, either relative to the mount point or a full path under it.
+ * @return esp_err_t ESP_OK if the file exists and was updated, ESP_ERR_NOT_FOUND if it was removed.
+ */
+esp_err_t file_catalog_refresh(const char *name);
+
+/**
+ * @brief Removes a file from the catalog (does not touch the card).
+ * @param name File name, either relative to the mount point or a full path under it.
+ */
+void file_catalog_remove(const char *name);
+
+/**
+ * @brief Checks whether a file is present in the catalog.
+ * @param name File name, either relative to the mount point or a full path under it.
+ * @return bool True if the file is known to the catalog.
+ */
+bool file_catalog_contains(const char *name);
+
+/**
+ * @brief Returns the number of files currently in the catalog.
+ */
+size_t file_catalog_count(void);
+
+/**
+ * @brief Copies the catalog into a newly allocated array.
+ * The copy lets callers format long responses without holding the catalog lock,
+ * so the log writer is never blocked by a slow HTTP client.
+ * @param out_entries Receives the allocated array (NULL if the catalog is empty). Free with free().
+ * @return size_t Number of entries in the returned array.
+ */
+size_t file_catalog_snapshot(file_catalog_entry_t **out_entries);
+
+/**
+ * @brief Finds the highest index N among files named <stem><N>.<ext> directly inside a directory.
+ * Used by the log writer to pick the next free file name without probing the card with fopen().
+ * @param dir Directory relative to the mount point ("" for the root) or a full path under it.
+ * @param stem File name prefix before the index (e.g. "log_" or "session_").
+ * @return int The highest index found, 0 if there is none, or -1 if the catalog is not initialized.
+ */
+int file_catalog_max_index(const char *dir, const char *stem);
+
+/**
+ * @brief Returns the duration of the last full scan in milliseconds.
+ */
+uint32_t file_catalog_last_scan_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FILE_CATALOG_H_ */
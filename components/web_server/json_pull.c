@@ -0,0 +1,471 @@
+// json_pull.c
+// This file implements the streaming (pull) JSON parser.
+// Bytes are taken from a fixed window that is refilled from the socket when it runs empty, so
+// a body of any length passes through the same JSON_PULL_WINDOW bytes. A small state word says
+// what the grammar allows next (a value, a key, a comma or a closing bracket), and a stack of
+// one byte per open container replaces the tree a DOM parser would build. Strings are unescaped
+// into a fixed buffer as they are read; numbers are collected and converted with strtod.
+
+#include "json_pull.h"
+#include <stdlib.h>            // For strtod
+#include <string.h>            // For memcpy
+#include "esp_log.h"           // For ESP_LOGx macros
+
+// --- Module Constants ---
+static const char *TAG = "json_pull";
+
+#define JSON_PULL_EOF (-1)       // get_char() at the end of the body or after an error.
+#define JSON_NUMBER_MAX 32       // Longest number literal accepted.
+
+/**
+ * @enum expect_t
+ * @brief What the grammar allows at the current position.
+ */
+typedef enum {
+    EXPECT_VALUE = 0,          // At the start, after ':' and after ',' in an array.
+    EXPECT_VALUE_OR_CLOSE,     // After '['.
+    EXPECT_KEY_OR_CLOSE,       // After '{'.
+    EXPECT_KEY,                // After ',' in an object.
+    EXPECT_COMMA_OR_CLOSE,     // After a value inside a container.
+    EXPECT_EOF,                // After the top-level value.
+    EXPECT_DONE,               // JSON_TOK_END or JSON_TOK_ERROR was returned.
+} expect_t;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Records the first error and stops the parser.
+ */
+static json_tok_t fail(json_pull_t *p, esp_err_t err)
+{
+    if (p->err == ESP_OK)
+        p->err = err;
+    p->expect = EXPECT_DONE;
+    return JSON_TOK_ERROR;
+}
+
+/**
+ * @brief Refills the window from the socket.
+ * @return bool False at the end of the body or on a receive error (recorded in p->err).
+ */
+static bool refill(json_pull_t *p)
+{
+    if (p->remaining == 0 || p->err != ESP_OK)
+        return false;
+    size_t want = p->remaining < sizeof(p->window) ? p->remaining : sizeof(p->window);
+    int ret = httpd_req_recv(p->req, p->window, want);
+    if (ret <= 0)
+    {
+        p->err = ret == HTTPD_SOCK_ERR_TIMEOUT ? ESP_ERR_TIMEOUT : ESP_FAIL;
+        return false;
+    }
+    p->remaining -= (size_t)ret;
+    p->pos = 0;
+    p->len = (uint16_t)ret;
+    return true;
+}
+
+/**
+ * @brief Returns the next byte without consuming it, or JSON_PULL_EOF.
+ */
+static int peek_char(json_pull_t *p)
+{
+    if (p->pos == p->len && !refill(p))
+        return JSON_PULL_EOF;
+    return (unsigned char)p->window[p->pos];
+}
+
+/**
+ * @brief Consumes and returns the next byte, or JSON_PULL_EOF.
+ */
+static int get_char(json_pull_t *p)
+{
+    int c = peek_char(p);
+    if (c != JSON_PULL_EOF)
+        p->pos++;
+    return c;
+}
+
+/**
+ * @brief Consumes whitespace and returns the next byte (consumed), or JSON_PULL_EOF.
+ */
+static int next_nonspace(json_pull_t *p)
+{
+    int c;
+    do
+    {
+        c = get_char(p);
+    } while (c == ' ' || c == '\t' || c == '\n' || c == '\r');
+    return c;
+}
+
+/**
+ * @brief Sets the state after a complete value.
+ */
+static void value_done(json_pull_t *p)
+{
+    p->expect = p->depth == 0 ? EXPECT_EOF : EXPECT_COMMA_OR_CLOSE;
+}
+
+/**
+ * @brief Appends bytes to str, or marks it truncated if they do not all fit.
+ * A multi-byte UTF-8 character is therefore never cut in half.
+ */
+static void put_bytes(json_pull_t *p, size_t *n, const char *bytes, size_t count)
+{
+    if (p->truncated || *n + count > sizeof(p->str) - 1)
+    {
+        p->truncated = true;
+        return;
+    }
+    memcpy(p->str + *n, bytes, count);
+    *n += count;
+}
+
+/**
+ * @brief Reads four hex digits of a \u escape.
+ * @return long The code unit, or -1 if the digits are invalid.
+ */
+static long read_hex4(json_pull_t *p)
+{
+    long v = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        int c = get_char(p);
+        if (c >= '0' && c <= '9')
+            v = (v << 4) | (c - '0');
+        else if (c >= 'a' && c <= 'f')
+            v = (v << 4) | (c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            v = (v << 4) | (c - 'A' + 10);
+        else
+            return -1;
+    }
+    return v;
+}
+
+/**
+ * @brief Encodes a code point as UTF-8.
+ * @return size_t Number of bytes written to out (1-4).
+ */
+static size_t utf8_encode(unsigned long cp, char *out)
+{
+    if (cp < 0x80)
+    {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800)
+    {
+        out[0] = (char)(0xC0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000)
+    {
+        out[0] = (char)(0xE0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (char)(0xF0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+/**
+ * @brief Reads a string after its opening quote into str.
+ * @return bool False on a syntax or receive error.
+ */
+static bool read_string(json_pull_t *p)
+{
+    size_t n = 0;
+    p->truncated = false;
+
+    while (1)
+    {
+        int c = get_char(p);
+        if (c == JSON_PULL_EOF || c < 0x20)
+            return false; // Unterminated string or a raw control character
+        if (c == '"')
+            break;
+        if (c != '\\')
+        {
+            // Raw UTF-8 is copied through; a multi-byte character is kept whole or dropped.
+            char bytes[4] = {(char)c};
+            size_t count = 1;
+            if (c >= 0xC0)
+            {
+                size_t need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+                while (count < need && (peek_char(p) & 0xC0) == 0x80)
+                    bytes[count++] = (char)get_char(p);
+            }
+            put_bytes(p, &n, bytes, count);
+            continue;
+        }
+
+        char out[4];
+        size_t count = 1;
+        c = get_char(p);
+        switch (c)
+        {
+        case '"':
+        case '\\':
+        case '/':
+            out[0] = (char)c;
+            break;
+        case 'b': out[0] = '\b'; break;
+        case 'f': out[0] = '\f'; break;
+        case 'n': out[0] = '\n'; break;
+        case 'r': out[0] = '\r'; break;
+        case 't': out[0] = '\t'; break;
+        case 'u':
+        {
+            long cp = read_hex4(p);
+            if (cp < 0 || (cp >= 0xDC00 && cp <= 0xDFFF))
+                return false;
+            if (cp >= 0xD800 && cp <= 0xDBFF)
+            {
+                // A high surrogate must be followed by an escaped low surrogate.
+                if (get_char(p) != '\\' || get_char(p) != 'u')
+                    return false;
+                long low = read_hex4(p);
+                if (low < 0xDC00 || low > 0xDFFF)
+                    return false;
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+            }
+            count = utf8_encode((unsigned long)cp, out);
+            break;
+        }
+        default:
+            return false;
+        }
+        put_bytes(p, &n, out, count);
+    }
+    p->str[n] = '\0';
+    return true;
+}
+
+/**
+ * @brief Reads a number whose first character was c into number.
+ * @return bool False if the literal is not a valid number.
+ */
+static bool read_number(json_pull_t *p, int c)
+{
+    char text[JSON_NUMBER_MAX + 1];
+    size_t n = 0;
+    text[n++] = (char)c;
+    while (1)
+    {
+        c = peek_char(p);
+        if (!((c >= '0' && c <= '9') || c == '.' || c == 'e' || c == 'E' || c == '+' || c == '-'))
+            break;
+        if (n == JSON_NUMBER_MAX)
+            return false;
+        text[n++] = (char)get_char(p);
+    }
+    text[n] = '\0';
+    char *end = NULL;
+    p->number = strtod(text, &end);
+    return end == text + n;
+}
+
+/**
+ * @brief Reads the rest of a literal (true, false, null) whose first character was consumed.
+ * @return bool False if the literal does not match.
+ */
+static bool read_literal(json_pull_t *p, const char *rest)
+{
+    for (; *rest; rest++)
+    {
+        if (get_char(p) != *rest)
+            return false;
+    }
+    int c = peek_char(p);
+    return !((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'));
+}
+
+/**
+ * @brief Opens a container.
+ */
+static json_tok_t push(json_pull_t *p, json_tok_t kind)
+{
+    if (p->depth == JSON_PULL_DEPTH)
+        return fail(p, ESP_ERR_INVALID_SIZE);
+    p->stack[p->depth++] = (uint8_t)kind;
+    p->expect = kind == JSON_TOK_OBJECT ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+    return kind;
+}
+
+/**
+ * @brief Closes the innermost container.
+ */
+static json_tok_t pop(json_pull_t *p)
+{
+    json_tok_t kind = (json_tok_t)p->stack[--p->depth];
+    value_done(p);
+    return kind == JSON_TOK_OBJECT ? JSON_TOK_OBJECT_END : JSON_TOK_ARRAY_END;
+}
+
+/**
+ * @brief Reads a value whose first character was c.
+ */
+static json_tok_t read_value(json_pull_t *p, int c)
+{
+    switch (c)
+    {
+    case '{':
+        return push(p, JSON_TOK_OBJECT);
+    case '[':
+        return push(p, JSON_TOK_ARRAY);
+    case '"':
+        if (!read_string(p))
+            return fail(p, ESP_ERR_INVALID_ARG);
+        value_done(p);
+        return JSON_TOK_STRING;
+    case 't':
+        if (!read_literal(p, "rue"))
+            return fail(p, ESP_ERR_INVALID_ARG);
+        value_done(p);
+        return JSON_TOK_TRUE;
+    case 'f':
+        if (!read_literal(p, "alse"))
+            return fail(p, ESP_ERR_INVALID_ARG);
+        value_done(p);
+        return JSON_TOK_FALSE;
+    case 'n':
+        if (!read_literal(p, "ull"))
+            return fail(p, ESP_ERR_INVALID_ARG);
+        value_done(p);
+        return JSON_TOK_NULL;
+    default:
+        if (c == '-' || (c >= '0' && c <= '9'))
+        {
+            if (!read_number(p, c))
+                return fail(p, ESP_ERR_INVALID_ARG);
+            value_done(p);
+            return JSON_TOK_NUMBER;
+        }
+        return fail(p, ESP_ERR_INVALID_ARG);
+    }
+}
+
+/**
+ * @brief Reads a member name after its opening quote, and the colon after it.
+ */
+static json_tok_t read_key(json_pull_t *p)
+{
+    if (!read_string(p) || next_nonspace(p) != ':')
+        return fail(p, ESP_ERR_INVALID_ARG);
+    p->expect = EXPECT_VALUE;
+    return JSON_TOK_KEY;
+}
+
+// --- Public Function Implementations ---
+
+void json_pull_init(json_pull_t *p, httpd_req_t *req)
+{
+    p->req = req;
+    p->remaining = req->content_len;
+    p->pos = 0;
+    p->len = 0;
+    p->depth = 0;
+    p->expect = EXPECT_VALUE;
+    p->err = ESP_OK;
+    p->str[0] = '\0';
+    p->truncated = false;
+    p->number = 0;
+}
+
+json_tok_t json_pull_next(json_pull_t *p)
+{
+    while (1)
+    {
+        if (p->expect == EXPECT_DONE)
+            return p->err == ESP_OK ? JSON_TOK_END : JSON_TOK_ERROR;
+
+        int c = next_nonspace(p);
+        if (c == JSON_PULL_EOF && p->err != ESP_OK)
+            return fail(p, p->err); // Receive error
+
+        switch (p->expect)
+        {
+        case EXPECT_EOF:
+            if (c != JSON_PULL_EOF)
+                return fail(p, ESP_ERR_INVALID_ARG); // Data after the value
+            p->expect = EXPECT_DONE;
+            return JSON_TOK_END;
+
+        case EXPECT_COMMA_OR_CLOSE:
+        {
+            json_tok_t top = (json_tok_t)p->stack[p->depth - 1];
+            if (c == ',')
+            {
+                p->expect = top == JSON_TOK_OBJECT ? EXPECT_KEY : EXPECT_VALUE;
+                continue;
+            }
+            if ((c == '}' && top == JSON_TOK_OBJECT) || (c == ']' && top == JSON_TOK_ARRAY))
+                return pop(p);
+            return fail(p, ESP_ERR_INVALID_ARG);
+        }
+
+        case EXPECT_KEY_OR_CLOSE:
+            if (c == '}')
+                return pop(p);
+            // fall through
+        case EXPECT_KEY:
+            if (c != '"')
+                return fail(p, ESP_ERR_INVALID_ARG);
+            return read_key(p);
+
+        case EXPECT_VALUE_OR_CLOSE:
+            if (c == ']')
+                return pop(p);
+            // fall through
+        default:
+            return read_value(p, c);
+        }
+    }
+}
+
+esp_err_t json_pull_skip(json_pull_t *p, json_tok_t first)
+{
+    if (first == JSON_TOK_ERROR)
+        return p->err;
+    if (first != JSON_TOK_OBJECT && first != JSON_TOK_ARRAY)
+        return ESP_OK;
+    uint8_t depth = p->depth; // Depth with the skipped container open
+    while (p->depth >= depth)
+    {
+        if (json_pull_next(p) == JSON_TOK_ERROR)
+            return p->err;
+    }
+    return ESP_OK;
+}
+
+esp_err_t json_pull_error(const json_pull_t *p)
+{
+    return p->err;
+}
+
+esp_err_t json_pull_send_error(const json_pull_t *p, httpd_req_t *req)
+{
+    switch (p->err)
+    {
+    case ESP_ERR_TIMEOUT:
+        httpd_resp_send_408(req);
+        break;
+    case ESP_FAIL:
+        break; // The connection is gone
+    case ESP_ERR_INVALID_SIZE:
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON nested too deep");
+        break;
+    default:
+        ESP_LOGW(TAG, "Invalid JSON near byte %u", (unsigned)(p->req->content_len - p->remaining - (p->len - p->pos)));
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+        break;
+    }
+    return ESP_FAIL;
+}
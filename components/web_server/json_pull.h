@@ -0,0 +1,106 @@
+// json_pull.h
+// This header defines the public API for the streaming (pull) JSON parser.
+// The parser reads a request body straight from httpd_req_recv() through a small window and
+// returns one token at a time: container begin and end, keys, strings, numbers and literals.
+// The caller walks the tokens and fills its own typed structures, skipping what it does not
+// know. The whole state lives in one json_pull_t (on the caller's stack), so memory use is
+// fixed no matter how large the body is, and nothing is allocated.
+
+#ifndef JSON_PULL_H_
+#define JSON_PULL_H_
+
+#include <stdbool.h>          // For boolean type
+#include <stddef.h>           // For size_t
+#include <stdint.h>           // For fixed width integer types
+#include "esp_err.h"          // For esp_err_t
+#include "esp_http_server.h"  // For httpd_req_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JSON_PULL_WINDOW 256   ///< Bytes received from the socket at a time.
+#define JSON_PULL_STR_MAX 64   ///< Longest key or string kept (including null terminator); longer ones are truncated.
+#define JSON_PULL_DEPTH 16     ///< Deepest nesting of objects and arrays.
+
+/**
+ * @enum json_tok_t
+ * @brief Token returned by json_pull_next().
+ */
+typedef enum {
+    JSON_TOK_ERROR = 0,    ///< Syntax error, too deep nesting or a receive error (see json_pull_error()).
+    JSON_TOK_END,          ///< End of the body after one complete value.
+    JSON_TOK_OBJECT,       ///< '{'
+    JSON_TOK_OBJECT_END,   ///< '}'
+    JSON_TOK_ARRAY,        ///< '['
+    JSON_TOK_ARRAY_END,    ///< ']'
+    JSON_TOK_KEY,          ///< Object member name, in str.
+    JSON_TOK_STRING,       ///< String value, in str.
+    JSON_TOK_NUMBER,       ///< Number, in number.
+    JSON_TOK_TRUE,         ///< true
+    JSON_TOK_FALSE,        ///< false
+    JSON_TOK_NULL,         ///< null
+} json_tok_t;
+
+/**
+ * @struct json_pull_t
+ * @brief Parser state. Only str, truncated and number are meant to be read by the caller.
+ */
+typedef struct {
+    httpd_req_t *req;                 ///< Request the body is read from.
+    size_t remaining;                 ///< Body bytes not yet received.
+    char window[JSON_PULL_WINDOW];    ///< Received bytes.
+    uint16_t pos;                     ///< Next byte in window.
+    uint16_t len;                     ///< Valid bytes in window.
+    uint8_t stack[JSON_PULL_DEPTH];   ///< Open containers (JSON_TOK_OBJECT or JSON_TOK_ARRAY).
+    uint8_t depth;                    ///< Number of open containers.
+    uint8_t expect;                   ///< What the grammar allows next (internal).
+    esp_err_t err;                    ///< First error, ESP_OK if none.
+    char str[JSON_PULL_STR_MAX];      ///< Text of the last key or string token (UTF-8, unescaped).
+    bool truncated;                   ///< True if str was cut to fit.
+    double number;                    ///< Value of the last number token.
+} json_pull_t;
+
+/**
+ * @brief Prepares a parser for the body of a request.
+ * @param p Parser state.
+ * @param req Request whose body is parsed (content_len bytes).
+ */
+void json_pull_init(json_pull_t *p, httpd_req_t *req);
+
+/**
+ * @brief Returns the next token. After JSON_TOK_ERROR or JSON_TOK_END it keeps returning the same.
+ * @param p Parser state.
+ * @return json_tok_t The token.
+ */
+json_tok_t json_pull_next(json_pull_t *p);
+
+/**
+ * @brief Skips the rest of a value whose first token was just returned (e.g. an unknown member).
+ * For a scalar this does nothing; for an object or array it consumes up to the matching end.
+ * @param p Parser state.
+ * @param first First token of the value.
+ * @return esp_err_t ESP_OK on success, the parser error otherwise.
+ */
+esp_err_t json_pull_skip(json_pull_t *p, json_tok_t first);
+
+/**
+ * @brief Returns the first error: ESP_ERR_INVALID_ARG for a syntax error, ESP_ERR_INVALID_SIZE
+ * for too deep nesting, ESP_ERR_TIMEOUT or ESP_FAIL if the body could not be received,
+ * ESP_OK if none.
+ */
+esp_err_t json_pull_error(const json_pull_t *p);
+
+/**
+ * @brief Sends the error response that matches the parser error (400, or 408 on a timeout).
+ * @param p Parser state.
+ * @param req The request.
+ * @return esp_err_t ESP_FAIL, to be returned by the handler.
+ */
+esp_err_t json_pull_send_error(const json_pull_t *p, httpd_req_t *req);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* JSON_PULL_H_ */
@@ -0,0 +1,156 @@
+// live_frame.c
+// This file implements the ring of recent frames, each slot guarded by a sequence lock.
+// A slot's sequence word is 2 x the frame number while the slot holds that frame and odd while
+// the writer replaces it. The frame itself is stored as atomic words with relaxed ordering:
+// the fences around the sequence word order them, and no reader ever sees a torn value. A
+// reader copies the words and keeps the copy only if the sequence word was the expected one
+// before and after the copy. The head counter is advanced only after a slot is complete.
+
+#include "live_frame.h"
+#include <stdatomic.h>         // For the sequence lock
+#include <string.h>            // For memcpy and memset
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For vTaskDelay
+
+// --- Module Constants ---
+#define LIVE_FRAME_SPINS 4                       // Immediate retries before a reader sleeps for a tick.
+#define LIVE_FRAME_WORDS (2 * NUM_CHANNELS + 2)  // Values, sampling offsets and the two halves of the timestamp.
+
+/**
+ * @struct ring_slot_t
+ * @brief One frame of the ring.
+ */
+typedef struct {
+    _Atomic uint32_t seq;                      // 2 x frame number, odd while a write is in progress.
+    _Atomic uint32_t words[LIVE_FRAME_WORDS];  // Bit patterns of the values, offsets and timestamp.
+} ring_slot_t;
+
+// --- Static Variables ---
+static ring_slot_t ring[LIVE_FRAME_RING];
+static _Atomic uint32_t head = 0;                  // Number of the latest complete frame.
+static _Atomic uint32_t read_retries = 0;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Copies frame number n out of its slot.
+ * @return bool False if the slot no longer holds frame n (it was overwritten during or before the copy).
+ */
+static bool read_slot(uint32_t n, live_frame_t *out)
+{
+    ring_slot_t *slot = &ring[n % LIVE_FRAME_RING];
+    uint32_t copy[LIVE_FRAME_WORDS];
+
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != 2 * n)
+    {
+        return false;
+    }
+    for (int i = 0; i < LIVE_FRAME_WORDS; i++)
+    {
+        copy[i] = atomic_load_explicit(&slot->words[i], memory_order_relaxed);
+    }
+    atomic_thread_fence(memory_order_acquire); // The words are read before the sequence is checked again.
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != 2 * n)
+    {
+        return false;
+    }
+
+    out->seq = n;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        memcpy(&out->values[i], &copy[i], sizeof(float));
+        out->offsets_us[i] = (int32_t)copy[NUM_CHANNELS + i];
+    }
+    out->frame_us = (int64_t)(((uint64_t)copy[2 * NUM_CHANNELS + 1] << 32) | copy[2 * NUM_CHANNELS]);
+    return true;
+}
+
+// --- Public Function Implementations ---
+
+void live_frame_publish(const float *values, const int64_t *sample_us, int64_t frame_us)
+{
+    uint32_t n = atomic_load_explicit(&head, memory_order_relaxed) + 1;
+    ring_slot_t *slot = &ring[n % LIVE_FRAME_RING];
+
+    atomic_store_explicit(&slot->seq, 2 * n - 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release); // The odd sequence is visible before any word changes.
+
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        atomic_store_explicit(&slot->words[i], bits, memory_order_relaxed);
+        atomic_store_explicit(&slot->words[NUM_CHANNELS + i], (uint32_t)(int32_t)(sample_us[i] - frame_us), memory_order_relaxed);
+    }
+    atomic_store_explicit(&slot->words[2 * NUM_CHANNELS], (uint32_t)((uint64_t)frame_us & 0xFFFFFFFFu), memory_order_relaxed);
+    atomic_store_explicit(&slot->words[2 * NUM_CHANNELS + 1], (uint32_t)((uint64_t)frame_us >> 32), memory_order_relaxed);
+
+    atomic_store_explicit(&slot->seq, 2 * n, memory_order_release);
+    atomic_store_explicit(&head, n, memory_order_release);
+}
+
+bool live_frame_read(live_frame_t *out)
+{
+    int attempt = 0;
+
+    while (1)
+    {
+        uint32_t n = atomic_load_explicit(&head, memory_order_acquire);
+        if (n == 0)
+        {
+            memset(out, 0, sizeof(*out));
+            return false;
+        }
+        if (read_slot(n, out))
+        {
+            return true;
+        }
+        // Only possible if the writer went around the whole ring during the copy.
+        atomic_fetch_add_explicit(&read_retries, 1, memory_order_relaxed);
+        if (++attempt >= LIVE_FRAME_SPINS)
+        {
+            vTaskDelay(1);
+            attempt = 0;
+        }
+    }
+}
+
+uint32_t live_frame_latest(void)
+{
+    return atomic_load_explicit(&head, memory_order_acquire);
+}
+
+esp_err_t live_frame_read_next(uint32_t *cursor, live_frame_t *out, uint32_t *lost)
+{
+    while (1)
+    {
+        uint32_t latest = atomic_load_explicit(&head, memory_order_acquire);
+        if (latest == *cursor)
+        {
+            return ESP_ERR_NOT_FOUND;
+        }
+        uint32_t n = *cursor + 1;
+        // The oldest slot may be the one being overwritten next; skip it as well.
+        if (latest - *cursor > LIVE_FRAME_RING - 1)
+        {
+            n = latest - (LIVE_FRAME_RING - 2);
+        }
+        if (read_slot(n, out))
+        {
+            if (lost)
+                *lost += n - *cursor - 1;
+            *cursor = n;
+            return ESP_OK;
+        }
+        // Overwritten during the copy: the reader is too far behind, move on to newer frames.
+        atomic_fetch_add_explicit(&read_retries, 1, memory_order_relaxed);
+        if (lost)
+            *lost += n - *cursor;
+        *cursor = n;
+    }
+}
+
+uint32_t live_frame_read_retries(void)
+{
+    return atomic_load_explicit(&read_retries, memory_order_relaxed);
+}
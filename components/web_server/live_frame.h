@@ -0,0 +1,83 @@
+// live_frame.h
+// This header defines the public API for publishing the latest ADC frame to the web layer.
+// The acquisition task is the only writer; any number of HTTP handlers read. The frame is
+// guarded by a sequence lock: the writer never blocks or skips an update, and a reader that
+// overlaps a write simply reads again, so it always gets all channels of the same frame.
+// Every frame carries its sequence number and sampling instant, so clients can tell a stale
+// or repeated frame from a new one.
+// The last LIVE_FRAME_RING frames are kept in a ring, each slot with its own sequence word,
+// so streaming clients can read every frame in order at their own pace without ever making
+// the writer wait.
+
+#ifndef LIVE_FRAME_H_
+#define LIVE_FRAME_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+#include "settings.h"  // For NUM_CHANNELS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def LIVE_FRAME_RING
+ * @brief Number of recent frames kept for streaming readers (about 0.6 s at the logging rate).
+ */
+#define LIVE_FRAME_RING 64
+
+/**
+ * @struct live_frame_t
+ * @brief A consistent copy of the latest frame.
+ */
+typedef struct {
+    uint32_t seq;                  ///< Frame number, counted from 1; 0 = no frame published yet.
+    int64_t frame_us;              ///< Sampling instant of the frame (esp_timer time, microseconds).
+    float values[NUM_CHANNELS];    ///< Scaled channel values.
+    int32_t offsets_us[NUM_CHANNELS]; ///< Sampling instant of each channel relative to frame_us.
+} live_frame_t;
+
+/**
+ * @brief Publishes a new frame. Wait-free; call from the acquisition task only.
+ * @param values Scaled channel values (NUM_CHANNELS of them).
+ * @param sample_us Sampling instant of each value (esp_timer time).
+ * @param frame_us Sampling instant of the frame (esp_timer time).
+ */
+void live_frame_publish(const float *values, const int64_t *sample_us, int64_t frame_us);
+
+/**
+ * @brief Copies the latest frame. Never returns a mix of two frames.
+ * Retries while a write is in progress and yields if the writer was preempted mid-update.
+ * @param out Destination.
+ * @return bool True if a frame was published, false before the first one (out is zeroed).
+ */
+bool live_frame_read(live_frame_t *out);
+
+/**
+ * @brief Returns the sequence number of the latest frame (0 before the first one).
+ * A streaming reader starts with this as its cursor to receive only frames published later.
+ */
+uint32_t live_frame_latest(void);
+
+/**
+ * @brief Reads the frame after a cursor from the ring.
+ * If the reader fell more than the ring behind, the oldest frames still in the ring are
+ * returned next and the number of frames missed is added to *lost.
+ * @param cursor Sequence number of the last frame read; advanced to out->seq on success.
+ * @param out Destination.
+ * @param lost Incremented by the number of skipped frames (may be NULL).
+ * @return esp_err_t ESP_OK if a frame was read, ESP_ERR_NOT_FOUND if there is no newer frame yet.
+ */
+esp_err_t live_frame_read_next(uint32_t *cursor, live_frame_t *out, uint32_t *lost);
+
+/**
+ * @brief Returns the number of reads that had to be repeated because they overlapped a write.
+ */
+uint32_t live_frame_read_retries(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIVE_FRAME_H_ */
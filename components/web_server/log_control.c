@@ -0,0 +1,275 @@
+// log_control.c
+// This file implements the logging control plane.
+// Producers copy a command into the queue, count it as pending and notify the consumer task.
+// The consumer checks the pending count with one atomic load per cycle and only touches the
+// queue when something was posted. The state word packs the state (low byte) and the number
+// of transitions so far (upper bits) and is only written by the consumer.
+
+#include "log_control.h"
+#include <stdatomic.h>         // For the state word and the pending counter
+#include <stdio.h>             // For snprintf
+#include <string.h>            // For memset
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For task notifications
+#include "freertos/queue.h"    // For the command queue
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "esp_timer.h"         // For esp_timer_get_time (marker time)
+
+// --- Module Constants ---
+static const char *TAG = "log_control";
+
+#define LOG_CONTROL_QUEUE_LENGTH 16      // Commands buffered for the consumer.
+#define LOG_CONTROL_RETRY_MS 1000        // Interval between attempts to open a log file while armed.
+#define STATE_MASK 0xFFu                 // State bits of the state word.
+#define STATE_SEQ_SHIFT 8                // Position of the transition count in the state word.
+
+/**
+ * @struct log_command_t
+ * @brief One queued command.
+ */
+typedef struct {
+    uint8_t cmd;                         // log_cmd_t
+    uint8_t source;                      // log_source_t
+    char text[LOG_CONTROL_TEXT_MAX];     // Marker label.
+    int64_t posted_us;                   // Time of posting (esp_timer time).
+} log_command_t;
+
+static const char *const state_names[] = {"idle", "armed", "logging"};
+static const char *const cmd_names[] = {"start", "stop", "toggle", "rotate", "marker", "reconfigure"};
+static const char *const source_names[] = {"boot", "button", "web", "schedule", "retry"};
+
+// --- Static Variables ---
+static QueueHandle_t cmd_queue = NULL;
+static const log_control_ops_t *ops = NULL;
+static TaskHandle_t consumer = NULL;
+static _Atomic uint32_t state_word = LOG_STATE_IDLE;  // State and transition count.
+static _Atomic uint32_t pending = 0;                  // Commands posted but not yet processed.
+static _Atomic uint32_t dropped = 0;                  // Commands lost to a full queue.
+static portMUX_TYPE status_lock = portMUX_INITIALIZER_UNLOCKED; // Protects status.
+static log_control_status_t status;                   // Counters, written by the consumer only.
+static TickType_t last_open_attempt = 0;              // When the last open was tried.
+
+// --- Private Utility Functions ---
+
+static inline log_state_t current_state(void)
+{
+    return (log_state_t)(atomic_load_explicit(&state_word, memory_order_acquire) & STATE_MASK);
+}
+
+/**
+ * @brief Publishes a new state and logs the transition.
+ */
+static void set_state(log_state_t next, const log_command_t *c)
+{
+    uint32_t word = atomic_load_explicit(&state_word, memory_order_relaxed);
+    log_state_t prev = (log_state_t)(word & STATE_MASK);
+    uint32_t seq = (word >> STATE_SEQ_SHIFT) + 1;
+    atomic_store_explicit(&state_word, (seq << STATE_SEQ_SHIFT) | next, memory_order_release);
+
+    portENTER_CRITICAL(&status_lock);
+    status.state = next;
+    status.transitions = seq;
+    portEXIT_CRITICAL(&status_lock);
+    ESP_LOGI(TAG, "#%lu %s -> %s (%s from %s)", (unsigned long)seq, state_names[prev], state_names[next],
+             cmd_names[c->cmd], source_names[c->source]);
+}
+
+static void count_rejected(const log_command_t *c, const char *reason)
+{
+    portENTER_CRITICAL(&status_lock);
+    status.rejected++;
+    portEXIT_CRITICAL(&status_lock);
+    ESP_LOGW(TAG, "%s from %s ignored: %s", cmd_names[c->cmd], source_names[c->source], reason);
+}
+
+/**
+ * @brief Tries to open a log file while armed; moves to LOGGING on success.
+ */
+static void try_open(const log_command_t *c)
+{
+    last_open_attempt = xTaskGetTickCount();
+    if (ops->open() == ESP_OK)
+    {
+        set_state(LOG_STATE_LOGGING, c);
+        return;
+    }
+    portENTER_CRITICAL(&status_lock);
+    status.open_failures++;
+    portEXIT_CRITICAL(&status_lock);
+    ESP_LOGW(TAG, "Could not open a log file, retrying in %d ms", LOG_CONTROL_RETRY_MS);
+}
+
+/**
+ * @brief Applies one command to the state machine.
+ */
+static void handle(log_command_t *c)
+{
+    log_state_t state = current_state();
+
+    portENTER_CRITICAL(&status_lock);
+    status.commands++;
+    status.last_cmd = (log_cmd_t)c->cmd;
+    status.last_source = (log_source_t)c->source;
+    portEXIT_CRITICAL(&status_lock);
+
+    if (c->cmd == LOG_CMD_TOGGLE)
+    {
+        c->cmd = (state == LOG_STATE_IDLE) ? LOG_CMD_START : LOG_CMD_STOP;
+    }
+
+    switch (c->cmd)
+    {
+    case LOG_CMD_START:
+        if (state != LOG_STATE_IDLE)
+        {
+            count_rejected(c, "already running");
+        }
+        else if (ops->start_allowed && !ops->start_allowed())
+        {
+            count_rejected(c, "acquisition is paused");
+            if (ops->start_aborted)
+                ops->start_aborted();
+        }
+        else
+        {
+            set_state(LOG_STATE_ARMED, c);
+            try_open(c);
+        }
+        break;
+
+    case LOG_CMD_STOP:
+        if (state == LOG_STATE_IDLE)
+        {
+            count_rejected(c, "not running");
+            break;
+        }
+        if (state == LOG_STATE_LOGGING)
+        {
+            ops->close();
+        }
+        else if (ops->start_aborted)
+        {
+            ops->start_aborted(); // Stopped before a log file could be opened
+        }
+        set_state(LOG_STATE_IDLE, c);
+        break;
+
+    case LOG_CMD_ROTATE:
+    case LOG_CMD_RECONFIGURE:
+        if (state != LOG_STATE_LOGGING)
+        {
+            if (c->cmd == LOG_CMD_ROTATE)
+                count_rejected(c, "no log file open");
+            else
+                ESP_LOGI(TAG, "Configuration changed, applies to the next log file");
+            break;
+        }
+        // The new file (and session) starts with the new configuration.
+        ops->close();
+        set_state(LOG_STATE_ARMED, c);
+        try_open(c);
+        break;
+
+    case LOG_CMD_MARKER:
+        if (state != LOG_STATE_LOGGING || !ops->marker)
+        {
+            count_rejected(c, "no log file open");
+            break;
+        }
+        ops->marker(c->text, c->posted_us);
+        break;
+
+    default:
+        count_rejected(c, "unknown command");
+        break;
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t log_control_init(const log_control_ops_t *control_ops)
+{
+    ops = control_ops;
+    cmd_queue = xQueueCreate(LOG_CONTROL_QUEUE_LENGTH, sizeof(log_command_t));
+    if (!cmd_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create command queue");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void log_control_attach(void)
+{
+    consumer = xTaskGetCurrentTaskHandle();
+}
+
+esp_err_t log_control_post(log_cmd_t cmd, log_source_t source, const char *text)
+{
+    if (!cmd_queue)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    log_command_t c = {.cmd = cmd, .source = source, .posted_us = esp_timer_get_time()};
+    if (text)
+    {
+        snprintf(c.text, sizeof(c.text), "%s", text);
+    }
+    // Counted before the send, so the consumer never sees a queued command with pending == 0.
+    atomic_fetch_add_explicit(&pending, 1, memory_order_release);
+    if (xQueueSend(cmd_queue, &c, 0) != pdTRUE)
+    {
+        atomic_fetch_sub_explicit(&pending, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&dropped, 1, memory_order_relaxed);
+        ESP_LOGE(TAG, "Command queue full, %s from %s dropped", cmd_names[cmd], source_names[source]);
+        return ESP_ERR_NO_MEM;
+    }
+    if (consumer)
+    {
+        xTaskNotifyGive(consumer);
+    }
+    return ESP_OK;
+}
+
+log_state_t log_control_process(void)
+{
+    log_state_t state = current_state();
+    if (atomic_load_explicit(&pending, memory_order_acquire) == 0 && state != LOG_STATE_ARMED)
+    {
+        return state; // Fast path: nothing posted, nothing to retry.
+    }
+
+    log_command_t c;
+    while (xQueueReceive(cmd_queue, &c, 0) == pdTRUE)
+    {
+        atomic_fetch_sub_explicit(&pending, 1, memory_order_relaxed);
+        handle(&c);
+    }
+
+    if (current_state() == LOG_STATE_ARMED &&
+        xTaskGetTickCount() - last_open_attempt >= pdMS_TO_TICKS(LOG_CONTROL_RETRY_MS))
+    {
+        log_command_t retry = {.cmd = LOG_CMD_START, .source = LOG_SRC_INTERNAL};
+        try_open(&retry);
+    }
+    return current_state();
+}
+
+log_state_t log_control_state(void)
+{
+    return current_state();
+}
+
+void log_control_get_status(log_control_status_t *out)
+{
+    portENTER_CRITICAL(&status_lock);
+    *out = status;
+    portEXIT_CRITICAL(&status_lock);
+    out->state = current_state();
+    out->dropped = atomic_load_explicit(&dropped, memory_order_relaxed);
+}
+
+const char *log_control_state_name(log_state_t state)
+{
+    return (unsigned)state < sizeof(state_names) / sizeof(state_names[0]) ? state_names[state] : "unknown";
+}
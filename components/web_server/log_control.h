@@ -0,0 +1,137 @@
+// log_control.h
+// This header defines the public API for the logging control plane.
+// Every request to change logging (button, web server, schedule, boot setting) is posted as a
+// command to one queue. The acquisition task consumes the queue and runs the state machine,
+// so transitions happen in one place, strictly in order, and each one is logged with its source.
+// The current state is published as one atomic word: readers (including the acquisition loop
+// itself) get it with a single load and never take a lock.
+
+#ifndef LOG_CONTROL_H_
+#define LOG_CONTROL_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_CONTROL_TEXT_MAX 48 ///< Maximum length (including null terminator) of a command's text (marker label).
+
+/**
+ * @enum log_state_t
+ * @brief Logging state.
+ */
+typedef enum {
+    LOG_STATE_IDLE = 0,    ///< Not logging.
+    LOG_STATE_ARMED,       ///< Logging requested, but no log file is open yet (e.g. the card is busy or missing).
+    LOG_STATE_LOGGING,     ///< A log file is open and frames are written.
+} log_state_t;
+
+/**
+ * @enum log_cmd_t
+ * @brief Commands accepted by the state machine.
+ */
+typedef enum {
+    LOG_CMD_START = 0,     ///< Start logging to a new file.
+    LOG_CMD_STOP,          ///< Stop logging and close the file.
+    LOG_CMD_TOGGLE,        ///< Start if idle, stop otherwise (resolved when the command is processed).
+    LOG_CMD_ROTATE,        ///< Close the current file and continue in a new one.
+    LOG_CMD_MARKER,        ///< Record a marker with a label in the running log.
+    LOG_CMD_RECONFIGURE,   ///< The channel configuration changed; a running log continues in a new file.
+} log_cmd_t;
+
+/**
+ * @enum log_source_t
+ * @brief Origin of a command, for the transition log.
+ */
+typedef enum {
+    LOG_SRC_BOOT = 0,      ///< Log-on-boot setting.
+    LOG_SRC_BUTTON,        ///< Boot button.
+    LOG_SRC_WEB,           ///< Web interface or HTTP API.
+    LOG_SRC_SCHEDULE,      ///< Schedule engine.
+    LOG_SRC_INTERNAL,      ///< The state machine itself (retries).
+} log_source_t;
+
+/**
+ * @struct log_control_ops_t
+ * @brief Actions of the state machine, implemented by the owner of the log file.
+ * All of them run in the task that calls log_control_process().
+ */
+typedef struct {
+    esp_err_t (*open)(void);               ///< Opens a new log file. Returns ESP_OK when logging can begin.
+    void (*close)(void);                   ///< Writes out and closes the current log file.
+    void (*marker)(const char *text, int64_t posted_us); ///< Records a marker requested at posted_us (esp_timer time) in the current log (may be NULL).
+    bool (*start_allowed)(void);           ///< Returns false while acquisition is paused (benchmark, burst). May be NULL.
+    void (*start_aborted)(void);           ///< A start ended without a log file: refused while paused, or stopped while armed. May be NULL.
+} log_control_ops_t;
+
+/**
+ * @struct log_control_status_t
+ * @brief Counters of the control plane.
+ */
+typedef struct {
+    log_state_t state;          ///< Current state.
+    uint32_t transitions;       ///< State changes since boot.
+    uint32_t commands;          ///< Commands processed.
+    uint32_t rejected;          ///< Commands that did not apply in the current state.
+    uint32_t dropped;           ///< Commands lost because the queue was full.
+    uint32_t open_failures;     ///< Failed attempts to open a log file.
+    log_cmd_t last_cmd;         ///< Last processed command.
+    log_source_t last_source;   ///< Source of the last processed command.
+} log_control_status_t;
+
+/**
+ * @brief Creates the command queue. Must be called before any command is posted.
+ * @param ops Actions of the state machine (kept by reference).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the queue could not be created.
+ */
+esp_err_t log_control_init(const log_control_ops_t *ops);
+
+/**
+ * @brief Registers the calling task as the consumer; it is woken by a task notification when
+ * a command is posted.
+ */
+void log_control_attach(void);
+
+/**
+ * @brief Posts a command. Never blocks; safe from tasks and esp_timer callbacks.
+ * The time of the call is recorded with the command, so a marker carries the instant it was
+ * requested rather than the instant it was processed.
+ * @param cmd Command.
+ * @param source Origin of the command.
+ * @param text Marker label (LOG_CMD_MARKER), or NULL.
+ * @return esp_err_t ESP_OK if queued, ESP_ERR_NO_MEM if the queue was full,
+ *         ESP_ERR_INVALID_STATE before log_control_init().
+ */
+esp_err_t log_control_post(log_cmd_t cmd, log_source_t source, const char *text);
+
+/**
+ * @brief Applies all pending commands and retries a pending open. Call from the consumer task
+ * once per cycle; returns at once (one atomic load) when there is nothing to do.
+ * @return log_state_t State after processing.
+ */
+log_state_t log_control_process(void);
+
+/**
+ * @brief Returns the current state with a single atomic load. Callable from any context.
+ */
+log_state_t log_control_state(void);
+
+/**
+ * @brief Copies the counters of the control plane.
+ * @param out Destination.
+ */
+void log_control_get_status(log_control_status_t *out);
+
+/**
+ * @brief Returns a short lowercase name of a state ("idle", "armed", "logging").
+ */
+const char *log_control_state_name(log_state_t state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_CONTROL_H_ */
@@ -0,0 +1,183 @@
+// log_crc.c
+// This file implements the CRC sidecar helpers and the log file verification.
+// CRCs are computed with the ROM CRC32 routine, which is table driven and fast enough that
+// verification is limited by the SD card read speed rather than by the CRC itself.
+
+#include "log_crc.h"
+#include <stdio.h>             // For FILE, fopen, fseek
+#include <stdlib.h>            // For malloc, free
+#include <string.h>            // For memset, strlen
+#include <sys/stat.h>          // For stat
+#include "esp_rom_crc.h"       // For esp_rom_crc32_le
+#include "esp_heap_caps.h"     // For heap_caps_malloc
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "sd_io.h"             // For throttled reads
+
+// --- Module Constants ---
+static const char *TAG = "log_crc";
+
+#define LOG_CRC_READ_BUFFER_SIZE 16384 // Large reads keep the verification close to raw card speed.
+#define LOG_CRC_RECORD_BATCH 64        // Number of sidecar records read at once.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Reads up to len bytes, retrying short reads from the scheduler until end of file.
+ * @return size_t Number of bytes read (less than len only at end of file or on error).
+ */
+static size_t read_full(void *buf, size_t len, FILE *file)
+{
+    size_t total = 0;
+    while (total < len)
+    {
+        size_t n = sd_io_read(NULL, (uint8_t *)buf + total, len - total, file);
+        if (n == 0)
+        {
+            break;
+        }
+        total += n;
+    }
+    return total;
+}
+
+/**
+ * @brief Adds a bad range to the result, merging it with the previous one if adjacent.
+ */
+static void add_bad_range(log_crc_result_t *result, uint32_t offset, uint32_t length)
+{
+    if (result->range_count > 0)
+    {
+        log_crc_range_t *last = &result->bad_ranges[result->range_count - 1];
+        if (last->offset + last->length == offset)
+        {
+            last->length += length;
+            return;
+        }
+    }
+    if (result->range_count == LOG_CRC_MAX_RANGES)
+    {
+        result->ranges_truncated = true;
+        return;
+    }
+    result->bad_ranges[result->range_count].offset = offset;
+    result->bad_ranges[result->range_count].length = length;
+    result->range_count++;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t log_crc_sidecar_path(const char *log_path, char *out, size_t out_len)
+{
+    int len = snprintf(out, out_len, "%s" LOG_CRC_SUFFIX, log_path);
+    if (len < 0 || (size_t)len >= out_len)
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+void log_crc_make_record(uint32_t offset, const void *data, uint32_t length, log_crc_record_t *out)
+{
+    out->offset = offset;
+    out->length = length;
+    out->crc = esp_rom_crc32_le(0, (const uint8_t *)data, length);
+}
+
+esp_err_t log_crc_verify(const char *log_path, log_crc_result_t *result)
+{
+    char crc_path[256];
+    struct stat st;
+
+    memset(result, 0, sizeof(*result));
+    if (log_crc_sidecar_path(log_path, crc_path, sizeof(crc_path)) != ESP_OK || stat(log_path, &st) != 0)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    FILE *log_file = fopen(log_path, "rb");
+    if (!log_file)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    FILE *crc_file = fopen(crc_path, "rb");
+    if (!crc_file)
+    {
+        fclose(log_file);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    uint8_t *buf = heap_caps_malloc(LOG_CRC_READ_BUFFER_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    log_crc_record_t *records = malloc(LOG_CRC_RECORD_BATCH * sizeof(log_crc_record_t));
+    if (!buf || !records)
+    {
+        heap_caps_free(buf);
+        free(records);
+        fclose(crc_file);
+        fclose(log_file);
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t pos = 0; // Current read position in the log file.
+    size_t record_count;
+
+    while ((record_count = read_full(records, LOG_CRC_RECORD_BATCH * sizeof(log_crc_record_t), crc_file) / sizeof(log_crc_record_t)) > 0)
+    {
+        for (size_t i = 0; i < record_count; i++)
+        {
+            const log_crc_record_t *rec = &records[i];
+            if (rec->offset != pos)
+            {
+                if (rec->offset > pos)
+                {
+                    result->bytes_unchecked += rec->offset - pos; // Data written outside the writer (CSV header).
+                }
+                fseek(log_file, rec->offset, SEEK_SET);
+                pos = rec->offset;
+            }
+
+            uint32_t crc = 0;
+            uint32_t remaining = rec->length;
+            while (remaining > 0)
+            {
+                size_t want = remaining < LOG_CRC_READ_BUFFER_SIZE ? remaining : LOG_CRC_READ_BUFFER_SIZE;
+                size_t got = read_full(buf, want, log_file);
+                if (got == 0)
+                {
+                    break; // File is shorter than the sidecar says (truncated by a power loss).
+                }
+                crc = esp_rom_crc32_le(crc, buf, got);
+                remaining -= got;
+            }
+            pos += rec->length - remaining;
+
+            result->blocks++;
+            result->bytes_checked += rec->length;
+            if (remaining > 0 || crc != rec->crc)
+            {
+                result->bad_blocks++;
+                add_bad_range(result, rec->offset, rec->length);
+            }
+        }
+        if (record_count < LOG_CRC_RECORD_BATCH)
+        {
+            break;
+        }
+    }
+
+    if ((uint32_t)st.st_size > pos)
+    {
+        result->bytes_unchecked += (uint32_t)st.st_size - pos; // Rows still in the writer or written after the last record.
+    }
+    result->elapsed_ms = (uint32_t)((esp_timer_get_time() - start_us) / 1000);
+
+    ESP_LOGI(TAG, "Verified %s: %lu blocks, %lu bad, %lu ms", log_path, (unsigned long)result->blocks,
+             (unsigned long)result->bad_blocks, (unsigned long)result->elapsed_ms);
+
+    heap_caps_free(buf);
+    free(records);
+    fclose(crc_file);
+    fclose(log_file);
+    return ESP_OK;
+}
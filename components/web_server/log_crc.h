@@ -0,0 +1,99 @@
+// log_crc.h
+// This header defines the CRC sidecar format used to check the integrity of log files.
+// For every block the log writer appends to a log file, it appends one record with the
+// block's offset, length and CRC32 to a sidecar file "<log file>.crc". Verification reads
+// the log file once and compares every block against its record, which detects corruption
+// caused by card wear or an interrupted write (e.g. a power loss).
+
+#ifndef LOG_CRC_H_
+#define LOG_CRC_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def LOG_CRC_SUFFIX
+ * @brief Suffix appended to a log file's path to get its CRC sidecar path.
+ */
+#define LOG_CRC_SUFFIX ".crc"
+
+/**
+ * @struct log_crc_record_t
+ * @brief One sidecar record (12 bytes, little-endian, no padding).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t offset; ///< Offset of the block in the log file.
+    uint32_t length; ///< Length of the block in bytes.
+    uint32_t crc;    ///< CRC32 (IEEE 802.3) of the block, as computed by esp_rom_crc32_le(0, ...).
+} log_crc_record_t;
+
+/**
+ * @struct log_crc_range_t
+ * @brief A byte range of a log file that failed verification.
+ */
+typedef struct {
+    uint32_t offset; ///< First byte of the range.
+    uint32_t length; ///< Length of the range in bytes.
+} log_crc_range_t;
+
+/**
+ * @def LOG_CRC_MAX_RANGES
+ * @brief Maximum number of bad ranges reported individually (adjacent bad blocks are merged).
+ */
+#define LOG_CRC_MAX_RANGES 16
+
+/**
+ * @struct log_crc_result_t
+ * @brief Result of verifying one log file.
+ */
+typedef struct {
+    uint32_t blocks;                               ///< Number of records checked.
+    uint32_t bad_blocks;                           ///< Number of blocks whose CRC did not match or that were missing.
+    uint64_t bytes_checked;                        ///< Bytes covered by records.
+    uint64_t bytes_unchecked;                      ///< Bytes not covered by any record (e.g. the header).
+    uint32_t range_count;                          ///< Number of entries used in bad_ranges.
+    bool ranges_truncated;                         ///< True if there were more bad ranges than LOG_CRC_MAX_RANGES.
+    log_crc_range_t bad_ranges[LOG_CRC_MAX_RANGES]; ///< Bad ranges, in file order.
+    uint32_t elapsed_ms;                           ///< Duration of the verification.
+} log_crc_result_t;
+
+/**
+ * @brief Builds the sidecar path for a log file.
+ * @param log_path Path of the log file.
+ * @param out Buffer receiving the sidecar path.
+ * @param out_len Length of the out buffer.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_SIZE if the buffer is too small.
+ */
+esp_err_t log_crc_sidecar_path(const char *log_path, char *out, size_t out_len);
+
+/**
+ * @brief Computes the sidecar record for a block.
+ * @param offset Offset of the block in the log file.
+ * @param data Block data.
+ * @param length Block length in bytes.
+ * @param out Receives the record.
+ */
+void log_crc_make_record(uint32_t offset, const void *data, uint32_t length, log_crc_record_t *out);
+
+/**
+ * @brief Verifies a log file against its sidecar.
+ * Reads go through the SD I/O scheduler, so verification never delays logging.
+ * @param log_path Full path of the log file.
+ * @param result Receives the verification result.
+ * @return esp_err_t ESP_OK if the verification ran (check result->bad_blocks),
+ *         ESP_ERR_NOT_FOUND if the log file or its sidecar does not exist,
+ *         ESP_ERR_NO_MEM if the read buffer could not be allocated.
+ */
+esp_err_t log_crc_verify(const char *log_path, log_crc_result_t *result);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_CRC_H_ */
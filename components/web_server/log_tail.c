@@ -0,0 +1,110 @@
+// log_tail.c
+// This file implements the checkpoint shared between the log writer and followers.
+// The state is a few words under a spinlock. Followers poll it at a short interval; that only
+// touches RAM, and the writer publishes at most a few checkpoints per second.
+
+#include "log_tail.h"
+#include <stdio.h>             // For snprintf
+#include <string.h>            // For strcmp
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For vTaskDelay
+
+// --- Module Constants ---
+#define LOG_TAIL_PATH_MAX 128      // Maximum length of the active file path.
+#define LOG_TAIL_POLL_MS 100       // Interval at which waiting followers check the checkpoint.
+
+// --- Static Variables ---
+static portMUX_TYPE tail_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the variables below.
+static char active_path[LOG_TAIL_PATH_MAX];                   // Active log file, empty when none.
+static uint32_t active_generation = 0;                        // Incremented for every new file.
+static bool active = false;                                   // True between open and close.
+static uint32_t committed_offset = 0;                         // Last checkpoint of the active file.
+static uint32_t followers = 0;                                // Running follow sessions.
+static uint32_t closed_generation = 0;                        // Last closed file ...
+static uint32_t closed_committed = 0;                         // ... and its final size.
+
+// --- Public Function Implementations ---
+
+void log_tail_open(const char *path, uint32_t committed)
+{
+    char copy[LOG_TAIL_PATH_MAX];
+    snprintf(copy, sizeof(copy), "%s", path);
+    portENTER_CRITICAL(&tail_lock);
+    memcpy(active_path, copy, sizeof(active_path));
+    active_generation++;
+    committed_offset = committed;
+    active = true;
+    portEXIT_CRITICAL(&tail_lock);
+}
+
+void log_tail_commit(uint32_t committed)
+{
+    portENTER_CRITICAL(&tail_lock);
+    committed_offset = committed;
+    portEXIT_CRITICAL(&tail_lock);
+}
+
+void log_tail_close(void)
+{
+    portENTER_CRITICAL(&tail_lock);
+    active = false;
+    closed_generation = active_generation;
+    closed_committed = committed_offset;
+    portEXIT_CRITICAL(&tail_lock);
+}
+
+bool log_tail_followed(void)
+{
+    portENTER_CRITICAL(&tail_lock);
+    bool followed = active && followers > 0;
+    portEXIT_CRITICAL(&tail_lock);
+    return followed;
+}
+
+esp_err_t log_tail_follow_begin(const char *path, uint32_t *generation)
+{
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    portENTER_CRITICAL(&tail_lock);
+    if (active && strcmp(path, active_path) == 0)
+    {
+        followers++;
+        *generation = active_generation;
+        ret = ESP_OK;
+    }
+    portEXIT_CRITICAL(&tail_lock);
+    return ret;
+}
+
+void log_tail_follow_end(void)
+{
+    portENTER_CRITICAL(&tail_lock);
+    if (followers > 0)
+        followers--;
+    portEXIT_CRITICAL(&tail_lock);
+}
+
+esp_err_t log_tail_wait(uint32_t generation, uint32_t offset, uint32_t timeout_ms, uint32_t *committed)
+{
+    for (uint32_t waited_ms = 0;; waited_ms += LOG_TAIL_POLL_MS)
+    {
+        portENTER_CRITICAL(&tail_lock);
+        bool open = generation == active_generation && active;
+        uint32_t now = open ? committed_offset : generation == closed_generation ? closed_committed : offset;
+        portEXIT_CRITICAL(&tail_lock);
+
+        *committed = now;
+        if (!open)
+        {
+            return ESP_ERR_INVALID_STATE; // Closed (possibly already followed by a newer file); now is final.
+        }
+        if (now > offset)
+        {
+            return ESP_OK;
+        }
+        if (waited_ms >= timeout_ms)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LOG_TAIL_POLL_MS));
+    }
+}
@@ -0,0 +1,71 @@
+// log_tail.h
+// This header defines the public API for following the active log file (`tail -f`).
+// The log writer publishes a checkpoint after every block that reached the card: the file
+// offset just after the last complete row (or columnar chunk) in it. Followers only ever read
+// up to the checkpoint, so they never see a torn row, and wait in RAM for the next one instead
+// of polling the card. While someone follows, the writer also syncs the file after each block
+// so its new size is visible to readers that open it.
+
+#ifndef LOG_TAIL_H_
+#define LOG_TAIL_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Announces a new active log file. Called by the log writer.
+ * @param path Full path of the file.
+ * @param committed Size of the data already in the file (e.g. the header).
+ */
+void log_tail_open(const char *path, uint32_t committed);
+
+/**
+ * @brief Publishes a new checkpoint. Called by the log writer after a block was written.
+ * @param committed File offset just after the last complete row on the card.
+ */
+void log_tail_commit(uint32_t committed);
+
+/**
+ * @brief Announces that the active file is complete. Followers send what is left and finish.
+ */
+void log_tail_close(void);
+
+/**
+ * @brief Checks whether anyone follows the active file (the writer then syncs after each block).
+ */
+bool log_tail_followed(void);
+
+/**
+ * @brief Starts following a file.
+ * @param path Full path of the file.
+ * @param generation Receives the identifier of the active file, for log_tail_wait().
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the file is not the active log file.
+ */
+esp_err_t log_tail_follow_begin(const char *path, uint32_t *generation);
+
+/**
+ * @brief Stops following; must be paired with a successful log_tail_follow_begin().
+ */
+void log_tail_follow_end(void);
+
+/**
+ * @brief Waits until the checkpoint passes an offset or the file is closed.
+ * @param generation Value from log_tail_follow_begin().
+ * @param offset Bytes the follower already has.
+ * @param timeout_ms Longest wait.
+ * @param committed Receives the current checkpoint.
+ * @return esp_err_t ESP_OK if the checkpoint is beyond offset, ESP_ERR_TIMEOUT if nothing new
+ *         arrived in time, ESP_ERR_INVALID_STATE if the file was closed (committed is final).
+ */
+esp_err_t log_tail_wait(uint32_t generation, uint32_t offset, uint32_t timeout_ms, uint32_t *committed);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_TAIL_H_ */
@@ -0,0 +1,294 @@
+// schedule.c
+// This file implements scheduled logging sessions.
+// Each evaluation computes, from the current local time, whether any window is open and when
+// the next window boundary (start or end) occurs, then arms a one-shot esp_timer for exactly
+// that instant. Sessions are edge triggered: the callback fires only when the scheduled state
+// changes, so logging switched manually in between is left alone until the next boundary.
+
+#include "schedule.h"
+#include <stdlib.h>            // For setenv
+#include <stdio.h>             // For snprintf
+#include <string.h>            // For strcmp, strlen
+#include <sys/time.h>          // For gettimeofday, settimeofday
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/semphr.h"   // For the config mutex
+#include "esp_timer.h"         // For the boundary timer
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "nvs.h"               // For NVS read/write operations
+
+// --- Module Constants ---
+static const char *TAG = "schedule";
+#define NAMESPACE "schedule"           // NVS namespace of the schedule
+#define KEY_CONFIG "config"            // Key of the schedule blob
+#define KEY_TZ "tz"                    // Key of the time zone string
+
+#define SCHEDULE_MIN_VALID_EPOCH 1704067200 // 2024-01-01; an earlier clock has not been set yet.
+#define SCHEDULE_MAX_SLEEP_S 3600           // Re-evaluate at least hourly (clock adjustments, DST).
+#define SCHEDULE_UNSET_CLOCK_RETRY_S 60     // Re-check interval while the clock is not set.
+#define SCHEDULE_LOOKAHEAD_DAYS 8           // Days searched for the next boundary.
+
+// --- Static Variables ---
+static schedule_config_t config;               // Active schedule.
+static SemaphoreHandle_t config_mutex = NULL;  // Protects config and status.
+static schedule_status_t status;               // Result of the last evaluation.
+static esp_timer_handle_t boundary_timer = NULL;
+static schedule_change_cb_t change_cb = NULL;
+static char tz_string[SCHEDULE_TZ_MAX] = "UTC0";
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Returns local midnight of the day `day_offset` days from the day of `now`.
+ */
+static time_t local_midnight(time_t now, int day_offset, int *weekday)
+{
+    struct tm tm;
+    localtime_r(&now, &tm);
+    tm.tm_mday += day_offset;
+    tm.tm_hour = 0;
+    tm.tm_min = 0;
+    tm.tm_sec = 0;
+    tm.tm_isdst = -1;
+    time_t midnight = mktime(&tm); // Normalizes tm, including tm_wday
+    *weekday = tm.tm_wday;
+    return midnight;
+}
+
+/**
+ * @brief Determines whether `now` lies in a window and finds the next window boundary after it.
+ * Must be called with config_mutex held.
+ * @return time_t Next boundary, or 0 if the schedule has no future boundary.
+ */
+static time_t find_next_boundary(time_t now, bool *in_window)
+{
+    time_t next = 0;
+    *in_window = false;
+
+    // Start one day back so sessions that began yesterday and run past midnight are found.
+    for (int d = -1; d < SCHEDULE_LOOKAHEAD_DAYS; d++)
+    {
+        int weekday;
+        time_t midnight = local_midnight(now, d, &weekday);
+        for (uint8_t w = 0; w < config.count; w++)
+        {
+            const schedule_window_t *win = &config.windows[w];
+            if (!(win->days & (1u << weekday)))
+                continue;
+            for (uint32_t m = win->start_min; m < 24 * 60; m += win->every_min)
+            {
+                time_t start = midnight + (time_t)m * 60;
+                time_t end = start + (time_t)win->duration_min * 60;
+                if (start <= now && now < end)
+                    *in_window = true;
+                if (start > now && (next == 0 || start < next))
+                    next = start;
+                if (end > now && (next == 0 || end < next))
+                    next = end;
+                if (win->every_min == 0)
+                    break;
+            }
+        }
+    }
+    return next;
+}
+
+/**
+ * @brief Re-evaluates the schedule, reports a state change and re-arms the timer.
+ * The change callback runs with config_mutex held and must not call back into this module
+ * (except schedule_is_idle()).
+ */
+static void evaluate(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    time_t now = tv.tv_sec;
+
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    bool was_in_window = status.in_window;
+    bool in_window = false;
+    time_t next = 0;
+    status.enabled = config.enabled;
+    status.clock_valid = now >= SCHEDULE_MIN_VALID_EPOCH;
+    if (config.enabled && status.clock_valid)
+    {
+        next = find_next_boundary(now, &in_window);
+    }
+    status.in_window = in_window;
+    status.next_change = next;
+    if (in_window && !was_in_window)
+        status.sessions++;
+
+    // The mutex stays held until the timer is re-armed, so evaluations from the timer task
+    // and from the web server (new schedule, clock set) cannot interleave.
+    if (in_window != was_in_window)
+    {
+        ESP_LOGI(TAG, "Scheduled session %s", in_window ? "started" : "ended");
+        if (change_cb)
+            change_cb(in_window);
+    }
+
+    // Sleep until the boundary, to the microsecond; wake earlier to follow clock changes.
+    int64_t delay_us;
+    if (!status.clock_valid && config.enabled)
+        delay_us = (int64_t)SCHEDULE_UNSET_CLOCK_RETRY_S * 1000000;
+    else if (next == 0 || next - now > SCHEDULE_MAX_SLEEP_S)
+        delay_us = (int64_t)SCHEDULE_MAX_SLEEP_S * 1000000;
+    else
+        delay_us = ((int64_t)(next - now) * 1000000) - tv.tv_usec;
+    if (delay_us < 1000)
+        delay_us = 1000;
+
+    esp_timer_stop(boundary_timer);
+    esp_timer_start_once(boundary_timer, (uint64_t)delay_us);
+    xSemaphoreGive(config_mutex);
+}
+
+/**
+ * @brief esp_timer callback at a window boundary.
+ */
+static void boundary_timer_cb(void *arg)
+{
+    evaluate();
+}
+
+/**
+ * @brief Checks that all windows of a schedule are in range.
+ */
+static bool config_is_valid(const schedule_config_t *c)
+{
+    if (c->count > SCHEDULE_MAX_WINDOWS)
+        return false;
+    for (uint8_t i = 0; i < c->count; i++)
+    {
+        const schedule_window_t *w = &c->windows[i];
+        if (w->days == 0 || w->days > 0x7F || w->start_min >= 24 * 60 ||
+            w->duration_min == 0 || w->duration_min > 24 * 60 || w->every_min > 24 * 60)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t schedule_init(schedule_change_cb_t on_change)
+{
+    change_cb = on_change;
+    config_mutex = xSemaphoreCreateMutex();
+    if (config_mutex == NULL)
+        return ESP_ERR_NO_MEM;
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK)
+    {
+        schedule_config_t stored;
+        size_t size = sizeof(stored);
+        if (nvs_get_blob(nvs_handle, KEY_CONFIG, &stored, &size) == ESP_OK &&
+            size == sizeof(stored) && config_is_valid(&stored))
+        {
+            config = stored;
+        }
+        size = sizeof(tz_string);
+        if (nvs_get_str(nvs_handle, KEY_TZ, tz_string, &size) != ESP_OK)
+        {
+            snprintf(tz_string, sizeof(tz_string), "UTC0");
+        }
+        nvs_close(nvs_handle);
+    }
+    setenv("TZ", tz_string, 1);
+    tzset();
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = boundary_timer_cb,
+        .name = "schedule",
+    };
+    if (esp_timer_create(&timer_args, &boundary_timer) != ESP_OK)
+        return ESP_ERR_NO_MEM;
+
+    ESP_LOGI(TAG, "Schedule %s, %u window(s), TZ %s", config.enabled ? "enabled" : "disabled",
+             config.count, tz_string);
+    evaluate();
+    return ESP_OK;
+}
+
+void schedule_get_config(schedule_config_t *out)
+{
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    *out = config;
+    xSemaphoreGive(config_mutex);
+}
+
+esp_err_t schedule_set_config(const schedule_config_t *new_config)
+{
+    if (!config_is_valid(new_config))
+        return ESP_ERR_INVALID_ARG;
+
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err != ESP_OK)
+        return err;
+    err = nvs_set_blob(nvs_handle, KEY_CONFIG, new_config, sizeof(*new_config));
+    if (err == ESP_OK)
+        err = nvs_commit(nvs_handle);
+    nvs_close(nvs_handle);
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to store the schedule: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    config = *new_config;
+    xSemaphoreGive(config_mutex);
+    ESP_LOGI(TAG, "Schedule %s, %u window(s)", new_config->enabled ? "enabled" : "disabled", new_config->count);
+    evaluate();
+    return ESP_OK;
+}
+
+void schedule_get_status(schedule_status_t *out)
+{
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    *out = status;
+    xSemaphoreGive(config_mutex);
+}
+
+bool schedule_is_idle(void)
+{
+    return status.enabled && !status.in_window;
+}
+
+esp_err_t schedule_set_time(time_t epoch, const char *tz)
+{
+    if (epoch < SCHEDULE_MIN_VALID_EPOCH || (tz && strlen(tz) >= SCHEDULE_TZ_MAX))
+        return ESP_ERR_INVALID_ARG;
+
+    if (tz && strcmp(tz, tz_string) != 0)
+    {
+        nvs_handle_t nvs_handle;
+        if (nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK)
+        {
+            if (nvs_set_str(nvs_handle, KEY_TZ, tz) == ESP_OK)
+                nvs_commit(nvs_handle);
+            nvs_close(nvs_handle);
+        }
+        xSemaphoreTake(config_mutex, portMAX_DELAY);
+        snprintf(tz_string, sizeof(tz_string), "%s", tz);
+        xSemaphoreGive(config_mutex);
+        setenv("TZ", tz_string, 1);
+        tzset();
+    }
+
+    struct timeval tv = {.tv_sec = epoch, .tv_usec = 0};
+    settimeofday(&tv, NULL);
+    ESP_LOGI(TAG, "System clock set to %lld (TZ %s)", (long long)epoch, tz_string);
+    evaluate();
+    return ESP_OK;
+}
+
+void schedule_get_tz(char *out, size_t len)
+{
+    xSemaphoreTake(config_mutex, portMAX_DELAY);
+    snprintf(out, len, "%s", tz_string);
+    xSemaphoreGive(config_mutex);
+}
@@ -0,0 +1,126 @@
+// schedule.h
+// This header defines the public API for scheduled logging sessions.
+// A schedule is a list of time windows, each given by the weekdays it applies to, a start
+// time, a duration and an optional repeat interval within the day (e.g. every day from 06:00,
+// 10 minutes every hour). The schedule is stored in NVS; a one-shot timer is armed for the
+// next window boundary, so logging starts and stops exactly on time without polling.
+// Windows are in local time of the system clock, which is set through schedule_set_time().
+
+#ifndef SCHEDULE_H_
+#define SCHEDULE_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include <time.h>      // For time_t
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def SCHEDULE_MAX_WINDOWS
+ * @brief Largest number of windows in a schedule.
+ */
+#define SCHEDULE_MAX_WINDOWS 8
+
+/**
+ * @def SCHEDULE_TZ_MAX
+ * @brief Maximum length (including null terminator) of the POSIX time zone string.
+ */
+#define SCHEDULE_TZ_MAX 48
+
+/**
+ * @struct schedule_window_t
+ * @brief One recurring logging window.
+ */
+typedef struct {
+    uint8_t days;          ///< Weekdays the window applies to (bit 0 = Sunday ... bit 6 = Saturday).
+    uint16_t start_min;    ///< Start of the first session of the day, minutes after midnight (0-1439).
+    uint16_t duration_min; ///< Length of each session in minutes (1-1440).
+    uint16_t every_min;    ///< Repeat interval within the day in minutes, 0 for one session per day.
+} schedule_window_t;
+
+/**
+ * @struct schedule_config_t
+ * @brief The complete schedule as stored in NVS.
+ */
+typedef struct {
+    bool enabled;          ///< True if the schedule controls logging.
+    uint8_t count;         ///< Number of valid entries in windows.
+    schedule_window_t windows[SCHEDULE_MAX_WINDOWS];
+} schedule_config_t;
+
+/**
+ * @struct schedule_status_t
+ * @brief Current state of the schedule engine.
+ */
+typedef struct {
+    bool enabled;          ///< True if the schedule is enabled.
+    bool clock_valid;      ///< False until the system clock has been set.
+    bool in_window;        ///< True while a scheduled session is running.
+    time_t next_change;    ///< Time of the next session start or end, 0 if none.
+    uint32_t sessions;     ///< Scheduled sessions started since boot.
+} schedule_status_t;
+
+/**
+ * @brief Callback invoked from the timer task when a scheduled session starts or ends.
+ * @param active True at the start of a session, false at its end.
+ */
+typedef void (*schedule_change_cb_t)(bool active);
+
+/**
+ * @brief Loads the schedule and time zone from NVS and arms the timer for the next boundary.
+ * NVS must already be initialized (settings_init()).
+ * @param on_change Callback invoked at every session start and end.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the timer could not be created.
+ */
+esp_err_t schedule_init(schedule_change_cb_t on_change);
+
+/**
+ * @brief Copies the current schedule.
+ * @param out Destination for the schedule.
+ */
+void schedule_get_config(schedule_config_t *out);
+
+/**
+ * @brief Validates, stores and activates a new schedule.
+ * If a scheduled session is running and is no longer covered by the new schedule, it ends.
+ * @param config New schedule.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if a window is out of range,
+ *         or the NVS error.
+ */
+esp_err_t schedule_set_config(const schedule_config_t *config);
+
+/**
+ * @brief Copies the current state of the schedule engine.
+ * @param out Destination for the state.
+ */
+void schedule_get_status(schedule_status_t *out);
+
+/**
+ * @brief Checks whether the device may idle: the schedule is enabled and no session is running.
+ */
+bool schedule_is_idle(void);
+
+/**
+ * @brief Sets the system clock and, optionally, the time zone, then re-evaluates the schedule.
+ * @param epoch Current time in seconds since 1970-01-01 UTC.
+ * @param tz POSIX time zone string (e.g. "CET-1CEST,M3.5.0,M10.5.0/3"), or NULL to keep the current one.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for a time before 2024 or a too long tz.
+ */
+esp_err_t schedule_set_time(time_t epoch, const char *tz);
+
+/**
+ * @brief Copies the current POSIX time zone string.
+ * @param out Destination buffer.
+ * @param len Length of the destination buffer.
+ */
+void schedule_get_tz(char *out, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHEDULE_H_ */
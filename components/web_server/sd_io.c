@@ -0,0 +1,258 @@
+// sd_io.c
+// This file implements the SD card I/O scheduler.
+// All bulk transfers on the card go through one bus mutex. The log writer runs at a higher
+// task priority than the HTTP server, so it is always the next owner when it is waiting.
+// Readers and background writers (downloads, uploads) additionally check the log writer's
+// backlog before every chunk: they shrink their chunks when the writer queue starts to fill,
+// pause completely when it is nearly full, and never take more than their share of bus time
+// while the writer has pending blocks.
+
+#include "sd_io.h"
+#include <string.h>            // For memset
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/semphr.h"   // For mutexes
+#include "freertos/task.h"     // For vTaskDelay
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "esp_log.h"           // For ESP_LOGx macros
+
+// --- Module Constants ---
+static const char *TAG = "sd_io";
+
+#define SD_IO_WRITER_SHARE_PCT 50    // Share of bus time guaranteed to the log writer while it has pending blocks.
+#define SD_IO_WINDOW_US 100000       // Length of the bandwidth accounting window (100 ms).
+#define SD_IO_SHRINK_FILL_PCT 25     // Writer queue fill at which readers switch to small chunks.
+#define SD_IO_PAUSE_FILL_PCT 50      // Writer queue fill at which readers pause until the writer catches up.
+#define SD_IO_MIN_CHUNK 512          // Chunk size used while the writer queue is filling (one sector).
+#define SD_IO_PAUSE_STEP_MS 10       // Sleep between checks while a reader is paused.
+#define SD_IO_MAX_PAUSE_MS 2000      // Upper bound for a single pause, so a stuck writer cannot hang HTTP clients.
+
+// --- Static Variables ---
+static SemaphoreHandle_t bus_mutex = NULL;               // Serializes bulk transfers on the card.
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the counters below.
+static volatile bool writer_waiting = false;            // True while the log writer waits for the bus.
+static volatile uint32_t writer_queued = 0;             // Full blocks waiting in the log writer.
+static volatile uint32_t writer_capacity = 0;           // Total log writer blocks (0 when idle).
+static int64_t writer_wait_start_us = 0;                // When the current writer started waiting.
+static int64_t writer_start_us = 0;                     // When the current write started.
+static int64_t window_start_us = 0;                     // Start of the current bandwidth window.
+static int64_t window_reader_us = 0;                    // Bus time used by readers in the current window.
+static sd_io_stats_t stats;                             // Global statistics.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Checks whether readers have used up their share of the current bandwidth window.
+ * Must be called with stats_lock held.
+ */
+static bool reader_share_exhausted_locked(int64_t now_us)
+{
+    if (now_us - window_start_us >= SD_IO_WINDOW_US)
+    {
+        window_start_us = now_us;
+        window_reader_us = 0;
+        return false;
+    }
+    return window_reader_us >= (SD_IO_WINDOW_US * (100 - SD_IO_WRITER_SHARE_PCT)) / 100;
+}
+
+/**
+ * @brief Waits until a reader may use the bus and decides how large its next chunk may be.
+ * @param session Optional per-transfer statistics.
+ * @param len Requested chunk size.
+ * @return size_t Allowed chunk size (at most len).
+ */
+static size_t reader_admit(sd_io_session_t *session, size_t len)
+{
+    bool throttled = false;
+
+    for (int waited_ms = 0; waited_ms < SD_IO_MAX_PAUSE_MS; waited_ms += SD_IO_PAUSE_STEP_MS)
+    {
+        portENTER_CRITICAL(&stats_lock);
+        uint32_t queued = writer_queued;
+        uint32_t capacity = writer_capacity;
+        bool over_share = (queued > 0 || writer_waiting) && reader_share_exhausted_locked(esp_timer_get_time());
+        if (capacity > 0 && queued > stats.writer_queue_peak)
+        {
+            stats.writer_queue_peak = queued;
+        }
+        portEXIT_CRITICAL(&stats_lock);
+
+        if (session && queued > session->max_writer_queue)
+        {
+            session->max_writer_queue = queued;
+        }
+        if (capacity == 0)
+        {
+            break; // Logger is idle, nothing to protect.
+        }
+
+        uint32_t fill_pct = (queued * 100) / capacity;
+        if (!writer_waiting && !over_share && fill_pct < SD_IO_PAUSE_FILL_PCT)
+        {
+            if (fill_pct >= SD_IO_SHRINK_FILL_PCT && len > SD_IO_MIN_CHUNK)
+            {
+                len = SD_IO_MIN_CHUNK; // Keep bus hold times short while the writer is busy.
+                throttled = true;
+            }
+            break;
+        }
+
+        throttled = true;
+        vTaskDelay(pdMS_TO_TICKS(SD_IO_PAUSE_STEP_MS));
+    }
+
+    if (throttled)
+    {
+        portENTER_CRITICAL(&stats_lock);
+        stats.reader_throttled++;
+        portEXIT_CRITICAL(&stats_lock);
+        if (session)
+        {
+            session->throttled++;
+        }
+    }
+    return len;
+}
+
+/**
+ * @brief Records a finished reader transfer.
+ */
+static void reader_account(sd_io_session_t *session, size_t bytes, int64_t start_us)
+{
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&stats_lock);
+    window_reader_us += now_us - start_us;
+    stats.reader_bytes += bytes;
+    portEXIT_CRITICAL(&stats_lock);
+    if (session)
+    {
+        session->bytes += bytes;
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t sd_io_init(void)
+{
+    if (bus_mutex != NULL)
+    {
+        return ESP_OK;
+    }
+    bus_mutex = xSemaphoreCreateMutex();
+    if (bus_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create SD bus mutex");
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&stats, 0, sizeof(stats));
+    window_start_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "SD I/O scheduler ready (writer share %d%%)", SD_IO_WRITER_SHARE_PCT);
+    return ESP_OK;
+}
+
+void sd_io_set_writer_backlog(uint32_t queued, uint32_t capacity)
+{
+    portENTER_CRITICAL(&stats_lock);
+    writer_queued = queued;
+    writer_capacity = capacity;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void sd_io_writer_begin(void)
+{
+    writer_waiting = true;
+    writer_wait_start_us = esp_timer_get_time();
+    if (bus_mutex)
+    {
+        xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    }
+    writer_waiting = false;
+    writer_start_us = esp_timer_get_time();
+
+    uint32_t wait_us = (uint32_t)(writer_start_us - writer_wait_start_us);
+    portENTER_CRITICAL(&stats_lock);
+    if (wait_us > stats.writer_max_wait_us)
+    {
+        stats.writer_max_wait_us = wait_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void sd_io_writer_end(size_t bytes)
+{
+    uint32_t write_us = (uint32_t)(esp_timer_get_time() - writer_start_us);
+    if (bus_mutex)
+    {
+        xSemaphoreGive(bus_mutex);
+    }
+    portENTER_CRITICAL(&stats_lock);
+    stats.writer_ops++;
+    stats.writer_bytes += bytes;
+    if (write_us > stats.writer_max_write_us)
+    {
+        stats.writer_max_write_us = write_us;
+    }
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+size_t sd_io_read(sd_io_session_t *session, void *buf, size_t len, FILE *file)
+{
+    size_t chunk = reader_admit(session, len);
+
+    if (bus_mutex)
+    {
+        xSemaphoreTake(bus_mutex, portMAX_DELAY);
+    }
+    int64_t start_us = esp_timer_get_time();
+    size_t read_bytes = fread(buf, 1, chunk, file);
+    if (bus_mutex)
+    {
+        xSemaphoreGive(bus_mutex);
+    }
+
+    reader_account(session, read_bytes, start_us);
+    return read_bytes;
+}
+
+size_t sd_io_write_background(sd_io_session_t *session, const void *buf, size_t len, FILE *file)
+{
+    const uint8_t *p = (const uint8_t *)buf;
+    size_t written = 0;
+
+    while (written < len)
+    {
+        size_t chunk = reader_admit(session, len - written);
+
+        if (bus_mutex)
+        {
+            xSemaphoreTake(bus_mutex, portMAX_DELAY);
+        }
+        int64_t start_us = esp_timer_get_time();
+        size_t n = fwrite(p + written, 1, chunk, file);
+        if (bus_mutex)
+        {
+            xSemaphoreGive(bus_mutex);
+        }
+
+        reader_account(session, n, start_us);
+        written += n;
+        if (n < chunk)
+        {
+            break; // Write error (e.g. card full).
+        }
+    }
+    return written;
+}
+
+void sd_io_get_stats(sd_io_stats_t *out)
+{
+    if (!out)
+    {
+        return;
+    }
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    out->writer_queue = writer_queued;
+    out->writer_capacity = writer_capacity;
+    portEXIT_CRITICAL(&stats_lock);
+}
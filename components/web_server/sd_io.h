@@ -0,0 +1,104 @@
+// sd_io.h
+// This header defines the public API for the SD card I/O scheduler.
+// The logger and the web server share one SPI SD bus through FATFS. The scheduler gives
+// log writes strict priority and a guaranteed share of bus time, and throttles web reads
+// (downloads) and background writes (uploads) according to how full the log writer's
+// buffers are, so a large download can never delay logging long enough to lose samples.
+
+#ifndef SD_IO_H_
+#define SD_IO_H_
+
+#include <stdio.h>     // For FILE
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct sd_io_session_t
+ * @brief Per-transfer statistics of a throttled reader (e.g. one download).
+ */
+typedef struct {
+    uint32_t bytes;            ///< Bytes transferred in this session.
+    uint32_t throttled;        ///< Number of times the transfer was paused or shrunk for the writer.
+    uint32_t max_writer_queue; ///< Highest writer queue depth observed during the transfer.
+} sd_io_session_t;
+
+/**
+ * @struct sd_io_stats_t
+ * @brief Global scheduler statistics since boot.
+ */
+typedef struct {
+    uint32_t writer_queue;          ///< Blocks currently waiting in the log writer queue.
+    uint32_t writer_capacity;       ///< Total number of log writer blocks (0 while not logging).
+    uint32_t writer_queue_peak;     ///< Highest writer queue depth observed while a reader was active.
+    uint32_t writer_ops;            ///< Number of block writes done by the log writer.
+    uint64_t writer_bytes;          ///< Bytes written by the log writer.
+    uint32_t writer_max_wait_us;    ///< Longest time the log writer waited for the bus.
+    uint32_t writer_max_write_us;   ///< Longest single block write (fwrite + fflush).
+    uint64_t reader_bytes;          ///< Bytes transferred by throttled readers and background writers.
+    uint32_t reader_throttled;      ///< Number of times a reader was paused or shrunk.
+} sd_io_stats_t;
+
+/**
+ * @brief Initializes the scheduler. Must be called once before any other function.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the bus mutex could not be created.
+ */
+esp_err_t sd_io_init(void);
+
+/**
+ * @brief Publishes the log writer's buffer fill, used to throttle readers.
+ * @param queued Number of full blocks waiting to be written.
+ * @param capacity Total number of blocks (0 when the writer is idle).
+ */
+void sd_io_set_writer_backlog(uint32_t queued, uint32_t capacity);
+
+/**
+ * @brief Acquires the bus for a log write. Readers back off as soon as a writer is waiting.
+ * Must be paired with sd_io_writer_end().
+ */
+void sd_io_writer_begin(void);
+
+/**
+ * @brief Releases the bus after a log write and records its statistics.
+ * @param bytes Number of bytes written.
+ */
+void sd_io_writer_end(size_t bytes);
+
+/**
+ * @brief Reads from a file with throttling according to the log writer's backlog.
+ * Behaves like fread() with an element size of 1, but may return fewer bytes than
+ * requested even before the end of the file. Returns 0 only at end of file or on error.
+ * @param session Optional per-transfer statistics (may be NULL).
+ * @param buf Destination buffer.
+ * @param len Maximum number of bytes to read.
+ * @param file File to read from.
+ * @return size_t Number of bytes read.
+ */
+size_t sd_io_read(sd_io_session_t *session, void *buf, size_t len, FILE *file);
+
+/**
+ * @brief Writes to a file as low-priority background traffic (e.g. uploads).
+ * Throttled like sd_io_read(), but always writes the complete buffer.
+ * @param session Optional per-transfer statistics (may be NULL).
+ * @param buf Source buffer.
+ * @param len Number of bytes to write.
+ * @param file File to write to.
+ * @return size_t Number of bytes written.
+ */
+size_t sd_io_write_background(sd_io_session_t *session, const void *buf, size_t len, FILE *file);
+
+/**
+ * @brief Copies the current scheduler statistics.
+ * @param out Destination for the statistics.
+ */
+void sd_io_get_stats(sd_io_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SD_IO_H_ */
@@ -0,0 +1,890 @@
+// session_catalog.c
+// This file implements the logging session catalog.
+// Records are single JSON lines: {"ev":"start",...} when a session begins, {"ev":"marker",...}
+// for every marker set while it runs and {"ev":"end",...} when it ends. The in-memory index
+// keeps the newest SESSION_INDEX_MAX sessions and SESSION_MARKERS_MAX markers; older ones remain
+// in the file, which is streamed when a lookup reaches past the index. The last assigned id is
+// kept in NVS, so ids are never reused, even if the catalog file is deleted.
+// Records are appended, and the id stored, by a low-priority writer task through the SD I/O
+// scheduler, so opening or closing a session or setting a marker never waits for the card.
+
+#include "session_catalog.h"
+#include <stdio.h>             // For FILE, fopen, fgets
+#include <stdlib.h>            // For malloc, free
+#include <string.h>            // For memset, strncpy
+#include <strings.h>           // For strncasecmp
+#include <ctype.h>             // For tolower
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/semphr.h"   // For the index mutex
+#include "freertos/queue.h"    // For the record queue
+#include "freertos/task.h"     // For the catalog writer task
+#include "esp_heap_caps.h"     // For PSRAM allocation
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "esp_rom_crc.h"       // For esp_rom_crc32_le
+#include "nvs.h"               // For the last session id
+#include "cJSON.h"             // For reading and writing records
+#include "file_catalog.h"      // For publishing the catalog file size
+#include "sd_io.h"             // For background writes to the card
+
+// --- Module Constants ---
+static const char *TAG = "session_catalog";
+#define SESSION_INDEX_MAX 128      // Sessions held in the in-memory index.
+#define SESSION_MARKERS_MAX 256    // Markers held in the in-memory index (all sessions).
+#define SESSION_LINE_MAX 1024      // Longest record line read from the catalog file.
+#define NAMESPACE "sessions"       // NVS namespace
+#define KEY_LAST_ID "last_id"      // Key of the last assigned session id
+#define SESSION_QUEUE_LENGTH 16    // Records waiting for the catalog writer task.
+#define SESSION_TASK_STACK_SIZE 3072 // Stack size of the catalog writer task.
+#define SESSION_TASK_PRIORITY 3    // Below acquisition, the log writer and the HTTP server.
+
+// --- Static Variables ---
+static SemaphoreHandle_t index_mutex = NULL;   // Protects everything below.
+static session_info_t *sessions = NULL;        // Index, oldest first.
+static size_t session_count = 0;               // Valid entries in sessions.
+static session_marker_t *markers = NULL;       // Marker index, oldest first.
+static size_t marker_count = 0;                // Valid entries in markers.
+static char catalog_path[64];                  // Full path of the catalog file.
+static const char *mount_prefix = NULL;        // Mount point, stripped from file names.
+static uint32_t last_id = 0;                   // Last assigned id.
+static uint32_t pending_id = 0;                // Prepared but not yet opened session, 0 if none.
+static char pending_tags[SESSION_TAGS_MAX];
+static char pending_note[SESSION_NOTE_MAX];
+static uint32_t current_id = 0;                // Running session, 0 if none.
+static QueueHandle_t record_queue = NULL;      // Record lines (or NULL to save the id), for the writer task.
+static uint32_t saved_id = 0;                  // Last id stored in NVS; only the writer task changes it.
+static volatile uint32_t dropped_records = 0;  // Records lost because the queue was full.
+static bool sessions_evicted = false;          // Older sessions are only in the catalog file.
+static bool markers_evicted = false;           // Older markers are only in the catalog file.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Copies a string into a fixed size buffer, truncating if necessary.
+ */
+static void copy_str(char *dst, size_t len, const char *src)
+{
+    strncpy(dst, src ? src : "", len - 1);
+    dst[len - 1] = '\0';
+}
+
+/**
+ * @brief Finds a session in the index by id. Must be called with index_mutex held.
+ */
+static session_info_t *find_by_id(uint32_t id)
+{
+    for (size_t i = session_count; i > 0; i--)
+    {
+        if (sessions[i - 1].id == id)
+            return &sessions[i - 1];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Appends a new session to the index, evicting the oldest one if full.
+ * Must be called with index_mutex held.
+ */
+static session_info_t *index_append(void)
+{
+    if (session_count == SESSION_INDEX_MAX)
+    {
+        memmove(&sessions[0], &sessions[1], (SESSION_INDEX_MAX - 1) * sizeof(session_info_t));
+        session_count--;
+        sessions_evicted = true;
+    }
+    session_info_t *s = &sessions[session_count++];
+    memset(s, 0, sizeof(*s));
+    return s;
+}
+
+/**
+ * @brief Appends a marker to the index, evicting the oldest one if full, and counts it for
+ * its session. Must be called with index_mutex held.
+ */
+static session_marker_t *marker_append(uint32_t session)
+{
+    if (marker_count == SESSION_MARKERS_MAX)
+    {
+        memmove(&markers[0], &markers[1], (SESSION_MARKERS_MAX - 1) * sizeof(session_marker_t));
+        marker_count--;
+        markers_evicted = true;
+    }
+    session_marker_t *m = &markers[marker_count++];
+    memset(m, 0, sizeof(*m));
+    m->session = session;
+    session_info_t *s = find_by_id(session);
+    if (s)
+        s->markers++;
+    return m;
+}
+
+/**
+ * @brief Allocates an index array, preferably in PSRAM.
+ */
+static void *index_alloc(size_t size)
+{
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    return p ? p : heap_caps_malloc(size, MALLOC_CAP_8BIT);
+}
+
+/**
+ * @brief Hashes the channel configuration field by field: the scaling factor and the unit up to
+ * its terminator, so bytes after the terminator (left over from an earlier, longer unit) and
+ * structure padding cannot make two equal configurations hash differently.
+ */
+static uint32_t cfg_hash(const channel_config_t *configs)
+{
+    uint32_t crc = 0;
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)&configs[i].scaling_factor, sizeof(configs[i].scaling_factor));
+        crc = esp_rom_crc32_le(crc, (const uint8_t *)configs[i].unit, strnlen(configs[i].unit, MAX_UNIT_LEN) + 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Stores the last assigned id in NVS if it changed. Called by the writer task only.
+ */
+static void save_last_id(void)
+{
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    uint32_t id = last_id;
+    xSemaphoreGive(index_mutex);
+    if (id == saved_id)
+        return;
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle) == ESP_OK)
+    {
+        if (nvs_set_u32(nvs_handle, KEY_LAST_ID, id) == ESP_OK && nvs_commit(nvs_handle) == ESP_OK)
+            saved_id = id;
+        nvs_close(nvs_handle);
+    }
+}
+
+/**
+ * @brief FreeRTOS task that appends queued records to the catalog file and stores the last id.
+ * Records are written in the order they were queued, as low-priority traffic through the SD I/O
+ * scheduler, so the tasks that create them (acquisition, HTTP) never wait for the card or NVS.
+ * @param pvParam Task parameters (not used).
+ */
+static void session_writer_task(void *pvParam)
+{
+    char *line;
+    while (1)
+    {
+        if (xQueueReceive(record_queue, &line, portMAX_DELAY) != pdTRUE)
+            continue;
+        if (line)
+        {
+            FILE *f = fopen(catalog_path, "a");
+            if (f)
+            {
+                size_t len = strlen(line);
+                line[len] = '\n'; // Replaces the terminator; the line is not used as a string again
+                sd_io_write_background(NULL, line, len + 1, f);
+                file_catalog_upsert(catalog_path, (uint32_t)ftell(f), time(NULL));
+                fclose(f);
+            }
+            else
+            {
+                ESP_LOGE(TAG, "Failed to append to %s", catalog_path);
+            }
+            cJSON_free(line);
+        }
+        // The id is only needed if the catalog file is deleted; at mount the file's ids count too.
+        save_last_id();
+    }
+}
+
+/**
+ * @brief Queues a request for the writer task: a record line, or NULL to only store the last id.
+ */
+static void queue_line(char *line)
+{
+    if (!record_queue || xQueueSend(record_queue, &line, 0) != pdTRUE)
+    {
+        dropped_records++;
+        ESP_LOGW(TAG, "Catalog queue full, %s dropped", line ? "record" : "id update");
+        cJSON_free(line);
+    }
+}
+
+/**
+ * @brief Queues one record for the catalog file and frees it. Never blocks.
+ */
+static void append_record(cJSON *record)
+{
+    char *line = cJSON_PrintUnformatted(record);
+    cJSON_Delete(record);
+    if (line)
+        queue_line(line);
+}
+
+/**
+ * @brief Returns a numeric member of a record, 0 if it is missing.
+ */
+static double get_number(const cJSON *record, const char *name)
+{
+    const cJSON *item = cJSON_GetObjectItem(record, name);
+    return cJSON_IsNumber(item) ? item->valuedouble : 0;
+}
+
+/**
+ * @brief Adds a float array to a record.
+ */
+static void add_float_array(cJSON *record, const char *name, const float *values)
+{
+    cJSON *arr = cJSON_AddArrayToObject(record, name);
+    for (int i = 0; arr && i < NUM_CHANNELS; i++)
+    {
+        cJSON_AddItemToArray(arr, cJSON_CreateNumber(values[i]));
+    }
+}
+
+/**
+ * @brief Reads a float array from a record.
+ */
+static void get_float_array(const cJSON *record, const char *name, float *values)
+{
+    const cJSON *arr = cJSON_GetObjectItem(record, name);
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        const cJSON *item = cJSON_GetArrayItem(arr, i);
+        values[i] = cJSON_IsNumber(item) ? (float)item->valuedouble : 0.0f;
+    }
+}
+
+/**
+ * @brief Fills a session from its start record.
+ */
+static void parse_start(const cJSON *rec, uint32_t id, session_info_t *s)
+{
+    memset(s, 0, sizeof(*s));
+    s->id = id;
+    s->start = (time_t)get_number(rec, "t");
+    s->cfg_hash = (uint32_t)get_number(rec, "cfg");
+    const cJSON *file = cJSON_GetArrayItem(cJSON_GetObjectItem(rec, "files"), 0);
+    copy_str(s->file, sizeof(s->file), cJSON_GetStringValue(file));
+    copy_str(s->tags, sizeof(s->tags), cJSON_GetStringValue(cJSON_GetObjectItem(rec, "tags")));
+    copy_str(s->note, sizeof(s->note), cJSON_GetStringValue(cJSON_GetObjectItem(rec, "note")));
+}
+
+/**
+ * @brief Adds the end time and summary of an end record to a session.
+ */
+static void parse_end(const cJSON *rec, session_info_t *s)
+{
+    s->end = (time_t)get_number(rec, "t");
+    s->summary.rows = (uint32_t)get_number(rec, "rows");
+    s->summary.bytes = (uint32_t)get_number(rec, "bytes");
+    get_float_array(rec, "min", s->summary.min);
+    get_float_array(rec, "max", s->summary.max);
+    get_float_array(rec, "mean", s->summary.mean);
+    s->has_summary = true;
+}
+
+/**
+ * @brief Fills a marker from its record (the session is set by the caller).
+ */
+static void parse_marker(const cJSON *rec, session_marker_t *m)
+{
+    m->t = (time_t)get_number(rec, "t");
+    m->ms = (uint32_t)get_number(rec, "ms");
+    m->row = (uint32_t)get_number(rec, "row");
+    m->frame = (uint32_t)get_number(rec, "frame");
+    copy_str(m->text, sizeof(m->text), cJSON_GetStringValue(cJSON_GetObjectItem(rec, "text")));
+}
+
+/**
+ * @brief Applies one record line of the catalog file to the index.
+ */
+static void load_record(const char *line)
+{
+    cJSON *rec = cJSON_Parse(line);
+    if (!rec)
+        return; // A torn last line after a power loss
+    const cJSON *ev = cJSON_GetObjectItem(rec, "ev");
+    const cJSON *id = cJSON_GetObjectItem(rec, "id");
+    if (cJSON_IsString(ev) && cJSON_IsNumber(id))
+    {
+        uint32_t sid = (uint32_t)id->valuedouble;
+        if (sid > last_id)
+            last_id = sid;
+
+        if (strcmp(ev->valuestring, "start") == 0)
+        {
+            parse_start(rec, sid, index_append());
+        }
+        else if (strcmp(ev->valuestring, "end") == 0)
+        {
+            session_info_t *s = find_by_id(sid);
+            if (s)
+                parse_end(rec, s);
+        }
+        else if (strcmp(ev->valuestring, "marker") == 0)
+        {
+            parse_marker(rec, marker_append(sid));
+        }
+    }
+    cJSON_Delete(rec);
+}
+
+/**
+ * @typedef record_fn_t
+ * @brief Called by scan_file() for every record.
+ * @param rec The parsed record.
+ * @param ev Its "ev" member.
+ * @param id Its session id.
+ * @param ctx Caller context.
+ */
+typedef void (*record_fn_t)(const cJSON *rec, const char *ev, uint32_t id, void *ctx);
+
+/**
+ * @brief Streams the catalog file and calls fn for every record, oldest first.
+ * Used when a lookup reaches past the in-memory index. The file is read through the SD I/O
+ * scheduler, so a long scan yields to the log writer; the index mutex is not held.
+ * @return esp_err_t ESP_OK if every record was read, ESP_ERR_INVALID_SIZE if an over-long line
+ *         was skipped, ESP_ERR_NO_MEM or ESP_FAIL if the file could not be read.
+ */
+static esp_err_t scan_file(record_fn_t fn, void *ctx)
+{
+    char *buf = malloc(SESSION_LINE_MAX);
+    if (!buf)
+        return ESP_ERR_NO_MEM;
+    FILE *f = fopen(catalog_path, "r");
+    if (!f)
+    {
+        free(buf);
+        return ESP_FAIL;
+    }
+
+    esp_err_t err = ESP_OK;
+    size_t len = 0;
+    bool skipping = false; // Inside an over-long line
+    while (1)
+    {
+        size_t n = sd_io_read(NULL, buf + len, SESSION_LINE_MAX - 1 - len, f);
+        if (n == 0)
+            break; // A torn last line without a line end is ignored
+        len += n;
+        buf[len] = '\0';
+
+        char *line = buf;
+        char *nl;
+        while ((nl = strchr(line, '\n')) != NULL)
+        {
+            *nl = '\0';
+            cJSON *rec = skipping ? NULL : cJSON_Parse(line);
+            skipping = false;
+            const cJSON *ev = cJSON_GetObjectItem(rec, "ev");
+            const cJSON *id = cJSON_GetObjectItem(rec, "id");
+            if (cJSON_IsString(ev) && cJSON_IsNumber(id))
+                fn(rec, ev->valuestring, (uint32_t)id->valuedouble, ctx);
+            cJSON_Delete(rec);
+            line = nl + 1;
+        }
+        len -= (size_t)(line - buf);
+        memmove(buf, line, len);
+        if (len == SESSION_LINE_MAX - 1)
+        {
+            len = 0; // No line end in a full buffer: drop the line up to its end
+            skipping = true;
+            err = ESP_ERR_INVALID_SIZE;
+        }
+    }
+    fclose(f);
+    free(buf);
+    return err;
+}
+
+/**
+ * @struct find_ctx_t
+ * @brief State of a session search in the catalog file.
+ */
+typedef struct {
+    const session_query_t *query;
+    uint32_t below;            // Only sessions with a smaller id; the others are in the index.
+    session_info_t *ring;      // The latest matches; the oldest is overwritten when full.
+    size_t size;               // Places in ring.
+    size_t count;              // Matches found, including overwritten ones.
+} find_ctx_t;
+
+/**
+ * @brief Finds a session among the matches kept by a file search.
+ */
+static session_info_t *ring_find(find_ctx_t *c, uint32_t id)
+{
+    size_t n = c->count < c->size ? c->count : c->size;
+    for (size_t i = 0; i < n; i++)
+    {
+        if (c->ring[i].id == id)
+            return &c->ring[i];
+    }
+    return NULL;
+}
+
+static bool matches(const session_info_t *s, const session_query_t *q);
+
+/**
+ * @brief record_fn_t of a session search in the catalog file.
+ */
+static void find_record(const cJSON *rec, const char *ev, uint32_t id, void *ctx)
+{
+    find_ctx_t *c = ctx;
+    if (id >= c->below)
+        return;
+    if (strcmp(ev, "start") == 0)
+    {
+        session_info_t s;
+        parse_start(rec, id, &s);
+        if (!matches(&s, c->query))
+            return;
+        if (c->size > 0)
+            c->ring[c->count % c->size] = s;
+        c->count++;
+    }
+    else
+    {
+        session_info_t *s = ring_find(c, id);
+        if (!s)
+            return;
+        if (strcmp(ev, "end") == 0)
+            parse_end(rec, s);
+        else if (strcmp(ev, "marker") == 0)
+            s->markers++;
+    }
+}
+
+/**
+ * @brief Reverses an array of sessions in place.
+ */
+static void reverse_sessions(session_info_t *a, size_t n)
+{
+    for (size_t i = 0; i < n / 2; i++)
+    {
+        session_info_t t = a[i];
+        a[i] = a[n - 1 - i];
+        a[n - 1 - i] = t;
+    }
+}
+
+/**
+ * @struct markers_ctx_t
+ * @brief State of a marker search in the catalog file.
+ */
+typedef struct {
+    uint32_t id;               // Session whose markers are collected.
+    session_marker_t *out;     // Markers found, oldest first.
+    size_t max;                // Places in out.
+    size_t count;              // Markers found, including those that did not fit.
+} markers_ctx_t;
+
+/**
+ * @brief record_fn_t of a marker search in the catalog file.
+ */
+static void markers_record(const cJSON *rec, const char *ev, uint32_t id, void *ctx)
+{
+    markers_ctx_t *c = ctx;
+    if (id != c->id || strcmp(ev, "marker") != 0)
+        return;
+    if (c->count < c->max)
+    {
+        session_marker_t *m = &c->out[c->count];
+        memset(m, 0, sizeof(*m));
+        m->session = id;
+        parse_marker(rec, m);
+    }
+    c->count++;
+}
+
+/**
+ * @brief Checks whether a comma separated tag list contains a tag.
+ */
+static bool has_tag(const char *tags, const char *tag)
+{
+    size_t len = strlen(tag);
+    for (const char *p = tags; *p;)
+    {
+        const char *comma = strchr(p, ',');
+        size_t n = comma ? (size_t)(comma - p) : strlen(p);
+        if (n == len && strncasecmp(p, tag, len) == 0)
+            return true;
+        if (!comma)
+            break;
+        p = comma + 1;
+    }
+    return false;
+}
+
+/**
+ * @brief Case-insensitive substring search.
+ */
+static bool contains_nocase(const char *haystack, const char *needle)
+{
+    size_t len = strlen(needle);
+    for (; *haystack; haystack++)
+    {
+        if (tolower((unsigned char)*haystack) == tolower((unsigned char)*needle) &&
+            strncasecmp(haystack, needle, len) == 0)
+            return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether a session matches a filter.
+ */
+static bool matches(const session_info_t *s, const session_query_t *q)
+{
+    if (!q)
+        return true;
+    if (q->tag && q->tag[0] && !has_tag(s->tags, q->tag))
+        return false;
+    if (q->text && q->text[0] && !contains_nocase(s->tags, q->text) &&
+        !contains_nocase(s->note, q->text) && !contains_nocase(s->file, q->text))
+        return false;
+    if (q->from && s->start < q->from)
+        return false;
+    if (q->to && s->start >= q->to)
+        return false;
+    return true;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t session_catalog_init(const char *mount_point)
+{
+    if (index_mutex == NULL)
+    {
+        index_mutex = xSemaphoreCreateMutex();
+        if (index_mutex == NULL)
+            return ESP_ERR_NO_MEM;
+    }
+    if (markers == NULL)
+    {
+        markers = index_alloc(SESSION_MARKERS_MAX * sizeof(session_marker_t));
+        if (!markers)
+            return ESP_ERR_NO_MEM;
+    }
+    if (sessions == NULL)
+    {
+        sessions = index_alloc(SESSION_INDEX_MAX * sizeof(session_info_t));
+        if (!sessions)
+            return ESP_ERR_NO_MEM;
+    }
+    if (record_queue == NULL)
+    {
+        record_queue = xQueueCreate(SESSION_QUEUE_LENGTH, sizeof(char *));
+        if (!record_queue)
+            return ESP_ERR_NO_MEM;
+        if (xTaskCreate(session_writer_task, "session_cat", SESSION_TASK_STACK_SIZE, NULL, SESSION_TASK_PRIORITY, NULL) != pdPASS)
+            return ESP_ERR_NO_MEM;
+    }
+    mount_prefix = mount_point;
+    snprintf(catalog_path, sizeof(catalog_path), "%s/" SESSION_CATALOG_FILE, mount_point);
+
+    nvs_handle_t nvs_handle;
+    if (nvs_open(NAMESPACE, NVS_READONLY, &nvs_handle) == ESP_OK)
+    {
+        nvs_get_u32(nvs_handle, KEY_LAST_ID, &last_id);
+        nvs_close(nvs_handle);
+    }
+    saved_id = last_id;
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    session_count = 0;
+    marker_count = 0;
+    sessions_evicted = false;
+    markers_evicted = false;
+    FILE *f = fopen(catalog_path, "r");
+    char *line = malloc(SESSION_LINE_MAX);
+    if (f && line)
+    {
+        while (fgets(line, SESSION_LINE_MAX, f))
+        {
+            load_record(line);
+        }
+    }
+    free(line);
+    if (f)
+        fclose(f);
+    xSemaphoreGive(index_mutex);
+
+    ESP_LOGI(TAG, "%u session(s) and %u marker(s) in the index, last id %lu", (unsigned)session_count,
+             (unsigned)marker_count, (unsigned long)last_id);
+    return ESP_OK;
+}
+
+esp_err_t session_catalog_prepare(const char *tags, const char *note, uint32_t *out_id)
+{
+    if (!sessions)
+        return ESP_ERR_INVALID_STATE;
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    if (pending_id || current_id)
+    {
+        xSemaphoreGive(index_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    pending_id = ++last_id;
+    copy_str(pending_tags, sizeof(pending_tags), tags);
+    copy_str(pending_note, sizeof(pending_note), note);
+    *out_id = pending_id;
+    xSemaphoreGive(index_mutex);
+    queue_line(NULL); // The writer task stores the id
+    return ESP_OK;
+}
+
+void session_catalog_cancel_pending(void)
+{
+    if (!sessions)
+        return;
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    pending_id = 0;
+    xSemaphoreGive(index_mutex);
+}
+
+uint32_t session_catalog_open(const char *file_path)
+{
+    if (!sessions)
+        return 0;
+
+    uint32_t hash = cfg_hash(settings_get_channel_configs());
+    size_t prefix_len = strlen(mount_prefix);
+    const char *rel = strncmp(file_path, mount_prefix, prefix_len) == 0 ? file_path + prefix_len + 1 : file_path;
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    bool fresh = pending_id == 0;
+    session_info_t *s = index_append();
+    s->id = fresh ? ++last_id : pending_id;
+    s->start = time(NULL);
+    s->cfg_hash = hash;
+    copy_str(s->file, sizeof(s->file), rel);
+    copy_str(s->tags, sizeof(s->tags), fresh ? "" : pending_tags);
+    copy_str(s->note, sizeof(s->note), fresh ? "" : pending_note);
+    pending_id = 0;
+    current_id = s->id;
+
+    cJSON *rec = cJSON_CreateObject();
+    if (rec)
+    {
+        cJSON_AddStringToObject(rec, "ev", "start");
+        cJSON_AddNumberToObject(rec, "id", s->id);
+        cJSON_AddNumberToObject(rec, "t", (double)s->start);
+        cJSON *files = cJSON_AddArrayToObject(rec, "files");
+        if (files)
+            cJSON_AddItemToArray(files, cJSON_CreateString(s->file));
+        cJSON_AddNumberToObject(rec, "cfg", s->cfg_hash);
+        cJSON_AddStringToObject(rec, "tags", s->tags);
+        cJSON_AddStringToObject(rec, "note", s->note);
+    }
+    uint32_t id = s->id;
+    xSemaphoreGive(index_mutex);
+
+    if (rec)
+        append_record(rec); // The writer task also stores the new id
+    ESP_LOGI(TAG, "Session %lu started: %s", (unsigned long)id, rel);
+    return id;
+}
+
+void session_catalog_close(const session_summary_t *summary)
+{
+    if (!sessions)
+        return;
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    uint32_t id = current_id;
+    session_info_t *s = id ? find_by_id(id) : NULL;
+    current_id = 0;
+    time_t now = time(NULL);
+    if (s)
+    {
+        s->end = now;
+        s->summary = *summary;
+        s->has_summary = true;
+    }
+    xSemaphoreGive(index_mutex);
+    if (!id)
+        return;
+
+    cJSON *rec = cJSON_CreateObject();
+    if (rec)
+    {
+        cJSON_AddStringToObject(rec, "ev", "end");
+        cJSON_AddNumberToObject(rec, "id", id);
+        cJSON_AddNumberToObject(rec, "t", (double)now);
+        cJSON_AddNumberToObject(rec, "rows", summary->rows);
+        cJSON_AddNumberToObject(rec, "bytes", summary->bytes);
+        add_float_array(rec, "min", summary->min);
+        add_float_array(rec, "max", summary->max);
+        add_float_array(rec, "mean", summary->mean);
+        append_record(rec);
+    }
+    ESP_LOGI(TAG, "Session %lu ended: %lu rows", (unsigned long)id, (unsigned long)summary->rows);
+}
+
+esp_err_t session_catalog_add_marker(uint32_t ms, uint32_t row, uint32_t frame, const char *text)
+{
+    if (!sessions)
+        return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    uint32_t id = current_id;
+    if (!id)
+    {
+        xSemaphoreGive(index_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    session_marker_t *m = marker_append(id);
+    m->t = time(NULL);
+    m->ms = ms;
+    m->row = row;
+    m->frame = frame;
+    copy_str(m->text, sizeof(m->text), text);
+
+    cJSON *rec = cJSON_CreateObject();
+    if (rec)
+    {
+        cJSON_AddStringToObject(rec, "ev", "marker");
+        cJSON_AddNumberToObject(rec, "id", id);
+        cJSON_AddNumberToObject(rec, "t", (double)m->t);
+        cJSON_AddNumberToObject(rec, "ms", ms);
+        cJSON_AddNumberToObject(rec, "row", row);
+        cJSON_AddNumberToObject(rec, "frame", frame);
+        cJSON_AddStringToObject(rec, "text", m->text);
+    }
+    xSemaphoreGive(index_mutex);
+
+    if (rec)
+        append_record(rec);
+    return ESP_OK;
+}
+
+size_t session_catalog_markers(uint32_t id, session_marker_t *out, size_t max, bool *truncated)
+{
+    size_t found = 0, matched = 0;
+    *truncated = false;
+    if (!sessions)
+        return 0;
+
+    // Older markers of the session may have left the index; they are then read from the file.
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    bool from_file = markers_evicted && (marker_count == 0 || id <= markers[0].session);
+    xSemaphoreGive(index_mutex);
+    if (from_file)
+    {
+        markers_ctx_t ctx = {.id = id, .out = out, .max = max};
+        if (scan_file(markers_record, &ctx) != ESP_OK)
+            *truncated = true;
+        found = ctx.count < max ? ctx.count : max;
+        matched = ctx.count;
+    }
+
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    for (size_t i = 0; i < marker_count; i++)
+    {
+        const session_marker_t *m = &markers[i];
+        if (m->session != id)
+            continue;
+        if (from_file)
+        {
+            // Markers already in the file were found by the scan; only queued ones are new here.
+            bool seen = false;
+            for (size_t j = 0; j < found && !seen; j++)
+                seen = out[j].ms == m->ms && out[j].frame == m->frame && strcmp(out[j].text, m->text) == 0;
+            if (seen)
+                continue;
+        }
+        if (found < max)
+            out[found++] = *m;
+        matched++;
+    }
+    xSemaphoreGive(index_mutex);
+    if (matched > found)
+        *truncated = true;
+    return found;
+}
+
+uint32_t session_catalog_current(void)
+{
+    return current_id;
+}
+
+size_t session_catalog_find(const session_query_t *query, session_info_t *out, size_t max, size_t *total,
+                            bool *truncated)
+{
+    size_t found = 0, matched = 0;
+    *truncated = false;
+    if (!sessions)
+    {
+        if (total)
+            *total = 0;
+        return 0;
+    }
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    for (size_t i = session_count; i > 0; i--)
+    {
+        const session_info_t *s = &sessions[i - 1];
+        if (!matches(s, query))
+            continue;
+        if (found < max)
+            out[found++] = *s;
+        matched++;
+    }
+    bool from_file = sessions_evicted;
+    uint32_t below = session_count ? sessions[0].id : UINT32_MAX;
+    xSemaphoreGive(index_mutex);
+
+    if (from_file)
+    {
+        // Sessions older than the index: keep the latest matches in the rest of out.
+        find_ctx_t ctx = {.query = query, .below = below, .ring = out + found, .size = max - found};
+        if (scan_file(find_record, &ctx) != ESP_OK)
+            *truncated = true;
+        size_t n = ctx.count < ctx.size ? ctx.count : ctx.size;
+        size_t oldest = ctx.size > 0 && ctx.count > ctx.size ? ctx.count % ctx.size : 0;
+        // The ring holds [oldest..n) then [0..oldest), oldest first; reversing both runs gives newest first.
+        reverse_sessions(ctx.ring, oldest);
+        reverse_sessions(ctx.ring + oldest, n - oldest);
+        found += n;
+        matched += ctx.count;
+    }
+    if (total)
+        *total = matched;
+    return found;
+}
+
+esp_err_t session_catalog_get(uint32_t id, session_info_t *out)
+{
+    if (!sessions)
+        return ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    session_info_t *s = find_by_id(id);
+    if (s)
+        *out = *s;
+    bool from_file = !s && sessions_evicted && (session_count == 0 || id < sessions[0].id);
+    xSemaphoreGive(index_mutex);
+    if (s)
+        return ESP_OK;
+    if (!from_file)
+        return ESP_ERR_NOT_FOUND;
+
+    // An older session: look it up in the file (a search that only its id matches).
+    session_query_t any = {0};
+    find_ctx_t ctx = {.query = &any, .below = id + 1, .ring = out, .size = 1};
+    scan_file(find_record, &ctx);
+    return ctx.count > 0 && out->id == id ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void session_catalog_clear(void)
+{
+    if (!sessions)
+        return;
+    xSemaphoreTake(index_mutex, portMAX_DELAY);
+    session_count = 0;
+    marker_count = 0;
+    sessions_evicted = false;
+    markers_evicted = false;
+    xSemaphoreGive(index_mutex);
+}
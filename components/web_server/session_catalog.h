@@ -0,0 +1,190 @@
+// session_catalog.h
+// This header defines the public API for the logging session catalog.
+// Every logging session gets an id and, optionally, tags and a note. Its start and end are
+// appended as JSON lines to sessions.jsonl in the card root (never rewritten, so a power loss
+// can at most lose the last line), together with the log file, a hash of the channel
+// configuration and per-channel summary statistics. At mount the file is read once into an
+// in-memory index of the newest sessions and markers, so listing and searching them usually
+// does not touch the card; a lookup that reaches past the index streams the file instead.
+// Markers set while a session runs are appended to the same file and indexed with it, so the
+// markers of a session can be listed without scanning its log file.
+// Records are written by a background task, so starting or ending a session and setting a
+// marker never wait for the card.
+
+#ifndef SESSION_CATALOG_H_
+#define SESSION_CATALOG_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include <time.h>      // For time_t
+#include "esp_err.h"   // For esp_err_t
+#include "settings.h"  // For NUM_CHANNELS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def SESSION_CATALOG_FILE
+ * @brief Name of the catalog file, relative to the mount point.
+ */
+#define SESSION_CATALOG_FILE "sessions.jsonl"
+
+#define SESSION_FILE_MAX 64  ///< Maximum length (including null terminator) of the log file name.
+#define SESSION_TAGS_MAX 64  ///< Maximum length (including null terminator) of the comma separated tags.
+#define SESSION_NOTE_MAX 96  ///< Maximum length (including null terminator) of the note.
+#define SESSION_MARKER_TEXT_MAX 48  ///< Maximum length (including null terminator) of a marker label.
+
+/**
+ * @struct session_summary_t
+ * @brief Summary statistics of a finished session, computed by the acquisition task.
+ */
+typedef struct {
+    uint32_t rows;                 ///< Rows logged.
+    uint32_t bytes;                ///< Size of the log file.
+    float min[NUM_CHANNELS];       ///< Smallest value per channel.
+    float max[NUM_CHANNELS];       ///< Largest value per channel.
+    float mean[NUM_CHANNELS];      ///< Mean value per channel.
+} session_summary_t;
+
+/**
+ * @struct session_info_t
+ * @brief One session as held in the in-memory index.
+ */
+typedef struct {
+    uint32_t id;                   ///< Session id (increasing, never reused).
+    time_t start;                  ///< Start time (system clock).
+    time_t end;                    ///< End time, 0 while the session is running or if it never ended (power loss).
+    uint32_t cfg_hash;             ///< CRC32 of the channel configuration (scaling factors and units) in use.
+    char file[SESSION_FILE_MAX];   ///< Log file, relative to the mount point.
+    char tags[SESSION_TAGS_MAX];   ///< Comma separated tags.
+    char note[SESSION_NOTE_MAX];   ///< Free text note.
+    uint32_t markers;              ///< Markers set during the session.
+    bool has_summary;              ///< True if the session ended and summary holds its statistics.
+    session_summary_t summary;     ///< Summary statistics.
+} session_info_t;
+
+/**
+ * @struct session_marker_t
+ * @brief One marker, located by the frame and log row it precedes.
+ */
+typedef struct {
+    uint32_t session;              ///< Id of the session the marker belongs to.
+    time_t t;                      ///< Time the marker was set (system clock).
+    uint32_t ms;                   ///< Time the marker was requested (milliseconds since boot, the log time base).
+    uint32_t row;                  ///< Number of data rows logged before the marker.
+    uint32_t frame;                ///< Sequence number of the first frame after the marker.
+    char text[SESSION_MARKER_TEXT_MAX]; ///< Label.
+} session_marker_t;
+
+/**
+ * @struct session_query_t
+ * @brief Filter for session_catalog_find(). Empty strings and zero times match everything.
+ */
+typedef struct {
+    const char *tag;               ///< Session must carry exactly this tag.
+    const char *text;              ///< Substring of the tags, note or file name.
+    time_t from;                   ///< Session must have started at or after this time.
+    time_t to;                     ///< Session must have started before this time.
+} session_query_t;
+
+/**
+ * @brief Loads the catalog file into the in-memory index. Call once after the SD card is mounted.
+ * @param mount_point Mount point of the SD card (e.g. "/sdcard").
+ * @return esp_err_t ESP_OK on success (also if the catalog file does not exist yet),
+ *         ESP_ERR_NO_MEM if the index could not be allocated.
+ */
+esp_err_t session_catalog_init(const char *mount_point);
+
+/**
+ * @brief Reserves the id of the next session and attaches tags and a note to it.
+ * The session itself begins when the log file is opened (session_catalog_open()).
+ * @param tags Comma separated tags, or NULL.
+ * @param note Note, or NULL.
+ * @param out_id Receives the session id.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if a session is already pending or running.
+ */
+esp_err_t session_catalog_prepare(const char *tags, const char *note, uint32_t *out_id);
+
+/**
+ * @brief Drops a prepared session that was never opened (e.g. logging could not be started),
+ * so its tags and note are not attached to a later, unrelated start.
+ */
+void session_catalog_cancel_pending(void);
+
+/**
+ * @brief Starts a session for a newly opened log file and appends its start record.
+ * Uses the prepared id, tags and note if session_catalog_prepare() was called; otherwise
+ * (logging started by the button or the schedule) a new untagged session is created.
+ * @param file_path Full path of the log file.
+ * @return uint32_t Id of the session, 0 if the catalog is not available.
+ */
+uint32_t session_catalog_open(const char *file_path);
+
+/**
+ * @brief Ends the running session and appends its end record with the summary statistics.
+ * @param summary Statistics of the session.
+ */
+void session_catalog_close(const session_summary_t *summary);
+
+/**
+ * @brief Adds a marker to the running session and appends its record.
+ * @param ms Time the marker was requested (milliseconds since boot).
+ * @param row Number of data rows logged so far in the session.
+ * @param frame Sequence number of the next frame.
+ * @param text Label.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if no session is running.
+ */
+esp_err_t session_catalog_add_marker(uint32_t ms, uint32_t row, uint32_t frame, const char *text);
+
+/**
+ * @brief Copies the markers of a session, oldest first. Markers that have left the in-memory
+ * index are read from the catalog file.
+ * @param id Session id.
+ * @param out Array receiving the markers.
+ * @param max Size of the out array.
+ * @param truncated Set to true if the session has more markers than max, or if the catalog
+ *        file could not be read completely; false if out holds all of them.
+ * @return size_t Number of markers written to out.
+ */
+size_t session_catalog_markers(uint32_t id, session_marker_t *out, size_t max, bool *truncated);
+
+/**
+ * @brief Returns the id of the running session, 0 if none.
+ */
+uint32_t session_catalog_current(void);
+
+/**
+ * @brief Finds sessions matching a filter, newest first. Once sessions have left the in-memory
+ * index, the older ones are found by streaming the catalog file.
+ * @param query Filter (NULL for all sessions).
+ * @param out Array receiving the matching sessions.
+ * @param max Size of the out array.
+ * @param total Receives the total number of matches (may be larger than max), or NULL.
+ * @param truncated Set to true if the catalog file could not be read completely, so older
+ *        matches may be missing from out and total.
+ * @return size_t Number of sessions written to out.
+ */
+size_t session_catalog_find(const session_query_t *query, session_info_t *out, size_t max, size_t *total,
+                            bool *truncated);
+
+/**
+ * @brief Looks up one session by id, in the catalog file if it has left the in-memory index.
+ * @param id Session id.
+ * @param out Receives the session.
+ * @return esp_err_t ESP_OK if found, ESP_ERR_NOT_FOUND otherwise.
+ */
+esp_err_t session_catalog_get(uint32_t id, session_info_t *out);
+
+/**
+ * @brief Empties the in-memory index after the catalog file was deleted (e.g. by /delete_all).
+ * Session ids keep increasing.
+ */
+void session_catalog_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SESSION_CATALOG_H_ */
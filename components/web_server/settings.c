@@ -1,13 +1,23 @@
 // settings.c
 // Implements a module for managing application settings, including logging preferences
 // and channel configurations, using ESP-IDF's Non-Volatile Storage (NVS) component.
+// Changes are applied to RAM at once and marked dirty; a one-shot esp_timer commits them
+// after a quiet period, so a burst of changes costs one NVS commit. Only keys whose value
+// differs from what is already in flash are written. A failed commit is retried with a growing
+// delay. A shutdown handler commits pending changes before esp_restart().
+// Only the settings of this module are coalesced: alarm limits, the schedule and the time zone
+// are rare, explicit saves that are committed at once, so their API reports the NVS result.
 
 #include "settings.h"
-#include "nvs_flash.h" // For NVS initialization and deinitialization
-#include "nvs.h"       // For NVS read/write operations
-#include "esp_log.h"   // For ESP-IDF logging
-#include "esp_err.h"   // For esp_err_t error codes
-#include <string.h>    // Required for memcpy for safe structure copying
+#include "nvs_flash.h"         // For NVS initialization and deinitialization
+#include "nvs.h"               // For NVS read/write operations
+#include "esp_log.h"           // For ESP-IDF logging
+#include "esp_err.h"           // For esp_err_t error codes
+#include "esp_timer.h"         // For the commit timer and commit latency
+#include "esp_system.h"        // For esp_register_shutdown_handler
+#include "freertos/FreeRTOS.h" // For the spinlock protecting the dirty state
+#include "freertos/semphr.h"   // For the commit mutex
+#include <string.h>            // Required for memcpy for safe structure copying
 
 // --- Module Constants ---
 static const char *TAG = "settings";
@@ -17,6 +27,14 @@ static const char *TAG = "settings";
 #define KEY_LOG_ON_BOOT "log_on_boot"   // Key for the boolean logging flag.
 #define KEY_CHAN_CONFIGS "chan_configs" // Key for storing all channel configurations as a blob.
 
+// Coalescing of commits.
+#define COMMIT_QUIET_MS 2000    // Commit once no change arrived for this long.
+#define COMMIT_MAX_DELAY_MS 30000 // Upper bound on how long a change may wait, even if changes keep coming.
+#define COMMIT_RETRY_MIN_MS 1000  // Delay before the first retry of a failed commit.
+#define COMMIT_RETRY_MAX_MS 60000 // Longest delay between retries (doubled after every failure).
+#define DIRTY_LOG_ON_BOOT (1u << 0)
+#define DIRTY_CHAN_CONFIGS (1u << 1)
+
 // --- Global Static Variables ---
 /**
  * @brief Internal array in RAM that holds configurations for all NUM_CHANNELS.
@@ -25,6 +43,19 @@ static const char *TAG = "settings";
  * and reduces flash wear. 'static' limits its scope to this file.
  */
 static channel_config_t channel_configs[NUM_CHANNELS];
+static bool log_on_boot = false;                          // RAM copy of 'log_on_boot'.
+
+// Values as they are in flash, to skip writes that would not change anything.
+static channel_config_t stored_configs[NUM_CHANNELS];
+static bool stored_log_on_boot = false;
+
+static portMUX_TYPE state_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the RAM copies, dirty and first_dirty_us.
+static uint32_t dirty = 0;                                // DIRTY_* bits of changes not yet committed.
+static int64_t first_dirty_us = 0;                        // Time of the oldest uncommitted change.
+static esp_timer_handle_t commit_timer = NULL;
+static SemaphoreHandle_t commit_mutex = NULL;             // Serializes commits (timer and flush).
+static uint32_t retry_ms = 0;                             // Delay of the next retry, 0 after a success (under commit_mutex).
+static settings_persist_stats_t stats;                    // Persistence counters (under state_lock).
 
 // --- Private Utility Function ---
 /**
@@ -43,6 +74,153 @@ static void set_default_channel_configs() {
     }
 }
 
+/**
+ * @brief Writes the dirty settings to NVS with a single commit.
+ * The RAM values are copied under the lock, so changes made during the (slow) flash write
+ * stay dirty and are committed by the next round.
+ * @return esp_err_t ESP_OK on success (also if nothing was dirty), or the NVS error.
+ */
+static esp_err_t commit_dirty(void) {
+    channel_config_t configs[NUM_CHANNELS];
+    bool lob;
+
+    if (!commit_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(commit_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&state_lock);
+    uint32_t pending = dirty;
+    dirty = 0;
+    memcpy(configs, channel_configs, sizeof(configs));
+    lob = log_on_boot;
+    portEXIT_CRITICAL(&state_lock);
+
+    // Drop keys whose value is already in flash (e.g. a setting changed and changed back).
+    if ((pending & DIRTY_LOG_ON_BOOT) && lob == stored_log_on_boot) {
+        pending &= ~DIRTY_LOG_ON_BOOT;
+    }
+    if ((pending & DIRTY_CHAN_CONFIGS) && memcmp(configs, stored_configs, sizeof(configs)) == 0) {
+        pending &= ~DIRTY_CHAN_CONFIGS;
+    }
+    if (pending == 0) {
+        xSemaphoreGive(commit_mutex);
+        return ESP_OK;
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    uint32_t writes = 0;
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK) {
+        if (pending & DIRTY_LOG_ON_BOOT) {
+            err = nvs_set_u8(nvs_handle, KEY_LOG_ON_BOOT, lob ? 1 : 0);
+            writes++;
+        }
+        if (err == ESP_OK && (pending & DIRTY_CHAN_CONFIGS)) {
+            // Write the entire array of structures as a single 'blob' to NVS.
+            err = nvs_set_blob(nvs_handle, KEY_CHAN_CONFIGS, configs, sizeof(configs));
+            writes++;
+        }
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs_handle); // Commit changes to physical flash memory.
+        }
+        nvs_close(nvs_handle);
+    }
+    uint32_t latency_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    if (err == ESP_OK) {
+        if (pending & DIRTY_LOG_ON_BOOT) {
+            stored_log_on_boot = lob;
+        }
+        if (pending & DIRTY_CHAN_CONFIGS) {
+            memcpy(stored_configs, configs, sizeof(stored_configs));
+        }
+    }
+
+    portENTER_CRITICAL(&state_lock);
+    if (err == ESP_OK) {
+        stats.commits++;
+        stats.nvs_writes += writes;
+        stats.last_commit_us = latency_us;
+        if (latency_us > stats.max_commit_us) {
+            stats.max_commit_us = latency_us;
+        }
+    } else {
+        stats.failures++;
+        dirty |= pending; // Retried by the timer below, or earlier with the next change or flush
+    }
+    portEXIT_CRITICAL(&state_lock);
+    if (err == ESP_OK) {
+        retry_ms = 0;
+    } else {
+        retry_ms = retry_ms ? retry_ms * 2 : COMMIT_RETRY_MIN_MS;
+        if (retry_ms > COMMIT_RETRY_MAX_MS) {
+            retry_ms = COMMIT_RETRY_MAX_MS;
+        }
+        if (commit_timer) {
+            esp_timer_stop(commit_timer); // Fails harmlessly if it is not running
+            esp_timer_start_once(commit_timer, (uint64_t)retry_ms * 1000);
+        }
+    }
+    uint32_t next_retry_ms = retry_ms;
+    xSemaphoreGive(commit_mutex);
+
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Settings committed to NVS (%lu key(s), %lu us)", (unsigned long)writes, (unsigned long)latency_us);
+    } else {
+        ESP_LOGE(TAG, "Error committing settings: %s (retry in %lu ms)", esp_err_to_name(err), (unsigned long)next_retry_ms);
+    }
+    return err;
+}
+
+/**
+ * @brief Timer callback: the quiet period has passed (esp_timer task context).
+ */
+static void commit_timer_cb(void *arg) {
+    commit_dirty();
+}
+
+/**
+ * @brief Shutdown handler: commits pending changes before a restart.
+ */
+static void settings_shutdown_handler(void) {
+    settings_flush();
+}
+
+/**
+ * @brief Marks settings as changed. Must be called with state_lock held.
+ */
+static void mark_dirty_locked(uint32_t bits, int64_t now_us) {
+    if (dirty == 0) {
+        first_dirty_us = now_us;
+    } else {
+        stats.coalesced++; // Absorbed into a commit that was already pending
+    }
+    dirty |= bits;
+    stats.changes++;
+}
+
+/**
+ * @brief (Re)starts the commit timer. Each change pushes the commit back by COMMIT_QUIET_MS,
+ * but never beyond COMMIT_MAX_DELAY_MS after the oldest uncommitted change.
+ */
+static void schedule_commit(void) {
+    if (!commit_timer) {
+        commit_dirty(); // Timer not available: write through
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    portENTER_CRITICAL(&state_lock);
+    int64_t deadline_us = first_dirty_us + (int64_t)COMMIT_MAX_DELAY_MS * 1000;
+    portEXIT_CRITICAL(&state_lock);
+    int64_t delay_us = (int64_t)COMMIT_QUIET_MS * 1000;
+    if (now_us + delay_us > deadline_us) {
+        delay_us = deadline_us > now_us ? deadline_us - now_us : 0;
+    }
+    esp_timer_stop(commit_timer); // Fails harmlessly if it is not running
+    esp_timer_start_once(commit_timer, (uint64_t)delay_us);
+}
+
 // --- Public Function Implementations ---
 
 /**
@@ -61,12 +239,26 @@ void settings_init(void) {
     }
     ESP_ERROR_CHECK(err); // Propagate any persistent NVS initialization errors.
 
+    // Commit machinery: the timer coalesces changes, the shutdown handler flushes them on restart.
+    commit_mutex = xSemaphoreCreateMutex();
+    const esp_timer_create_args_t timer_args = {
+        .callback = commit_timer_cb,
+        .name = "settings_commit",
+    };
+    if (!commit_mutex || esp_timer_create(&timer_args, &commit_timer) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create the commit timer; settings are written through.");
+        commit_timer = NULL;
+    }
+    esp_register_shutdown_handler(settings_shutdown_handler);
+
     // Open NVS for reading all settings.
     nvs_handle_t nvs_handle;
     err = nvs_open(NAMESPACE, NVS_READONLY, &nvs_handle);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open NVS namespace: %s. Using default settings for all.", esp_err_to_name(err));
         set_default_channel_configs(); // Fallback to defaults if NVS cannot be opened.
+        stored_log_on_boot = log_on_boot;
+        memcpy(stored_configs, channel_configs, sizeof(stored_configs));
         return; // Exit as further reading is not possible.
     }
 
@@ -74,9 +266,7 @@ void settings_init(void) {
     uint8_t log_on_boot_val = 0; // Default value if not found
     err = nvs_get_u8(nvs_handle, KEY_LOG_ON_BOOT, &log_on_boot_val);
     if (err == ESP_OK) {
-        // Current implementation of settings_get_log_on_boot reads from NVS directly.
-        // If it were to read from a global variable, we would update it here.
-        // For now, this is just for logging the loaded value.
+        log_on_boot = log_on_boot_val != 0;
         ESP_LOGI(TAG, "Loaded setting 'log_on_boot' = %d", log_on_boot_val);
     } else if (err == ESP_ERR_NVS_NOT_FOUND) {
         ESP_LOGI(TAG, "'log_on_boot' setting not found, defaulting to 0.");
@@ -107,49 +297,31 @@ void settings_init(void) {
 
     // Close the NVS handle after all readings are complete.
     nvs_close(nvs_handle);
+
+    // Defaults count as stored: they are only written once something is changed.
+    stored_log_on_boot = log_on_boot;
+    memcpy(stored_configs, channel_configs, sizeof(stored_configs));
 }
 
 /**
- * @brief Retrieves the current 'log_on_boot' setting from NVS.
- * Note: This function reads directly from NVS each time it is called.
+ * @brief Retrieves the current 'log_on_boot' setting from its RAM copy.
  * @return bool True if automatic logging on boot is enabled, false otherwise.
  */
 bool settings_get_log_on_boot(void) {
-    nvs_handle_t nvs_handle;
-    uint8_t val = 0; // Default to false if not found or error
-    esp_err_t err = nvs_open(NAMESPACE, NVS_READONLY, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGW(TAG, "Failed to open NVS in settings_get_log_on_boot: %s", esp_err_to_name(err));
-        return false;
-    }
-    nvs_get_u8(nvs_handle, KEY_LOG_ON_BOOT, &val); // Read the value
-    nvs_close(nvs_handle);
-    return (val != 0); // Convert u8 to bool
+    return log_on_boot;
 }
 
 /**
- * @brief Sets the 'log_on_boot' setting and saves it to NVS.
+ * @brief Sets the 'log_on_boot' setting in RAM and schedules its commit to NVS.
  * @param enabled Boolean value; true to enable, false to disable.
  */
 void settings_set_log_on_boot(bool enabled) {
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for writing in settings_set_log_on_boot: %s", esp_err_to_name(err));
-        return;
-    }
-    err = nvs_set_u8(nvs_handle, KEY_LOG_ON_BOOT, enabled ? 1 : 0);
-    if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle); // Commit changes to flash
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "Saved: log_on_boot = %d", enabled);
-        } else {
-            ESP_LOGE(TAG, "Error committing 'log_on_boot': %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGE(TAG, "Error setting 'log_on_boot' in NVS: %s", esp_err_to_name(err));
-    }
-    nvs_close(nvs_handle);
+    portENTER_CRITICAL(&state_lock);
+    log_on_boot = enabled;
+    mark_dirty_locked(DIRTY_LOG_ON_BOOT, esp_timer_get_time());
+    portEXIT_CRITICAL(&state_lock);
+    ESP_LOGI(TAG, "Set: log_on_boot = %d", enabled);
+    schedule_commit();
 }
 
 /**
@@ -163,40 +335,54 @@ const channel_config_t* settings_get_channel_configs(void) {
 }
 
 /**
- * @brief Saves new channel configurations to NVS flash memory.
- * The entire array of NUM_CHANNELS structures is saved as a single blob.
- * The internal RAM copy (`channel_configs`) is also updated after successful NVS write.
+ * @brief Applies new channel configurations and schedules their commit to NVS.
+ * The internal RAM copy (`channel_configs`) is updated at once; the entire array of
+ * NUM_CHANNELS structures is written as a single blob when the commit timer expires.
  * @param configs Pointer to an array of NUM_CHANNELS `channel_config_t` structures to save.
- * @return esp_err_t Returns ESP_OK on success, or an error code otherwise.
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_ARG if configs is NULL.
  */
 esp_err_t settings_save_channel_configs(const channel_config_t* configs) {
     if (!configs) {
         return ESP_ERR_INVALID_ARG;
     }
 
-    nvs_handle_t nvs_handle;
-    esp_err_t err = nvs_open(NAMESPACE, NVS_READWRITE, &nvs_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to open NVS for writing channel configs: %s", esp_err_to_name(err));
-        return err;
-    }
+    portENTER_CRITICAL(&state_lock);
+    memcpy(channel_configs, configs, sizeof(channel_configs));
+    mark_dirty_locked(DIRTY_CHAN_CONFIGS, esp_timer_get_time());
+    portEXIT_CRITICAL(&state_lock);
+    ESP_LOGI(TAG, "Channel configurations updated.");
+    schedule_commit();
+    return ESP_OK;
+}
 
-    // Write the entire array of structures as a single 'blob' to NVS.
-    err = nvs_set_blob(nvs_handle, KEY_CHAN_CONFIGS, configs, sizeof(channel_configs));
-    if (err == ESP_OK) {
-        err = nvs_commit(nvs_handle); // Commit changes to physical flash memory.
-        if (err == ESP_OK) {
-            ESP_LOGI(TAG, "Channel configurations successfully saved to NVS.");
-            // Update the internal global variable in RAM to be synchronized
-            // with what was just saved to NVS.
-            memcpy(channel_configs, configs, sizeof(channel_configs));
-        } else {
-            ESP_LOGE(TAG, "Error committing channel configurations: %s", esp_err_to_name(err));
-        }
-    } else {
-        ESP_LOGE(TAG, "Error setting channel configurations blob in NVS: %s", esp_err_to_name(err));
+/**
+ * @brief Commits pending changes to NVS at once.
+ * Stops the commit timer first, so the same changes are not committed twice.
+ * @return esp_err_t ESP_OK on success (also if nothing was pending), or the NVS error.
+ */
+esp_err_t settings_flush(void) {
+    if (commit_timer) {
+        esp_timer_stop(commit_timer);
+    }
+    if (!commit_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    portENTER_CRITICAL(&state_lock);
+    bool pending = dirty != 0;
+    if (pending) {
+        stats.flushes++;
     }
+    portEXIT_CRITICAL(&state_lock);
+    return pending ? commit_dirty() : ESP_OK;
+}
 
-    nvs_close(nvs_handle);
-    return err;
-}
\ No newline at end of file
+/**
+ * @brief Copies the persistence counters.
+ * @param out Destination.
+ */
+void settings_get_persist_stats(settings_persist_stats_t *out) {
+    portENTER_CRITICAL(&state_lock);
+    *out = stats;
+    out->pending = dirty != 0;
+    portEXIT_CRITICAL(&state_lock);
+}
@@ -6,6 +6,7 @@
 #define SETTINGS_H_
 
 #include <stdbool.h> // For boolean type 'bool', 'true', 'false'
+#include <stdint.h>  // For fixed width integer types
 #include "esp_err.h" // For esp_err_t and ESP_OK, ESP_FAIL etc.
 
 #ifdef __cplusplus
@@ -53,6 +54,23 @@ typedef struct {
 } channel_config_t;
 
 
+/**
+ * @struct settings_persist_stats_t
+ * @brief Counters of the settings persistence layer.
+ */
+typedef struct {
+    uint32_t changes;        ///< Setting changes applied to RAM.
+    uint32_t coalesced;      ///< Changes that joined a commit that was already pending.
+    uint32_t commits;        ///< Successful NVS commits.
+    uint32_t nvs_writes;     ///< Keys written to NVS (unchanged keys are skipped).
+    uint32_t flushes;        ///< Commits forced by settings_flush() (e.g. before a restart).
+    uint32_t failures;       ///< Failed commits (the changes stay pending).
+    uint32_t last_commit_us; ///< Duration of the last commit (open, writes and nvs_commit).
+    uint32_t max_commit_us;  ///< Longest commit since boot.
+    bool pending;            ///< True if changes are waiting for the commit timer.
+} settings_persist_stats_t;
+
+
 // --- Public Function Declarations ---
 
 /**
@@ -66,13 +84,14 @@ void settings_init(void);
 
 /**
  * @brief Retrieves the current value of the 'log_on_boot' setting.
- * This function reads the value directly from NVS each time it's called.
+ * The value is kept in RAM (loaded by `settings_init()`), so no flash access is made.
  * @return bool True if automatic logging on boot is enabled, false otherwise.
  */
 bool settings_get_log_on_boot(void);
 
 /**
- * @brief Sets the 'log_on_boot' setting and persistently saves it to NVS flash.
+ * @brief Sets the 'log_on_boot' setting. The change takes effect at once and is committed
+ * to NVS flash together with other changes after a quiet period (see `settings_flush()`).
  * @param enabled Boolean value; true to enable, false to disable.
  */
 void settings_set_log_on_boot(bool enabled);
@@ -88,16 +107,31 @@ void settings_set_log_on_boot(bool enabled);
 const channel_config_t* settings_get_channel_configs(void);
 
 /**
- * @brief Saves new channel configurations to NVS flash memory.
+ * @brief Saves new channel configurations.
  * This function takes a pointer to an array of NUM_CHANNELS `channel_config_t`
- * structures and saves the entire array as a single "blob" in NVS. After
- * successful flash write, it also updates the internal RAM copy to ensure
- * settings are immediately active.
+ * structures and copies it to the internal RAM copy, so the settings are
+ * immediately active. The entire array is written to NVS as a single "blob"
+ * once no further change arrived for a few seconds; a burst of changes
+ * (e.g. the settings page saving everything at once) costs one NVS commit.
  * @param configs Pointer to an array of NUM_CHANNELS `channel_config_t` structures to save.
- * @return esp_err_t Returns ESP_OK on success, or an error code otherwise.
+ * @return esp_err_t Returns ESP_OK on success, ESP_ERR_INVALID_ARG if configs is NULL.
  */
 esp_err_t settings_save_channel_configs(const channel_config_t* configs);
 
+/**
+ * @brief Commits pending setting changes to NVS immediately.
+ * Registered as a shutdown handler, so esp_restart() never loses a change; call it
+ * directly before any other deliberate power-down.
+ * @return esp_err_t ESP_OK on success (also if nothing was pending), or the NVS error.
+ */
+esp_err_t settings_flush(void);
+
+/**
+ * @brief Copies the counters of the settings persistence layer.
+ * @param out Destination.
+ */
+void settings_get_persist_stats(settings_persist_stats_t *out);
+
 
 #ifdef __cplusplus
 }
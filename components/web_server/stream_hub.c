@@ -0,0 +1,395 @@
+// stream_hub.c
+// This file implements the live stream hub.
+// New clients arrive through a queue, so the table of specs and subscribers belongs to the hub
+// task alone and needs no lock. Every STREAM_HUB_POLL_MS the task reads the new frames from
+// the live frame ring, appends each frame that passes a spec's decimation to that spec's
+// buffer (formatted once) and then sends the buffer to all subscribers of the spec. A client
+// whose send fails is removed and its request completed. Every client socket gets a short send
+// timeout, so a client that stops reading is dropped after STREAM_HUB_SEND_TIMEOUT_MS instead of
+// holding up the others for the server's full send timeout. While nobody is subscribed, the task
+// blocks on the queue and costs nothing.
+
+#include "stream_hub.h"
+#include <stdio.h>             // For snprintf
+#include <string.h>            // For memset
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For the hub task
+#include "freertos/queue.h"    // For the subscription queue
+#include "freertos/semphr.h"   // For the subscriber slots
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "lwip/sockets.h"      // For the per-client send timeout
+#include "conn_budget.h"       // For the shared budget of long-lived connections
+#include "live_frame.h"        // For the frame ring
+#include "settings.h"          // For the scaling factors
+
+// --- Module Constants ---
+static const char *TAG = "stream_hub";
+
+#define STREAM_HUB_POLL_MS 50            // Interval between two batches (the ring holds ~0.6 s).
+#define STREAM_HUB_SEND_TIMEOUT_MS 250   // Longest a client may block a send before it is dropped.
+#define STREAM_HUB_BUFFER_SIZE 1024      // Formatted rows of one spec, sent as one chunk.
+#define STREAM_HUB_ROW_MAX 240           // Longest row including the SSE framing.
+#define STREAM_HUB_TASK_STACK_SIZE 4096  // Stack size of the hub task.
+#define STREAM_HUB_TASK_PRIORITY 5       // Same as the HTTP server.
+#define STREAM_HUB_EVENT_QUEUE_LENGTH 8  // Events buffered between two batches.
+#define STREAM_HUB_EVENT_NAME_MAX 16     // Longest event name including the terminator.
+#define STREAM_HUB_EVENT_DATA_MAX 128    // Longest event data including the terminator.
+
+/**
+ * @struct spec_entry_t
+ * @brief One unique spec with its decimation state and the rows formatted for it.
+ */
+typedef struct {
+    stream_spec_t spec;
+    uint32_t refs;                       // Subscribers using this spec, 0 = free entry.
+    int64_t due_us;                      // Frame time from which the next row is taken.
+    uint32_t rows;                       // Rows in buf.
+    int len;                             // Bytes in buf.
+    char buf[STREAM_HUB_BUFFER_SIZE];
+} spec_entry_t;
+
+/**
+ * @struct subscriber_t
+ * @brief One client.
+ */
+typedef struct {
+    httpd_req_t *req;                    // Asynchronous request, NULL = free entry.
+    stream_spec_t spec;                  // Spec requested (only used while queued).
+    int entry;                           // Index into specs.
+} subscriber_t;
+
+/**
+ * @struct hub_event_t
+ * @brief One queued event for the server-sent event clients.
+ */
+typedef struct {
+    char name[STREAM_HUB_EVENT_NAME_MAX];
+    char data[STREAM_HUB_EVENT_DATA_MAX];
+} hub_event_t;
+
+// --- Static Variables ---
+static QueueHandle_t join_queue = NULL;          // New subscribers, handed from the HTTP task to the hub.
+static SemaphoreHandle_t slots = NULL;           // Free subscriber places.
+static QueueHandle_t event_queue = NULL;         // Events for the server-sent event clients.
+static spec_entry_t specs[STREAM_HUB_MAX_SUBSCRIBERS];
+static subscriber_t subscribers[STREAM_HUB_MAX_SUBSCRIBERS];
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+static stream_hub_stats_t stats;                 // Updated by the hub task under stats_lock.
+
+// --- Private Utility Functions ---
+
+static bool spec_equal(const stream_spec_t *a, const stream_spec_t *b)
+{
+    return a->mask == b->mask && a->period_us == b->period_us && a->raw == b->raw &&
+           a->offsets == b->offsets && a->format == b->format;
+}
+
+/**
+ * @brief Formats the CSV header of a spec, the same as the log file header for the selected channels.
+ * @return int Length of the header, including the line end (and the SSE framing).
+ */
+static int format_header(char *out, size_t size, const stream_spec_t *spec)
+{
+    int len = snprintf(out, size, "%stimestamp", spec->format == STREAM_FORMAT_SSE ? "event: header\ndata: " : "");
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        if (spec->mask & (1u << i))
+            len += snprintf(out + len, size - len, ";adc%d", i);
+    }
+    for (int i = 0; spec->offsets && i < NUM_CHANNELS; i++)
+    {
+        if (spec->mask & (1u << i))
+            len += snprintf(out + len, size - len, ";dt%d_us", i);
+    }
+    len += snprintf(out + len, size - len, spec->format == STREAM_FORMAT_SSE ? "\n\n" : "\n");
+    return len;
+}
+
+/**
+ * @brief Formats one frame as a row, the same as log_adc_to_sd() in main.c for the selected channels.
+ * @param out Buffer with at least STREAM_HUB_ROW_MAX bytes free.
+ * @return int Length of the row, including the line end (and the SSE framing).
+ */
+static int format_row(char *out, const live_frame_t *frame, const stream_spec_t *spec, const channel_config_t *configs)
+{
+    const int max = STREAM_HUB_ROW_MAX - 2; // Room for the line end(s)
+    int len = snprintf(out, max, "%s%lu", spec->format == STREAM_FORMAT_SSE ? "data: " : "",
+                       (unsigned long)(frame->frame_us / 1000));
+    for (int i = 0; i < NUM_CHANNELS && len < max; i++)
+    {
+        if (spec->mask & (1u << i))
+        {
+            float value = frame->values[i];
+            if (spec->raw && configs[i].scaling_factor != 0.0f)
+                value /= configs[i].scaling_factor; // Back to the voltage at the ADC input
+            len += snprintf(out + len, max - len, ";%.6f", value);
+        }
+    }
+    for (int i = 0; spec->offsets && i < NUM_CHANNELS && len < max; i++)
+    {
+        if (spec->mask & (1u << i))
+            len += snprintf(out + len, max - len, ";%ld", (long)frame->offsets_us[i]);
+    }
+    if (len > max - 1)
+        len = max - 1;
+    out[len++] = '\n';
+    if (spec->format == STREAM_FORMAT_SSE)
+        out[len++] = '\n';
+    return len;
+}
+
+/**
+ * @brief Removes a subscriber and completes its request.
+ */
+static void remove_subscriber(subscriber_t *sub)
+{
+    spec_entry_t *entry = &specs[sub->entry];
+    httpd_req_async_handler_complete(sub->req);
+    sub->req = NULL;
+    entry->refs--;
+    xSemaphoreGive(slots);
+    conn_budget_give();
+    ESP_LOGI(TAG, "Client disconnected (spec mask 0x%02lx, %lu us, %s)", (unsigned long)entry->spec.mask,
+             (unsigned long)entry->spec.period_us, entry->refs ? "still shared" : "spec released");
+}
+
+/**
+ * @brief Puts a new subscriber into the table, sharing an existing spec entry if possible.
+ */
+static void add_subscriber(const subscriber_t *joining)
+{
+    int entry = -1;
+    int free_entry = -1;
+    for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS; i++)
+    {
+        if (specs[i].refs > 0 && spec_equal(&specs[i].spec, &joining->spec))
+        {
+            entry = i;
+            break;
+        }
+        if (specs[i].refs == 0 && free_entry < 0)
+            free_entry = i;
+    }
+    if (entry < 0)
+    {
+        // There are as many entries as places, so a free one always exists.
+        entry = free_entry;
+        specs[entry].spec = joining->spec;
+        specs[entry].due_us = 0;
+        specs[entry].len = 0;
+        specs[entry].rows = 0;
+    }
+    specs[entry].refs++;
+
+    for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS; i++)
+    {
+        if (subscribers[i].req == NULL)
+        {
+            subscribers[i] = *joining;
+            subscribers[i].entry = entry;
+            break;
+        }
+    }
+    ESP_LOGI(TAG, "Client connected (spec mask 0x%02lx, %lu us, %s, %s)", (unsigned long)joining->spec.mask,
+             (unsigned long)joining->spec.period_us, joining->spec.raw ? "raw" : "scaled",
+             specs[entry].refs > 1 ? "shared" : "new spec");
+}
+
+/**
+ * @brief Sends the formatted rows of a spec to all its subscribers.
+ * @return uint32_t Rows sent, counted per subscriber.
+ */
+static uint32_t flush_entry(int entry)
+{
+    spec_entry_t *e = &specs[entry];
+    uint32_t sent = 0;
+    for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS && e->len > 0; i++)
+    {
+        subscriber_t *sub = &subscribers[i];
+        if (sub->req == NULL || sub->entry != entry)
+            continue;
+        if (httpd_resp_send_chunk(sub->req, e->buf, e->len) == ESP_OK)
+            sent += e->rows;
+        else
+            remove_subscriber(sub);
+    }
+    e->len = 0;
+    e->rows = 0;
+    return sent;
+}
+
+/**
+ * @brief Sends the queued events to all server-sent event clients.
+ * @return uint32_t Events sent, counted per client.
+ */
+static uint32_t send_events(void)
+{
+    hub_event_t ev;
+    char buf[STREAM_HUB_EVENT_NAME_MAX + STREAM_HUB_EVENT_DATA_MAX + 16];
+    uint32_t sent = 0;
+    while (xQueueReceive(event_queue, &ev, 0) == pdTRUE)
+    {
+        int len = snprintf(buf, sizeof(buf), "event: %s\ndata: %s\n\n", ev.name, ev.data);
+        for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS; i++)
+        {
+            subscriber_t *sub = &subscribers[i];
+            if (sub->req == NULL || specs[sub->entry].spec.format != STREAM_FORMAT_SSE)
+                continue;
+            if (httpd_resp_send_chunk(sub->req, buf, len) == ESP_OK)
+                sent++;
+            else
+                remove_subscriber(sub);
+        }
+    }
+    return sent;
+}
+
+/**
+ * @brief FreeRTOS task that formats and sends the live streams.
+ * @param pvParam Task parameters (not used).
+ */
+static void stream_hub_task(void *pvParam)
+{
+    const channel_config_t *configs = settings_get_channel_configs();
+    subscriber_t joining;
+    live_frame_t frame;
+    uint32_t cursor = 0;
+    uint32_t active = 0;
+
+    while (1)
+    {
+        if (active == 0)
+        {
+            xQueueReceive(join_queue, &joining, portMAX_DELAY); // Idle until the first client
+            xQueueReset(event_queue);                           // Events from before are stale
+            add_subscriber(&joining);
+            cursor = live_frame_latest(); // Only frames published from now on
+        }
+        while (xQueueReceive(join_queue, &joining, 0) == pdTRUE)
+        {
+            add_subscriber(&joining);
+        }
+
+        uint32_t frames = 0, rows = 0, sent = 0, lost = 0;
+        uint32_t events_sent = send_events();
+        while (live_frame_read_next(&cursor, &frame, &lost) == ESP_OK)
+        {
+            frames++;
+            for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS; i++)
+            {
+                spec_entry_t *e = &specs[i];
+                if (e->refs == 0)
+                    continue;
+                // Decimation by time: the requested rate holds whatever the acquisition rate is.
+                if (e->spec.period_us > 0)
+                {
+                    if (frame.frame_us < e->due_us)
+                        continue;
+                    e->due_us = e->due_us + e->spec.period_us > frame.frame_us ? e->due_us + e->spec.period_us
+                                                                              : frame.frame_us + e->spec.period_us;
+                }
+                if (e->len + STREAM_HUB_ROW_MAX > STREAM_HUB_BUFFER_SIZE)
+                    sent += flush_entry(i);
+                e->len += format_row(e->buf + e->len, &frame, &e->spec, configs);
+                e->rows++;
+                rows++;
+            }
+        }
+
+        uint32_t specs_in_use = 0;
+        active = 0;
+        for (int i = 0; i < STREAM_HUB_MAX_SUBSCRIBERS; i++)
+        {
+            if (specs[i].refs > 0)
+                sent += flush_entry(i);
+            if (specs[i].refs > 0) // A failed send may have released it
+            {
+                specs_in_use++;
+                active += specs[i].refs;
+            }
+        }
+
+        portENTER_CRITICAL(&stats_lock);
+        stats.subscribers = active;
+        stats.specs = specs_in_use;
+        stats.frames += frames;
+        stats.rows += rows;
+        stats.rows_sent += sent;
+        stats.lost_frames += lost;
+        stats.events += events_sent;
+        portEXIT_CRITICAL(&stats_lock);
+
+        if (active > 0)
+            vTaskDelay(pdMS_TO_TICKS(STREAM_HUB_POLL_MS));
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t stream_hub_init(void)
+{
+    if (join_queue)
+    {
+        return ESP_OK;
+    }
+    join_queue = xQueueCreate(STREAM_HUB_MAX_SUBSCRIBERS, sizeof(subscriber_t));
+    slots = xSemaphoreCreateCounting(STREAM_HUB_MAX_SUBSCRIBERS, STREAM_HUB_MAX_SUBSCRIBERS);
+    event_queue = xQueueCreate(STREAM_HUB_EVENT_QUEUE_LENGTH, sizeof(hub_event_t));
+    if (!join_queue || !slots || !event_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create the subscription queue");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(stream_hub_task, "stream_hub", STREAM_HUB_TASK_STACK_SIZE, NULL, STREAM_HUB_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create the hub task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t stream_hub_subscribe(httpd_req_t *req, const stream_spec_t *spec)
+{
+    if (!slots || xSemaphoreTake(slots, 0) != pdTRUE)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!conn_budget_take()) // Followers of the active log file share the sockets
+    {
+        xSemaphoreGive(slots);
+        return ESP_ERR_NO_MEM;
+    }
+    char header[STREAM_HUB_ROW_MAX];
+    int len = format_header(header, sizeof(header), spec);
+    if (httpd_resp_send_chunk(req, header, len) != ESP_OK)
+    {
+        conn_budget_give();
+        xSemaphoreGive(slots);
+        return ESP_FAIL;
+    }
+    // All clients are served by one task, so one that stops reading must not stall the others for long.
+    struct timeval timeout = {.tv_sec = 0, .tv_usec = STREAM_HUB_SEND_TIMEOUT_MS * 1000};
+    setsockopt(httpd_req_to_sockfd(req), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    subscriber_t joining = {.req = req, .spec = *spec, .entry = -1};
+    xQueueSend(join_queue, &joining, portMAX_DELAY); // Never blocks: the queue has a place per slot
+    return ESP_OK;
+}
+
+void stream_hub_post_event(const char *name, const char *data)
+{
+    if (!event_queue || uxSemaphoreGetCount(slots) == STREAM_HUB_MAX_SUBSCRIBERS)
+    {
+        return; // Nobody is subscribed
+    }
+    hub_event_t ev;
+    snprintf(ev.name, sizeof(ev.name), "%s", name);
+    snprintf(ev.data, sizeof(ev.data), "%s", data);
+    xQueueSend(event_queue, &ev, 0);
+}
+
+void stream_hub_get_stats(stream_hub_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&stats_lock);
+}
@@ -0,0 +1,98 @@
+// stream_hub.h
+// This header defines the public API for the live stream hub.
+// Every live stream client subscribes with a spec: channel mask, maximum rate, raw or scaled
+// values and output format. Clients with the same spec share one entry: the hub task reads
+// each frame from the live frame ring once, decimates and formats it once per unique spec and
+// sends the same bytes to every client of that spec. A dashboard that shows one gauge at 2 Hz
+// therefore receives (and costs) one value twice per second, not every channel of every frame.
+
+#ifndef STREAM_HUB_H_
+#define STREAM_HUB_H_
+
+#include <stdbool.h>          // For boolean type
+#include <stdint.h>           // For fixed width integer types
+#include "esp_err.h"          // For esp_err_t
+#include "esp_http_server.h"  // For httpd_req_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def STREAM_HUB_MAX_SUBSCRIBERS
+ * @brief Maximum number of live stream clients (and therefore of unique specs).
+ */
+#define STREAM_HUB_MAX_SUBSCRIBERS 4
+
+/**
+ * @enum stream_format_t
+ * @brief Output format of a live stream.
+ */
+typedef enum {
+    STREAM_FORMAT_CSV, ///< Chunked CSV, the same as the log file format.
+    STREAM_FORMAT_SSE, ///< Server-sent events, one CSV row per event.
+} stream_format_t;
+
+/**
+ * @struct stream_spec_t
+ * @brief What a client wants to receive. Clients with equal specs share the formatted output.
+ */
+typedef struct {
+    uint32_t mask;            ///< Channels (bit N = channel N).
+    uint32_t period_us;       ///< Minimum time between two rows, 0 = every frame.
+    bool raw;                 ///< Voltages at the ADC input instead of scaled values.
+    bool offsets;             ///< Add the per-channel sampling offsets (dtN_us columns).
+    stream_format_t format;   ///< Output format.
+} stream_spec_t;
+
+/**
+ * @struct stream_hub_stats_t
+ * @brief Hub counters, for the status API.
+ */
+typedef struct {
+    uint32_t subscribers;     ///< Connected clients.
+    uint32_t specs;           ///< Unique specs among them.
+    uint32_t frames;          ///< Frames read from the ring.
+    uint32_t rows;            ///< Rows formatted (once per spec, not per client).
+    uint32_t rows_sent;       ///< Rows sent, counted per client.
+    uint32_t lost_frames;     ///< Frames that left the ring before the hub read them.
+    uint32_t events;          ///< Events sent to server-sent event clients (counted per event).
+} stream_hub_stats_t;
+
+/**
+ * @brief Creates the hub task. Must be called once before the first subscription.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the task or queue could not be created.
+ */
+esp_err_t stream_hub_init(void);
+
+/**
+ * @brief Adds a client. Sends the header (CSV column names) and hands the request to the hub,
+ * which sends the rows and completes the request when the client disconnects.
+ * @param req Asynchronous request (from httpd_req_async_handler_begin()), content type already set.
+ * @param spec What the client receives.
+ * @return esp_err_t ESP_OK on success (the hub owns req), ESP_ERR_NO_MEM if all places (or all
+ *         long-lived connections, see conn_budget.h) are taken,
+ *         ESP_FAIL if the header could not be sent. On error the caller still owns req.
+ */
+esp_err_t stream_hub_subscribe(httpd_req_t *req, const stream_spec_t *spec);
+
+/**
+ * @brief Sends an event (e.g. an alarm) to all server-sent event clients with the next batch.
+ * CSV clients only receive data rows. Never blocks; the event is dropped if nobody is
+ * subscribed or the event queue is full.
+ * @param name Event name (e.g. "alarm").
+ * @param data Event data, one line.
+ */
+void stream_hub_post_event(const char *name, const char *data);
+
+/**
+ * @brief Copies the hub counters.
+ * @param out Destination.
+ */
+void stream_hub_get_stats(stream_hub_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STREAM_HUB_H_ */
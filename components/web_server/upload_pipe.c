@@ -0,0 +1,244 @@
+// upload_pipe.c
+// This file implements the pipelined upload writer.
+// Two buffers circulate between two queues, like the log writer's block pool: the HTTP task
+// fills one while the writer task writes the other through the SD I/O scheduler (as
+// background traffic, so logging keeps priority). Every buffer except the last one is full,
+// and its size is a multiple of the sector size, so all writes start on a sector boundary and
+// FATFS passes them to the card driver directly, without going through its sector window.
+
+#include "upload_pipe.h"
+#include <stdbool.h>           // For boolean type
+#include <string.h>            // For memcpy
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For the writer task
+#include "freertos/queue.h"    // For the buffer queues
+#include "freertos/semphr.h"   // For the done semaphore
+#include "esp_heap_caps.h"     // For DMA capable buffers
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "sd_io.h"             // For the SD I/O scheduler
+
+// --- Module Constants ---
+static const char *TAG = "upload_pipe";
+
+#define UPLOAD_PIPE_BUFFERS 2              // Double buffering: one filling, one writing.
+#define UPLOAD_PIPE_MAX_BUFFER 16384       // Preferred buffer size (32 sectors).
+#define UPLOAD_PIPE_MIN_BUFFER 4096        // Smallest buffer size tried when memory is short.
+#define UPLOAD_PIPE_ALIGN 32               // Buffer alignment for DMA.
+#define UPLOAD_PIPE_TASK_STACK_SIZE 3072   // Stack size of the writer task.
+#define UPLOAD_PIPE_TASK_PRIORITY 5        // Same as the HTTP server, below the log writer (6).
+
+/**
+ * @struct pipe_buf_t
+ * @brief One of the two buffers.
+ */
+typedef struct {
+    uint8_t *data;  // Storage (buffer_size bytes).
+    size_t len;     // Number of used bytes.
+} pipe_buf_t;
+
+// --- Static Variables ---
+static pipe_buf_t buffers[UPLOAD_PIPE_BUFFERS];
+static pipe_buf_t end_marker;                  // Queued by upload_pipe_end(); all buffers before it are written.
+static QueueHandle_t free_queue = NULL;        // Empty buffers.
+static QueueHandle_t full_queue = NULL;        // Buffers waiting to be written.
+static SemaphoreHandle_t done_sem = NULL;      // Given by the writer task when it reaches the end marker.
+static pipe_buf_t *current = NULL;             // Buffer being filled by the HTTP task.
+static size_t buffer_size = 0;                 // Size of the buffers of the running upload.
+static FILE *target = NULL;                    // File of the running upload, NULL when idle.
+static volatile bool write_failed = false;     // Set by the writer task on a short write.
+static int64_t start_us = 0;                   // When the running upload began.
+static int64_t recv_wait_us = 0;               // HTTP task waiting for a free buffer.
+static int64_t write_idle_us = 0;              // Writer task waiting for a full buffer (writer task only).
+static uint32_t written_bytes = 0;             // Bytes written (writer task only).
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief FreeRTOS task that writes full buffers to the target file.
+ * @param pvParam Task parameters (not used).
+ */
+static void upload_pipe_task(void *pvParam)
+{
+    pipe_buf_t *buf;
+    while (1)
+    {
+        int64_t wait_start_us = esp_timer_get_time();
+        xQueueReceive(full_queue, &buf, portMAX_DELAY);
+        // Waiting before the upload began is not idle time of the upload.
+        int64_t now_us = esp_timer_get_time();
+        write_idle_us += now_us - (wait_start_us > start_us ? wait_start_us : start_us);
+
+        if (buf == &end_marker)
+        {
+            xSemaphoreGive(done_sem);
+            continue;
+        }
+
+        if (!write_failed)
+        {
+            size_t written = sd_io_write_background(NULL, buf->data, buf->len, target);
+            written_bytes += written;
+            if (written != buf->len)
+            {
+                ESP_LOGE(TAG, "Short write (%u of %u bytes)", (unsigned)written, (unsigned)buf->len);
+                write_failed = true;
+            }
+        }
+        buf->len = 0;
+        xQueueSend(free_queue, &buf, portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief Allocates the two buffers, halving the size until the allocation succeeds.
+ */
+static esp_err_t allocate_buffers(void)
+{
+    for (size_t size = UPLOAD_PIPE_MAX_BUFFER; size >= UPLOAD_PIPE_MIN_BUFFER; size /= 2)
+    {
+        int i;
+        for (i = 0; i < UPLOAD_PIPE_BUFFERS; i++)
+        {
+            // Internal RAM keeps the SPI transfers DMA capable without an extra copy.
+            buffers[i].data = heap_caps_aligned_alloc(UPLOAD_PIPE_ALIGN, size, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+            if (!buffers[i].data)
+                break;
+        }
+        if (i == UPLOAD_PIPE_BUFFERS)
+        {
+            buffer_size = size;
+            return ESP_OK;
+        }
+        while (i-- > 0)
+        {
+            heap_caps_free(buffers[i].data);
+            buffers[i].data = NULL;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t upload_pipe_init(void)
+{
+    if (free_queue)
+    {
+        return ESP_OK;
+    }
+    free_queue = xQueueCreate(UPLOAD_PIPE_BUFFERS, sizeof(pipe_buf_t *));
+    full_queue = xQueueCreate(UPLOAD_PIPE_BUFFERS + 1, sizeof(pipe_buf_t *)); // +1 for the end marker
+    done_sem = xSemaphoreCreateBinary();
+    if (!free_queue || !full_queue || !done_sem)
+    {
+        ESP_LOGE(TAG, "Failed to create upload queues");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(upload_pipe_task, "upload_pipe", UPLOAD_PIPE_TASK_STACK_SIZE, NULL, UPLOAD_PIPE_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create upload writer task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t upload_pipe_begin(FILE *file)
+{
+    if (!free_queue || target)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (allocate_buffers() != ESP_OK)
+    {
+        ESP_LOGE(TAG, "No memory for upload buffers");
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < UPLOAD_PIPE_BUFFERS; i++)
+    {
+        buffers[i].len = 0;
+        pipe_buf_t *buf = &buffers[i];
+        xQueueSend(free_queue, &buf, 0);
+    }
+    target = file;
+    current = NULL;
+    write_failed = false;
+    written_bytes = 0;
+    recv_wait_us = 0;
+    write_idle_us = 0;
+    start_us = esp_timer_get_time();
+    return ESP_OK;
+}
+
+esp_err_t upload_pipe_write(const void *data, size_t len)
+{
+    const uint8_t *src = data;
+    while (len > 0)
+    {
+        if (write_failed)
+        {
+            return ESP_FAIL;
+        }
+        if (!current)
+        {
+            int64_t wait_start_us = esp_timer_get_time();
+            xQueueReceive(free_queue, &current, portMAX_DELAY);
+            recv_wait_us += esp_timer_get_time() - wait_start_us;
+        }
+        size_t n = buffer_size - current->len;
+        if (n > len)
+            n = len;
+        memcpy(current->data + current->len, src, n);
+        current->len += n;
+        src += n;
+        len -= n;
+        if (current->len == buffer_size)
+        {
+            xQueueSend(full_queue, &current, portMAX_DELAY);
+            current = NULL;
+        }
+    }
+    return write_failed ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t upload_pipe_end(upload_pipe_stats_t *stats)
+{
+    if (!target)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (current)
+    {
+        xQueueSend(current->len > 0 ? full_queue : free_queue, &current, portMAX_DELAY);
+        current = NULL;
+    }
+    pipe_buf_t *marker = &end_marker;
+    xQueueSend(full_queue, &marker, portMAX_DELAY);
+    xSemaphoreTake(done_sem, portMAX_DELAY); // The writer is idle from here on.
+
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+    pipe_buf_t *buf;
+    while (xQueueReceive(free_queue, &buf, 0) == pdTRUE)
+    {
+        heap_caps_free(buf->data);
+        buf->data = NULL;
+    }
+
+    uint32_t kbps = elapsed_us > 0 ? (uint32_t)((uint64_t)written_bytes * 1000000 / 1024 / elapsed_us) : 0;
+    if (stats)
+    {
+        stats->bytes = written_bytes;
+        stats->elapsed_ms = (uint32_t)(elapsed_us / 1000);
+        stats->buffer_size = (uint32_t)buffer_size;
+        stats->recv_wait_ms = (uint32_t)(recv_wait_us / 1000);
+        stats->write_idle_ms = (uint32_t)(write_idle_us / 1000);
+        stats->kbytes_per_s = kbps;
+    }
+    ESP_LOGI(TAG, "Upload: %lu bytes in %lu ms (%lu KB/s), waited for the card %lu ms, for the network %lu ms",
+             (unsigned long)written_bytes, (unsigned long)(elapsed_us / 1000), (unsigned long)kbps,
+             (unsigned long)(recv_wait_us / 1000), (unsigned long)(write_idle_us / 1000));
+
+    bool failed = write_failed;
+    target = NULL;
+    return failed ? ESP_FAIL : ESP_OK;
+}
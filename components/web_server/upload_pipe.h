@@ -0,0 +1,68 @@
+// upload_pipe.h
+// This header defines the public API for the pipelined upload writer.
+// An upload alternates between receiving from the socket and writing to the card; done in one
+// task, each side idles while the other works. The pipe decouples them: the HTTP task copies
+// received data into one of two large DMA-capable buffers, and a helper task writes the other
+// buffer to the card at the same time. Only one upload can use the pipe at a time (the HTTP
+// server handles one request at a time).
+
+#ifndef UPLOAD_PIPE_H_
+#define UPLOAD_PIPE_H_
+
+#include <stdio.h>     // For FILE
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct upload_pipe_stats_t
+ * @brief Statistics of one upload.
+ */
+typedef struct {
+    uint32_t bytes;            ///< Bytes written to the file.
+    uint32_t elapsed_ms;       ///< Time from upload_pipe_begin() to the end of the last write.
+    uint32_t buffer_size;      ///< Size of each of the two buffers.
+    uint32_t recv_wait_ms;     ///< Time the HTTP task waited for a free buffer (card was the bottleneck).
+    uint32_t write_idle_ms;    ///< Time the writer task waited for a full buffer (network was the bottleneck).
+    uint32_t kbytes_per_s;     ///< Average throughput in KB/s.
+} upload_pipe_stats_t;
+
+/**
+ * @brief Creates the writer task. Must be called once before the first upload.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the task or queues could not be created.
+ */
+esp_err_t upload_pipe_init(void);
+
+/**
+ * @brief Starts an upload into an open file and allocates the two buffers.
+ * @param file File opened for writing; it must stay open until upload_pipe_end() returns.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if an upload is already running,
+ *         ESP_ERR_NO_MEM if no buffers could be allocated.
+ */
+esp_err_t upload_pipe_begin(FILE *file);
+
+/**
+ * @brief Appends received data. Blocks only while both buffers are in use.
+ * @param data Data to append.
+ * @param len Number of bytes.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if an earlier write to the card failed.
+ */
+esp_err_t upload_pipe_write(const void *data, size_t len);
+
+/**
+ * @brief Writes out the last partial buffer, waits until all data is on the card and frees the buffers.
+ * @param stats Optional destination for the statistics of the upload (may be NULL).
+ * @return esp_err_t ESP_OK if all data was written, ESP_FAIL on a write error,
+ *         ESP_ERR_INVALID_STATE if no upload is running.
+ */
+esp_err_t upload_pipe_end(upload_pipe_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UPLOAD_PIPE_H_ */
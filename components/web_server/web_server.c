@@ -30,16 +30,31 @@
 #include <stdbool.h>           // Standardni tip za boolean vrijednosti (true/false)
 #include "settings.h"          // Header za funkcije upravljanja postavkama (vjerojatno pohranjenim u NVS ili drugdje)
 #include "ws2812.h"            // Header za WS2812 LED driver (iako se funkcije iz njega ne koriste direktno ovdje, uključen je)
-
-// --- Globalne varijable i mutex za sinkronizaciju ---
-
-// Varijabla koja prati status logiranja (aktivno/neaktivno). 'static' ograničava opseg na ovu datoteku.
-static bool logging_active = false;
-// Mutex za osiguravanje thread-safe pristupa globalnim varijablama 'logging_active' i 'last_voltages'.
-// Više taskova (npr. web server handler i task za očitavanje ADC-a) mogu pokušati pristupiti ovim varijablama istovremeno.
-static SemaphoreHandle_t logging_mutex = NULL;
-// Polje za pohranu zadnje očitanih naponskih vrijednosti s dva ADS1115 modula, ukupno 8 kanala.
-static float last_voltages[8] = {0};
+#include "file_catalog.h"
+#include "sd_io.h"
+#include "log_crc.h"
+#include "adc_bench.h"
+#include "adc_burst.h"
+#include "frame_align.h"
+#include "schedule.h"
+#include "session_catalog.h"
+#include "columnar.h"
+#include "log_control.h"
+#include "live_frame.h"
+#include "upload_pipe.h"
+#include "log_tail.h"
+#include "stream_hub.h"
+#include "alarm.h"
+#include "json_pull.h"
+#include "conn_budget.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"      // Za CONFIG_LWIP_MAX_SOCKETS (provjera broja socketa servera)
+#include "ads_bus.h"      // Stvarni I2C takt ADS1115 sabirnice nakon provjere (za /api/adc/bus)
+
+// --- Globalne varijable ---
+
+// Status logiranja vodi kontrolna ravnina (log_control.c); ovdje se samo šalju naredbe i čita stanje.
+// Zadnji očitani okvir (8 kanala) objavljuje se bez zaključavanja kroz live_frame.c.
 
 // Extern deklaracije za globalne varijable iz main.c
 // Ove varijable čuvaju putanju do trenutne log datoteke i mutex za pristup njoj.
@@ -49,82 +64,25 @@ extern SemaphoreHandle_t g_log_file_path_mutex; // Definirano u main.c
 
 // --- Funkcije za upravljanje globalnim stanjem ---
 
-// Funkcija: set_last_voltages
-// Opis: Ažurira globalne varijable 'last_voltages' s novim očitanim vrijednostima.
-//       Koristi mutex za siguran pristup u multi-thread okruženju.
-// Argumenti:
-//   - voltages: Pokazivač na niz float vrijednosti koje predstavljaju zadnje očitanja s ADC-a.
-void set_last_voltages(const float *voltages)
-{
-    // Provjeri jesu li mutex i ulazni niz validni
-    if (logging_mutex && voltages)
-    {
-        // Pokušaj preuzeti mutex s timeoutom od 10ms.
-        // Ako se mutex uspješno preuzme (nitko drugi ga ne koristi trenutno), nastavi.
-        if (xSemaphoreTake(logging_mutex, pdMS_TO_TICKS(10)) == pdTRUE)
-        {
-            // Kopiraj ulazne vrijednosti u globalnu varijablu 'last_voltages'.
-            memcpy(last_voltages, voltages, sizeof(last_voltages));
-            // Otpusti mutex kako bi ga drugi taskovi mogli preuzeti.
-            xSemaphoreGive(logging_mutex);
-        }
-        // Ako mutex nije uspješno preuzet unutar 10ms, preskače se ažuriranje.
-        // Ovo sprječava blokiranje web server handlera ako je task za logiranje zauzet.
-    }
-}
-
 // Funkcija: set_logging_active
-// Opis: Postavlja status logiranja (aktivno/neaktivno).
-//       Osigurava da je mutex inicijaliziran i koristi ga za thread-safe postavljanje statusa.
+// Opis: Traži pokretanje ili zaustavljanje logiranja.
+//       Šalje naredbu kontrolnoj ravnini; task za akviziciju je primjenjuje između dva očitanja,
+//       pa se promjena ne vidi odmah u is_logging_enabled().
 // Argumenti:
-//   - active: Boolean vrijednost (true ili false) kojom se postavlja status logiranja.
+//   - active: Boolean vrijednost (true ili false) kojom se postavlja status logiranja.
 void set_logging_active(bool active)
 {
-    // Provjeri je li mutex inicijaliziran. Ako nije, kreiraj ga.
-    if (logging_mutex == NULL)
-    {
-        logging_mutex = xSemaphoreCreateMutex();
-    }
-    // Pokušaj preuzeti mutex i čekaj beskonačno (portMAX_DELAY) dok ne postane dostupan.
-    // Oprez: Beskonačno čekanje može uzrokovati zaglavljivanje (deadlock) ako mutex nikad ne postane dostupan.
-    // U kritičnim putevima bolje koristiti timeout. Ovdje se pretpostavlja da se ovo ne poziva u jako kritičnom dijelu.
-    if (xSemaphoreTake(logging_mutex, portMAX_DELAY))
-    {
-        // Ako je mutex preuzet, sigurno postavi globalnu varijablu.
-        logging_active = active;
-        // Otpusti mutex.
-        xSemaphoreGive(logging_mutex);
-    }
+    log_control_post(active ? LOG_CMD_START : LOG_CMD_STOP, LOG_SRC_WEB, NULL);
 }
 
 // Funkcija: is_logging_enabled
 // Opis: Vraća trenutni status logiranja.
-//       Osigurava thread-safe čitanje globalne varijable 'logging_active'.
+//       Stanje se čita jednim atomarnim čitanjem, bez mutexa. Logiranje je aktivno i dok
+//       čeka na otvaranje datoteke (stanje "armed").
 // Povratna vrijednost: bool - true ako je logiranje aktivno, false inače.
 bool is_logging_enabled(void)
 {
-    bool status;
-    // Provjeri je li mutex inicijaliziran. Ako nije, kreiraj ga.
-    if (logging_mutex == NULL)
-    {
-        logging_mutex = xSemaphoreCreateMutex();
-    }
-    // Pokušaj preuzeti mutex i čekaj beskonačno.
-    if (xSemaphoreTake(logging_mutex, portMAX_DELAY))
-    {
-        // Ako je mutex preuzet, sigurno pročitaj globalnu varijablu.
-        status = logging_active;
-        // Otpusti mutex.
-        xSemaphoreGive(logging_mutex);
-    }
-    else
-    {
-        // Ako mutex nije preuzet (ovo bi se trebalo dogoditi samo u slučaju interne FreeRTOS greške ili deadlocka),
-        // vrati false. Logiranje greške ovdje nedostaje, moglo bi se dodati ako je kritično.
-        status = false;
-    }
-    // Vrati pročitani status.
-    return status;
+    return log_control_state() != LOG_STATE_IDLE;
 }
 
 // --- Definicije konstanti i makroa ---
@@ -138,10 +96,30 @@ static const char *TAG_WEB = "web_server";
 // Handler za HTTP server instancu. Ova varijabla pohranjuje referencu na pokrenuti HTTP server.
 // Koristi se za konfiguraciju, pokretanje, zaustavljanje i registraciju URI handlera.
 static httpd_handle_t server = NULL;
+static SemaphoreHandle_t follow_slots = NULL; // Slobodni taskovi za praćenje (FOLLOW_MAX_SESSIONS); sockete dijeli s tokovima preko conn_budget.
+static bool verify_running = false;           // Provjera CRC-a je u tijeku (samo jedna odjednom); mijenja se pod worker_lock.
+static bool capture_running = false;          // Burst je u tijeku (samo jedan odjednom); mijenja se pod worker_lock.
+static portMUX_TYPE worker_lock = portMUX_INITIALIZER_UNLOCKED;
 
 // Definicije konstanti vezanih za funkcionalnost uploada datoteka.
-#define UPLOAD_BUFFER_SIZE 2048 // Veličina privremenog buffera koji se koristi za čitanje dijelova (chunkova) uploadane datoteke iz HTTP zahtjeva.
+#define UPLOAD_BUFFER_SIZE 8192 // Veličina privremenog buffera koji se koristi za čitanje dijelova (chunkova) uploadane datoteke iz HTTP zahtjeva.
+                                // Na karticu se piše preko upload_pipe.c (dva velika buffera), pa ovaj buffer služi samo za primanje i parsiranje.
 #define FILE_PATH_MAX 256       // Maksimalna dopuštena duljina pune putanje do datoteke (uključujući točku montiranja, '/'). Koristi se za sprečavanje prelijevanja buffera.
+#define DELETE_MAX_DEPTH 3       // Najveća dubina direktorija koju /delete_all obrađuje (YYYY/MM/DD kod rasporeda po datumu).
+#define CAPTURE_CHUNK_SIZE 4096  // Veličina CSV chunka kod slanja bursta preko HTTP-a.
+#define FOLLOW_MAX_SESSIONS 2    // Najviše istovremenih praćenja aktivne log datoteke (/download?follow=1).
+#define FOLLOW_TASK_STACK_SIZE 4096 // Stog taska koji šalje praćenu datoteku.
+#define FOLLOW_WAIT_MS 2000      // Najdulje čekanje na novu kontrolnu točku log writera u jednom koraku.
+#define FOLLOW_RETRY_MS 200      // Čekanje kad nova veličina datoteke još nije vidljiva na kartici.
+#define FOLLOW_CHUNK_SIZE 1024   // Veličina chunka kod slanja praćene datoteke.
+#define VERIFY_TASK_STACK_SIZE 4096 // Stog taska koji provjerava datoteku prema CRC zapisu (/api/verify).
+#define CAPTURE_TASK_STACK_SIZE 4096 // Stog taska koji snima burst (/api/capture).
+#define WORKER_TASK_PRIORITY 4   // Taskovi dugih zahtjeva (provjera, burst) rade ispod HTTP servera (5).
+#define STREAM_MAX_RATE 1000     // Najveća dopuštena vrijednost parametra rate (redova u sekundi).
+// Tokovi uživo i praćenja uzimaju sockete iz zajedničkog budžeta (conn_budget.h), pa uvijek ostaje
+// CONN_BUDGET_CLIENTS socketa za stranice, /adc i API. httpd za sebe koristi još 3 socketa.
+_Static_assert(CONN_BUDGET_SOCKETS + 3 <= CONFIG_LWIP_MAX_SOCKETS, "CONFIG_LWIP_MAX_SOCKETS je premali za CONN_BUDGET_SOCKETS");
+#define SESSION_MARKERS_LIST_MAX 64 // Najviše markera u odgovoru /api/sessions?id=N.
 
 // --- Extern deklaracije za binarne podatke ugrađenih fileova ---
 // Ovi nizovi bajtova predstavljaju sadržaj statičkih web fileova (CSS, JS, HTML)
@@ -302,6 +280,27 @@ static esp_err_t url_decode(const char *src, char *dst, size_t dst_size)
     return ESP_OK; // Vrati ESP_OK za uspjeh.
 }
 
+/**
+ * @brief Reads the URL-decoded value of the `file` query parameter.
+ * @param req Pointer to the HTTP request structure.
+ * @param out Buffer receiving the decoded file name (relative to the mount point).
+ * @param out_len Length of the out buffer.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NOT_FOUND if the parameter is missing or invalid.
+ */
+static esp_err_t get_file_query_param(httpd_req_t *req, char *out, size_t out_len)
+{
+    char query[256];
+    char value[128 + 1];
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK ||
+        httpd_query_key_value(query, "file", value, sizeof(value)) != ESP_OK ||
+        url_decode(value, out, out_len) != ESP_OK || out[0] == '\0')
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    return ESP_OK;
+}
+
 // Funkcija: httpd_send_template_chunk
 // Opis: Pomoćna funkcija za slanje dijela ugrađenog HTML template-a kao chunk u HTTP odgovoru.
 //       Koristi se za slanje dijelova HTML-a prije i poslije placeholder-a kada se
@@ -428,6 +427,51 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+/**
+ * @brief Reads the rest of a JSON array of `{"factor":1.0,"unit":"V"}` objects (after its '[')
+ * into channel configurations. Unknown members are skipped.
+ * @param jp Pull parser positioned after the '[' token.
+ * @param configs Receives NUM_CHANNELS configurations.
+ * @return bool True if the array holds exactly NUM_CHANNELS valid objects. On false, a parser
+ *         error (json_pull_error()) means the JSON itself is invalid.
+ */
+static bool parse_channel_configs(json_pull_t *jp, channel_config_t *configs)
+{
+    int count = 0;
+    json_tok_t tok;
+    while ((tok = json_pull_next(jp)) == JSON_TOK_OBJECT)
+    {
+        if (count == NUM_CHANNELS)
+            return false; // Previše elemenata
+        bool has_factor = false, has_unit = false;
+        while ((tok = json_pull_next(jp)) == JSON_TOK_KEY)
+        {
+            bool is_factor = strcmp(jp->str, "factor") == 0;
+            bool is_unit = strcmp(jp->str, "unit") == 0;
+            tok = json_pull_next(jp);
+            if (is_factor && tok == JSON_TOK_NUMBER)
+            {
+                configs[count].scaling_factor = (float)jp->number;
+                has_factor = true;
+            }
+            else if (is_unit && tok == JSON_TOK_STRING)
+            {
+                snprintf(configs[count].unit, MAX_UNIT_LEN, "%s", jp->str);
+                has_unit = true;
+            }
+            else if (is_factor || is_unit || json_pull_skip(jp, tok) != ESP_OK)
+            {
+                return false; // Pogrešan tip vrijednosti ili neispravan JSON
+            }
+        }
+        // Validacija: Ima li svaki objekt 'factor' (broj) i 'unit' (string)?
+        if (tok != JSON_TOK_OBJECT_END || !has_factor || !has_unit)
+            return false;
+        count++;
+    }
+    return tok == JSON_TOK_ARRAY_END && count == NUM_CHANNELS;
+}
+
 /**
  * @brief Handler za POST /api/channel-configs (API) - sprema postavke.
  * @param req HTTP zahtjev koji u tijelu sadrži JSON podatke.
@@ -435,67 +479,32 @@ static esp_err_t settings_get_handler(httpd_req_t *req)
  *
  * API endpoint koji prima nove konfiguracije kanala u JSON formatu od klijenta,
  * validira ih, i ako su ispravne, prosljeđuje ih 'settings' modulu za spremanje u NVS.
+ * Tijelo se parsira u hodu (json_pull) izravno u strukture kanala, bez buffera za cijelo
+ * tijelo i bez alokacije, pa veličina zahtjeva nije ograničena.
  */
 static esp_err_t channel_configs_post_handler(httpd_req_t *req)
 {
-    char buf[1024]; // Buffer za primanje JSON podataka.
-    int ret, remaining = req->content_len;
-
-    // Provjera da li je sadržaj veći od našeg buffera.
-    if (remaining >= sizeof(buf))
-    {
-        ESP_LOGE(TAG_WEB, "Veličina zahtjeva (%d) je prevelika za buffer (%d).", remaining, sizeof(buf));
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Zahtjev prevelik");
-    }
-
-    // Primanje tijela HTTP zahtjeva.
-    ret = httpd_req_recv(req, buf, remaining);
-    if (ret <= 0)
-    {
-        if (ret == HTTPD_SOCK_ERR_TIMEOUT)
-        {
-            httpd_resp_send_408(req);
-        }
-        return ESP_FAIL;
-    }
-    buf[ret] = '\0'; // Null-terminacija primljenog stringa.
+    json_pull_t jp;
+    channel_config_t new_configs[NUM_CHANNELS];
 
-    // Parsiranje JSON stringa.
-    cJSON *root = cJSON_Parse(buf);
+    json_pull_init(&jp, req);
     // Validacija: Je li ispravan JSON, je li polje, ima li točno 8 elemenata?
-    if (!cJSON_IsArray(root) || cJSON_GetArraySize(root) != NUM_CHANNELS)
+    bool valid = json_pull_next(&jp) == JSON_TOK_ARRAY && parse_channel_configs(&jp, new_configs) &&
+                 json_pull_next(&jp) == JSON_TOK_END;
+    if (json_pull_error(&jp) != ESP_OK)
     {
-        cJSON_Delete(root);
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON mora biti polje s 8 elemenata");
+        return json_pull_send_error(&jp, req);
     }
-
-    channel_config_t new_configs[NUM_CHANNELS];
-    cJSON *elem = NULL;
-    int i = 0;
-    // Iteracija kroz elemente JSON polja.
-    cJSON_ArrayForEach(elem, root)
+    if (!valid)
     {
-        cJSON *factor_item = cJSON_GetObjectItem(elem, "factor");
-        cJSON *unit_item = cJSON_GetObjectItem(elem, "unit");
-
-        // Validacija: Ima li svaki objekt 'factor' (broj) i 'unit' (string)?
-        if (!cJSON_IsNumber(factor_item) || !cJSON_IsString(unit_item))
-        {
-            cJSON_Delete(root);
-            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravan format elementa");
-        }
-
-        // Popunjavanje naše C strukture s podacima iz JSON-a.
-        new_configs[i].scaling_factor = (float)factor_item->valuedouble; // Cast to float
-        strncpy(new_configs[i].unit, unit_item->valuestring, MAX_UNIT_LEN - 1);
-        new_configs[i].unit[MAX_UNIT_LEN - 1] = '\0'; // Osiguravanje null terminacije.
-        i++;
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "JSON mora biti polje s 8 elemenata {\"factor\":broj,\"unit\":\"tekst\"}");
     }
-    cJSON_Delete(root); // Oslobađanje memorije od parsiranog JSON-a.
 
     // Prosljeđivanje novih konfiguracija 'settings' modulu za spremanje.
     if (settings_save_channel_configs(new_configs) == ESP_OK)
     {
+        // Log koji je u tijeku nastavlja se u novoj datoteci s novom konfiguracijom.
+        log_control_post(LOG_CMD_RECONFIGURE, LOG_SRC_WEB, NULL);
         httpd_resp_sendstr(req, "Postavke uspješno spremljene.");
     }
     else
@@ -507,57 +516,67 @@ static esp_err_t channel_configs_post_handler(httpd_req_t *req)
 
 // Handler za POST zahtjeve na putanju /settings.
 // Opis: Prima JSON podatke u tijelu zahtjeva i ažurira postavke logiranja (konkretno log_on_boot).
-// Očekuje JSON format: {"log_on_boot": true/false}.
+// Očekuje JSON format: {"log_on_boot": true/false}, opcionalno i "channels" (polje od 8 kanala).
+// Tijelo se parsira u hodu (json_pull); nepoznati članovi se preskaču.
 static esp_err_t settings_post_handler(httpd_req_t *req)
 {
-    char buf[1024]; // Povećavamo buffer da stanu i konfiguracije kanala
-    int ret = httpd_req_recv(req, buf, sizeof(buf) - 1);
-    if (ret <= 0)
+    json_pull_t jp;
+    channel_config_t new_configs[NUM_CHANNELS];
+    int log_on_boot = -1;      // -1 = nije zadano
+    bool channels_ok = false;
+
+    json_pull_init(&jp, req);
+    json_tok_t tok = json_pull_next(&jp);
+    if (tok == JSON_TOK_OBJECT)
     {
-        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "No data received");
+        while ((tok = json_pull_next(&jp)) == JSON_TOK_KEY)
+        {
+            bool is_log_on_boot = strcmp(jp.str, "log_on_boot") == 0;
+            bool is_channels = strcmp(jp.str, "channels") == 0;
+            tok = json_pull_next(&jp);
+            // 1. "log_on_boot" ako postoji
+            if (is_log_on_boot && (tok == JSON_TOK_TRUE || tok == JSON_TOK_FALSE))
+            {
+                log_on_boot = tok == JSON_TOK_TRUE;
+            }
+            // 2. "channels" konfiguracija ako postoji; neispravno polje se ignorira
+            else if (is_channels && tok == JSON_TOK_ARRAY)
+            {
+                uint8_t depth = jp.depth; // Dubina s otvorenim poljem kanala
+                channels_ok = parse_channel_configs(&jp, new_configs);
+                // Ostatak neispravnog polja se preskače
+                while (!channels_ok && jp.depth >= depth && json_pull_next(&jp) != JSON_TOK_ERROR)
+                {
+                }
+            }
+            else if (json_pull_skip(&jp, tok) != ESP_OK)
+            {
+                break;
+            }
+            if (json_pull_error(&jp) != ESP_OK)
+                break;
+        }
+        if (tok == JSON_TOK_OBJECT_END)
+            tok = json_pull_next(&jp);
     }
-    buf[ret] = '\0';
-
-    cJSON *root = cJSON_Parse(buf);
-    if (!root)
+    if (json_pull_error(&jp) != ESP_OK)
+    {
+        return json_pull_send_error(&jp, req);
+    }
+    if (tok != JSON_TOK_END)
     {
         return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
     }
 
-    // 1. Provjeri i spremi "log_on_boot" ako postoji
-    cJSON *log_on_boot_item = cJSON_GetObjectItem(root, "log_on_boot");
-    if (cJSON_IsBool(log_on_boot_item))
+    if (log_on_boot >= 0)
     {
-        settings_set_log_on_boot(cJSON_IsTrue(log_on_boot_item));
+        settings_set_log_on_boot(log_on_boot);
     }
-
-    // 2. Provjeri i spremi "channels" konfiguraciju ako postoji
-    cJSON *channels_array = cJSON_GetObjectItem(root, "channels");
-    if (cJSON_IsArray(channels_array) && cJSON_GetArraySize(channels_array) == NUM_CHANNELS)
+    // Spremi samo ako je parsirano točno 8 kanala
+    if (channels_ok && settings_save_channel_configs(new_configs) == ESP_OK)
     {
-        channel_config_t new_configs[NUM_CHANNELS];
-        cJSON *elem = NULL;
-        int i = 0;
-        cJSON_ArrayForEach(elem, channels_array)
-        {
-            cJSON *factor_item = cJSON_GetObjectItem(elem, "factor");
-            cJSON *unit_item = cJSON_GetObjectItem(elem, "unit");
-            if (cJSON_IsNumber(factor_item) && cJSON_IsString(unit_item))
-            {
-                new_configs[i].scaling_factor = factor_item->valuedouble;
-                strncpy(new_configs[i].unit, unit_item->valuestring, MAX_UNIT_LEN - 1);
-                new_configs[i].unit[MAX_UNIT_LEN - 1] = '\0';
-                i++;
-            }
-        }
-        // Spremi samo ako je parsirano točno 8 kanala
-        if (i == NUM_CHANNELS)
-        {
-            settings_save_channel_configs(new_configs);
-        }
+        log_control_post(LOG_CMD_RECONFIGURE, LOG_SRC_WEB, NULL);
     }
-
-    cJSON_Delete(root);
     return httpd_resp_sendstr(req, "OK");
 }
 
@@ -607,21 +626,22 @@ static esp_err_t root_get_handler(httpd_req_t *req)
 // Handler za GET zahtjeve na putanju /list.
 // Opis: Generira HTML stranicu s popisom datoteka koje se nalaze na SD kartici i poslužuje je klijentu.
 // Koristi ugrađeni list.html template i dinamički umeće popis datoteka.
+// The list is served from the in-memory file catalog (file_catalog.c), so a request
+// does not re-read the FAT directory and does not compete with the log writer for the SPI bus.
 static esp_err_t list_get_handler(httpd_req_t *req)
 {
-    ESP_LOGI(TAG_WEB, "Serviram /list (iz template-a uz chunked slanje)"); // Logira informaciju.
+    ESP_LOGI(TAG_WEB, "Serviram /list (iz kataloga datoteka uz chunked slanje)"); // Logira informaciju.
 
-    // Pokušava otvoriti direktorij koji je točka montiranja SD kartice (MOUNT_POINT, npr. "/sdcard").
-    DIR *dir = opendir(MOUNT_POINT);
-    // Provjerava je li otvaranje direktorija uspjelo.
-    if (!dir)
+    // Provjerava je li katalog izgrađen (SD kartica montirana i skenirana pri pokretanju).
+    if (!file_catalog_is_ready())
     {
-        // Ako ne uspije (npr. SD kartica nije inicijalizirana ili umetnuta), logira grešku
-        // i šalje poruku o grešci klijentu koristeći pomoćnu funkciju send_message_response.
-        ESP_LOGE(TAG_WEB, "Greska pri otvaranju direktorija %s (%s)", MOUNT_POINT, strerror(errno));
+        ESP_LOGE(TAG_WEB, "Katalog datoteka nije spreman (SD kartica nije montirana?)");
         return send_message_response(req, "Greska posluzitelja", "error", "Nije moguce otvoriti direktorij na SD kartici.");
     }
-    ESP_LOGI(TAG_WEB, "Direktorij %s uspjesno otvoren.", MOUNT_POINT);
+
+    // Kopija kataloga, kako se lock ne bi držao za vrijeme slanja odgovora sporom klijentu.
+    file_catalog_entry_t *catalog = NULL;
+    size_t catalog_count = file_catalog_snapshot(&catalog);
 
     // Priprema buffer za dinamičko generiranje HTML koda koji će predstavljati redove tablice s popisom datoteka.
     char *file_list_html = NULL;                    // Pointer na buffer.
@@ -631,158 +651,152 @@ static esp_err_t list_get_handler(httpd_req_t *req)
     // Provjera uspješnosti alokacije.
     if (!file_list_html)
     {
-        // Ako alokacija ne uspije, logira grešku, zatvori otvoreni direktorij i pošalje grešku klijentu.
+        // Ako alokacija ne uspije, logira grešku, oslobodi kopiju kataloga i pošalje grešku klijentu.
         ESP_LOGE(TAG_WEB, "Greska pri alokaciji pocetne memorije za popis datoteka!");
-        closedir(dir);
+        free(catalog);
         return send_message_response(req, "Greska posluzitelja", "error", "Interna greska (memorija).");
     }
     file_list_html[0] = '\0'; // Inicijaliziraj buffer kao prazan C string.
 
-    struct dirent *entry; // Struktura za pohranu informacija o pojedinom unosu u direktoriju (ime, tip).
-    ESP_LOGI(TAG_WEB, "Citaju se unosi u direktoriju %s...", MOUNT_POINT);
-    // Petlja čita unose (datoteke i poddirektorije) iz direktorija jedan po jedan.
-    // readdir vraća NULL kada više nema unosa.
-    while ((entry = readdir(dir)) != NULL)
+    // Petlja prolazi kroz sve datoteke iz kataloga.
+    for (size_t idx = 0; idx < catalog_count; idx++)
     {
-        // Logira ime i tip pronađenog unosa (debug razina).
-        ESP_LOGI(TAG_WEB, "readdir pronasao: ime='%s', tip=%d", entry->d_name, entry->d_type);
-        // Provjerava je li pronađeni unos regularna datoteka (DT_REG). Zanemaruje direktorije (DT_DIR) i ostalo.
-        if (entry->d_type == DT_REG)
+        const file_catalog_entry_t *entry = &catalog[idx];
+        ESP_LOGD(TAG_WEB, "Obrada datoteke iz kataloga: %s", entry->name);
+        // Procjena potrebne duljine buffera za HTML kod za *ovaj* red datoteke.
+        // Uključuje prostor za ime filea (koje se može pojaviti više puta i biti URL enkodirano),
+        // HTML tagove za red tablice (<tr>, <td>, <a>) i linkove.
+        size_t js_escaped_len_estimate = strlen(entry->name) * 2 + 1;                             // Procjena za potencijalno JavaScript escapiranje imena u linkovima.
+        size_t entry_html_len_estimate = js_escaped_len_estimate + strlen(entry->name) * 2 + 350; // Gruba procjena za cijeli HTML red s linkovima.
+
+        // Provjerava ima li dovoljno mjesta u bufferu za dodavanje HTML koda za ovu datoteku.
+        // Ako trenutna duljina + procijenjena duljina novog unosa premašuje veličinu buffera.
+        if (file_list_len + entry_html_len_estimate >= file_list_buffer_size)
         {
-            ESP_LOGD(TAG_WEB, "Obrada regularne datoteke: %s", entry->d_name);
-            // Procjena potrebne duljine buffera za HTML kod za *ovaj* red datoteke.
-            // Uključuje prostor za ime filea (koje se može pojaviti više puta i biti URL enkodirano),
-            // HTML tagove za red tablice (<tr>, <td>, <a>) i linkove.
-            size_t js_escaped_len_estimate = strlen(entry->d_name) * 2 + 1;                             // Procjena za potencijalno JavaScript escapiranje imena u linkovima.
-            size_t entry_html_len_estimate = js_escaped_len_estimate + strlen(entry->d_name) * 2 + 350; // Gruba procjena za cijeli HTML red s linkovima.
-
-            // Provjerava ima li dovoljno mjesta u bufferu za dodavanje HTML koda za ovu datoteku.
-            // Ako trenutna duljina + procijenjena duljina novog unosa premašuje veličinu buffera.
-            if (file_list_len + entry_html_len_estimate >= file_list_buffer_size)
+            // Ako nema dovoljno mjesta, realocira buffer na veću veličinu.
+            size_t new_size = file_list_buffer_size + entry_html_len_estimate + 1024; // Nova veličina: trenutna + procjena za novi unos + dodatnih 1KB kao padding.
+            char *temp = realloc(file_list_html, new_size);                           // Pokušaj realokacije. realloc može vratiti NULL ako ne uspije.
+            // Provjera uspješnosti realokacije.
+            if (!temp)
             {
-                // Ako nema dovoljno mjesta, realocira buffer na veću veličinu.
-                size_t new_size = file_list_buffer_size + entry_html_len_estimate + 1024; // Nova veličina: trenutna + procjena za novi unos + dodatnih 1KB kao padding.
-                char *temp = realloc(file_list_html, new_size);                           // Pokušaj realokacije. realloc može vratiti NULL ako ne uspije.
-                // Provjera uspješnosti realokacije.
-                if (!temp)
-                {
-                    // Ako realokacija ne uspije, logiraj grešku, prekinuti čitanje direktorija
-                    // i nastavi s postojećim (skraćenim) popisom.
-                    ESP_LOGE(TAG_WEB, "Greska pri realokaciji memorije za popis datoteka, skracujem popis!");
-                    break; // Izlaz iz while petlje (prekida dodavanje daljnjih datoteka).
-                }
-                file_list_html = temp;            // Ažuriraj pointer na novi, veći buffer.
-                file_list_buffer_size = new_size; // Ažuriraj informaciju o novoj veličini buffera.
-                ESP_LOGI(TAG_WEB, "Realociran buffer popisa datoteka na %d bajtova", new_size);
+                // Ako realokacija ne uspije, logiraj grešku, prekinuti obradu kataloga
+                // i nastavi s postojećim (skraćenim) popisom.
+                ESP_LOGE(TAG_WEB, "Greska pri realokaciji memorije za popis datoteka, skracujem popis!");
+                break; // Izlaz iz petlje (prekida dodavanje daljnjih datoteka).
             }
+            file_list_html = temp;            // Ažuriraj pointer na novi, veći buffer.
+            file_list_buffer_size = new_size; // Ažuriraj informaciju o novoj veličini buffera.
+            ESP_LOGD(TAG_WEB, "Realociran buffer popisa datoteka na %d bajtova", new_size);
+        }
 
-            // Priprema buffere za URL-ove za preuzimanje i brisanje datoteke.
-            char delete_url[512];   // Buffer za URL za brisanje.
-            char download_url[512]; // Buffer za URL za preuzimanje.
-
-            // URL-enkodiranje imena datoteke kako bi se sigurno koristilo u URL-u kao query parametar.
-            // Npr. razmaci postaju %20, zagrade %28/%29.
-            // Ovo je ručno implementirano, osnovno URL enkodiranje. Za potpunu usklađenost,
-            // koristile bi se standardne funkcije URL enkodiranja ako su dostupne u ESP-IDF.
-            char url_encoded_filename[sizeof(entry->d_name) * 3 + 1]; // Buffer dovoljno velik za najgori slučaj enkodiranja.
-            char *p_in_url = entry->d_name;                           // Pointer za čitanje iz izvornog imena filea.
-            char *p_out_url = url_encoded_filename;                   // Pointer za pisanje u izlazni buffer.
-            // Petlja prolazi kroz ime datoteke i enkodira specifične znakove.
-            while (*p_in_url && (p_out_url - url_encoded_filename) < (sizeof(url_encoded_filename) - 4))
+        // Priprema buffere za URL-ove za preuzimanje i brisanje datoteke.
+        char delete_url[512];   // Buffer za URL za brisanje.
+        char download_url[512]; // Buffer za URL za preuzimanje.
+
+        // URL-enkodiranje imena datoteke kako bi se sigurno koristilo u URL-u kao query parametar.
+        // Npr. razmaci postaju %20, zagrade %28/%29.
+        // Ovo je ručno implementirano, osnovno URL enkodiranje. Za potpunu usklađenost,
+        // koristile bi se standardne funkcije URL enkodiranja ako su dostupne u ESP-IDF.
+        char url_encoded_filename[FILE_CATALOG_NAME_MAX * 3 + 1]; // Buffer dovoljno velik za najgori slučaj enkodiranja.
+        const char *p_in_url = entry->name;                         // Pointer za čitanje iz izvornog imena filea.
+        char *p_out_url = url_encoded_filename;                   // Pointer za pisanje u izlazni buffer.
+        // Petlja prolazi kroz ime datoteke i enkodira specifične znakove.
+        while (*p_in_url && (p_out_url - url_encoded_filename) < (sizeof(url_encoded_filename) - 4))
+        {
+            if (*p_in_url == ' ')
             {
-                if (*p_in_url == ' ')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '2';
-                    *p_out_url++ = '0';
-                }
-                else if (*p_in_url == '(')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '2';
-                    *p_out_url++ = '8';
-                }
-                else if (*p_in_url == ')')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '2';
-                    *p_out_url++ = '9';
-                }
-                else if (*p_in_url == '&')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '2';
-                    *p_out_url++ = '6';
-                } // Dodaj enkodiranje za &
-                else if (*p_in_url == '=')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '3';
-                    *p_out_url++ = 'D';
-                } // Dodaj enkodiranje za =
-                else if (*p_in_url == '?')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '3';
-                    *p_out_url++ = 'F';
-                } // Dodaj enkodiranje za ?
-                else if (*p_in_url == '/')
-                {
-                    *p_out_url++ = '%';
-                    *p_out_url++ = '2';
-                    *p_out_url++ = 'F';
-                } // Dodaj enkodiranje za /
-                else
-                {
-                    *p_out_url++ = *p_in_url;
-                } // Ostale znakove kopiraj direktno.
-                p_in_url++;
+                *p_out_url++ = '%';
+                *p_out_url++ = '2';
+                *p_out_url++ = '0';
             }
-            *p_out_url = '\0'; // Null-terminiraj enkodirani string.
-            // Provjera je li enkodirani string skraćen zbog veličine buffera.
-            if ((p_out_url - url_encoded_filename) >= sizeof(url_encoded_filename))
+            else if (*p_in_url == '(')
             {
-                url_encoded_filename[sizeof(url_encoded_filename) - 1] = '\0';          // Osiguraj null-terminaciju na kraju buffera.
-                ESP_LOGW(TAG_WEB, "URL encoded filename truncated: %s", entry->d_name); // Logiraj upozorenje.
+                *p_out_url++ = '%';
+                *p_out_url++ = '2';
+                *p_out_url++ = '8';
             }
-
-            // Sastavljanje kompletnih URL-ova za preuzimanje i brisanje.
-            // Koristi snprintf za formatiranje, uključujući enkodirano ime datoteke kao query parametar 'file'.
-            // Provjera prelijevanja snprintf-a.
-            if (snprintf(download_url, sizeof(download_url), "/download?file=%s", url_encoded_filename) >= sizeof(download_url))
+            else if (*p_in_url == ')')
             {
-                ESP_LOGE(TAG_WEB, "Download URL truncation error for %s", entry->d_name);
-                download_url[sizeof(download_url) - 1] = '\0'; // Osiguraj null-terminaciju.
+                *p_out_url++ = '%';
+                *p_out_url++ = '2';
+                *p_out_url++ = '9';
             }
-            if (snprintf(delete_url, sizeof(delete_url), "/delete?file=%s", url_encoded_filename) >= sizeof(delete_url))
+            else if (*p_in_url == '&')
             {
-                ESP_LOGE(TAG_WEB, "Delete URL truncation error for %s", entry->d_name);
-                delete_url[sizeof(delete_url) - 1] = '\0'; // Osiguraj null-terminaciju.
-            }
-
-            // Generiranje HTML koda za jedan red tablice (<tr>...</tr>) koji prikazuje ime datoteke
-            // i sadrži linkove za preuzimanje i brisanje.
-            // Koristi snprintf za formatiranje, dodajući generirani HTML na kraj postojećeg file_list_html buffera.
-            int written_len = snprintf(file_list_html + file_list_len, file_list_buffer_size - file_list_len,
-                                       "<tr><td>%s</td><td><a href=\"%s\">Preuzmi</a></td><td><a href=\"%s\" class=\"delete-link\">Obriši</a></td></tr>",
-                                       entry->d_name, download_url, delete_url);
-            // Provjera je li snprintf bio uspješan (vratio > 0) i je li stao u preostali prostor buffera.
-            if (written_len > 0 && (size_t)written_len < (file_list_buffer_size - file_list_len))
+                *p_out_url++ = '%';
+                *p_out_url++ = '2';
+                *p_out_url++ = '6';
+            } // Dodaj enkodiranje za &
+            else if (*p_in_url == '=')
             {
-                file_list_len += written_len; // Ažuriraj trenutnu zauzetu duljinu buffera.
-            }
+                *p_out_url++ = '%';
+                *p_out_url++ = '3';
+                *p_out_url++ = 'D';
+            } // Dodaj enkodiranje za =
+            else if (*p_in_url == '?')
+            {
+                *p_out_url++ = '%';
+                *p_out_url++ = '3';
+                *p_out_url++ = 'F';
+            } // Dodaj enkodiranje za ?
+            else if (*p_in_url == '/')
+            {
+                *p_out_url++ = '%';
+                *p_out_url++ = '2';
+                *p_out_url++ = 'F';
+            } // Dodaj enkodiranje za /
             else
             {
-                // Ako snprintf ne uspije ili je buffer premali, logiraj grešku.
-                ESP_LOGE(TAG_WEB, "snprintf greska pri pisanju unosa datoteke ili buffer premali za: %s", entry->d_name);
-                if (written_len > 0)
-                    file_list_len = file_list_buffer_size - 1; // U slučaju preljeva, postavi duljinu na maksimalnu kako bi se izbjeglo pisanje izvan granica.
-                // NAPOMENA: Ovo skraćivanje može rezultirati nekompletnim HTML-om ako se dogodi unutar taga.
-            }
+                *p_out_url++ = *p_in_url;
+            } // Ostale znakove kopiraj direktno.
+            p_in_url++;
+        }
+        *p_out_url = '\0'; // Null-terminiraj enkodirani string.
+        // Provjera je li enkodirani string skraćen zbog veličine buffera.
+        if ((p_out_url - url_encoded_filename) >= sizeof(url_encoded_filename))
+        {
+            url_encoded_filename[sizeof(url_encoded_filename) - 1] = '\0';          // Osiguraj null-terminaciju na kraju buffera.
+            ESP_LOGW(TAG_WEB, "URL encoded filename truncated: %s", entry->name); // Logiraj upozorenje.
+        }
+
+        // Sastavljanje kompletnih URL-ova za preuzimanje i brisanje.
+        // Koristi snprintf za formatiranje, uključujući enkodirano ime datoteke kao query parametar 'file'.
+        // Provjera prelijevanja snprintf-a.
+        if (snprintf(download_url, sizeof(download_url), "/download?file=%s", url_encoded_filename) >= sizeof(download_url))
+        {
+            ESP_LOGE(TAG_WEB, "Download URL truncation error for %s", entry->name);
+            download_url[sizeof(download_url) - 1] = '\0'; // Osiguraj null-terminaciju.
+        }
+        if (snprintf(delete_url, sizeof(delete_url), "/delete?file=%s", url_encoded_filename) >= sizeof(delete_url))
+        {
+            ESP_LOGE(TAG_WEB, "Delete URL truncation error for %s", entry->name);
+            delete_url[sizeof(delete_url) - 1] = '\0'; // Osiguraj null-terminaciju.
+        }
+
+        // Generiranje HTML koda za jedan red tablice (<tr>...</tr>) koji prikazuje ime datoteke
+        // i sadrži linkove za preuzimanje i brisanje.
+        // Koristi snprintf za formatiranje, dodajući generirani HTML na kraj postojećeg file_list_html buffera.
+        // Veličina se prikazuje u kB (s jednom decimalom) radi preglednosti.
+        int written_len = snprintf(file_list_html + file_list_len, file_list_buffer_size - file_list_len,
+                                   "<tr><td>%s</td><td>%lu.%lu kB</td><td><a href=\"%s\">Preuzmi</a></td><td><a href=\"%s\" class=\"delete-link\">Obriši</a></td></tr>",
+                                   entry->name, (unsigned long)(entry->size / 1024), (unsigned long)((entry->size % 1024) * 10 / 1024),
+                                   download_url, delete_url);
+        // Provjera je li snprintf bio uspješan (vratio > 0) i je li stao u preostali prostor buffera.
+        if (written_len > 0 && (size_t)written_len < (file_list_buffer_size - file_list_len))
+        {
+            file_list_len += written_len; // Ažuriraj trenutnu zauzetu duljinu buffera.
+        }
+        else
+        {
+            // Ako snprintf ne uspije ili je buffer premali, logiraj grešku.
+            ESP_LOGE(TAG_WEB, "snprintf greska pri pisanju unosa datoteke ili buffer premali za: %s", entry->name);
+            if (written_len > 0)
+                file_list_len = file_list_buffer_size - 1; // U slučaju preljeva, postavi duljinu na maksimalnu kako bi se izbjeglo pisanje izvan granica.
+            // NAPOMENA: Ovo skraćivanje može rezultirati nekompletnim HTML-om ako se dogodi unutar taga.
         }
     }
-    closedir(dir); // Zatvori direktorij nakon čitanja unosa.
-    ESP_LOGI(TAG_WEB, "Zavrseno citanje unosa u direktoriju. Ukupna duljina HTML liste: %d", file_list_len);
+    free(catalog); // Oslobodi kopiju kataloga nakon generiranja HTML-a.
+    ESP_LOGI(TAG_WEB, "Zavrsena obrada kataloga (%d datoteka). Ukupna duljina HTML liste: %d", catalog_count, file_list_len);
 
     // Postavlja Content-Type odgovora na 'text/html' jer se poslužuje HTML stranica.
     httpd_resp_set_type(req, "text/html");
@@ -838,9 +852,237 @@ fail_list_handler:
     return ESP_FAIL; // Vraća ESP_FAIL.
 }
 
+/**
+ * @brief Sends one piece of extracted CSV as a chunk of the HTTP response.
+ * Used as the columnar_extract_csv() callback; ctx is the request.
+ */
+static esp_err_t send_csv_piece(const char *data, size_t len, void *ctx)
+{
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len);
+}
+
+/**
+ * @brief Streams selected channels of a columnar log file as CSV (`/download?file=...&channels=2,5`).
+ * Only the timestamp block and the requested column blocks of each chunk are read from the card.
+ * @param req HTTP request.
+ * @param filepath Full path of the log file.
+ * @param name File name as requested (relative to the mount point).
+ * @param channels Comma separated channel list.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if the transfer was aborted.
+ */
+static esp_err_t download_columns(httpd_req_t *req, const char *filepath, const char *name, const char *channels)
+{
+    uint32_t mask;
+    if (!columnar_is_file(filepath))
+    {
+        return send_message_response(req, "Greska preuzimanja", "error",
+                                     "Odabir kanala podrzan je samo za stupcane (" COLUMNAR_EXTENSION ") zapise.");
+    }
+    if (columnar_parse_channels(channels, &mask) != ESP_OK)
+    {
+        return send_message_response(req, "Greska preuzimanja", "error", "Nevazeci popis kanala (npr. channels=2,5).");
+    }
+
+    // Ime preuzete datoteke: log_3.col + kanali 2,5 -> log_3_ch2-5.csv
+    const char *base = strrchr(name, '/');
+    base = base ? base + 1 : name;
+    char download_name[96];
+    int len = snprintf(download_name, sizeof(download_name), "%.*s_ch", (int)(strlen(base) - strlen(COLUMNAR_EXTENSION)), base);
+    const char *sep = "";
+    for (int c = 0; c < COLUMNAR_MAX_CHANNELS && len < (int)sizeof(download_name); c++)
+    {
+        if (mask & (1u << c))
+        {
+            len += snprintf(download_name + len, sizeof(download_name) - len, "%s%d", sep, c);
+            sep = "-";
+        }
+    }
+    if (len < (int)sizeof(download_name))
+        snprintf(download_name + len, sizeof(download_name) - len, ".csv");
+    char content_disposition[sizeof(download_name) + 32];
+    snprintf(content_disposition, sizeof(content_disposition), "attachment; filename=\"%s\"", download_name);
+
+    columnar_extract_stats_t stats;
+    int64_t start_us = esp_timer_get_time();
+    httpd_resp_set_type(req, "text/csv");
+    httpd_resp_set_hdr(req, "Content-Disposition", content_disposition);
+    esp_err_t err = columnar_extract_csv(filepath, mask, send_csv_piece, req, &stats);
+    if (err == ESP_ERR_NOT_FOUND || err == ESP_ERR_INVALID_VERSION || err == ESP_ERR_INVALID_ARG || err == ESP_ERR_NO_MEM)
+    {
+        // Ništa još nije poslano, pa se greška može prikazati kao poruka.
+        httpd_resp_set_hdr(req, "Content-Disposition", "inline");
+        return send_message_response(req, "Greska preuzimanja", "error",
+                                     err == ESP_ERR_NOT_FOUND ? "Datoteka nije pronadjena." :
+                                     err == ESP_ERR_INVALID_ARG ? "Zapis ne sadrzi trazeni kanal." :
+                                     err == ESP_ERR_NO_MEM ? "Interna greska servera (memorija)." :
+                                     "Datoteka nije stupcani zapis.");
+    }
+    if (err != ESP_OK || httpd_resp_send_chunk(req, NULL, 0) != ESP_OK)
+    {
+        ESP_LOGE(TAG_WEB, "Greska pri slanju kanala datoteke %s", filepath);
+        return ESP_FAIL;
+    }
+    // Koliko je kartice stvarno pročitano u odnosu na cijelu datoteku.
+    ESP_LOGI(TAG_WEB, "Kanali %s iz %s: %lu redaka, %lu blokova (%lu iz direktorija), procitano %lu od %lu B, %lld ms, prigušeno %lu puta",
+             channels, name, (unsigned long)stats.frames, (unsigned long)stats.chunks, (unsigned long)stats.indexed,
+             (unsigned long)stats.bytes_read, (unsigned long)stats.file_size,
+             (long long)((esp_timer_get_time() - start_us) / 1000), (unsigned long)stats.throttled);
+    return ESP_OK;
+}
+
+/**
+ * @struct follow_ctx_t
+ * @brief State of one follow session, owned by its task.
+ */
+typedef struct {
+    httpd_req_t *req;            // Asynchronous copy of the request.
+    char path[FILE_PATH_MAX];    // Full path of the followed file.
+    uint32_t generation;         // Active file identifier from log_tail_follow_begin().
+} follow_ctx_t;
+
+/**
+ * @brief Sends the bytes [from, to) of a file as chunks. The file is opened for every range,
+ * because an open FATFS file does not see data appended through another handle.
+ * @param failed Set to true if the client went away.
+ * @return uint32_t Number of bytes sent; less than requested if the card does not show them yet.
+ */
+static uint32_t follow_send_range(httpd_req_t *req, const char *path, uint32_t from, uint32_t to,
+                                  sd_io_session_t *io, bool *failed)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+    uint32_t sent = 0;
+    if (fseek(f, (long)from, SEEK_SET) == 0)
+    {
+        char buf[FOLLOW_CHUNK_SIZE];
+        while (from + sent < to)
+        {
+            size_t n = sd_io_read(io, buf, MIN(sizeof(buf), (size_t)(to - from - sent)), f);
+            if (n == 0)
+            {
+                break; // The new size is not synced yet
+            }
+            if (httpd_resp_send_chunk(req, buf, n) != ESP_OK)
+            {
+                *failed = true;
+                break;
+            }
+            sent += (uint32_t)n;
+        }
+    }
+    fclose(f);
+    return sent;
+}
+
+/**
+ * @brief Task that streams the active log file up to each writer checkpoint until the file is
+ * closed or the client disconnects. Runs outside the HTTP server task, which stays free for
+ * other requests.
+ * @param arg follow_ctx_t, freed by the task.
+ */
+static void follow_task(void *arg)
+{
+    follow_ctx_t *ctx = arg;
+    sd_io_session_t io = {0};
+    uint32_t sent = 0;
+    uint32_t committed = 0;
+    bool failed = false;
+    int64_t start_us = esp_timer_get_time();
+
+    while (!failed)
+    {
+        esp_err_t st = log_tail_wait(ctx->generation, sent, FOLLOW_WAIT_MS, &committed);
+        uint32_t n = 0;
+        if (committed > sent)
+        {
+            n = follow_send_range(ctx->req, ctx->path, sent, committed, &io, &failed);
+            sent += n;
+        }
+        if (st == ESP_ERR_INVALID_STATE && (sent >= committed || n == 0))
+        {
+            break; // File closed and everything on the card was sent
+        }
+        if (committed > sent && n == 0 && !failed)
+        {
+            vTaskDelay(pdMS_TO_TICKS(FOLLOW_RETRY_MS));
+        }
+    }
+    if (!failed)
+    {
+        httpd_resp_send_chunk(ctx->req, NULL, 0);
+    }
+    ESP_LOGI(TAG_WEB, "Pracenje %s zavrseno: %lu B u %lld s%s", ctx->path, (unsigned long)sent,
+             (long long)((esp_timer_get_time() - start_us) / 1000000), failed ? " (klijent prekinuo vezu)" : "");
+
+    log_tail_follow_end();
+    conn_budget_give();
+    xSemaphoreGive(follow_slots);
+    httpd_req_async_handler_complete(ctx->req);
+    free(ctx);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Starts following the active log file (`/download?file=...&follow=1`).
+ * Existing content is sent first, then new rows as the log writer commits them; the response
+ * ends when the file is closed. Only complete rows are ever sent.
+ * @param req HTTP request.
+ * @param filepath Full path of the active log file.
+ * @param generation Value from log_tail_follow_begin(); the session is ended here on failure.
+ * @return esp_err_t ESP_OK if the session was started.
+ */
+static esp_err_t download_follow(httpd_req_t *req, const char *filepath, uint32_t generation)
+{
+    if (!follow_slots || xSemaphoreTake(follow_slots, 0) != pdTRUE)
+    {
+        log_tail_follow_end();
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Previse istovremenih pracenja aktivne datoteke.");
+    }
+    if (!conn_budget_take()) // Tokovi uživo dijele iste sockete
+    {
+        xSemaphoreGive(follow_slots);
+        log_tail_follow_end();
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "Previse istovremenih tokova i pracenja.");
+    }
+    follow_ctx_t *ctx = calloc(1, sizeof(follow_ctx_t));
+    if (!ctx || httpd_req_async_handler_begin(req, &ctx->req) != ESP_OK)
+    {
+        free(ctx);
+        conn_budget_give();
+        xSemaphoreGive(follow_slots);
+        log_tail_follow_end();
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Pracenje nije moguce pokrenuti.");
+    }
+    snprintf(ctx->path, sizeof(ctx->path), "%s", filepath);
+    ctx->generation = generation;
+    httpd_resp_set_type(ctx->req, columnar_is_file(filepath) ? "application/octet-stream" : "text/plain");
+    httpd_resp_set_hdr(ctx->req, "Cache-Control", "no-cache");
+
+    if (xTaskCreate(follow_task, "log_follow", FOLLOW_TASK_STACK_SIZE, ctx, 5, NULL) != pdPASS)
+    {
+        httpd_resp_send_err(ctx->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Pracenje nije moguce pokrenuti.");
+        httpd_req_async_handler_complete(ctx->req);
+        free(ctx);
+        conn_budget_give();
+        xSemaphoreGive(follow_slots);
+        log_tail_follow_end();
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG_WEB, "Pracenje aktivne datoteke %s", filepath);
+    return ESP_OK;
+}
+
 // Handler za GET zahtjeve na putanju /download.
 // Opis: Omogućava preuzimanje datoteka s SD kartice klijentu.
 // Ime datoteke za preuzimanje se prosljeđuje kao query parametar u URL-u (npr. /download?file=ime_datoteke.txt).
+// Za stupčane zapise (.col) parametar channels (npr. &channels=2,5) daje CSV samo s tim kanalima.
+// S follow=1 za aktivnu log datoteku veza ostaje otvorena i šalju se novi redovi (kao tail -f);
+// za ostale datoteke follow se zanemaruje.
 static esp_err_t download_handler(httpd_req_t *req)
 {
     ESP_LOGI(TAG_WEB, "Serviram /download"); // Logira informaciju o zahtjevu.
@@ -848,6 +1090,8 @@ static esp_err_t download_handler(httpd_req_t *req)
     char *query_buf = NULL;                  // Buffer za čitanje query stringa iz URL-a.
     size_t query_buf_len;                    // Duljina query stringa.
     char filename_query[128 + 1];            // Buffer za vrijednost 'file' query parametra (ime datoteke kao string).
+    char channels_query[32] = "";            // Opcionalni 'channels' parametar (npr. "2,5") za stupčane zapise.
+    char follow_query[4] = "";               // Opcionalni 'follow' parametar ("1" = prati aktivnu datoteku).
     esp_err_t send_ret = ESP_OK;             // Varijabla za praćenje statusa operacije slanja podataka filea.
 
     // Dohvaća duljinu query stringa iz URL-a zahtjeva. Dodaje 1 za null-terminaciju.
@@ -877,6 +1121,15 @@ static esp_err_t download_handler(httpd_req_t *req)
         query_buf = NULL; // Oslobađa alociranu memoriju.
         return send_message_response(req, "Greška preuzimanja", "error", "Nevažeći parametar datoteke.");
     }
+    // 'channels' nije obavezan; bez njega se datoteka preuzima u izvornom obliku.
+    if (httpd_query_key_value(query_buf, "channels", channels_query, sizeof(channels_query)) != ESP_OK)
+    {
+        channels_query[0] = '\0';
+    }
+    if (httpd_query_key_value(query_buf, "follow", follow_query, sizeof(follow_query)) != ESP_OK)
+    {
+        follow_query[0] = '\0';
+    }
     free(query_buf);
     query_buf = NULL; // Oslobađa memoriju za query string jer više nije potreban.
 
@@ -894,6 +1147,24 @@ static esp_err_t download_handler(httpd_req_t *req)
     build_filepath(filepath, sizeof(filepath), MOUNT_POINT, decoded_filename);
     ESP_LOGI(TAG_WEB, "Pokusaj preuzimanja datoteke: %s (dekodirano: '%s')", filepath, decoded_filename);
 
+    // Odabrani kanali stupčanog zapisa šalju se kao CSV koji sadrži samo te stupce.
+    if (channels_query[0] != '\0')
+    {
+        char decoded_channels[sizeof(channels_query)];
+        if (url_decode(channels_query, decoded_channels, sizeof(decoded_channels)) != ESP_OK)
+        {
+            return send_message_response(req, "Greska preuzimanja", "error", "Nevazeci popis kanala.");
+        }
+        return download_columns(req, filepath, decoded_filename, decoded_channels);
+    }
+
+    // Praćenje je moguće samo za datoteku u koju log writer upravo piše.
+    uint32_t follow_generation;
+    if (strcmp(follow_query, "1") == 0 && log_tail_follow_begin(filepath, &follow_generation) == ESP_OK)
+    {
+        return download_follow(req, filepath, follow_generation);
+    }
+
     // Pokušava otvoriti datoteku na SD kartici za čitanje u binarnom modu ("rb").
     FILE *file = fopen(filepath, "rb");
     // Provjerava je li otvaranje datoteke uspjelo.
@@ -912,18 +1183,23 @@ static esp_err_t download_handler(httpd_req_t *req)
     // "attachment; filename=\"%s\"" sugerira browseru da ponudi datoteku na preuzimanje
     // s navedenim imenom (dekodirano ime datoteke).
     char content_disposition[sizeof(decoded_filename) + 50]; // Buffer za Content-Disposition zaglavlje.
-    snprintf(content_disposition, sizeof(content_disposition), "attachment; filename=\"%s\"", decoded_filename);
+    // Za datoteke u poddirektorijima (YYYY/MM/DD/...) browseru se šalje samo ime datoteke bez putanje.
+    const char *download_name = strrchr(decoded_filename, '/');
+    download_name = download_name ? download_name + 1 : decoded_filename;
+    snprintf(content_disposition, sizeof(content_disposition), "attachment; filename=\"%s\"", download_name);
     httpd_resp_set_hdr(req, "Content-Disposition", content_disposition);
 
     // Čita i šalje sadržaj datoteke u manjim dijelovima (chunkovima).
     // Ovo je efikasnije od učitavanja cijelog file-a u memoriju odjednom, pogotovo za velike file-ove.
+    // Čitanje ide kroz SD I/O scheduler, koji usporava preuzimanje kad se log writer ne stigne isprazniti.
     char file_buf[1024]; // Buffer za čitanje dijelova datoteke iz file-a.
     size_t read_bytes;   // Broj bajtova pročitanih u jednom čitanju.
+    sd_io_session_t io_session = {0}; // Statistika ovog preuzimanja (prigušenja, dubina reda log writera).
     // Petlja se izvodi dok se iz file-a čita bar 1 bajt.
     do
     {
         // Čita dio datoteke (do veličine file_buf) u buffer.
-        read_bytes = fread(file_buf, 1, sizeof(file_buf), file);
+        read_bytes = sd_io_read(&io_session, file_buf, sizeof(file_buf), file);
         // Provjerava je li išta pročitano.
         if (read_bytes > 0)
         {
@@ -955,9 +1231,84 @@ static esp_err_t download_handler(httpd_req_t *req)
     // Logira uspješan završetak preuzimanja ako nije bilo grešaka pri slanju.
     if (send_ret == ESP_OK)
         ESP_LOGI(TAG_WEB, "Preuzimanje datoteke zavrseno: %s", decoded_filename);
+    // Pokazuje da je log writer ostao ispred preuzimanja (najveća dubina reda tijekom prijenosa).
+    ESP_LOGI(TAG_WEB, "Preuzimanje %s: %lu B, prigušeno %lu puta, najveći red log writera %lu",
+             decoded_filename, (unsigned long)io_session.bytes, (unsigned long)io_session.throttled,
+             (unsigned long)io_session.max_writer_queue);
     return send_ret; // Vraća finalni status operacije slanja.
 }
 
+/**
+ * @brief Removes the now-empty directories above a deleted file, up to the mount point.
+ * Used for the date-partitioned layout, so deleting the last file of a day also removes
+ * its DD (and possibly MM and YYYY) directory. Stops at the first non-empty directory.
+ * @param filepath Full path of the deleted file.
+ */
+static void remove_empty_parent_dirs(const char *filepath)
+{
+    char dir[FILE_PATH_MAX];
+    strncpy(dir, filepath, sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = '\0';
+
+    char *slash;
+    while ((slash = strrchr(dir, '/')) != NULL && (size_t)(slash - dir) > strlen(MOUNT_POINT))
+    {
+        *slash = '\0';
+        if (rmdir(dir) != 0)
+        {
+            break; // Directory is not empty (or cannot be removed).
+        }
+        ESP_LOGI(TAG_WEB, "Removed empty directory: %s", dir);
+    }
+}
+
+/**
+ * @brief Deletes all regular files below a directory and removes the emptied subdirectories.
+ * @param dir_path Full path of the directory.
+ * @param depth Remaining recursion depth.
+ * @param deleted_count Incremented for each deleted file.
+ * @param failed_count Incremented for each file that could not be deleted.
+ * @return esp_err_t ESP_OK if the directory could be opened, ESP_FAIL otherwise.
+ */
+static esp_err_t delete_directory_contents(const char *dir_path, int depth, int *deleted_count, int *failed_count)
+{
+    DIR *dir = opendir(dir_path);
+    if (!dir) {
+        ESP_LOGE(TAG_WEB, "Error opening directory %s (%s)", dir_path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    struct dirent *entry;
+    char filepath[FILE_PATH_MAX];
+
+    while ((entry = readdir(dir)) != NULL) {
+        // Skip special entries like "." and ".." and the system volume information directory
+        if (entry->d_name[0] == '.' || strcmp(entry->d_name, "System Volume Information") == 0) {
+            continue;
+        }
+
+        snprintf(filepath, sizeof(filepath), "%s/%s", dir_path, entry->d_name);
+        filepath[sizeof(filepath) - 1] = '\0'; // Ensure null termination
+
+        if (entry->d_type == DT_DIR) {
+            if (depth > 0 && delete_directory_contents(filepath, depth - 1, deleted_count, failed_count) == ESP_OK) {
+                rmdir(filepath); // Fails harmlessly if something could not be deleted.
+            }
+        } else if (entry->d_type == DT_REG) { // Only process regular files
+            if (unlink(filepath) == 0) {
+                ESP_LOGI(TAG_WEB, "Deleted file: %s", filepath);
+                file_catalog_remove(filepath);
+                (*deleted_count)++;
+            } else {
+                ESP_LOGE(TAG_WEB, "Failed to delete file: %s (%s)", filepath, strerror(errno));
+                (*failed_count)++;
+            }
+        }
+    }
+    closedir(dir);
+    return ESP_OK;
+}
+
 // Handler za GET zahtjeve na putanju /delete.
 // Opis: Omogućava brisanje datoteka s SD kartice.
 // Ime datoteke za brisanje se prosljeđuje kao query parametar u URL-u (npr. /delete?file=ime_datoteke.txt).
@@ -1041,6 +1392,20 @@ static esp_err_t delete_handler(httpd_req_t *req)
     {
         // Ako brisanje uspije, logira uspjeh i dodaje uspješan status ("success") i poruku u JSON odgovor.
         ESP_LOGI(TAG_WEB, "Datoteka uspjesno obrisana: '%s'", decoded_filename);
+        file_catalog_remove(decoded_filename); // Ukloni datoteku i iz kataloga.
+        // Obriši i CRC sidecar datoteku log zapisa ako postoji.
+        char crc_path[FILE_PATH_MAX + 8];
+        if (log_crc_sidecar_path(filepath, crc_path, sizeof(crc_path)) == ESP_OK && unlink(crc_path) == 0)
+        {
+            file_catalog_remove(crc_path);
+        }
+        // Kod stupčanog zapisa obriši i direktorij blokova.
+        if (columnar_is_file(filepath) && columnar_dir_path(filepath, crc_path, sizeof(crc_path)) == ESP_OK &&
+            unlink(crc_path) == 0)
+        {
+            file_catalog_remove(crc_path);
+        }
+        remove_empty_parent_dirs(filepath);    // Ukloni prazne direktorije datuma (YYYY/MM/DD) koji su ostali iza nje.
         char success_msg[sizeof(decoded_filename) + 100]; // Buffer za poruku o uspjehu.
         snprintf(success_msg, sizeof(success_msg), "Datoteka '%s' je uspjesno obrisana.", decoded_filename);
 
@@ -1089,7 +1454,8 @@ send_json_delete_response:
 
 /**
  * @brief Handler for GET requests to the `/delete_all` URI.
- * Deletes all regular files from the SD card's mount point.
+ * Deletes all regular files from the SD card, including the date-partitioned
+ * log directories (YYYY/MM/DD), which are removed once they are empty.
  * Returns a JSON response indicating the operation status (success/error).
  * @param req Pointer to the HTTP request structure.
  * @return esp_err_t ESP_OK on success.
@@ -1108,41 +1474,19 @@ static esp_err_t delete_all_handler(httpd_req_t *req)
         return ESP_FAIL;
     }
 
-    DIR *dir = opendir(MOUNT_POINT);
-    if (!dir) {
-        ESP_LOGE(TAG_WEB, "Error opening directory %s (%s)", MOUNT_POINT, strerror(errno));
+    int deleted_count = 0;
+    int failed_count = 0;
+
+    if (delete_directory_contents(MOUNT_POINT, DELETE_MAX_DEPTH, &deleted_count, &failed_count) != ESP_OK) {
         cJSON_AddStringToObject(root_json, "status", "error");
         cJSON_AddStringToObject(root_json, "message", "Could not open SD card directory.");
         goto send_json_delete_all_response;
     }
-
-    struct dirent *entry;
-    char filepath[FILE_PATH_MAX];
-    int deleted_count = 0;
-    int failed_count = 0;
-
-    while ((entry = readdir(dir)) != NULL) {
-        // Skip directories and special entries like "." and ".."
-        if (entry->d_type == DT_REG) { // Only process regular files
-            // Skip system volume information directory if present
-            if (strcmp(entry->d_name, "System Volume Information") == 0) {
-                ESP_LOGI(TAG_WEB, "Skipping system directory: %s", entry->d_name);
-                continue;
-            }
-
-            snprintf(filepath, sizeof(filepath), "%s/%s", MOUNT_POINT, entry->d_name);
-            filepath[sizeof(filepath) - 1] = '\0'; // Ensure null termination
-
-            if (unlink(filepath) == 0) {
-                ESP_LOGI(TAG_WEB, "Deleted file: %s", filepath);
-                deleted_count++;
-            } else {
-                ESP_LOGE(TAG_WEB, "Failed to delete file: %s (%s)", filepath, strerror(errno));
-                failed_count++;
-            }
-        }
+    // Ako je obrisan i katalog sesija, isprazni i njegov indeks u memoriji.
+    struct stat catalog_st;
+    if (stat(MOUNT_POINT "/" SESSION_CATALOG_FILE, &catalog_st) != 0) {
+        session_catalog_clear();
     }
-    closedir(dir);
 
     if (deleted_count > 0 || failed_count > 0) {
         char msg[128];
@@ -1189,6 +1533,8 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
     char *buf = NULL;             // Buffer za primanje dijelova (chunkova) uploadanih podataka iz tijela HTTP zahtjeva.
     char *filename = NULL;        // Varijabla za spremanje imena datoteke izdvojenog iz HTTP zaglavlja (Content-Disposition).
     FILE *fd = NULL;              // File deskriptor (pointer na FILE strukturu) za pisanje u datoteku na SD kartici.
+    bool piped = false;           // True dok upload_pipe piše u fd (pisanje na karticu teče paralelno s primanjem).
+    upload_pipe_stats_t pipe_stats = {0}; // Statistika uploada (bajtovi, trajanje, KB/s).
 
     int ret;                          // Varijabla za spremanje povratnih vrijednosti funkcija (npr. httpd_req_recv, fwrite).
     int remaining = req->content_len; // Broj bajtova koji preostaju za primanje u tijelu HTTP zahtjeva.
@@ -1294,7 +1640,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
     // Petlja nastavlja primati dok god ima preostalih bajtova (remaining > 0).
     while (remaining > 0)
     {
-        ESP_LOGI(TAG_WEB, "Petlja za primanje podataka. Preostalo: %d", remaining); // Logira status u petlji.
+        ESP_LOGD(TAG_WEB, "Petlja za primanje podataka. Preostalo: %d", remaining); // Logira status u petlji.
         // Prima sljedeći chunk podataka u buffer 'buf'. Čita minimalno od preostalih bajtova ili UPLOAD_BUFFER_SIZE - 1.
         // Ostavljamo 1 bajt slobodan u bufferu kako bismo mogli null-terminirati pročitani chunk za sigurno string operacije (strstr, strchr).
         ret = httpd_req_recv(req, buf, MIN(remaining, UPLOAD_BUFFER_SIZE - 1));
@@ -1327,7 +1673,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
             goto cleanup_and_send_json; // Skok na dio za čišćenje resursa i slanje JSON odgovora.
         }
         buf[ret] = '\0';                                 // Null-terminiraj primljeni chunk kako bi bio važeći C string.
-        ESP_LOGI(TAG_WEB, "Primljeno %d bajtova.", ret); // Logira koliko bajtova je primljeno u ovom chunku.
+        ESP_LOGD(TAG_WEB, "Primljeno %d bajtova.", ret); // Logira koliko bajtova je primljeno u ovom chunku.
 
         // --- Logika za parsiranje multipart/form-data ---
         // Prvi dio multipart poruke sadrži zaglavlja dijela (uključujući Content-Disposition s imenom filea),
@@ -1470,6 +1816,15 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
                                     else
                                     {
                                         ESP_LOGI(TAG_WEB, "Datoteka '%s' uspjesno otvorena za pisanje.", filepath); // Logira uspjeh otvaranja.
+                                        // Pokreni pisač u pozadini: dok se jedan buffer piše na karticu, drugi se puni iz socketa.
+                                        if (upload_pipe_begin(fd) != ESP_OK)
+                                        {
+                                            root_json = cJSON_CreateObject();
+                                            cJSON_AddStringToObject(root_json, "status", "error");
+                                            cJSON_AddStringToObject(root_json, "message", "Interna greska servera (memorija za upload).");
+                                            goto cleanup_and_send_json;
+                                        }
+                                        piped = true;
                                     }
                                 }
                             }
@@ -1556,13 +1911,16 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
                     if (actual_data_len > 0)
                     {
                         // Ako ima stvarnih podataka za pisanje (duljina > 0), zapiši ih u otvorenu datoteku na SD kartici.
-                        fwrite(data_start_ptr, 1, actual_data_len, fd);
-                        ESP_LOGI(TAG_WEB, "Zapisano %d bajtova (iz prvog data chunka).", actual_data_len); // Logira koliko bajtova je zapisano.
+                        if (upload_pipe_write(data_start_ptr, actual_data_len) != ESP_OK)
+                        {
+                            goto upload_write_failed;
+                        }
+                        ESP_LOGD(TAG_WEB, "Zapisano %d bajtova (iz prvog data chunka).", actual_data_len); // Logira koliko bajtova je zapisano.
                     }
                     else if (boundary_in_data_ptr)
                     {
                         // Ako je boundary odmah nakon CRLF CRLF (actual_data_len je 0), to znači da je uploadana prazna datoteka.
-                        ESP_LOGI(TAG_WEB, "Boundary je na samom pocetku podataka u ovom chunku (0 bajtova filea prije njega).");
+                        ESP_LOGD(TAG_WEB, "Boundary je na samom pocetku podataka u ovom chunku (0 bajtova filea prije njega).");
                     }
 
                     if (remaining == 0)
@@ -1573,7 +1931,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
                     else
                     {
                         // Inače, nastavi s petljom za primanje sljedećih chunkova podataka datoteke.
-                        ESP_LOGI(TAG_WEB, "Nastavljam primati sljedece data chunkove.");
+                        ESP_LOGD(TAG_WEB, "Nastavljam primati sljedece data chunkove.");
                     }
                 }
                 else if (filename && !fd)
@@ -1601,7 +1959,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
             {
                 // Ako početak podataka (sekvenca \r\n\r\n) još nije pronađen u ovom chunku.
                 // Ovo se može dogoditi ako su zaglavlja prvog dijela multipart poruke veća od UPLOAD_BUFFER_SIZE.
-                ESP_LOGI(TAG_WEB, "Oznaka pocetka podataka (CRLFCRLF) jos nije pronadjena u ovom chunku.");
+                ESP_LOGD(TAG_WEB, "Oznaka pocetka podataka (CRLFCRLF) jos nije pronadjena u ovom chunku.");
                 // U ovom slučaju, ovaj chunk vjerojatno još uvijek sadrži zaglavlja prvog dijela. Podaci se ne pišu u file.
                 // TODO: Implementirati robustnije parsiranje multipart zaglavlja koja se protežu preko više chunkova.
             }
@@ -1610,7 +1968,7 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
         {
             // Ako su podaci datoteke već počeli (file_data_started je true) i file descriptor je validan.
             // Obrađujemo sljedeće chunkove koji sadrže samo binarne podatke filea.
-            ESP_LOGI(TAG_WEB, "Podaci datoteke su vec poceli. Obrada sljedeceg chunka...");
+            ESP_LOGD(TAG_WEB, "Podaci datoteke su vec poceli. Obrada sljedeceg chunka...");
             // Traži boundary string unutar *cijelog* ovog chunka.
             char *boundary_in_chunk = strstr(buf, boundary);
             size_t data_to_write = ret; // Početno, cijeli primljeni chunk se smatra podacima filea.
@@ -1636,13 +1994,16 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
             if (data_to_write > 0)
             {
                 // Ako ima podataka za pisanje, zapiši ih u datoteku.
-                fwrite(buf, 1, data_to_write, fd);
-                ESP_LOGI(TAG_WEB, "Zapisano %d bajtova (iz sljedeceg chunka).", data_to_write); // Logira koliko bajtova je zapisano.
+                if (upload_pipe_write(buf, data_to_write) != ESP_OK)
+                {
+                    goto upload_write_failed;
+                }
+                ESP_LOGD(TAG_WEB, "Zapisano %d bajtova (iz sljedeceg chunka).", data_to_write); // Logira koliko bajtova je zapisano.
             }
             else if (boundary_in_chunk)
             {
                 // Ako je boundary na samom početku chunka (nakon prethodnog chunk-a koji je završio s CRLF).
-                ESP_LOGI(TAG_WEB, "Boundary je na samom pocetku sljedeceg chunka (0 bajtova filea prije njega).");
+                ESP_LOGD(TAG_WEB, "Boundary je na samom pocetku sljedeceg chunka (0 bajtova filea prije njega).");
             }
 
             if (remaining == 0)
@@ -1677,13 +2038,33 @@ static esp_err_t upload_post_handler(httpd_req_t *req)
 
     ESP_LOGI(TAG_WEB, "Zavrsena petlja primanja podataka. Konacni 'remaining' (nakon oduzimanja): %d. Originalni content_len: %d", remaining, original_content_len);
 
+    goto cleanup_and_send_json;
+
+// Labela za grešku pri pisanju na karticu (npr. kartica je puna).
+upload_write_failed:
+    ESP_LOGE(TAG_WEB, "Greska pri pisanju uploada na SD karticu.");
+    root_json = cJSON_CreateObject();
+    cJSON_AddStringToObject(root_json, "status", "error");
+    cJSON_AddStringToObject(root_json, "message", "Greska pri pisanju na SD karticu (kartica je mozda puna).");
+
 // Labela na koju se skače u slučaju greške ili nakon uspješnog završetka petlje primanja.
 // Ovdje se vrši čišćenje resursa i slanje konačnog JSON odgovora.
 cleanup_and_send_json:
+    if (piped)
+    {
+        // Pričekaj da pozadinski pisač zapiše sve buffere prije zatvaranja datoteke.
+        if (upload_pipe_end(&pipe_stats) != ESP_OK && root_json == NULL)
+        {
+            root_json = cJSON_CreateObject();
+            cJSON_AddStringToObject(root_json, "status", "error");
+            cJSON_AddStringToObject(root_json, "message", "Greska pri pisanju na SD karticu (kartica je mozda puna).");
+        }
+    }
     if (fd)
     {
         fclose(fd); // Zatvori datoteku ako je bila otvorena.
         ESP_LOGI(TAG_WEB, "Datoteka zatvorena.");
+        file_catalog_refresh(filepath); // Ažuriraj katalog s konačnom veličinom uploadane datoteke.
     }
     if (buf)
     {
@@ -1705,6 +2086,12 @@ cleanup_and_send_json:
             cJSON_AddStringToObject(root_json, "status", "success");    // Dodaj status "success".
             cJSON_AddStringToObject(root_json, "message", success_msg); // Dodaj poruku.
             cJSON_AddStringToObject(root_json, "filename", filename);   // Dodaj ime filea u odgovor.
+            // Brzina uploada i gdje se čekalo: na karticu (card_wait_ms) ili na mrežu (network_wait_ms).
+            cJSON_AddNumberToObject(root_json, "bytes", pipe_stats.bytes);
+            cJSON_AddNumberToObject(root_json, "ms", pipe_stats.elapsed_ms);
+            cJSON_AddNumberToObject(root_json, "kb_per_s", pipe_stats.kbytes_per_s);
+            cJSON_AddNumberToObject(root_json, "card_wait_ms", pipe_stats.recv_wait_ms);
+            cJSON_AddNumberToObject(root_json, "network_wait_ms", pipe_stats.write_idle_ms);
         }
         else
         { // Ako je root_json bio NULL, a filename ili fd nisu validni, označava grešku koja nije specifično obrađena prije.
@@ -1751,16 +2138,22 @@ send_json_upload_response:
 
 // Handler za GET zahtjeve na putanju /log_status.
 // Opis: Vraća trenutni status logiranja (aktivno/neaktivno) kao jednostavan JSON objekt.
-// Format odgovora: {"active": 1} ako je aktivno, {"active": 0} ako nije.
+// Format odgovora: {"active":1,"state":"logging","transitions":3,...}; "active" je 1 i dok je stanje "armed".
 // NAPOMENA: Postoji i log_status_handler koji vraća plain text, ali ovaj handler (log_status_get_handler)
 // je registriran za /log_status URI u start_webserver funkciji.
 static esp_err_t log_status_get_handler(httpd_req_t *req)
 {
-    char resp[32]; // Buffer za JSON odgovor.
-    // Dohvaća trenutni status logiranja koristeći thread-safe funkciju is_logging_enabled().
-    bool log_active = is_logging_enabled();
-    // Formatira odgovor kao JSON objekt s ključem "active" i vrijednošću 1 (true) ili 0 (false).
-    int len = snprintf(resp, sizeof(resp), "{\"active\":%d}", log_active ? 1 : 0);
+    char resp[192]; // Buffer za JSON odgovor.
+    // Dohvaća stanje i brojače kontrolne ravnine.
+    log_control_status_t st;
+    log_control_get_status(&st);
+    // Formatira odgovor kao JSON objekt; "active" ostaje radi kompatibilnosti sa sučeljem.
+    int len = snprintf(resp, sizeof(resp),
+                       "{\"active\":%d,\"state\":\"%s\",\"transitions\":%lu,\"commands\":%lu,"
+                       "\"rejected\":%lu,\"dropped\":%lu,\"open_failures\":%lu}",
+                       st.state != LOG_STATE_IDLE ? 1 : 0, log_control_state_name(st.state),
+                       (unsigned long)st.transitions, (unsigned long)st.commands, (unsigned long)st.rejected,
+                       (unsigned long)st.dropped, (unsigned long)st.open_failures);
 
     // Postavlja Content-Type zaglavlje odgovora na 'application/json'.
     httpd_resp_set_type(req, "application/json");
@@ -1829,6 +2222,14 @@ static esp_err_t log_toggle_handler(httpd_req_t *req)
         {
             // Pretvara vrijednost u boolean: true ako je string "1", false inače.
             bool active = (strcmp(val, "1") == 0);
+            // Dok traje self-benchmark, akvizicija je pauzirana i logiranje se ne može uključiti.
+            if (active && (adc_bench_is_running() || adc_burst_is_running()))
+            {
+                httpd_resp_set_type(req, "application/json");
+                httpd_resp_set_status(req, "409 Conflict");
+                httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Benchmark ili burst snimanje je u tijeku.\"}");
+                return ESP_OK;
+            }
             // Postavlja globalni status logiranja koristeći thread-safe funkciju.
             set_logging_active(active);
             // Logira novopostavljeni status (informativna razina).
@@ -1844,28 +2245,30 @@ static esp_err_t log_toggle_handler(httpd_req_t *req)
 
 // Handler za GET zahtjeve na putanju /adc.
 // Opis: Vraća zadnjih 8 očitanih vrijednosti napona s oba ADS1115 ADC-a u JSON formatu.
-// Vrijednosti se dobivaju iz globalne varijable last_voltages.
-// Format odgovora: JSON niz float vrijednosti, npr. [1.2345, 0.5678, 3.0102, 0.0000, ...].
+// Vrijednosti se dobivaju iz zadnjeg objavljenog okvira (live_frame.c); svi kanali su uvijek iz istog okvira.
+// Format odgovora: {"seq":1234,"age_ms":12,"kanali":[{"vrijednost":1.2345,"jedinica":"V"}, ...]}.
+// "seq" je redni broj okvira (0 = još nema očitanja), "age_ms" starost okvira u milisekundama.
 esp_err_t adc_handler(httpd_req_t *req)
 {
-    float voltages[NUM_CHANNELS]; // Lokalno polje za sigurno kopiranje podataka
+    live_frame_t frame; // Lokalna kopija zadnjeg okvira
     // Dohvaćamo i konfiguracije da bismo znali jedinice za svaki kanal.
     const channel_config_t *configs = settings_get_channel_configs();
 
-    // Korištenje mutexa za sigurno čitanje globalnog polja 'last_voltages'.
-    if (xSemaphoreTake(logging_mutex, pdMS_TO_TICKS(10)) == pdTRUE)
+    // Čitanje bez zaključavanja; akvizicija nikad ne čeka na web server.
+    bool have_frame = live_frame_read(&frame);
+    float *voltages = frame.values;
+
+    // Kreiranje JSON odgovora pomoću cJSON biblioteke.
+    cJSON *root = cJSON_CreateObject();
+    cJSON_AddNumberToObject(root, "seq", frame.seq);
+    if (have_frame)
     {
-        memcpy(voltages, last_voltages, sizeof(last_voltages));
-        xSemaphoreGive(logging_mutex);
+        cJSON_AddNumberToObject(root, "age_ms", (double)((esp_timer_get_time() - frame.frame_us) / 1000));
     }
     else
     {
-        // Ako je mutex zauzet, popuni lokalno polje nulama kao fallback.
-        memset(voltages, 0, sizeof(voltages));
+        cJSON_AddNullToObject(root, "age_ms");
     }
-
-    // Kreiranje JSON odgovora pomoću cJSON biblioteke.
-    cJSON *root = cJSON_CreateObject();
     cJSON *kanali_array = cJSON_CreateArray();
     cJSON_AddItemToObject(root, "kanali", kanali_array);
 
@@ -1894,6 +2297,98 @@ esp_err_t adc_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
+// Handler za GET zahtjeve na putanje /stream.csv i /stream.sse.
+// Opis: Beskonačan tok živih očitanja za skripte i alate iz komandne linije
+//       (npr. curl "http://192.168.4.1/stream.csv?channels=0,1&rate=100" > data.csv) ili za
+//       preglednik (EventSource na /stream.sse, jedan CSV redak po događaju).
+//       Zaglavlje i format redaka isti su kao u log datoteci, samo za odabrane kanale.
+// Parametri: channels (popis kanala, zadano svi), rate (najviše redova u sekundi, zadano svaki okvir),
+//            raw=1 (napon na ulazu ADC-a umjesto skalirane vrijednosti).
+// Klijenti s istim parametrima dijele jednom formatirane retke (stream_hub.c).
+static esp_err_t stream_handler(httpd_req_t *req)
+{
+    char query_buf[96] = "";
+    char channels_query[32] = "";
+    char rate_query[12] = "";
+    char raw_query[4] = "";
+    stream_spec_t spec = {
+        .mask = (1u << NUM_CHANNELS) - 1,
+        .period_us = 0,
+        .raw = false,
+        .offsets = !frame_align_is_enabled(),
+        .format = (stream_format_t)(intptr_t)req->user_ctx,
+    };
+
+    if (httpd_req_get_url_query_str(req, query_buf, sizeof(query_buf)) == ESP_OK)
+    {
+        httpd_query_key_value(query_buf, "channels", channels_query, sizeof(channels_query));
+        httpd_query_key_value(query_buf, "rate", rate_query, sizeof(rate_query));
+        httpd_query_key_value(query_buf, "raw", raw_query, sizeof(raw_query));
+    }
+    if (channels_query[0] != '\0' &&
+        (columnar_parse_channels(channels_query, &spec.mask) != ESP_OK || spec.mask >= (1u << NUM_CHANNELS)))
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Nevazeci popis kanala (npr. channels=0,1).");
+    }
+    if (rate_query[0] != '\0')
+    {
+        char *end;
+        unsigned long rate = strtoul(rate_query, &end, 10);
+        if (*end != '\0' || rate > STREAM_MAX_RATE)
+        {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Nevazeci parametar rate (0-1000 redova u sekundi).");
+        }
+        spec.period_us = rate > 0 ? 1000000 / rate : 0;
+    }
+    spec.raw = strcmp(raw_query, "1") == 0;
+
+    httpd_req_t *async_req;
+    if (httpd_req_async_handler_begin(req, &async_req) != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Tok nije moguce pokrenuti.");
+    }
+    httpd_resp_set_type(async_req, spec.format == STREAM_FORMAT_SSE ? "text/event-stream" : "text/csv");
+    httpd_resp_set_hdr(async_req, "Cache-Control", "no-cache");
+
+    esp_err_t err = stream_hub_subscribe(async_req, &spec);
+    if (err == ESP_ERR_NO_MEM)
+    {
+        httpd_resp_set_status(async_req, "503 Service Unavailable");
+        httpd_resp_set_type(async_req, "text/plain");
+        httpd_resp_sendstr(async_req, "Previse istovremenih tokova uzivo i pracenja.");
+    }
+    if (err != ESP_OK)
+    {
+        httpd_req_async_handler_complete(async_req);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/stream/stats` URI.
+ * Returns the live stream hub counters: clients, unique specs among them, rows formatted
+ * (once per spec) and rows sent (per client), and frames lost from the ring, plus the
+ * long-lived connections (streams and followers) open out of the shared budget.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t stream_stats_get_handler(httpd_req_t *req)
+{
+    stream_hub_stats_t st;
+    stream_hub_get_stats(&st);
+
+    char resp[256];
+    snprintf(resp, sizeof(resp),
+             "{\"subscribers\":%lu,\"specs\":%lu,\"frames\":%lu,\"rows\":%lu,\"rows_sent\":%lu,\"lost_frames\":%lu,"
+             "\"long_lived\":%lu,\"long_lived_max\":%d}",
+             (unsigned long)st.subscribers, (unsigned long)st.specs, (unsigned long)st.frames,
+             (unsigned long)st.rows, (unsigned long)st.rows_sent, (unsigned long)st.lost_frames,
+             (unsigned long)conn_budget_in_use(), CONN_BUDGET_LONG_LIVED);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
+
 /**
  * @brief Handler za GET /api/channel-configs (API) - dohvaća postavke.
  * @param req HTTP zahtjev.
@@ -1963,21 +2458,8 @@ static esp_err_t logging_html_get_handler(httpd_req_t *req)
 // u start_webserver funkciji. log_status_get_handler vraća status u JSON formatu i JEST registriran.
 static esp_err_t log_status_handler(httpd_req_t *req)
 {
-    char resp[32];      // Buffer za odgovor.
-    int log_status = 0; // Varijabla za status (0 ili 1).
-
-    // Čitanje statusa logiranja koristeći mutex za thread-safe pristup globalnoj varijabli.
-    // Koristi timeout od 10ms. Ako ne uspije, log_status ostaje 0 (inicijalna vrijednost).
-    if (xSemaphoreTake(logging_mutex, pdMS_TO_TICKS(10)) == pdTRUE)
-    {
-        log_status = logging_active;   // Čita globalnu varijablu logging_active.
-        xSemaphoreGive(logging_mutex); // Otpusti mutex.
-    }
-    else
-    {
-        // Logira upozorenje ako mutex nije preuzet (ako je potrebno, trenutno zakomentirano).
-        // ESP_LOGW(TAG_WEB, "Timeout preuzimanja mutexa za log_status handler.");
-    }
+    char resp[32];                              // Buffer za odgovor.
+    int log_status = is_logging_enabled();      // Status (0 ili 1), bez zaključavanja.
 
     // Formatira odgovor kao broj (0 ili 1) u string.
     int len = snprintf(resp, sizeof(resp), "%d", log_status);
@@ -2038,127 +2520,1405 @@ static esp_err_t current_log_file_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-
-// Funkcija: start_webserver
-// Opis: Konfigurira i pokreće HTTP server na ESP32 te registrira sve URI handlere.
-// Ova funkcija je glavna ulazna točka za pokretanje web server funkcionalnosti.
-// Povratna vrijednost: esp_err_t - ESP_OK ako je server uspješno pokrenut i handleri registrirani, inače ESP_FAIL.
-esp_err_t start_webserver()
+/**
+ * @brief Handler for GET requests to the `/api/catalog/rescan` URI.
+ * Rebuilds the in-memory file catalog from the SD card. Only needed after the card
+ * contents were changed outside of the firmware (e.g. the card was edited on a PC).
+ * Returns a JSON object with the number of catalogued files and the scan duration.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t catalog_rescan_handler(httpd_req_t *req)
 {
-    // Inicijalizacija mutexa za thread-safe pristup globalnim varijablama (logging_active, last_voltages).
-    // Kreira se samo ako već nije (npr. pri prvom pokretanju servera).
-    if (logging_mutex == NULL)
+    char resp[128];
+    httpd_resp_set_type(req, "application/json");
+
+    esp_err_t err = file_catalog_rescan();
+    if (err != ESP_OK)
     {
-        logging_mutex = xSemaphoreCreateMutex(); // Pokušaj kreiranja mutexa.
-        if (logging_mutex == NULL)
-        {
-            ESP_LOGE(TAG_WEB, "Greska pri kreiranju logging_mutex!"); // Logira grešku ako kreiranje ne uspije.
-            return ESP_FAIL;                                          // Vraća grešku.
-        }
-        // ESP_LOGI(TAG_WEB, "Logging mutex kreiran."); // Opcionalno: Logira kreiranje mutexa.
+        httpd_resp_set_status(req, "500 Internal Server Error");
+        httpd_resp_sendstr(req, err == ESP_ERR_NO_MEM
+                                    ? "{\"status\":\"error\",\"message\":\"Premalo memorije za katalog; zadrzan je prethodni.\"}"
+                                    : "{\"status\":\"error\",\"message\":\"Nije moguce procitati direktorij na SD kartici.\"}");
+        return ESP_OK;
     }
 
-    // Inicijalizacija konfiguracijske strukture za HTTP server.
-    // HTTPD_DEFAULT_CONFIG() pruža standardne zadane postavke preporučene od strane ESP-IDF-a.
-    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    // Prilagodba nekih defaultnih postavki za ovaj specifični server:
-    config.stack_size = 16384;    // Povećaj veličinu stoga (stack) za HTTP server task. Web serveri obično trebaju više memorije stoga za obradu zahtjeva. Default je često 4096.
-    config.max_uri_handlers = 20; // Povećaj maksimalni broj URI handlera koji se mogu registrirati. Omogućava registraciju više različitih URL putanja. Default je često 8.
-    // Povećanje ovih vrijednosti može utjecati na potrošnju RAM-a, pa ih treba prilagoditi potrebama.
-    // config.core_id = 0; // Opcionalno: Može se postaviti da server task radi na određenoj jezgri procesora (0 ili 1 na dual-core ESP32). Ostavljanje zadano (tskNO_AFFINITY) dopušta scheduleru da odabere.
+    snprintf(resp, sizeof(resp), "{\"status\":\"success\",\"files\":%u,\"scan_ms\":%lu}",
+             (unsigned)file_catalog_count(), (unsigned long)file_catalog_last_scan_ms());
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
 
-    // Postavlja funkciju koja se koristi za uspoređivanje URI-ja dolaznih zahtjeva s registriranim URI-jima handlera.
-    // httpd_uri_match_wildcard omogućava korištenje wildcard znakova (npr. /files/*) u URI-jima definicija handlera,
-    // iako u ovom kodu nema wildcard handlera, ova postavka ne smeta i može biti korisna za buduće proširenje.
-    config.uri_match_fn = httpd_uri_match_wildcard;
+/**
+ * @brief Handler for GET requests to the `/api/io/stats` URI.
+ * Returns the SD I/O scheduler statistics: the current and peak log writer queue depth,
+ * writer wait and write times, and how often web transfers were throttled for the writer.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t io_stats_get_handler(httpd_req_t *req)
+{
+    sd_io_stats_t st;
+    sd_io_get_stats(&st);
+
+    char resp[384];
+    snprintf(resp, sizeof(resp),
+             "{\"writer_queue\":%lu,\"writer_capacity\":%lu,\"writer_queue_peak\":%lu,"
+             "\"writer_ops\":%lu,\"writer_bytes\":%llu,\"writer_max_wait_us\":%lu,\"writer_max_write_us\":%lu,"
+             "\"reader_bytes\":%llu,\"reader_throttled\":%lu}",
+             (unsigned long)st.writer_queue, (unsigned long)st.writer_capacity, (unsigned long)st.writer_queue_peak,
+             (unsigned long)st.writer_ops, (unsigned long long)st.writer_bytes, (unsigned long)st.writer_max_wait_us,
+             (unsigned long)st.writer_max_write_us, (unsigned long long)st.reader_bytes, (unsigned long)st.reader_throttled);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
 
-    // Logiranje porta na kojem će server pokušati pokrenuti. Port se obično konfigurira u sdkconfig-u projekta.
-    ESP_LOGI(TAG_WEB, "Pokrecem HTTP server na portu: %d (Max header len konfiguriran preko menuconfig)",
-             config.server_port);
+/**
+ * @brief Handler for GET requests to the `/api/settings/stats` URI.
+ * Returns the counters of the settings persistence layer: changes applied, changes coalesced
+ * into a pending commit, NVS commits and key writes, forced flushes, failures, whether a commit
+ * is pending, and the last and longest commit time.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t settings_stats_get_handler(httpd_req_t *req)
+{
+    settings_persist_stats_t st;
+    settings_get_persist_stats(&st);
+
+    char resp[256];
+    snprintf(resp, sizeof(resp),
+             "{\"changes\":%lu,\"coalesced\":%lu,\"commits\":%lu,\"nvs_writes\":%lu,\"flushes\":%lu,"
+             "\"failures\":%lu,\"pending\":%s,\"last_commit_us\":%lu,\"max_commit_us\":%lu}",
+             (unsigned long)st.changes, (unsigned long)st.coalesced, (unsigned long)st.commits,
+             (unsigned long)st.nvs_writes, (unsigned long)st.flushes, (unsigned long)st.failures,
+             st.pending ? "true" : "false", (unsigned long)st.last_commit_us, (unsigned long)st.max_commit_us);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
 
-    // Pokretanje HTTP server instance.
-    // Funkcija httpd_start() inicijalizira server, stvara potrebne taskove i započinje slušanje na konfiguriranom portu.
-    // Argumenti su: pointer na httpd_handle_t varijablu (gdje će se spremiti handler instance) i konfiguracijska struktura.
-    if (httpd_start(&server, &config) != ESP_OK)
+/**
+ * @brief Claims the single place of a long request that is answered by a worker task.
+ * The request keeps its socket while the worker runs, so it also takes a place from the
+ * shared budget of long-lived connections.
+ * @param busy Flag of the request type (e.g. verify_running).
+ * @return esp_err_t ESP_OK if claimed, ESP_ERR_INVALID_STATE if one is already running,
+ *         ESP_ERR_NO_MEM if the connection budget is exhausted.
+ */
+static esp_err_t worker_claim(bool *busy)
+{
+    portENTER_CRITICAL(&worker_lock);
+    bool was_busy = *busy;
+    *busy = true;
+    portEXIT_CRITICAL(&worker_lock);
+    if (was_busy)
+        return ESP_ERR_INVALID_STATE;
+    if (!conn_budget_take())
     {
-        // Ako pokretanje servera ne uspije, logiraj grešku.
-        ESP_LOGE(TAG_WEB, "Greska pri pokretanju servera!");
-        server = NULL;   // Postavi server handler na NULL da indicira da server nije pokrenut.
-        return ESP_FAIL; // Vraća ESP_FAIL.
+        portENTER_CRITICAL(&worker_lock);
+        *busy = false;
+        portEXIT_CRITICAL(&worker_lock);
+        return ESP_ERR_NO_MEM;
     }
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG_WEB, "Registriram URI handlere"); // Logira početak registracije handlera.
+/**
+ * @brief Releases a place claimed with worker_claim().
+ */
+static void worker_release(bool *busy)
+{
+    conn_budget_give();
+    portENTER_CRITICAL(&worker_lock);
+    *busy = false;
+    portEXIT_CRITICAL(&worker_lock);
+}
 
-    // --- Registracija URI Handlera ---
-    // Za svaku putanju (URI) koju server treba obraditi (npr. "/", "/list", "/upload"), kreira se httpd_uri_t struktura
-    // koja definira URI, HTTP metodu (GET, POST, itd.), funkciju handlera koja će obraditi zahtjev, i opcionalno korisnički kontekst.
-    // Nakon konfiguracije strukture, handler se registrira pomoću httpd_register_uri_handler().
+/**
+ * @struct verify_ctx_t
+ * @brief One verification, owned by its task.
+ */
+typedef struct {
+    httpd_req_t *req;            // Asynchronous copy of the request.
+    char filename[129];          // File name as requested (for the response).
+    char path[FILE_PATH_MAX];    // Full path of the file.
+} verify_ctx_t;
 
-    // Handler za root URI "/" (glavna stranica). Obrada GET zahtjeva.
-    httpd_uri_t root_uri = {.uri = "/", .method = HTTP_GET, .handler = root_get_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &root_uri); // Registracija handlera.
+/**
+ * @brief Sends the verification result as JSON.
+ */
+static void verify_send_result(httpd_req_t *req, const char *filename, const log_crc_result_t *result)
+{
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return;
+    }
+    float seconds = result->elapsed_ms / 1000.0f;
+    float mb_per_s = seconds > 0 ? (result->bytes_checked / (1024.0f * 1024.0f)) / seconds : 0;
+
+    cJSON_AddStringToObject(root, "status", result->bad_blocks == 0 ? "success" : "error");
+    cJSON_AddStringToObject(root, "file", filename);
+    cJSON_AddNumberToObject(root, "blocks", result->blocks);
+    cJSON_AddNumberToObject(root, "bad_blocks", result->bad_blocks);
+    cJSON_AddNumberToObject(root, "bytes_checked", (double)result->bytes_checked);
+    cJSON_AddNumberToObject(root, "bytes_unchecked", (double)result->bytes_unchecked);
+    cJSON_AddNumberToObject(root, "elapsed_ms", result->elapsed_ms);
+    cJSON_AddNumberToObject(root, "mb_per_s", mb_per_s);
+    cJSON *ranges = cJSON_AddArrayToObject(root, "bad_ranges");
+    for (uint32_t i = 0; ranges && i < result->range_count; i++)
+    {
+        cJSON *range = cJSON_CreateObject();
+        cJSON_AddNumberToObject(range, "offset", result->bad_ranges[i].offset);
+        cJSON_AddNumberToObject(range, "length", result->bad_ranges[i].length);
+        cJSON_AddItemToArray(ranges, range);
+    }
+    cJSON_AddBoolToObject(root, "ranges_truncated", result->ranges_truncated);
 
-    // Handler za URI "/list" (stranica s popisom datoteka na SD kartici). Obrada GET zahtjeva.
-    httpd_uri_t list_uri = {.uri = "/list", .method = HTTP_GET, .handler = list_get_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &list_uri);
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON print failed");
+        return;
+    }
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+}
 
-    // Handler za URI "/download" (preuzimanje datoteka s SD kartice). Obrada GET zahtjeva.
-    // Koristi query parametar za ime datoteke.
-    httpd_uri_t download_uri = {.uri = "/download", .method = HTTP_GET, .handler = download_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &download_uri);
+/**
+ * @brief FreeRTOS task that verifies one file and answers its request.
+ * Reading a large log takes a while; running it here keeps the HTTP server task free for the
+ * other endpoints, streams and followers in the meantime.
+ * @param arg verify_ctx_t of the verification (freed here).
+ */
+static void verify_task(void *arg)
+{
+    verify_ctx_t *ctx = arg;
+    log_crc_result_t *result = malloc(sizeof(log_crc_result_t));
+    esp_err_t err = result ? log_crc_verify(ctx->path, result) : ESP_ERR_NO_MEM;
+    if (err == ESP_OK)
+    {
+        verify_send_result(ctx->req, ctx->filename, result);
+    }
+    else
+    {
+        httpd_resp_set_status(ctx->req, err == ESP_ERR_NOT_FOUND ? "404 Not Found" : "500 Internal Server Error");
+        httpd_resp_sendstr(ctx->req, err == ESP_ERR_NOT_FOUND
+                                         ? "{\"status\":\"error\",\"message\":\"Datoteka ili njen CRC zapis ne postoji.\"}"
+                                         : "{\"status\":\"error\",\"message\":\"Interna greska servera (memorija).\"}");
+    }
+    free(result);
 
-    // Handler za URI "/delete" (brisanje datoteka s SD kartice). Obrada GET zahtjeva.
-    // Koristi query parametar za ime datoteke. Vraća JSON status.
-    httpd_uri_t delete_uri = {.uri = "/delete", .method = HTTP_GET, .handler = delete_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &delete_uri);
+    httpd_req_async_handler_complete(ctx->req);
+    free(ctx);
+    worker_release(&verify_running);
+    vTaskDelete(NULL);
+}
 
-// Handler za brisanje SVIH datoteka
-    httpd_uri_t delete_all_uri = {
-        .uri = "/delete_all",
-        .method = HTTP_GET, // Ili HTTP_POST za destruktivne akcije
-        .handler = delete_all_handler,
-        .user_ctx = NULL
-    };
-    httpd_register_uri_handler(server, &delete_all_uri);
+/**
+ * @brief Handler for GET requests to the `/api/verify?file=` URI.
+ * Checks a log file against its CRC sidecar and reports the corrupted byte ranges,
+ * together with the verification throughput. The check runs in its own task (one at a time,
+ * further requests get 503), which answers the request when it is done; the response is the
+ * same as if it had been computed here.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t verify_get_handler(httpd_req_t *req)
+{
+    char filename[129];
 
-    // Handler za URI "/style.css" (posluživanje ugrađenog CSS file-a). Obrada GET zahtjeva.
-    httpd_uri_t css_uri = {.uri = "/style.css", .method = HTTP_GET, .handler = css_get_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &css_uri);
+    httpd_resp_set_type(req, "application/json");
+    if (get_file_query_param(req, filename, sizeof(filename)) != ESP_OK)
+    {
+        httpd_resp_set_status(req, "400 Bad Request");
+        httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Nedostaje parametar datoteke.\"}");
+        return ESP_OK;
+    }
 
-    // Handler za URI "/script.js" (posluživanje ugrađenog JS file-a). Obrada GET zahtjeva.
-    httpd_uri_t js_uri = {.uri = "/script.js", .method = HTTP_GET, .handler = js_get_handler, .user_ctx = NULL};
-    httpd_register_uri_handler(server, &js_uri);
+    esp_err_t claim = worker_claim(&verify_running);
+    if (claim != ESP_OK)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        httpd_resp_sendstr(req, claim == ESP_ERR_INVALID_STATE
+                                    ? "{\"status\":\"error\",\"message\":\"Provjera je vec u tijeku.\"}"
+                                    : "{\"status\":\"error\",\"message\":\"Previse istovremenih dugotrajnih veza.\"}");
+        return ESP_OK;
+    }
 
-    // Handler za URI "/upload" (upload datoteka na SD karticu). Koristi POST metodu.
-    // Rukuje multipart/form-data tijelom zahtjeva.
-    httpd_uri_t upload_uri = {
-        .uri = "/upload",
-        .method = HTTP_POST,
-        .handler = upload_post_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &upload_uri);
+    verify_ctx_t *ctx = calloc(1, sizeof(verify_ctx_t));
+    if (ctx && httpd_req_async_handler_begin(req, &ctx->req) == ESP_OK)
+    {
+        snprintf(ctx->filename, sizeof(ctx->filename), "%s", filename);
+        build_filepath(ctx->path, sizeof(ctx->path), MOUNT_POINT, filename);
+        if (xTaskCreate(verify_task, "log_verify", VERIFY_TASK_STACK_SIZE, ctx, WORKER_TASK_PRIORITY, NULL) == pdPASS)
+        {
+            return ESP_OK;
+        }
+        httpd_resp_send_err(ctx->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Provjeru nije moguce pokrenuti.");
+        httpd_req_async_handler_complete(ctx->req);
+        free(ctx);
+        ctx = NULL;
+        req = NULL; // Odgovor je već poslan preko asinkrone kopije
+    }
+    free(ctx);
+    worker_release(&verify_running);
+    if (req)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Provjeru nije moguce pokrenuti.");
+    }
+    return ESP_FAIL;
+}
 
-    // Handler za URI "/logging.html" (posluživanje ugrađene HTML stranice za logiranje/monitoring). Obrada GET zahtjeva.
-    httpd_uri_t logging_uri = {
-        .uri = "/logging.html",
-        .method = HTTP_GET,
-        .handler = logging_html_get_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &logging_uri);
+/**
+ * @brief Handler for GET requests to the `/api/benchmark/start` URI.
+ * Starts the acquisition self-benchmark. Query parameters (all optional):
+ * `ms` measurement time per configuration, `target_fps` frame rate for the recommendation,
+ * `channels` channel count for the recommendation (1, 4 or 8).
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t benchmark_start_handler(httpd_req_t *req)
+{
+    char query[96];
+    char val[16];
+    uint32_t ms = 500;
+    float target_fps = 50.0f;
+    int channels = 8;
 
-    // Handler za URI "/adc" (dohvat zadnjih ADS1115 vrijednosti putem AJAX-a/API-ja). Obrada GET zahtjeva.
-    // Vraća JSON niz float vrijednosti.
-    httpd_uri_t adc_uri = {
-        .uri = "/adc",
-        .method = HTTP_GET,
-        .handler = adc_handler,
-        .user_ctx = NULL};
-    httpd_register_uri_handler(server, &adc_uri);
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        if (httpd_query_key_value(query, "ms", val, sizeof(val)) == ESP_OK)
+            ms = (uint32_t)atoi(val);
+        if (httpd_query_key_value(query, "target_fps", val, sizeof(val)) == ESP_OK)
+            target_fps = strtof(val, NULL);
+        if (httpd_query_key_value(query, "channels", val, sizeof(val)) == ESP_OK)
+            channels = atoi(val);
+    }
 
-    // Handler za URI "/log" (uključivanje/isključivanje logiranja putem query parametra ?active=0/1). Obrada GET zahtjeva.
-    // Vraća JSON status.
-    httpd_uri_t log_uri = {
-        .uri = "/log",
+    httpd_resp_set_type(req, "application/json");
+    esp_err_t err = adc_bench_start(ms, target_fps, (uint8_t)channels);
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Benchmark nije moguce pokrenuti dok je logiranje aktivno, benchmark vec radi ili traje burst snimanje.\"}");
+        return ESP_OK;
+    }
+    if (err != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Benchmark start failed");
+        return ESP_FAIL;
+    }
+
+    adc_bench_status_t st;
+    adc_bench_get_results(&st);
+    char resp[128];
+    snprintf(resp, sizeof(resp), "{\"status\":\"started\",\"configurations\":%lu,\"ms_per_config\":%lu}",
+             (unsigned long)st.total, (unsigned long)st.ms_per_config);
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
+
+/**
+ * @brief Converts one benchmark result to a JSON object.
+ */
+static cJSON *benchmark_result_to_json(const adc_bench_result_t *r)
+{
+    cJSON *item = cJSON_CreateObject();
+    if (!item)
+        return NULL;
+    cJSON_AddNumberToObject(item, "i2c_hz", r->i2c_hz);
+    cJSON_AddNumberToObject(item, "sps", r->sps);
+    cJSON_AddNumberToObject(item, "pga_fsr", r->pga_fsr);
+    cJSON_AddNumberToObject(item, "channels", r->channels);
+    cJSON_AddNumberToObject(item, "fps", r->fps);
+    cJSON_AddNumberToObject(item, "conv_avg_us", r->conv_avg_us);
+    cJSON_AddNumberToObject(item, "conv_max_us", r->conv_max_us);
+    cJSON_AddNumberToObject(item, "conversions", r->conversions);
+    cJSON_AddNumberToObject(item, "errors", r->errors);
+    cJSON_AddNumberToObject(item, "error_rate", r->conversions ? (double)r->errors / r->conversions : 0);
+    return item;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/benchmark` URI.
+ * Returns the progress of the current (or the results of the last) self-benchmark:
+ * a table with one row per configuration and the recommended configuration.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t benchmark_get_handler(httpd_req_t *req)
+{
+    adc_bench_status_t st;
+    const adc_bench_result_t *results = adc_bench_get_results(&st);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return ESP_FAIL;
+    }
+    cJSON_AddBoolToObject(root, "running", st.running);
+    cJSON_AddNumberToObject(root, "completed", st.completed);
+    cJSON_AddNumberToObject(root, "total", st.total);
+    cJSON_AddNumberToObject(root, "target_fps", st.target_fps);
+    cJSON_AddNumberToObject(root, "channels", st.channels);
+    cJSON *table = cJSON_AddArrayToObject(root, "results");
+    for (uint32_t i = 0; table && i < st.completed; i++)
+    {
+        cJSON_AddItemToArray(table, benchmark_result_to_json(&results[i]));
+    }
+    if (!st.running && st.recommended >= 0)
+    {
+        cJSON_AddItemToObject(root, "recommended", benchmark_result_to_json(&results[st.recommended]));
+        cJSON_AddBoolToObject(root, "target_met", st.target_met);
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON print failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/adc/bus` URI.
+ * Returns the ADS1115 I2C bus clock chosen at startup, whether it passed readback
+ * verification, how many fallbacks were needed, the bus time per 8-channel frame
+ * compared to 400 kHz, and the conversion wait statistics (average wait against the
+ * datasheet conversion time, calibrated margin, extra polls and timeouts).
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t adc_bus_get_handler(httpd_req_t *req)
+{
+    ads_bus_info_t info;
+    ads_bus_get_info(&info);
+
+    char resp[512];
+    snprintf(resp, sizeof(resp),
+             "{\"requested_hz\":%lu,\"active_hz\":%lu,\"verified\":%s,\"fallbacks\":%lu,"
+             "\"frame_bus_us\":%lu,\"baseline_bus_us\":%lu,\"saved_us_per_frame\":%ld,"
+             "\"conversions\":%lu,\"ready_first_poll\":%lu,\"spin_polls\":%lu,\"timeouts\":%lu,"
+             "\"avg_wait_us\":%lu,\"period_us\":%lu,\"margin_us\":%lu}",
+             (unsigned long)info.requested_hz, (unsigned long)info.active_hz, info.verified ? "true" : "false",
+             (unsigned long)info.fallbacks, (unsigned long)info.frame_bus_us, (unsigned long)info.baseline_bus_us,
+             (long)info.baseline_bus_us - (long)info.frame_bus_us,
+             (unsigned long)info.conversions, (unsigned long)info.ready_first_poll, (unsigned long)info.spin_polls,
+             (unsigned long)info.timeouts, (unsigned long)info.avg_wait_us, (unsigned long)info.period_us,
+             (unsigned long)info.margin_us);
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+    return ESP_OK;
+}
+
+/**
+ * @struct capture_ctx_t
+ * @brief One burst capture, owned by its task.
+ */
+typedef struct {
+    httpd_req_t *req;            // Asynchronous copy of the request.
+    uint8_t adc;                 // ADC index (0 or 1).
+    uint8_t channel;             // Input of that ADC (0-3).
+    uint32_t samples;            // Number of samples.
+    bool to_sd;                  // Save to burst_N.csv (true) or send back as CSV.
+} capture_ctx_t;
+
+/**
+ * @brief Captures a burst and answers its request. Runs in the capture task.
+ */
+static void capture_run(const capture_ctx_t *ctx)
+{
+    httpd_req_t *req = ctx->req;
+    adc_burst_result_t burst;
+    esp_err_t err = adc_burst_capture(ctx->adc, ctx->channel, ctx->samples, &burst);
+    if (err == ESP_ERR_INVALID_STATE)
+    {
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_set_status(req, "409 Conflict");
+        httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Burst nije moguce pokrenuti dok je logiranje aktivno ili traje benchmark.\"}");
+        return;
+    }
+    if (err != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Burst capture failed");
+        return;
+    }
+
+    if (!ctx->to_sd)
+    {
+        char header[32];
+        httpd_resp_set_type(req, "text/csv");
+        snprintf(header, sizeof(header), "%lu", (unsigned long)burst.missed);
+        httpd_resp_set_hdr(req, "X-Capture-Missed", header);
+        char sps_header[16];
+        snprintf(sps_header, sizeof(sps_header), "%.1f", burst.sps);
+        httpd_resp_set_hdr(req, "X-Capture-SPS", sps_header);
+        httpd_resp_set_hdr(req, "X-Capture-RDY-Paced", burst.rdy_paced ? "1" : "0");
+
+        char *chunk = malloc(CAPTURE_CHUNK_SIZE);
+        if (!chunk)
+        {
+            adc_burst_free(&burst);
+            httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+            return;
+        }
+        uint32_t pos = 0;
+        size_t n;
+        err = ESP_OK;
+        while (err == ESP_OK && (n = adc_burst_format_csv(&burst, &pos, chunk, CAPTURE_CHUNK_SIZE)) > 0)
+        {
+            err = httpd_resp_send_chunk(req, chunk, n);
+        }
+        free(chunk);
+        adc_burst_free(&burst);
+        if (err == ESP_OK)
+        {
+            httpd_resp_send_chunk(req, NULL, 0);
+        }
+        return;
+    }
+
+    char path[FILE_PATH_MAX];
+    err = adc_burst_save(&burst, path, sizeof(path));
+    char resp[256];
+    if (err == ESP_OK)
+    {
+        snprintf(resp, sizeof(resp),
+                 "{\"status\":\"ok\",\"file\":\"%s\",\"samples\":%lu,\"missed\":%lu,"
+                 "\"duration_ms\":%.1f,\"sps\":%.1f,\"rdy_paced\":%s}",
+                 path + strlen(MOUNT_POINT) + 1, (unsigned long)burst.count, (unsigned long)burst.missed,
+                 burst.duration_us / 1000.0f, burst.sps, burst.rdy_paced ? "true" : "false");
+    }
+    adc_burst_free(&burst);
+    if (err != ESP_OK)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Spremanje bursta na SD karticu nije uspjelo");
+        return;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
+}
+
+/**
+ * @brief FreeRTOS task that captures one burst and answers its request.
+ * A burst can take about 35 s; running it here keeps the HTTP server task free for the other
+ * endpoints, streams and followers in the meantime.
+ * @param arg capture_ctx_t of the capture (freed here).
+ */
+static void capture_task(void *arg)
+{
+    capture_ctx_t *ctx = arg;
+    capture_run(ctx);
+    httpd_req_async_handler_complete(ctx->req);
+    free(ctx);
+    worker_release(&capture_running);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/capture` URI.
+ * Captures a burst of samples from one channel at the full ADC data rate.
+ * Query parameters: `adc` (0 or 1), `channel` (0-3), `samples` (1-30000, default 1000) and
+ * `dest` (`sd` to save the burst to burst_N.csv and return a JSON summary, `http` to stream
+ * it back as CSV). The response arrives when the burst is done; logging must be off. The
+ * burst runs in its own task (one at a time), so the server keeps serving other requests.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t capture_handler(httpd_req_t *req)
+{
+    char query[96];
+    char val[16];
+    int adc = 0;
+    int channel = 0;
+    int samples = 1000;
+    bool to_sd = true;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        if (httpd_query_key_value(query, "adc", val, sizeof(val)) == ESP_OK)
+            adc = atoi(val);
+        if (httpd_query_key_value(query, "channel", val, sizeof(val)) == ESP_OK)
+            channel = atoi(val);
+        if (httpd_query_key_value(query, "samples", val, sizeof(val)) == ESP_OK)
+            samples = atoi(val);
+        if (httpd_query_key_value(query, "dest", val, sizeof(val)) == ESP_OK)
+            to_sd = strcmp(val, "http") != 0;
+    }
+    if (adc < 0 || adc > 1 || channel < 0 || channel > 3 || samples < 1 || samples > ADC_BURST_MAX_SAMPLES)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravni parametri (adc 0-1, channel 0-3, samples 1-30000)");
+        return ESP_FAIL;
+    }
+
+    esp_err_t claim = worker_claim(&capture_running);
+    if (claim != ESP_OK)
+    {
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_set_status(req, claim == ESP_ERR_INVALID_STATE ? "409 Conflict" : "503 Service Unavailable");
+        httpd_resp_sendstr(req, claim == ESP_ERR_INVALID_STATE
+                                    ? "{\"status\":\"error\",\"message\":\"Burst je vec u tijeku.\"}"
+                                    : "{\"status\":\"error\",\"message\":\"Previse istovremenih dugotrajnih veza.\"}");
+        return ESP_OK;
+    }
+
+    capture_ctx_t *ctx = calloc(1, sizeof(capture_ctx_t));
+    if (ctx && httpd_req_async_handler_begin(req, &ctx->req) == ESP_OK)
+    {
+        ctx->adc = (uint8_t)adc;
+        ctx->channel = (uint8_t)channel;
+        ctx->samples = (uint32_t)samples;
+        ctx->to_sd = to_sd;
+        if (xTaskCreate(capture_task, "adc_capture", CAPTURE_TASK_STACK_SIZE, ctx, WORKER_TASK_PRIORITY, NULL) == pdPASS)
+        {
+            return ESP_OK;
+        }
+        httpd_resp_send_err(ctx->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Burst nije moguce pokrenuti.");
+        httpd_req_async_handler_complete(ctx->req);
+        free(ctx);
+        ctx = NULL;
+        req = NULL; // Odgovor je već poslan preko asinkrone kopije
+    }
+    free(ctx);
+    worker_release(&capture_running);
+    if (req)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Burst nije moguce pokrenuti.");
+    }
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/adc/timing` URI.
+ * Returns the measured inter-channel skew (time between the first and last conversion of a
+ * frame), the average sampling delay of each channel after channel 0, the frame period with
+ * its min/max/average/standard deviation (acquisition jitter) and whether values are
+ * interpolated to a common frame instant. With `?reset=1` the statistics are cleared after
+ * they were read, so consecutive requests cover consecutive periods (used by tools/loadtest.py).
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t adc_timing_get_handler(httpd_req_t *req)
+{
+    frame_align_stats_t st;
+    frame_align_get_stats(&st);
+
+    char query[32];
+    char value[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "reset", value, sizeof(value)) == ESP_OK && strcmp(value, "1") == 0)
+    {
+        frame_align_reset_stats();
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return ESP_FAIL;
+    }
+    cJSON_AddBoolToObject(root, "aligned", st.enabled);
+    cJSON_AddNumberToObject(root, "frames", st.frames);
+    cJSON_AddNumberToObject(root, "aligned_frames", st.aligned_frames);
+    cJSON_AddNumberToObject(root, "frame_period_us", st.frame_period_us);
+    cJSON_AddNumberToObject(root, "skew_last_us", st.skew_last_us);
+    cJSON_AddNumberToObject(root, "skew_avg_us", st.skew_avg_us);
+    cJSON_AddNumberToObject(root, "skew_max_us", st.skew_max_us);
+    cJSON_AddNumberToObject(root, "periods", st.periods);
+    cJSON_AddNumberToObject(root, "period_min_us", st.period_min_us);
+    cJSON_AddNumberToObject(root, "period_max_us", st.period_max_us);
+    cJSON_AddNumberToObject(root, "period_avg_us", st.period_avg_us);
+    cJSON_AddNumberToObject(root, "period_std_us", st.period_std_us);
+    cJSON *offsets = cJSON_AddArrayToObject(root, "offset_avg_us");
+    for (int i = 0; offsets && i < FRAME_ALIGN_MAX_CHANNELS; i++)
+    {
+        cJSON_AddItemToArray(offsets, cJSON_CreateNumber(st.offset_avg_us[i]));
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON print failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * @brief Receives a small JSON request body and parses it.
+ * Sends the error response itself if the body is missing, too large or not valid JSON.
+ * @param req Pointer to the HTTP request structure.
+ * @return cJSON* Parsed body (free with cJSON_Delete()), or NULL on error.
+ */
+static cJSON *receive_json_body(httpd_req_t *req)
+{
+    char buf[1024];
+    if (req->content_len == 0 || req->content_len >= sizeof(buf))
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravna veličina zahtjeva");
+        return NULL;
+    }
+    int received = 0;
+    while (received < (int)req->content_len)
+    {
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret <= 0)
+        {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT)
+                httpd_resp_send_408(req);
+            return NULL;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
+
+    cJSON *root = cJSON_Parse(buf);
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Invalid JSON");
+    }
+    return root;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/schedule` URI.
+ * Returns the logging schedule and the state of the schedule engine:
+ * `{"enabled":true,"clock_valid":true,"in_window":false,"next_change":1718000000,"sessions":3,
+ *   "windows":[{"days":62,"start":"06:00","duration_min":10,"every_min":60}]}`.
+ * `days` is a weekday bit mask (bit 0 = Sunday ... bit 6 = Saturday).
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t schedule_get_handler(httpd_req_t *req)
+{
+    schedule_config_t cfg;
+    schedule_status_t st;
+    schedule_get_config(&cfg);
+    schedule_get_status(&st);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return ESP_FAIL;
+    }
+    cJSON_AddBoolToObject(root, "enabled", cfg.enabled);
+    cJSON_AddBoolToObject(root, "clock_valid", st.clock_valid);
+    cJSON_AddBoolToObject(root, "in_window", st.in_window);
+    cJSON_AddNumberToObject(root, "next_change", (double)st.next_change);
+    cJSON_AddNumberToObject(root, "sessions", st.sessions);
+    cJSON *windows = cJSON_AddArrayToObject(root, "windows");
+    for (uint8_t i = 0; windows && i < cfg.count; i++)
+    {
+        const schedule_window_t *w = &cfg.windows[i];
+        cJSON *item = cJSON_CreateObject();
+        if (!item)
+            break;
+        char start[8];
+        snprintf(start, sizeof(start), "%02u:%02u", w->start_min / 60, w->start_min % 60);
+        cJSON_AddNumberToObject(item, "days", w->days);
+        cJSON_AddStringToObject(item, "start", start);
+        cJSON_AddNumberToObject(item, "duration_min", w->duration_min);
+        cJSON_AddNumberToObject(item, "every_min", w->every_min);
+        cJSON_AddItemToArray(windows, item);
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON print failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST requests to the `/api/schedule` URI.
+ * Replaces the logging schedule with the one in the JSON body (same format as GET,
+ * only `enabled` and `windows` are used) and stores it in NVS.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t schedule_post_handler(httpd_req_t *req)
+{
+    cJSON *root = receive_json_body(req);
+    if (!root)
+        return ESP_FAIL;
+
+    schedule_config_t cfg = {0};
+    cJSON *enabled = cJSON_GetObjectItem(root, "enabled");
+    cJSON *windows = cJSON_GetObjectItem(root, "windows");
+    cfg.enabled = cJSON_IsTrue(enabled);
+    bool valid = cJSON_IsArray(windows) && cJSON_GetArraySize(windows) <= SCHEDULE_MAX_WINDOWS;
+
+    cJSON *item = NULL;
+    if (valid)
+    {
+        cJSON_ArrayForEach(item, windows)
+        {
+            cJSON *days = cJSON_GetObjectItem(item, "days");
+            cJSON *start = cJSON_GetObjectItem(item, "start");
+            cJSON *duration = cJSON_GetObjectItem(item, "duration_min");
+            cJSON *every = cJSON_GetObjectItem(item, "every_min");
+            unsigned hh, mm;
+            if (!cJSON_IsNumber(days) || !cJSON_IsString(start) || !cJSON_IsNumber(duration) ||
+                sscanf(start->valuestring, "%u:%u", &hh, &mm) != 2 || hh > 23 || mm > 59 ||
+                days->valueint < 0 || duration->valueint < 0 ||
+                (cJSON_IsNumber(every) && every->valueint < 0))
+            {
+                valid = false;
+                break;
+            }
+            schedule_window_t *w = &cfg.windows[cfg.count++];
+            w->days = (uint8_t)days->valueint;
+            w->start_min = (uint16_t)(hh * 60 + mm);
+            w->duration_min = (uint16_t)duration->valueint;
+            w->every_min = cJSON_IsNumber(every) ? (uint16_t)every->valueint : 0;
+        }
+    }
+    cJSON_Delete(root);
+
+    esp_err_t err = valid ? schedule_set_config(&cfg) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_INVALID_ARG)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravan raspored (days 1-127, start HH:MM, duration_min 1-1440, every_min 0-1440)");
+    }
+    if (err != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Greška pri spremanju rasporeda.");
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/alarms` URI.
+ * Returns the alarm limits and state of every channel and the cost of the evaluation:
+ * `{"active_mask":2,"events":5,"dropped":0,"frames":12000,"cycles_last":180,"cycles_max":420,"cycles_avg":175,
+ *   "channels":[{"channel":0,"state":"normal","high":2.5,"low":null,"hysteresis":0.05,"debounce":3}, ...]}`.
+ * A disabled limit is `null`.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t alarms_get_handler(httpd_req_t *req)
+{
+    alarm_config_t cfg;
+    alarm_status_t st;
+    alarm_get_config(&cfg);
+    alarm_get_status(&st);
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return ESP_FAIL;
+    }
+    cJSON_AddNumberToObject(root, "active_mask", st.active_mask);
+    cJSON_AddNumberToObject(root, "events", st.events);
+    cJSON_AddNumberToObject(root, "dropped", st.dropped);
+    cJSON_AddNumberToObject(root, "frames", st.frames);
+    cJSON_AddNumberToObject(root, "cycles_last", st.cycles_last);
+    cJSON_AddNumberToObject(root, "cycles_max", st.cycles_max);
+    cJSON_AddNumberToObject(root, "cycles_avg", st.cycles_avg);
+    cJSON *channels = cJSON_AddArrayToObject(root, "channels");
+    for (int i = 0; channels && i < NUM_CHANNELS; i++)
+    {
+        const alarm_limit_t *l = &cfg.channels[i];
+        cJSON *item = cJSON_CreateObject();
+        if (!item)
+            break;
+        cJSON_AddNumberToObject(item, "channel", i);
+        cJSON_AddStringToObject(item, "state", alarm_state_name((alarm_state_t)st.states[i]));
+        if (l->high_enabled)
+            cJSON_AddNumberToObject(item, "high", l->high);
+        else
+            cJSON_AddNullToObject(item, "high");
+        if (l->low_enabled)
+            cJSON_AddNumberToObject(item, "low", l->low);
+        else
+            cJSON_AddNullToObject(item, "low");
+        cJSON_AddNumberToObject(item, "hysteresis", l->hysteresis);
+        cJSON_AddNumberToObject(item, "debounce", l->debounce);
+        cJSON_AddItemToArray(channels, item);
+    }
+
+    char *json_string = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON print failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+    return ESP_OK;
+}
+
+/**
+ * @brief Handler for POST requests to the `/api/alarms` URI.
+ * Updates the limits of the channels listed in the JSON body (same format as GET, only
+ * `channel`, `high`, `low`, `hysteresis` and `debounce` are used; `null` or a missing limit
+ * disables it) and stores them in NVS. Channels that are not listed keep their limits.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t alarms_post_handler(httpd_req_t *req)
+{
+    cJSON *root = receive_json_body(req);
+    if (!root)
+        return ESP_FAIL;
+
+    alarm_config_t cfg;
+    alarm_get_config(&cfg);
+    cJSON *channels = cJSON_GetObjectItem(root, "channels");
+    bool valid = cJSON_IsArray(channels);
+
+    cJSON *item = NULL;
+    if (valid)
+    {
+        cJSON_ArrayForEach(item, channels)
+        {
+            cJSON *channel = cJSON_GetObjectItem(item, "channel");
+            cJSON *high = cJSON_GetObjectItem(item, "high");
+            cJSON *low = cJSON_GetObjectItem(item, "low");
+            cJSON *hysteresis = cJSON_GetObjectItem(item, "hysteresis");
+            cJSON *debounce = cJSON_GetObjectItem(item, "debounce");
+            if (!cJSON_IsNumber(channel) || channel->valueint < 0 || channel->valueint >= NUM_CHANNELS ||
+                (hysteresis && !cJSON_IsNumber(hysteresis)) || (debounce && !cJSON_IsNumber(debounce)))
+            {
+                valid = false;
+                break;
+            }
+            alarm_limit_t *l = &cfg.channels[channel->valueint];
+            l->high_enabled = cJSON_IsNumber(high);
+            l->high = l->high_enabled ? (float)high->valuedouble : 0.0f;
+            l->low_enabled = cJSON_IsNumber(low);
+            l->low = l->low_enabled ? (float)low->valuedouble : 0.0f;
+            l->hysteresis = hysteresis ? (float)hysteresis->valuedouble : 0.0f;
+            l->debounce = debounce ? (uint16_t)MAX(0, MIN(debounce->valueint, UINT16_MAX)) : 1;
+        }
+    }
+    cJSON_Delete(root);
+
+    esp_err_t err = valid ? alarm_set_config(&cfg) : ESP_ERR_INVALID_ARG;
+    if (err == ESP_ERR_INVALID_ARG)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravne granice alarma (channel 0-7, low < high, hysteresis >= 0, debounce 1-1000)");
+    }
+    if (err != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Greška pri spremanju granica alarma.");
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/time` URI.
+ * Returns the system clock (`epoch`, `local` time) and the POSIX time zone used for the schedule.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t time_get_handler(httpd_req_t *req)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    char local[32];
+    char tz[SCHEDULE_TZ_MAX];
+    localtime_r(&now, &tm);
+    strftime(local, sizeof(local), "%Y-%m-%d %H:%M:%S", &tm);
+    schedule_get_tz(tz, sizeof(tz));
+
+    schedule_status_t st;
+    schedule_get_status(&st);
+    char resp[160];
+    snprintf(resp, sizeof(resp), "{\"epoch\":%lld,\"local\":\"%s\",\"tz\":\"%s\",\"valid\":%s}",
+             (long long)now, local, tz, st.clock_valid ? "true" : "false");
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, resp);
+}
+
+/**
+ * @brief Handler for POST requests to the `/api/time` URI.
+ * Sets the system clock from `{"epoch":1718000000,"tz":"CET-1CEST,M3.5.0,M10.5.0/3"}`
+ * (`tz` is optional and kept in NVS). The device has no battery-backed clock, so the time has
+ * to be set again after every power cycle; the web interface does this from the browser.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t time_post_handler(httpd_req_t *req)
+{
+    cJSON *root = receive_json_body(req);
+    if (!root)
+        return ESP_FAIL;
+
+    cJSON *epoch = cJSON_GetObjectItem(root, "epoch");
+    cJSON *tz = cJSON_GetObjectItem(root, "tz");
+    esp_err_t err = ESP_ERR_INVALID_ARG;
+    if (cJSON_IsNumber(epoch))
+    {
+        err = schedule_set_time((time_t)epoch->valuedouble, cJSON_IsString(tz) ? tz->valuestring : NULL);
+    }
+    cJSON_Delete(root);
+
+    if (err != ESP_OK)
+    {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Neispravno vrijeme ili vremenska zona");
+    }
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, "{\"status\":\"ok\"}");
+}
+
+/**
+ * @brief Handler for POST requests to the `/api/sessions/start` URI.
+ * Starts logging as a new session described by `{"tags":["pump","test"],"note":"..."}`
+ * (both optional; tags may also be given as a comma separated string) and returns its id:
+ * `{"status":"ok","id":12}`. Refused with 409 while logging, the self-benchmark or a burst is active.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t sessions_start_handler(httpd_req_t *req)
+{
+    char tags[SESSION_TAGS_MAX] = "";
+    char note[SESSION_NOTE_MAX] = "";
+
+    if (req->content_len > 0)
+    {
+        cJSON *root = receive_json_body(req);
+        if (!root)
+            return ESP_FAIL;
+        cJSON *tags_item = cJSON_GetObjectItem(root, "tags");
+        cJSON *note_item = cJSON_GetObjectItem(root, "note");
+        if (cJSON_IsArray(tags_item))
+        {
+            size_t used = 0;
+            cJSON *tag = NULL;
+            cJSON_ArrayForEach(tag, tags_item)
+            {
+                if (!cJSON_IsString(tag) || tag->valuestring[0] == '\0' || strchr(tag->valuestring, ','))
+                    continue; // Commas separate the stored tags
+                int n = snprintf(tags + used, sizeof(tags) - used, "%s%s", used ? "," : "", tag->valuestring);
+                if (n < 0 || used + (size_t)n >= sizeof(tags))
+                {
+                    tags[used] = '\0'; // Drop the tag that does not fit
+                    break;
+                }
+                used += (size_t)n;
+            }
+        }
+        else if (cJSON_IsString(tags_item))
+        {
+            snprintf(tags, sizeof(tags), "%s", tags_item->valuestring);
+        }
+        if (cJSON_IsString(note_item))
+        {
+            snprintf(note, sizeof(note), "%s", note_item->valuestring);
+        }
+        cJSON_Delete(root);
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    uint32_t id = 0;
+    if (is_logging_enabled() || adc_bench_is_running() || adc_burst_is_running() ||
+        session_catalog_prepare(tags, note, &id) != ESP_OK)
+    {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Sesiju nije moguce pokrenuti: logiranje, benchmark ili burst je vec aktivan.\"}");
+    }
+    // Ako naredba ne stigne do stroja stanja, pripremljene oznake ne smiju ostati za sljedeći start.
+    if (log_control_post(LOG_CMD_START, LOG_SRC_WEB, NULL) != ESP_OK)
+    {
+        session_catalog_cancel_pending();
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Sesiju nije moguce pokrenuti: red naredbi je pun.\"}");
+    }
+    ESP_LOGI(TAG_WEB, "Sesija %lu pokrenuta (oznake: %s)", (unsigned long)id, tags);
+
+    char resp[64];
+    snprintf(resp, sizeof(resp), "{\"status\":\"ok\",\"id\":%lu}", (unsigned long)id);
+    return httpd_resp_sendstr(req, resp);
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/sessions/stop` URI.
+ * Stops logging, which ends the running session. Returns the id of the session that was running.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t sessions_stop_handler(httpd_req_t *req)
+{
+    uint32_t id = session_catalog_current();
+    set_logging_active(false); // Stopping before the log file was opened drops the prepared session
+
+    char resp[64];
+    snprintf(resp, sizeof(resp), "{\"status\":\"ok\",\"id\":%lu}", (unsigned long)id);
+    httpd_resp_set_type(req, "application/json");
+    return httpd_resp_sendstr(req, resp);
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/marker` URI.
+ * Sets a marker with the label given by `text` (optional, default "web") in the running log.
+ * The marker is placed before the next frame and recorded in the session catalog.
+ * Refused with 409 unless a log file is open.
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t marker_handler(httpd_req_t *req)
+{
+    char query[128];
+    char value[3 * LOG_CONTROL_TEXT_MAX];
+    char text[LOG_CONTROL_TEXT_MAX] = "web";
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "text", value, sizeof(value)) == ESP_OK && value[0] != '\0')
+    {
+        // '+' je razmak u query stringu
+        for (char *p = value; *p; p++)
+        {
+            if (*p == '+')
+                *p = ' ';
+        }
+        if (url_decode(value, text, sizeof(text)) != ESP_OK || text[0] == '\0')
+        {
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "Nevazeci tekst markera");
+        }
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    if (log_control_state() != LOG_STATE_LOGGING)
+    {
+        httpd_resp_set_status(req, "409 Conflict");
+        return httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Marker je moguce postaviti samo dok se logira.\"}");
+    }
+    if (log_control_post(LOG_CMD_MARKER, LOG_SRC_WEB, text) != ESP_OK)
+    {
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_sendstr(req, "{\"status\":\"error\",\"message\":\"Red naredbi je pun.\"}");
+    }
+
+    char resp[64];
+    snprintf(resp, sizeof(resp), "{\"status\":\"ok\",\"session\":%lu}", (unsigned long)session_catalog_current());
+    return httpd_resp_sendstr(req, resp);
+}
+
+/**
+ * @brief Adds the markers of a session as a `marker_list` array of
+ * `{"t":...,"ms":...,"row":...,"frame":...,"text":"..."}` objects, and `marker_list_truncated`
+ * if not all of them are in the list.
+ */
+static void add_session_markers(cJSON *item, uint32_t id)
+{
+    session_marker_t *list = malloc(SESSION_MARKERS_LIST_MAX * sizeof(session_marker_t));
+    if (!list)
+        return;
+    bool truncated;
+    size_t n = session_catalog_markers(id, list, SESSION_MARKERS_LIST_MAX, &truncated);
+    cJSON_AddBoolToObject(item, "marker_list_truncated", truncated);
+    cJSON *arr = cJSON_AddArrayToObject(item, "marker_list");
+    for (size_t i = 0; arr && i < n; i++)
+    {
+        cJSON *m = cJSON_CreateObject();
+        if (!m)
+            break;
+        cJSON_AddNumberToObject(m, "t", (double)list[i].t);
+        cJSON_AddNumberToObject(m, "ms", list[i].ms);
+        cJSON_AddNumberToObject(m, "row", list[i].row);
+        cJSON_AddNumberToObject(m, "frame", list[i].frame);
+        cJSON_AddStringToObject(m, "text", list[i].text);
+        cJSON_AddItemToArray(arr, m);
+    }
+    free(list);
+}
+
+/**
+ * @brief Converts one session to a JSON object.
+ */
+static cJSON *session_to_json(const session_info_t *s, bool with_stats)
+{
+    cJSON *item = cJSON_CreateObject();
+    if (!item)
+        return NULL;
+    char hash[12];
+    snprintf(hash, sizeof(hash), "%08lx", (unsigned long)s->cfg_hash);
+    cJSON_AddNumberToObject(item, "id", s->id);
+    cJSON_AddNumberToObject(item, "start", (double)s->start);
+    cJSON_AddNumberToObject(item, "end", (double)s->end);
+    cJSON_AddStringToObject(item, "file", s->file);
+    cJSON_AddStringToObject(item, "tags", s->tags);
+    cJSON_AddStringToObject(item, "note", s->note);
+    cJSON_AddStringToObject(item, "cfg_hash", hash);
+    cJSON_AddBoolToObject(item, "running", s->id == session_catalog_current());
+    cJSON_AddNumberToObject(item, "markers", s->markers);
+    if (with_stats && s->markers)
+    {
+        add_session_markers(item, s->id);
+    }
+    if (s->has_summary)
+    {
+        cJSON_AddNumberToObject(item, "rows", s->summary.rows);
+        cJSON_AddNumberToObject(item, "bytes", s->summary.bytes);
+        if (with_stats)
+        {
+            cJSON_AddItemToObject(item, "min", cJSON_CreateFloatArray(s->summary.min, NUM_CHANNELS));
+            cJSON_AddItemToObject(item, "max", cJSON_CreateFloatArray(s->summary.max, NUM_CHANNELS));
+            cJSON_AddItemToObject(item, "mean", cJSON_CreateFloatArray(s->summary.mean, NUM_CHANNELS));
+        }
+    }
+    return item;
+}
+
+/**
+ * @brief Handler for GET requests to the `/api/sessions` URI.
+ * Lists sessions from the catalog, newest first (older ones are read from the card). Query parameters (all optional):
+ * `id` a single session (with per-channel min/max/mean), `tag` exact tag, `q` text in tags,
+ * note or file name, `from`/`to` start time range (epoch seconds), `limit` (default 50, max 100).
+ * @param req Pointer to the HTTP request structure.
+ * @return esp_err_t ESP_OK on success.
+ */
+static esp_err_t sessions_get_handler(httpd_req_t *req)
+{
+    char query[192];
+    char val[16];
+    char tag[SESSION_TAGS_MAX] = "";
+    char text[SESSION_NOTE_MAX] = "";
+    session_query_t filter = {.tag = tag, .text = text};
+    int limit = 50;
+    long id = -1;
+
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK)
+    {
+        if (httpd_query_key_value(query, "id", val, sizeof(val)) == ESP_OK)
+            id = atol(val);
+        httpd_query_key_value(query, "tag", tag, sizeof(tag));
+        httpd_query_key_value(query, "q", text, sizeof(text));
+        if (httpd_query_key_value(query, "from", val, sizeof(val)) == ESP_OK)
+            filter.from = (time_t)atoll(val);
+        if (httpd_query_key_value(query, "to", val, sizeof(val)) == ESP_OK)
+            filter.to = (time_t)atoll(val);
+        if (httpd_query_key_value(query, "limit", val, sizeof(val)) == ESP_OK)
+            limit = atoi(val);
+    }
+    if (limit < 1 || limit > 100)
+        limit = 100;
+
+    cJSON *root = NULL;
+    if (id >= 0)
+    {
+        session_info_t s;
+        if (session_catalog_get((uint32_t)id, &s) != ESP_OK)
+        {
+            return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, "Sesija nije pronađena");
+        }
+        root = session_to_json(&s, true);
+    }
+    else
+    {
+        session_info_t *found = malloc(limit * sizeof(session_info_t));
+        if (!found)
+        {
+            return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+        }
+        size_t total = 0;
+        bool truncated;
+        size_t n = session_catalog_find(&filter, found, (size_t)limit, &total, &truncated);
+        root = cJSON_CreateObject();
+        if (root)
+        {
+            cJSON_AddNumberToObject(root, "total", total);
+            cJSON_AddBoolToObject(root, "truncated", truncated); // Katalog na kartici nije pročitan do kraja
+            cJSON *list = cJSON_AddArrayToObject(root, "sessions");
+            for (size_t i = 0; list && i < n; i++)
+            {
+                cJSON_AddItemToArray(list, session_to_json(&found[i], false));
+            }
+        }
+        free(found);
+    }
+
+    char *json_string = root ? cJSON_PrintUnformatted(root) : NULL;
+    cJSON_Delete(root);
+    if (!json_string)
+    {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "JSON creation failed");
+        return ESP_FAIL;
+    }
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, json_string);
+    cJSON_free(json_string);
+    return ESP_OK;
+}
+
+
+// Funkcija: start_webserver
+// Opis: Konfigurira i pokreće HTTP server na ESP32 te registrira sve URI handlere.
+// Ova funkcija je glavna ulazna točka za pokretanje web server funkcionalnosti.
+// Povratna vrijednost: esp_err_t - ESP_OK ako je server uspješno pokrenut i handleri registrirani, inače ESP_FAIL.
+esp_err_t start_webserver()
+{
+    // Pokretanje pozadinskog pisača za upload (primanje i pisanje na karticu se preklapaju).
+    if (upload_pipe_init() != ESP_OK)
+    {
+        ESP_LOGE(TAG_WEB, "Greska pri pokretanju upload pisaca!");
+        return ESP_FAIL;
+    }
+    // Mjesta za praćenje aktivne log datoteke (svako praćenje ima svoj task).
+    if (follow_slots == NULL)
+    {
+        follow_slots = xSemaphoreCreateCounting(FOLLOW_MAX_SESSIONS, FOLLOW_MAX_SESSIONS);
+    }
+    if (stream_hub_init() != ESP_OK)
+    {
+        ESP_LOGE(TAG_WEB, "Greska pri pokretanju tokova uzivo!");
+        return ESP_FAIL;
+    }
+
+    // Inicijalizacija konfiguracijske strukture za HTTP server.
+    // HTTPD_DEFAULT_CONFIG() pruža standardne zadane postavke preporučene od strane ESP-IDF-a.
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    // Prilagodba nekih defaultnih postavki za ovaj specifični server:
+    config.stack_size = 16384;    // Povećaj veličinu stoga (stack) za HTTP server task. Web serveri obično trebaju više memorije stoga za obradu zahtjeva. Default je često 4096.
+    config.max_uri_handlers = 48; // Povećaj maksimalni broj URI handlera koji se mogu registrirati. Omogućava registraciju više različitih URL putanja. Default je često 8.
+    config.max_open_sockets = CONN_BUDGET_SOCKETS; // Default 7 ne ostavlja mjesta običnim klijentima kad su tokovi i praćenja otvoreni.
+    // Povećanje ovih vrijednosti može utjecati na potrošnju RAM-a, pa ih treba prilagoditi potrebama.
+    // config.core_id = 0; // Opcionalno: Može se postaviti da server task radi na određenoj jezgri procesora (0 ili 1 na dual-core ESP32). Ostavljanje zadano (tskNO_AFFINITY) dopušta scheduleru da odabere.
+
+    // Postavlja funkciju koja se koristi za uspoređivanje URI-ja dolaznih zahtjeva s registriranim URI-jima handlera.
+    // httpd_uri_match_wildcard omogućava korištenje wildcard znakova (npr. /files/*) u URI-jima definicija handlera,
+    // iako u ovom kodu nema wildcard handlera, ova postavka ne smeta i može biti korisna za buduće proširenje.
+    config.uri_match_fn = httpd_uri_match_wildcard;
+
+    // Logiranje porta na kojem će server pokušati pokrenuti. Port se obično konfigurira u sdkconfig-u projekta.
+    ESP_LOGI(TAG_WEB, "Pokrecem HTTP server na portu: %d (Max header len konfiguriran preko menuconfig)",
+             config.server_port);
+
+    // Pokretanje HTTP server instance.
+    // Funkcija httpd_start() inicijalizira server, stvara potrebne taskove i započinje slušanje na konfiguriranom portu.
+    // Argumenti su: pointer na httpd_handle_t varijablu (gdje će se spremiti handler instance) i konfiguracijska struktura.
+    if (httpd_start(&server, &config) != ESP_OK)
+    {
+        // Ako pokretanje servera ne uspije, logiraj grešku.
+        ESP_LOGE(TAG_WEB, "Greska pri pokretanju servera!");
+        server = NULL;   // Postavi server handler na NULL da indicira da server nije pokrenut.
+        return ESP_FAIL; // Vraća ESP_FAIL.
+    }
+
+    ESP_LOGI(TAG_WEB, "Registriram URI handlere"); // Logira početak registracije handlera.
+
+    // --- Registracija URI Handlera ---
+    // Za svaku putanju (URI) koju server treba obraditi (npr. "/", "/list", "/upload"), kreira se httpd_uri_t struktura
+    // koja definira URI, HTTP metodu (GET, POST, itd.), funkciju handlera koja će obraditi zahtjev, i opcionalno korisnički kontekst.
+    // Nakon konfiguracije strukture, handler se registrira pomoću httpd_register_uri_handler().
+
+    // Handler za root URI "/" (glavna stranica). Obrada GET zahtjeva.
+    httpd_uri_t root_uri = {.uri = "/", .method = HTTP_GET, .handler = root_get_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &root_uri); // Registracija handlera.
+
+    // Handler za URI "/list" (stranica s popisom datoteka na SD kartici). Obrada GET zahtjeva.
+    httpd_uri_t list_uri = {.uri = "/list", .method = HTTP_GET, .handler = list_get_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &list_uri);
+
+    // Handler za URI "/download" (preuzimanje datoteka s SD kartice). Obrada GET zahtjeva.
+    // Koristi query parametar za ime datoteke.
+    httpd_uri_t download_uri = {.uri = "/download", .method = HTTP_GET, .handler = download_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &download_uri);
+
+    // Handler za URI "/delete" (brisanje datoteka s SD kartice). Obrada GET zahtjeva.
+    // Koristi query parametar za ime datoteke. Vraća JSON status.
+    httpd_uri_t delete_uri = {.uri = "/delete", .method = HTTP_GET, .handler = delete_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &delete_uri);
+
+// Handler za brisanje SVIH datoteka
+    httpd_uri_t delete_all_uri = {
+        .uri = "/delete_all",
+        .method = HTTP_GET, // Ili HTTP_POST za destruktivne akcije
+        .handler = delete_all_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &delete_all_uri);
+
+    // Handler za URI "/style.css" (posluživanje ugrađenog CSS file-a). Obrada GET zahtjeva.
+    httpd_uri_t css_uri = {.uri = "/style.css", .method = HTTP_GET, .handler = css_get_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &css_uri);
+
+    // Handler za URI "/script.js" (posluživanje ugrađenog JS file-a). Obrada GET zahtjeva.
+    httpd_uri_t js_uri = {.uri = "/script.js", .method = HTTP_GET, .handler = js_get_handler, .user_ctx = NULL};
+    httpd_register_uri_handler(server, &js_uri);
+
+    // Handler za URI "/upload" (upload datoteka na SD karticu). Koristi POST metodu.
+    // Rukuje multipart/form-data tijelom zahtjeva.
+    httpd_uri_t upload_uri = {
+        .uri = "/upload",
+        .method = HTTP_POST,
+        .handler = upload_post_handler,
+        .user_ctx = NULL};
+    httpd_register_uri_handler(server, &upload_uri);
+
+    // Handler za URI "/logging.html" (posluživanje ugrađene HTML stranice za logiranje/monitoring). Obrada GET zahtjeva.
+    httpd_uri_t logging_uri = {
+        .uri = "/logging.html",
+        .method = HTTP_GET,
+        .handler = logging_html_get_handler,
+        .user_ctx = NULL};
+    httpd_register_uri_handler(server, &logging_uri);
+
+    // Handler za URI "/adc" (dohvat zadnjih ADS1115 vrijednosti putem AJAX-a/API-ja). Obrada GET zahtjeva.
+    // Vraća JSON niz float vrijednosti.
+    httpd_uri_t adc_uri = {
+        .uri = "/adc",
+        .method = HTTP_GET,
+        .handler = adc_handler,
+        .user_ctx = NULL};
+    httpd_register_uri_handler(server, &adc_uri);
+
+    // Handleri za URI "/stream.csv" i "/stream.sse" (beskonačan tok živih očitanja). Obrada GET zahtjeva.
+    // user_ctx nosi format toka.
+    httpd_uri_t stream_csv_uri = {
+        .uri = "/stream.csv",
+        .method = HTTP_GET,
+        .handler = stream_handler,
+        .user_ctx = (void *)STREAM_FORMAT_CSV};
+    httpd_register_uri_handler(server, &stream_csv_uri);
+
+    httpd_uri_t stream_sse_uri = {
+        .uri = "/stream.sse",
+        .method = HTTP_GET,
+        .handler = stream_handler,
+        .user_ctx = (void *)STREAM_FORMAT_SSE};
+    httpd_register_uri_handler(server, &stream_sse_uri);
+
+    // Handler za statistiku tokova uživo (klijenti, zajednički formati).
+    httpd_uri_t stream_stats_uri = {
+        .uri = "/api/stream/stats",
+        .method = HTTP_GET,
+        .handler = stream_stats_get_handler,
+        .user_ctx = NULL};
+    httpd_register_uri_handler(server, &stream_stats_uri);
+
+    // Handler za URI "/log" (uključivanje/isključivanje logiranja putem query parametra ?active=0/1). Obrada GET zahtjeva.
+    // Vraća JSON status.
+    httpd_uri_t log_uri = {
+        .uri = "/log",
         .method = HTTP_GET,
         .handler = log_toggle_handler,
         .user_ctx = NULL};
@@ -2232,6 +3992,170 @@ httpd_register_uri_handler(server, &chartjs_uri);
     };
     httpd_register_uri_handler(server, &current_log_file_uri);
 
+    // Handler za ručno ponovno skeniranje SD kartice (nakon promjena sadržaja izvan firmwarea).
+    httpd_uri_t catalog_rescan_uri = {
+        .uri = "/api/catalog/rescan",
+        .method = HTTP_GET,
+        .handler = catalog_rescan_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &catalog_rescan_uri);
+
+    // Handler za statistiku SD I/O schedulera (red log writera, prigušivanje preuzimanja).
+    httpd_uri_t io_stats_uri = {
+        .uri = "/api/io/stats",
+        .method = HTTP_GET,
+        .handler = io_stats_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &io_stats_uri);
+
+    // Handler za statistiku spremanja postavki u NVS (broj zapisa, trajanje commita).
+    httpd_uri_t settings_stats_uri = {
+        .uri = "/api/settings/stats",
+        .method = HTTP_GET,
+        .handler = settings_stats_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &settings_stats_uri);
+
+    // Handler za provjeru integriteta log datoteke prema CRC zapisu.
+    httpd_uri_t verify_uri = {
+        .uri = "/api/verify",
+        .method = HTTP_GET,
+        .handler = verify_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &verify_uri);
+
+    // Handleri za self-benchmark akvizicije (pokretanje i dohvat rezultata).
+    httpd_uri_t benchmark_start_uri = {
+        .uri = "/api/benchmark/start",
+        .method = HTTP_GET,
+        .handler = benchmark_start_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &benchmark_start_uri);
+
+    httpd_uri_t benchmark_uri = {
+        .uri = "/api/benchmark",
+        .method = HTTP_GET,
+        .handler = benchmark_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &benchmark_uri);
+
+    // Handler za informacije o I2C sabirnici ADS1115 (brzina, verifikacija, vrijeme po frameu).
+    httpd_uri_t adc_bus_uri = {
+        .uri = "/api/adc/bus",
+        .method = HTTP_GET,
+        .handler = adc_bus_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &adc_bus_uri);
+
+    // Handler za burst snimanje jednog kanala punom brzinom ADC-a.
+    httpd_uri_t capture_uri = {
+        .uri = "/api/capture",
+        .method = HTTP_GET,
+        .handler = capture_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &capture_uri);
+
+    // Handler za vremenski raspored uzorkovanja kanala (skew između kanala unutar framea).
+    httpd_uri_t adc_timing_uri = {
+        .uri = "/api/adc/timing",
+        .method = HTTP_GET,
+        .handler = adc_timing_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &adc_timing_uri);
+
+    // Handleri za raspored logiranja (vremenski prozori) i postavljanje sata sustava.
+    httpd_uri_t schedule_get_uri = {
+        .uri = "/api/schedule",
+        .method = HTTP_GET,
+        .handler = schedule_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &schedule_get_uri);
+
+    httpd_uri_t schedule_post_uri = {
+        .uri = "/api/schedule",
+        .method = HTTP_POST,
+        .handler = schedule_post_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &schedule_post_uri);
+
+    // Handleri za granice alarma po kanalima (stanje, trošak provjere i spremanje granica).
+    httpd_uri_t alarms_get_uri = {
+        .uri = "/api/alarms",
+        .method = HTTP_GET,
+        .handler = alarms_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &alarms_get_uri);
+
+    httpd_uri_t alarms_post_uri = {
+        .uri = "/api/alarms",
+        .method = HTTP_POST,
+        .handler = alarms_post_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &alarms_post_uri);
+
+    httpd_uri_t time_get_uri = {
+        .uri = "/api/time",
+        .method = HTTP_GET,
+        .handler = time_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &time_get_uri);
+
+    httpd_uri_t time_post_uri = {
+        .uri = "/api/time",
+        .method = HTTP_POST,
+        .handler = time_post_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &time_post_uri);
+
+    // Handleri za sesije logiranja (pokretanje s oznakama, zaustavljanje, pretraživanje kataloga).
+    httpd_uri_t sessions_start_uri = {
+        .uri = "/api/sessions/start",
+        .method = HTTP_POST,
+        .handler = sessions_start_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &sessions_start_uri);
+
+    httpd_uri_t sessions_stop_uri = {
+        .uri = "/api/sessions/stop",
+        .method = HTTP_GET,
+        .handler = sessions_stop_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &sessions_stop_uri);
+
+    // Registracija handlera za postavljanje markera u aktivni log
+    httpd_uri_t marker_uri = {
+        .uri = "/api/marker",
+        .method = HTTP_GET,
+        .handler = marker_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &marker_uri);
+
+    httpd_uri_t sessions_uri = {
+        .uri = "/api/sessions",
+        .method = HTTP_GET,
+        .handler = sessions_get_handler,
+        .user_ctx = NULL
+    };
+    httpd_register_uri_handler(server, &sessions_uri);
+
     ESP_LOGI(TAG_WEB, "Web server pokrenut."); // Logira informaciju o uspješnom pokretanju.
     return ESP_OK;                             // Vraća ESP_OK ako je server uspješno pokrenut i handleri registrirani.
 
@@ -2255,7 +4179,4 @@ void stop_webserver()
         server = NULL;                               // Postavlja server handler na NULL da indicira da server više ne radi.
         ESP_LOGI(TAG_WEB, "Web server zaustavljen"); // Logira završetak zaustavljanja.
     }
-    // NAPOMENA: Ovdje se ne oslobađa mutex `logging_mutex` jer bi se server (i s njim povezane funkcije)
-    // potencijalno mogao ponovno pokrenuti kasnije. Mutex bi se trebao osloboditi samo ako se zna
-    // da se server i svi taskovi koji ga koriste više nikada neće pokrenuti tijekom životnog vijeka aplikacije.
 }
\ No newline at end of file
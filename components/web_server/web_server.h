@@ -22,31 +22,20 @@ extern "C" {
 esp_err_t start_webserver(void);
 
 /**
- * @brief Sets the global logging status to active or inactive.
- * This function controls whether data is logged to the SD card.
- * It uses an internal mutex for thread-safe access to the logging status variable.
+ * @brief Requests logging to start or stop.
+ * Posts LOG_CMD_START or LOG_CMD_STOP (source: web) to the logging control plane; the
+ * acquisition task applies it between two scans, so the change is not visible at once.
  * @param active Boolean value; set to true to enable logging, false to disable.
  */
 void set_logging_active(bool active);
 
 /**
  * @brief Retrieves the current logging status.
- * This function returns the current state of the global flag indicating whether logging is active.
- * It uses an internal mutex for thread-safe reading of the status.
- * @return bool Returns true if logging is currently active, false otherwise.
+ * Reads the control plane state with a single atomic load (no lock).
+ * @return bool Returns true while logging is requested (armed or logging), false when idle.
  */
 bool is_logging_enabled(void);
 
-/**
- * @brief Updates the last read voltage values from ADS1115 modules.
- * This function receives an array of 8 float values representing measured voltages
- * from the 8 channels of two ADS1115 modules. These values are stored in an internal
- * global variable within `web_server.c` (`last_voltages`) using a mutex for
- * thread-safe access, allowing the `/adc` handler to retrieve them for web display.
- * @param voltages Pointer to an array of 8 float values with the new voltage readings.
- */
-void set_last_voltages(const float *voltages);
-
 /**
  * @brief Retrieves the name of the currently active log file.
  * This function should be implemented in web_server.c and provides the filename
@@ -0,0 +1,271 @@
+// adc_bench.c
+// This file implements the acquisition self-benchmark.
+// A background task takes the ADC bus away from the acquisition task, runs every configuration
+// of the sweep for a fixed time, and restores the normal settings when done. Results are
+// published entry by entry, so the web interface can show progress while the sweep runs.
+
+#include "adc_bench.h"
+#include "adc_bus.h"
+#include "ads_bus.h"
+#include <string.h>            // For memset
+#include "freertos/task.h"     // For tasks
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "web_server.h"        // For is_logging_enabled
+#include "adc_burst.h"         // For adc_burst_is_running
+
+// --- Module Constants ---
+static const char *TAG = "adc_bench";
+
+#define BENCH_TASK_STACK_SIZE 4096 // Stack size of the benchmark task.
+#define BENCH_TASK_PRIORITY 5      // Same as the acquisition task it replaces.
+#define BENCH_MIN_MS 100           // Shortest allowed measurement per configuration.
+#define BENCH_MAX_MS 3000          // Longest allowed measurement per configuration.
+#define BENCH_MAX_ERROR_RATE 0.001f // Highest error rate a recommended configuration may have.
+
+// --- Sweep Definition ---
+static const uint32_t sweep_i2c_hz[] = {100000, 400000, 1000000};
+static const struct {
+    ads1115_sps_t sps;
+    uint16_t rate;
+} sweep_sps[] = {
+    {ADS1115_SPS_128, 128},
+    {ADS1115_SPS_250, 250},
+    {ADS1115_SPS_475, 475},
+    {ADS1115_SPS_860, 860},
+};
+static const struct {
+    ads1115_fsr_t pga;
+    float fsr;
+} sweep_pga[] = {
+    {ADS1115_FSR_4_096, 4.096f},
+    {ADS1115_FSR_0_512, 0.512f},
+};
+static const uint8_t sweep_channels[] = {1, 4, 8};
+
+#define SWEEP_COUNT (sizeof(sweep_i2c_hz) / sizeof(sweep_i2c_hz[0]) * \
+                     sizeof(sweep_sps) / sizeof(sweep_sps[0]) *       \
+                     sizeof(sweep_pga) / sizeof(sweep_pga[0]) *       \
+                     sizeof(sweep_channels) / sizeof(sweep_channels[0]))
+
+// --- Static Variables ---
+static adc_bus_t bus;                          // ADC bus description.
+static adc_bench_result_t results[SWEEP_COUNT];      // Results of the current or last sweep.
+static volatile adc_bench_status_t status = {.recommended = -1};
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Sets the I2C clock of the ADC bus.
+ */
+static esp_err_t set_i2c_clock(uint32_t clk_hz)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = bus.sda_io,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = bus.scl_io,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_hz,
+    };
+    return i2c_param_config(bus.port, &conf);
+}
+
+/**
+ * @brief Measures one configuration for the given time and fills in the result.
+ */
+static void measure(adc_bench_result_t *r, uint32_t ms)
+{
+    static const ads1115_mux_t mux[] = {ADS1115_MUX_0_GND, ADS1115_MUX_1_GND, ADS1115_MUX_2_GND, ADS1115_MUX_3_GND};
+    uint64_t conv_total_us = 0;
+    uint32_t frames = 0;
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t end_us = start_us + (int64_t)ms * 1000;
+    while (esp_timer_get_time() < end_us)
+    {
+        for (uint8_t ch = 0; ch < r->channels; ch++)
+        {
+            ads1115_t *adc = ch < 4 ? bus.adc1 : bus.adc2;
+            int64_t t0 = esp_timer_get_time();
+            int16_t raw;
+            esp_err_t err = ads_bus_convert(adc->i2c_port, adc->address, adc->config.reg, (uint8_t)mux[ch % 4], &raw);
+            uint32_t dt = (uint32_t)(esp_timer_get_time() - t0);
+
+            r->conversions++;
+            conv_total_us += dt;
+            if (dt > r->conv_max_us)
+            {
+                r->conv_max_us = dt;
+            }
+            if (err != ESP_OK)
+            {
+                r->errors++;
+            }
+        }
+        frames++;
+    }
+
+    float elapsed_s = (esp_timer_get_time() - start_us) / 1e6f;
+    r->fps = elapsed_s > 0 ? frames / elapsed_s : 0;
+    r->conv_avg_us = r->conversions ? (float)conv_total_us / r->conversions : 0;
+}
+
+/**
+ * @brief Picks the recommended result: an error-free configuration with the requested channel
+ * count that reaches the target rate with the lowest data rate (lowest ADC noise) and the lowest
+ * I2C clock (most margin on the bus), preferring the normal PGA. If no configuration reaches
+ * the target, the fastest error-free one is recommended instead.
+ */
+static void recommend(void)
+{
+    int best = -1;
+    int fastest = -1;
+
+    for (uint32_t i = 0; i < status.completed; i++)
+    {
+        const adc_bench_result_t *r = &results[i];
+        if (r->channels != status.channels || r->conversions == 0 ||
+            (float)r->errors / r->conversions > BENCH_MAX_ERROR_RATE)
+        {
+            continue;
+        }
+        if (fastest < 0 || r->fps > results[fastest].fps)
+        {
+            fastest = i;
+        }
+        if (r->fps < status.target_fps)
+        {
+            continue;
+        }
+        if (best < 0)
+        {
+            best = i;
+            continue;
+        }
+        const adc_bench_result_t *b = &results[best];
+        bool r_normal_pga = r->pga_fsr == 4.096f;
+        bool b_normal_pga = b->pga_fsr == 4.096f;
+        if (r->sps < b->sps ||
+            (r->sps == b->sps && r->i2c_hz < b->i2c_hz) ||
+            (r->sps == b->sps && r->i2c_hz == b->i2c_hz && r_normal_pga && !b_normal_pga))
+        {
+            best = i;
+        }
+    }
+
+    status.target_met = best >= 0;
+    status.recommended = best >= 0 ? best : fastest;
+}
+
+/**
+ * @brief FreeRTOS task that runs the sweep.
+ * @param pvParam Task parameters (not used).
+ */
+static void adc_bench_task(void *pvParam)
+{
+    xSemaphoreTake(bus.bus_mutex, portMAX_DELAY); // Pauses the acquisition task after its current scan
+    ESP_LOGI(TAG, "Benchmark started: %lu configurations, %lu ms each",
+             (unsigned long)status.total, (unsigned long)status.ms_per_config);
+
+    uint32_t index = 0;
+    for (size_t c = 0; c < sizeof(sweep_i2c_hz) / sizeof(sweep_i2c_hz[0]); c++)
+    {
+        set_i2c_clock(sweep_i2c_hz[c]);
+        for (size_t s = 0; s < sizeof(sweep_sps) / sizeof(sweep_sps[0]); s++)
+        {
+            for (size_t p = 0; p < sizeof(sweep_pga) / sizeof(sweep_pga[0]); p++)
+            {
+                ads1115_set_sps(bus.adc1, sweep_sps[s].sps);
+                ads1115_set_sps(bus.adc2, sweep_sps[s].sps);
+                ads1115_set_pga(bus.adc1, sweep_pga[p].pga);
+                ads1115_set_pga(bus.adc2, sweep_pga[p].pga);
+
+                for (size_t n = 0; n < sizeof(sweep_channels) / sizeof(sweep_channels[0]); n++)
+                {
+                    adc_bench_result_t *r = &results[index];
+                    memset(r, 0, sizeof(*r));
+                    r->i2c_hz = sweep_i2c_hz[c];
+                    r->sps = sweep_sps[s].rate;
+                    r->pga_fsr = sweep_pga[p].fsr;
+                    r->channels = sweep_channels[n];
+                    measure(r, status.ms_per_config);
+                    status.completed = ++index; // Publish the entry only once it is complete
+                }
+            }
+        }
+    }
+
+    // Restore the normal acquisition settings before handing the bus back.
+    set_i2c_clock(bus.clk_hz);
+    ads1115_set_sps(bus.adc1, bus.sps);
+    ads1115_set_sps(bus.adc2, bus.sps);
+    ads1115_set_pga(bus.adc1, bus.pga);
+    ads1115_set_pga(bus.adc2, bus.pga);
+    xSemaphoreGive(bus.bus_mutex);
+
+    recommend();
+    if (status.recommended >= 0)
+    {
+        const adc_bench_result_t *r = &results[status.recommended];
+        ESP_LOGI(TAG, "Benchmark done, recommended: %lu Hz I2C, %u SPS, %u channels -> %.1f fps%s",
+                 (unsigned long)r->i2c_hz, r->sps, r->channels, r->fps, status.target_met ? "" : " (target not reached)");
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Benchmark done, no error-free configuration found");
+    }
+    status.running = false;
+    vTaskDelete(NULL);
+}
+
+// --- Public Function Implementations ---
+
+void adc_bench_init(const adc_bus_t *bus_desc)
+{
+    bus = *bus_desc;
+}
+
+esp_err_t adc_bench_start(uint32_t ms_per_config, float target_fps, uint8_t channels)
+{
+    if (status.running || is_logging_enabled() || adc_burst_is_running() || bus.bus_mutex == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (ms_per_config < BENCH_MIN_MS)
+        ms_per_config = BENCH_MIN_MS;
+    if (ms_per_config > BENCH_MAX_MS)
+        ms_per_config = BENCH_MAX_MS;
+    if (channels != 1 && channels != 4)
+        channels = 8;
+
+    status.completed = 0;
+    status.total = SWEEP_COUNT;
+    status.ms_per_config = ms_per_config;
+    status.target_fps = target_fps;
+    status.channels = channels;
+    status.recommended = -1;
+    status.target_met = false;
+    status.running = true;
+
+    if (xTaskCreate(adc_bench_task, "adc_bench", BENCH_TASK_STACK_SIZE, NULL, BENCH_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        status.running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+bool adc_bench_is_running(void)
+{
+    return status.running;
+}
+
+const adc_bench_result_t *adc_bench_get_results(adc_bench_status_t *out)
+{
+    if (out)
+    {
+        *out = status;
+    }
+    return results;
+}
@@ -0,0 +1,80 @@
+// adc_bench.h
+// This header defines the public API for the acquisition self-benchmark.
+// The benchmark sweeps combinations of I2C clock, ADS1115 data rate (SPS), PGA and number of
+// scanned channels, measures what the hardware actually achieves for each combination, and
+// recommends a configuration for a requested frame rate.
+// This header is used by the web server and therefore does not depend on the ADC driver;
+// the bus description used at startup lives in adc_bus.h.
+
+#ifndef ADC_BENCH_H_
+#define ADC_BENCH_H_
+
+#include <stdbool.h>           // For boolean type
+#include <stddef.h>            // For size_t
+#include <stdint.h>            // For fixed width integer types
+#include "esp_err.h"           // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct adc_bench_result_t
+ * @brief Measurements for one scan configuration.
+ */
+typedef struct {
+    uint32_t i2c_hz;       ///< I2C clock in Hz.
+    uint16_t sps;          ///< ADS1115 data rate in samples per second.
+    uint8_t channels;      ///< Number of channels scanned per frame.
+    float pga_fsr;         ///< PGA full scale range in volts.
+    float fps;             ///< Achieved frames (complete scans) per second.
+    float conv_avg_us;     ///< Average time per conversion (mux write + conversion + read).
+    uint32_t conv_max_us;  ///< Longest conversion.
+    uint32_t conversions;  ///< Number of conversions attempted.
+    uint32_t errors;       ///< Number of failed conversions.
+} adc_bench_result_t;
+
+/**
+ * @struct adc_bench_status_t
+ * @brief State of the current or last benchmark run.
+ */
+typedef struct {
+    bool running;          ///< True while the sweep is in progress.
+    uint32_t completed;    ///< Number of configurations measured so far.
+    uint32_t total;        ///< Number of configurations in the sweep.
+    uint32_t ms_per_config;///< Measurement time per configuration.
+    float target_fps;      ///< Requested frame rate for the recommendation.
+    uint8_t channels;      ///< Channel count the recommendation is made for.
+    int recommended;       ///< Index of the recommended result, or -1 if none (yet).
+    bool target_met;       ///< True if the recommended configuration reaches target_fps.
+} adc_bench_status_t;
+
+/**
+ * @brief Starts a benchmark sweep in a background task.
+ * Acquisition is paused for the duration of the sweep, so the benchmark is refused while logging.
+ * @param ms_per_config Measurement time per configuration (clamped to 100-3000 ms).
+ * @param target_fps Frame rate the recommendation should reach.
+ * @param channels Channel count the recommendation is made for (1, 4 or 8).
+ * @return esp_err_t ESP_OK if started, ESP_ERR_INVALID_STATE if logging is active or a sweep is running,
+ *         ESP_ERR_NO_MEM if the task could not be created.
+ */
+esp_err_t adc_bench_start(uint32_t ms_per_config, float target_fps, uint8_t channels);
+
+/**
+ * @brief Checks whether a sweep is in progress.
+ */
+bool adc_bench_is_running(void);
+
+/**
+ * @brief Returns the state of the current or last sweep and its results.
+ * Only the first status->completed entries of the returned array are valid.
+ * @param status Receives the current status.
+ * @return const adc_bench_result_t* Array of results (valid until the next sweep is started).
+ */
+const adc_bench_result_t *adc_bench_get_results(adc_bench_status_t *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_BENCH_H_ */
@@ -0,0 +1,383 @@
+// adc_burst.c
+// This file implements single-channel burst capture.
+// With the ALERT/RDY pin of the ADC wired to a GPIO, the ADC runs in continuous mode at
+// 860 SPS and signals every finished conversion on the pin; the capture loop only reads the
+// conversion register after each edge, so the ADC's own clock paces the samples. Without the
+// pin, back-to-back single-shot conversions are used instead.
+
+#include "adc_burst.h"
+#include "adc_bus.h"
+#include "ads_bus.h"
+#include <stdio.h>              // For snprintf, fopen
+#include <stdlib.h>             // For malloc, free
+#include <string.h>             // For memset
+#include <time.h>               // For time
+#include <sys/stat.h>           // For stat
+#include "freertos/task.h"      // For task priority functions
+#include "driver/gpio.h"        // For the RDY pin interrupt
+#include "esp_heap_caps.h"      // For PSRAM allocation
+#include "esp_timer.h"          // For esp_timer_get_time
+#include "esp_attr.h"           // For IRAM_ATTR
+#include "esp_log.h"            // For ESP_LOGx macros
+#include "web_server.h"         // For is_logging_enabled
+#include "adc_bench.h"          // For adc_bench_is_running
+#include "file_catalog.h"       // For file names and catalog updates
+#include "sd_io.h"              // For SD writes that yield to the log writer
+
+// --- Module Constants ---
+static const char *TAG = "adc_burst";
+
+#define MOUNT_POINT "/sdcard"         // Mount point for the SD card
+#define BURST_FILE_STEM "burst_"      // Prefix of burst file names
+#define BURST_RDY_TIMEOUT_MS 20       // Longest wait for one RDY edge (a conversion takes 1.2 ms at 860 SPS)
+#define BURST_TASK_PRIORITY 10        // Priority of the capturing task during a burst
+#define BURST_WRITE_CHUNK 4096        // Size of the CSV chunks written to the card
+#define BURST_MAX_FILE_INDEX 10000    // Highest burst file number tried before giving up
+
+// Config register fields (ADS1115 datasheet, table 8).
+#define CFG_MUX_SHIFT 12
+#define CFG_PGA_MASK 0x0E00
+#define CFG_MODE_SINGLE 0x0100
+#define CFG_DR_MASK 0x00E0
+#define CFG_DR_860 0x00E0
+#define CFG_COMP_QUE_DISABLE 0x0003
+
+// Threshold values that turn ALERT/RDY into a conversion-ready output (Hi_thresh MSB 1, Lo_thresh MSB 0),
+// and the power-on defaults that are restored afterwards.
+#define THRESH_RDY_LO 0x0000
+#define THRESH_RDY_HI 0x8000
+#define THRESH_DEFAULT_LO 0x8000
+#define THRESH_DEFAULT_HI 0x7FFF
+
+// Full scale range per PGA setting (config register bits 11:9).
+static const float pga_fsr[8] = {6.144f, 4.096f, 2.048f, 1.024f, 0.512f, 0.256f, 0.256f, 0.256f};
+
+// --- Static Variables ---
+static adc_bus_t bus;                          // ADC bus description.
+static volatile bool running = false;          // True while a burst is in progress.
+static SemaphoreHandle_t rdy_sem = NULL;       // Given by the RDY interrupt for each finished conversion.
+static volatile uint32_t rdy_edges = 0;        // RDY edges seen during the current burst.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief RDY pin interrupt: counts the edge and wakes the capture loop.
+ */
+static void IRAM_ATTR rdy_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    rdy_edges++;
+    xSemaphoreGiveFromISR(rdy_sem, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/**
+ * @brief Detaches the RDY interrupt and, if this module installed it, the GPIO ISR service.
+ */
+static void rdy_irq_release(int gpio, bool handler_added, bool service_installed)
+{
+    if (handler_added)
+    {
+        gpio_isr_handler_remove(gpio);
+    }
+    gpio_set_intr_type(gpio, GPIO_INTR_DISABLE);
+    if (service_installed)
+    {
+        gpio_uninstall_isr_service();
+    }
+}
+
+/**
+ * @brief Captures a burst in continuous mode, paced by the RDY pin.
+ */
+static esp_err_t capture_rdy(ads1115_t *ads, int gpio, uint8_t channel, uint32_t count, adc_burst_result_t *r)
+{
+    bool service_installed = false; // Installed by this burst (not by another driver)
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_ENABLE, // ALERT/RDY is open drain
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_NEGEDGE,   // Pulses low for 8 us after each conversion
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err == ESP_OK)
+    {
+        err = gpio_install_isr_service(0);
+        if (err == ESP_OK)
+        {
+            service_installed = true;
+        }
+        else if (err == ESP_ERR_INVALID_STATE)
+        {
+            err = ESP_OK; // Already installed by another driver
+        }
+    }
+    if (err == ESP_OK)
+    {
+        rdy_edges = 0;
+        xSemaphoreTake(rdy_sem, 0); // Drop a stale give
+        err = gpio_isr_handler_add(gpio, rdy_isr, NULL);
+        if (err != ESP_OK)
+        {
+            rdy_irq_release(gpio, false, service_installed);
+        }
+    }
+    if (err != ESP_OK)
+    {
+        ESP_LOGE(TAG, "RDY GPIO %d setup failed: %s", gpio, esp_err_to_name(err));
+        return err;
+    }
+
+    uint8_t addr = ads->address;
+    int port = ads->i2c_port;
+    uint16_t config = (uint16_t)(((4 + channel) << CFG_MUX_SHIFT) | (ads->config.reg & CFG_PGA_MASK) | CFG_DR_860);
+    // MODE = 0 (continuous), COMP_QUE = 00 (assert after one conversion)
+
+    err = ads_bus_write_register(port, addr, ADS_BUS_REG_LO_THRESH, THRESH_RDY_LO);
+    if (err == ESP_OK)
+        err = ads_bus_write_register(port, addr, ADS_BUS_REG_HI_THRESH, THRESH_RDY_HI);
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    UBaseType_t old_priority = uxTaskPriorityGet(self);
+    vTaskPrioritySet(self, BURST_TASK_PRIORITY);
+
+    if (err == ESP_OK)
+        err = ads_bus_write_register(port, addr, ADS_BUS_REG_CONFIG, config); // Starts continuous conversion
+    uint32_t handled = 0;
+    int64_t t_first = 0, t_last = 0;
+    while (err == ESP_OK && r->count < count)
+    {
+        if (xSemaphoreTake(rdy_sem, pdMS_TO_TICKS(BURST_RDY_TIMEOUT_MS)) != pdTRUE)
+        {
+            ESP_LOGE(TAG, "No RDY edge on GPIO %d after %lu samples", gpio, (unsigned long)r->count);
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        uint32_t edges = rdy_edges;
+        if (edges - handled > 1)
+        {
+            r->missed += edges - handled - 1; // Conversions overwritten before we read them
+        }
+        handled = edges;
+
+        uint16_t value;
+        err = ads_bus_read_register(port, addr, ADS_BUS_REG_CONVERSION, &value);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        t_last = esp_timer_get_time();
+        if (r->count == 0)
+        {
+            t_first = t_last;
+        }
+        r->samples[r->count++] = (int16_t)value;
+    }
+
+    vTaskPrioritySet(self, old_priority);
+    rdy_irq_release(gpio, true, service_installed);
+
+    // Back to single-shot with the comparator disabled, as the acquisition task expects.
+    ads_bus_write_register(port, addr, ADS_BUS_REG_CONFIG,
+                           (uint16_t)((ads->config.reg & ~0x8000) | CFG_MODE_SINGLE | CFG_COMP_QUE_DISABLE));
+    ads_bus_write_register(port, addr, ADS_BUS_REG_LO_THRESH, THRESH_DEFAULT_LO);
+    ads_bus_write_register(port, addr, ADS_BUS_REG_HI_THRESH, THRESH_DEFAULT_HI);
+
+    r->duration_us = (uint32_t)(t_last - t_first);
+    return err;
+}
+
+/**
+ * @brief Captures a burst with back-to-back single-shot conversions at 860 SPS.
+ */
+static esp_err_t capture_single_shot(ads1115_t *ads, uint8_t channel, uint32_t count, adc_burst_result_t *r)
+{
+    uint16_t config = (uint16_t)((ads->config.reg & ~CFG_DR_MASK) | CFG_DR_860);
+    int64_t t_first = 0, t_last = 0;
+    esp_err_t err = ESP_OK;
+
+    while (r->count < count)
+    {
+        int16_t raw;
+        err = ads_bus_convert(ads->i2c_port, ads->address, config, (uint8_t)(4 + channel), &raw);
+        if (err != ESP_OK)
+        {
+            break;
+        }
+        t_last = esp_timer_get_time();
+        if (r->count == 0)
+        {
+            t_first = t_last;
+        }
+        r->samples[r->count++] = raw;
+    }
+
+    r->duration_us = (uint32_t)(t_last - t_first);
+    return err;
+}
+
+// --- Public Function Implementations ---
+
+void adc_burst_init(const adc_bus_t *bus_desc)
+{
+    bus = *bus_desc;
+    if (rdy_sem == NULL)
+    {
+        rdy_sem = xSemaphoreCreateBinary();
+    }
+}
+
+esp_err_t adc_burst_capture(uint8_t adc, uint8_t channel, uint32_t count, adc_burst_result_t *result)
+{
+    if (!result || adc > 1 || channel > 3 || count == 0 || count > ADC_BURST_MAX_SAMPLES)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (running || is_logging_enabled() || adc_bench_is_running() || bus.bus_mutex == NULL || rdy_sem == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    memset(result, 0, sizeof(*result));
+    result->samples = heap_caps_malloc(count * sizeof(int16_t), MALLOC_CAP_SPIRAM);
+    if (!result->samples)
+    {
+        result->samples = heap_caps_malloc(count * sizeof(int16_t), MALLOC_CAP_8BIT); // No PSRAM fitted
+    }
+    if (!result->samples)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ads1115_t *ads = adc ? bus.adc2 : bus.adc1;
+    int gpio = bus.rdy_gpio[adc];
+    result->adc = adc;
+    result->channel = channel;
+    result->rdy_paced = gpio >= 0;
+    result->volts_per_bit = pga_fsr[(ads->config.reg & CFG_PGA_MASK) >> 9] / 32768.0f;
+
+    running = true;
+    xSemaphoreTake(bus.bus_mutex, portMAX_DELAY); // Pauses the acquisition task after its current scan
+    ESP_LOGI(TAG, "Burst: ADC%u AIN%u, %lu samples, %s", adc + 1, channel, (unsigned long)count,
+             result->rdy_paced ? "RDY paced" : "single-shot (no RDY pin)");
+    esp_err_t err = result->rdy_paced ? capture_rdy(ads, gpio, channel, count, result)
+                                      : capture_single_shot(ads, channel, count, result);
+    xSemaphoreGive(bus.bus_mutex);
+    running = false;
+
+    if (result->count > 1 && result->duration_us > 0)
+    {
+        result->sps = (result->count - 1) * 1e6f / result->duration_us;
+    }
+    ESP_LOGI(TAG, "Burst done: %lu samples in %lu us (%.1f SPS), %lu missed",
+             (unsigned long)result->count, (unsigned long)result->duration_us, result->sps,
+             (unsigned long)result->missed);
+
+    if (err != ESP_OK)
+    {
+        adc_burst_free(result);
+    }
+    return err;
+}
+
+size_t adc_burst_format_csv(const adc_burst_result_t *result, uint32_t *pos, char *buf, size_t len)
+{
+    size_t used = 0;
+    if (*pos == 0)
+    {
+        used = (size_t)snprintf(buf, len, "sample;t_us;raw;voltage\n");
+    }
+    float period_us = result->count > 1 ? (float)result->duration_us / (result->count - 1) : 0;
+    while (*pos < result->count)
+    {
+        char line[64];
+        int16_t raw = result->samples[*pos];
+        int n = snprintf(line, sizeof(line), "%lu;%lu;%d;%.6f\n", (unsigned long)*pos,
+                         (unsigned long)(*pos * period_us), raw, raw * result->volts_per_bit);
+        if (n <= 0 || used + (size_t)n >= len)
+        {
+            break;
+        }
+        memcpy(buf + used, line, (size_t)n);
+        used += (size_t)n;
+        (*pos)++;
+    }
+    return used;
+}
+
+esp_err_t adc_burst_save(const adc_burst_result_t *result, char *out_path, size_t path_len)
+{
+    int index = file_catalog_is_ready() ? file_catalog_max_index("", BURST_FILE_STEM) + 1 : 1;
+    struct stat st;
+    for (; index > 0 && index < BURST_MAX_FILE_INDEX; ++index)
+    {
+        snprintf(out_path, path_len, MOUNT_POINT "/" BURST_FILE_STEM "%d.csv", index);
+        // Without a ready catalog, or with files copied to the card since the last scan, the
+        // next number may already be taken; an existing burst is never overwritten.
+        if (stat(out_path, &st) != 0)
+        {
+            break;
+        }
+    }
+    if (index <= 0 || index >= BURST_MAX_FILE_INDEX)
+    {
+        ESP_LOGE(TAG, "No free burst file name left");
+        return ESP_FAIL;
+    }
+
+    FILE *f = fopen(out_path, "w");
+    if (!f)
+    {
+        ESP_LOGE(TAG, "Failed to create %s", out_path);
+        return ESP_FAIL;
+    }
+    char *chunk = malloc(BURST_WRITE_CHUNK);
+    if (!chunk)
+    {
+        fclose(f);
+        remove(out_path);
+        return ESP_ERR_NO_MEM;
+    }
+
+    sd_io_session_t session = {0};
+    uint32_t pos = 0;
+    size_t n;
+    bool ok = true;
+    while ((n = adc_burst_format_csv(result, &pos, chunk, BURST_WRITE_CHUNK)) > 0)
+    {
+        if (sd_io_write_background(&session, chunk, n, f) != n)
+        {
+            ok = false;
+            break;
+        }
+    }
+    free(chunk);
+    file_catalog_upsert(out_path, (uint32_t)ftell(f), time(NULL));
+    fclose(f);
+
+    if (!ok)
+    {
+        ESP_LOGE(TAG, "Short write to %s", out_path);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Burst saved to %s", out_path);
+    return ESP_OK;
+}
+
+void adc_burst_free(adc_burst_result_t *result)
+{
+    if (result && result->samples)
+    {
+        heap_caps_free(result->samples);
+        result->samples = NULL;
+    }
+}
+
+bool adc_burst_is_running(void)
+{
+    return running;
+}
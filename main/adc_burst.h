@@ -0,0 +1,93 @@
+// adc_burst.h
+// This header defines the public API for single-channel burst capture.
+// A burst switches one ADS1115 to continuous conversion on one input and collects a fixed
+// number of samples at the full data rate, paced by the ADC's ALERT/RDY pin, into a PSRAM
+// buffer. Normal scanning is paused for the duration of the burst and resumes afterwards.
+
+#ifndef ADC_BURST_H_
+#define ADC_BURST_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def ADC_BURST_MAX_SAMPLES
+ * @brief Largest number of samples in one burst (about 35 s at 860 SPS, 60 KB of PSRAM).
+ */
+#define ADC_BURST_MAX_SAMPLES 30000
+
+/**
+ * @struct adc_burst_result_t
+ * @brief Samples and statistics of one burst.
+ */
+typedef struct {
+    int16_t *samples;      ///< Raw conversion results (owned by the result, free with adc_burst_free()).
+    uint32_t count;        ///< Number of samples collected.
+    uint32_t missed;       ///< Conversions the ADC completed that were not read (0 for a complete burst).
+    uint32_t duration_us;  ///< Time from the first to the last sample.
+    float sps;             ///< Achieved sample rate.
+    float volts_per_bit;   ///< Scale of the raw values for the PGA setting used.
+    bool rdy_paced;        ///< True if paced by the RDY pin; false if back-to-back single-shot conversions were used.
+    uint8_t adc;           ///< ADC index (0 or 1).
+    uint8_t channel;       ///< Input channel (0-3).
+} adc_burst_result_t;
+
+/**
+ * @brief Captures a burst of samples from one channel at the full data rate (860 SPS).
+ * Without an RDY pin configured for the ADC, back-to-back single-shot conversions are used
+ * instead, which reach a lower rate. Refused while logging or while the self-benchmark runs.
+ * Blocks until the burst is done (up to about 35 s) and raises the calling task's priority while
+ * it runs, so call it from a task of its own rather than from a server or event task.
+ * @param adc ADC index (0 for channels 0-3, 1 for channels 4-7).
+ * @param channel Input of that ADC (0-3).
+ * @param count Number of samples (1 to ADC_BURST_MAX_SAMPLES).
+ * @param result Receives the samples and statistics. Free with adc_burst_free() on success.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG for bad parameters,
+ *         ESP_ERR_INVALID_STATE if logging or another bus user is active,
+ *         ESP_ERR_NO_MEM if the buffer could not be allocated,
+ *         ESP_ERR_TIMEOUT if the RDY pin stopped signalling.
+ */
+esp_err_t adc_burst_capture(uint8_t adc, uint8_t channel, uint32_t count, adc_burst_result_t *result);
+
+/**
+ * @brief Formats the next part of a burst as CSV ("sample;t_us;raw;voltage", with a header line first).
+ * Call repeatedly with the same position until it returns 0.
+ * @param result Burst to format.
+ * @param pos Position in the burst; start with 0, updated on return.
+ * @param buf Output buffer.
+ * @param len Length of the output buffer (at least 64 bytes).
+ * @return size_t Number of bytes written to buf, 0 when the whole burst has been formatted.
+ */
+size_t adc_burst_format_csv(const adc_burst_result_t *result, uint32_t *pos, char *buf, size_t len);
+
+/**
+ * @brief Writes a burst to a new CSV file on the SD card (burst_N.csv in the card root).
+ * @param result Burst to write.
+ * @param out_path Receives the full path of the written file.
+ * @param path_len Length of the out_path buffer.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if the file could not be written.
+ */
+esp_err_t adc_burst_save(const adc_burst_result_t *result, char *out_path, size_t path_len);
+
+/**
+ * @brief Frees the samples of a burst.
+ * @param result Burst to free.
+ */
+void adc_burst_free(adc_burst_result_t *result);
+
+/**
+ * @brief Checks whether a burst is in progress.
+ */
+bool adc_burst_is_running(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_BURST_H_ */
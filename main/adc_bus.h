@@ -0,0 +1,52 @@
+// adc_bus.h
+// This header defines how the application hands the ADC bus to the modules that take it over
+// from the acquisition task for a while (self-benchmark, burst capture).
+// It is kept apart from their public headers so that the web server does not depend on the ADC driver.
+
+#ifndef ADC_BUS_H_
+#define ADC_BUS_H_
+
+#include <stdint.h>            // For fixed width integer types
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/semphr.h"   // For SemaphoreHandle_t
+#include "driver/i2c.h"        // For i2c_port_t
+#include "ads1115.h"           // For ads1115_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct adc_bus_t
+ * @brief Describes the ADC bus, and the settings to restore after it was taken over.
+ */
+typedef struct {
+    ads1115_t *adc1;              ///< First ADS1115 (channels 0-3).
+    ads1115_t *adc2;              ///< Second ADS1115 (channels 4-7).
+    SemaphoreHandle_t bus_mutex;  ///< Mutex held by the acquisition task while it scans, and by a module that takes the bus over.
+    i2c_port_t port;              ///< I2C port of the ADCs.
+    int sda_io;                   ///< SDA GPIO.
+    int scl_io;                   ///< SCL GPIO.
+    uint32_t clk_hz;              ///< Normal I2C clock.
+    ads1115_fsr_t pga;            ///< Normal PGA setting.
+    ads1115_sps_t sps;            ///< Normal data rate.
+    int rdy_gpio[2];              ///< ALERT/RDY GPIO of each ADC, or -1 if not connected.
+} adc_bus_t;
+
+/**
+ * @brief Registers the ADC bus used by the benchmark. Must be called once at startup.
+ * @param bus Bus description (copied).
+ */
+void adc_bench_init(const adc_bus_t *bus);
+
+/**
+ * @brief Registers the ADC bus used by the burst capture. Must be called once at startup.
+ * @param bus Bus description (copied).
+ */
+void adc_burst_init(const adc_bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADC_BUS_H_ */
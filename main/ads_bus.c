@@ -0,0 +1,348 @@
+// ads_bus.c
+// This file implements the ADS1115 I2C bus bring-up.
+// Verification writes a set of configuration patterns to the ADS1115 config register (with
+// the OS bit cleared, so no conversion is started) and reads each one back. Marginal bus
+// timing (weak pull-ups, long wires) shows up as NACKs or corrupted bits long before it
+// would corrupt conversion results unnoticed.
+
+#include "ads_bus.h"
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/semphr.h"   // For the conversion wait semaphore
+#include "esp_rom_sys.h"       // For esp_rom_delay_us
+#include "driver/i2c.h"        // For the legacy I2C driver
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "esp_log.h"           // For ESP_LOGx macros
+
+// --- Module Constants ---
+static const char *TAG = "ads_bus";
+
+#define ADS_REG_CONVERSION ADS_BUS_REG_CONVERSION // ADS1115 conversion register.
+#define ADS_REG_CONFIG ADS_BUS_REG_CONFIG         // ADS1115 config register.
+#define ADS_CONFIG_OS_MASK 0x8000 // OS bit; reads back as "not converting", so it is not compared.
+#define ADS_VERIFY_ROUNDS 10      // How many times each pattern is written and read back.
+#define ADS_TIMING_FRAMES 20      // Number of frames timed for the bus time measurement.
+#define ADS_FRAME_CONVERSIONS 8   // Conversions per frame (4 per ADC).
+#define ADS_BASELINE_HZ 400000    // Clock used as the comparison baseline.
+#define ADS_I2C_TIMEOUT_MS 10     // Timeout for a single transfer.
+#define ADS_CONFIG_MUX_MASK 0x7000 // MUX bits of the config register.
+#define ADS_CONFIG_MODE_SINGLE 0x0100 // MODE bit: single-shot conversion.
+#define ADS_CONFIG_DR_SHIFT 5     // Position of the data rate bits.
+#define ADS_MIN_MARGIN_US 10      // Smallest margin the calibration may reach.
+#define ADS_SPIN_DELAY_US 20      // Pause between two OS bit checks while spinning.
+
+// Clocks tried from fastest to slowest. The ESP32 I2C controller has no high-speed
+// (3.4 MHz, master code) mode, so Fast-mode Plus is the fastest option.
+static const uint32_t bus_speeds[] = {1000000, 400000, 100000};
+
+// Config patterns for readback: single-shot mode, OS cleared, varying MUX, PGA and data rate bits.
+static const uint16_t verify_patterns[] = {0x4583, 0x5383, 0x6BA3, 0x7D43, 0x0F63, 0x2F03};
+
+// Datasheet data rates, indexed by the DR bits of the config register.
+static const uint16_t data_rates[] = {8, 16, 32, 64, 128, 250, 475, 860};
+
+// --- Static Variables ---
+static ads_bus_info_t info;
+static esp_timer_handle_t conv_timer = NULL;    // One-shot timer that ends the conversion wait.
+static SemaphoreHandle_t conv_done_sem = NULL;  // Given by the timer callback.
+static uint32_t margin_us[8];                   // Calibrated margin per data rate (0 = not calibrated yet).
+static uint64_t total_wait_us = 0;              // Sum of all conversion waits, for the average.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Sets the I2C clock of the ADC bus.
+ */
+static esp_err_t set_clock(int port, int sda_io, int scl_io, uint32_t clk_hz)
+{
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = sda_io,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = scl_io,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = clk_hz,
+    };
+    return i2c_param_config(port, &conf);
+}
+
+/**
+ * @brief Verifies the current clock with config register readback on one ADC.
+ * The original configuration is restored afterwards.
+ */
+static bool verify_device(int port, uint8_t addr)
+{
+    uint16_t original;
+    if (ads_bus_read_register(port, addr, ADS_REG_CONFIG, &original) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "0x%02X: no response", addr);
+        return false;
+    }
+
+    bool ok = true;
+    for (int round = 0; round < ADS_VERIFY_ROUNDS && ok; round++)
+    {
+        for (size_t i = 0; i < sizeof(verify_patterns) / sizeof(verify_patterns[0]); i++)
+        {
+            uint16_t readback;
+            if (ads_bus_write_register(port, addr, ADS_REG_CONFIG, verify_patterns[i]) != ESP_OK ||
+                ads_bus_read_register(port, addr, ADS_REG_CONFIG, &readback) != ESP_OK)
+            {
+                ESP_LOGW(TAG, "0x%02X: transfer failed", addr);
+                ok = false;
+                break;
+            }
+            if ((readback & ~ADS_CONFIG_OS_MASK) != (verify_patterns[i] & ~ADS_CONFIG_OS_MASK))
+            {
+                ESP_LOGW(TAG, "0x%02X: wrote 0x%04X, read back 0x%04X", addr, verify_patterns[i], readback);
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    ads_bus_write_register(port, addr, ADS_REG_CONFIG, original & ~ADS_CONFIG_OS_MASK);
+    return ok;
+}
+
+/**
+ * @brief Measures the bus time of the transfers the driver does for one frame:
+ * per conversion one config write and one conversion register read.
+ * @return uint32_t Average bus time per frame in microseconds, or 0 on a transfer error.
+ */
+static uint32_t measure_frame_us(int port, const uint8_t *addresses, size_t count)
+{
+    uint16_t config[2] = {0};
+    uint16_t value;
+    size_t devices = count < 2 ? count : 2;
+
+    for (size_t d = 0; d < devices; d++)
+    {
+        if (ads_bus_read_register(port, addresses[d], ADS_REG_CONFIG, &config[d]) != ESP_OK)
+        {
+            return 0;
+        }
+        config[d] &= ~ADS_CONFIG_OS_MASK; // Never start a conversion, only the bus time is measured.
+    }
+
+    int64_t start_us = esp_timer_get_time();
+    for (int frame = 0; frame < ADS_TIMING_FRAMES; frame++)
+    {
+        for (int conv = 0; conv < ADS_FRAME_CONVERSIONS; conv++)
+        {
+            size_t d = (conv * devices) / ADS_FRAME_CONVERSIONS;
+            if (ads_bus_write_register(port, addresses[d], ADS_REG_CONFIG, config[d]) != ESP_OK ||
+                ads_bus_read_register(port, addresses[d], ADS_REG_CONVERSION, &value) != ESP_OK)
+            {
+                return 0;
+            }
+        }
+    }
+    return (uint32_t)((esp_timer_get_time() - start_us) / ADS_TIMING_FRAMES);
+}
+
+/**
+ * @brief esp_timer callback: the datasheet conversion time plus margin has elapsed.
+ */
+static void conv_timer_cb(void *arg)
+{
+    xSemaphoreGive(conv_done_sem);
+}
+
+/**
+ * @brief Creates the conversion timer and its semaphore on first use.
+ */
+static esp_err_t conv_timer_init(void)
+{
+    if (conv_timer)
+    {
+        return ESP_OK;
+    }
+    conv_done_sem = xSemaphoreCreateBinary();
+    if (!conv_done_sem)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = conv_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "ads_conv",
+    };
+    return esp_timer_create(&args, &conv_timer);
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t ads_bus_write_register(int port, uint8_t addr, uint8_t reg, uint16_t value)
+{
+    uint8_t buf[3] = {reg, (uint8_t)(value >> 8), (uint8_t)(value & 0xFF)};
+    return i2c_master_write_to_device(port, addr, buf, sizeof(buf), pdMS_TO_TICKS(ADS_I2C_TIMEOUT_MS));
+}
+
+esp_err_t ads_bus_read_register(int port, uint8_t addr, uint8_t reg, uint16_t *value)
+{
+    uint8_t data[2];
+    esp_err_t err = i2c_master_write_read_device(port, addr, &reg, 1, data, sizeof(data), pdMS_TO_TICKS(ADS_I2C_TIMEOUT_MS));
+    if (err == ESP_OK)
+    {
+        *value = ((uint16_t)data[0] << 8) | data[1];
+    }
+    return err;
+}
+
+esp_err_t ads_bus_negotiate(int port, int sda_io, int scl_io, uint32_t requested_hz,
+                            const uint8_t *addresses, size_t count)
+{
+    info.requested_hz = requested_hz;
+    info.fallbacks = 0;
+    info.verified = false;
+    info.frame_bus_us = 0;
+    info.baseline_bus_us = 0;
+
+    size_t n_speeds = sizeof(bus_speeds) / sizeof(bus_speeds[0]);
+    size_t first = 0;
+    while (first < n_speeds - 1 && bus_speeds[first] > requested_hz)
+    {
+        first++;
+    }
+
+    for (size_t s = first; s < n_speeds; s++)
+    {
+        info.active_hz = bus_speeds[s];
+        set_clock(port, sda_io, scl_io, bus_speeds[s]);
+
+        bool ok = true;
+        for (size_t i = 0; i < count && ok; i++)
+        {
+            ok = verify_device(port, addresses[i]);
+        }
+        if (ok)
+        {
+            info.verified = true;
+            break;
+        }
+        ESP_LOGW(TAG, "I2C readback verification failed at %lu Hz", (unsigned long)bus_speeds[s]);
+        if (s + 1 < n_speeds)
+        {
+            info.fallbacks++;
+        }
+    }
+
+    if (info.verified)
+    {
+        // Compare the frame bus time against the 400 kHz baseline to show what the faster clock saves.
+        if (info.active_hz != ADS_BASELINE_HZ)
+        {
+            set_clock(port, sda_io, scl_io, ADS_BASELINE_HZ);
+            info.baseline_bus_us = measure_frame_us(port, addresses, count);
+            set_clock(port, sda_io, scl_io, info.active_hz);
+        }
+        info.frame_bus_us = measure_frame_us(port, addresses, count);
+        if (info.active_hz == ADS_BASELINE_HZ)
+        {
+            info.baseline_bus_us = info.frame_bus_us;
+        }
+        ESP_LOGI(TAG, "ADS1115 bus at %lu Hz (requested %lu Hz): %lu us bus time per frame, %ld us vs 400 kHz",
+                 (unsigned long)info.active_hz, (unsigned long)info.requested_hz, (unsigned long)info.frame_bus_us,
+                 (long)info.baseline_bus_us - (long)info.frame_bus_us);
+        return ESP_OK;
+    }
+
+    ESP_LOGE(TAG, "ADS1115 bus failed verification at every clock, staying at %lu Hz", (unsigned long)info.active_hz);
+    return ESP_FAIL;
+}
+
+esp_err_t ads_bus_convert(int port, uint8_t address, uint16_t config, uint8_t mux, int16_t *raw)
+{
+    esp_err_t err = conv_timer_init();
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    uint8_t dr = (config >> ADS_CONFIG_DR_SHIFT) & 0x07;
+    uint32_t period_us = 1000000UL / data_rates[dr];
+    if (margin_us[dr] == 0)
+    {
+        margin_us[dr] = period_us / 10; // The internal oscillator is specified to +/-10 %.
+    }
+
+    uint16_t start_config = (config & ~ADS_CONFIG_MUX_MASK) | ((uint16_t)(mux & 0x07) << 12) |
+                            ADS_CONFIG_OS_MASK | ADS_CONFIG_MODE_SINGLE;
+    int64_t start_us = esp_timer_get_time();
+    err = ads_bus_write_register(port, address, ADS_REG_CONFIG, start_config);
+    if (err != ESP_OK)
+    {
+        return err;
+    }
+
+    // Sleep for exactly the expected conversion time instead of whole RTOS ticks.
+    xSemaphoreTake(conv_done_sem, 0); // Discard a stale give from an earlier timeout
+    esp_timer_start_once(conv_timer, period_us + margin_us[dr]);
+    xSemaphoreTake(conv_done_sem, portMAX_DELAY);
+
+    // OS reads back as 1 once the conversion is complete. Spin briefly if the ADC is late.
+    uint16_t status = 0;
+    int polls = 0;
+    int64_t deadline_us = start_us + 2 * (int64_t)period_us;
+    while (1)
+    {
+        err = ads_bus_read_register(port, address, ADS_REG_CONFIG, &status);
+        if (err != ESP_OK)
+        {
+            return err;
+        }
+        if (status & ADS_CONFIG_OS_MASK)
+        {
+            break;
+        }
+        if (esp_timer_get_time() > deadline_us)
+        {
+            info.timeouts++;
+            return ESP_ERR_TIMEOUT;
+        }
+        polls++;
+        esp_rom_delay_us(ADS_SPIN_DELAY_US);
+    }
+    uint32_t wait_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    // Calibrate: shrink the margin slowly while conversions are ready on time,
+    // grow it by the observed lateness when they are not.
+    if (polls == 0)
+    {
+        info.ready_first_poll++;
+        margin_us[dr] -= margin_us[dr] / 16;
+        if (margin_us[dr] < ADS_MIN_MARGIN_US)
+        {
+            margin_us[dr] = ADS_MIN_MARGIN_US;
+        }
+    }
+    else
+    {
+        info.spin_polls += polls;
+        uint32_t late_us = wait_us > period_us + margin_us[dr] ? wait_us - period_us - margin_us[dr] : 0;
+        margin_us[dr] += late_us + ADS_SPIN_DELAY_US;
+    }
+
+    info.conversions++;
+    total_wait_us += wait_us;
+    info.avg_wait_us = (uint32_t)(total_wait_us / info.conversions);
+    info.period_us = period_us;
+    info.margin_us = margin_us[dr];
+
+    uint16_t value;
+    err = ads_bus_read_register(port, address, ADS_REG_CONVERSION, &value);
+    if (err == ESP_OK)
+    {
+        *raw = (int16_t)value;
+    }
+    return err;
+}
+
+void ads_bus_get_info(ads_bus_info_t *out)
+{
+    if (out)
+    {
+        *out = info;
+    }
+}
@@ -0,0 +1,111 @@
+// ads_bus.h
+// This header defines the public API for bringing up the ADS1115 I2C bus at the fastest
+// clock that works reliably on the actual hardware.
+// The requested clock is verified with register readback on every ADC; if any transfer
+// fails or reads back wrong, the bus falls back to the next slower standard clock.
+// It also provides the single-shot conversion used by acquisition, which waits for the
+// conversion on a microsecond timer instead of RTOS ticks.
+
+#ifndef ADS_BUS_H_
+#define ADS_BUS_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @struct ads_bus_info_t
+ * @brief Result of the bus bring-up.
+ */
+typedef struct {
+    uint32_t requested_hz;    ///< Clock requested in the configuration.
+    uint32_t active_hz;       ///< Clock in use after verification and fallback.
+    uint32_t fallbacks;       ///< Number of slower clocks tried after a failed verification.
+    bool verified;            ///< True if the active clock passed readback verification.
+    uint32_t frame_bus_us;    ///< Measured bus time of the transfers for one 8-channel frame at the active clock.
+    uint32_t baseline_bus_us; ///< The same measurement at 400 kHz, for comparison.
+    uint32_t conversions;     ///< Single-shot conversions done with ads_bus_convert().
+    uint32_t ready_first_poll;///< Conversions that were ready at the first OS bit check after the timed wait.
+    uint32_t spin_polls;      ///< Additional OS bit checks needed because the conversion was not ready yet.
+    uint32_t timeouts;        ///< Conversions that did not finish within twice the datasheet time.
+    uint32_t avg_wait_us;     ///< Average time from conversion start to result available.
+    uint32_t period_us;       ///< Datasheet conversion time (1/SPS) of the last conversion.
+    uint32_t margin_us;       ///< Calibrated margin added to the datasheet time for the last data rate.
+} ads_bus_info_t;
+
+/**
+ * @brief Sets the I2C clock and verifies it against all ADCs, falling back to slower clocks on failure.
+ * The I2C driver must already be installed. Tried clocks are 1 MHz (Fast-mode Plus), 400 kHz
+ * (Fast-mode) and 100 kHz (Standard-mode), starting at the fastest one not above requested_hz.
+ * @param port I2C port of the ADCs.
+ * @param sda_io SDA GPIO.
+ * @param scl_io SCL GPIO.
+ * @param requested_hz Requested clock.
+ * @param addresses I2C addresses of the ADCs.
+ * @param count Number of addresses.
+ * @return esp_err_t ESP_OK if a clock passed verification, ESP_FAIL if even 100 kHz failed
+ *         (the bus is then left at 100 kHz).
+ */
+esp_err_t ads_bus_negotiate(int port, int sda_io, int scl_io, uint32_t requested_hz,
+                            const uint8_t *addresses, size_t count);
+
+/**
+ * @def ADS_BUS_REG_CONVERSION
+ * @brief ADS1115 register addresses, for use with the register access functions.
+ */
+#define ADS_BUS_REG_CONVERSION 0x00
+#define ADS_BUS_REG_CONFIG 0x01
+#define ADS_BUS_REG_LO_THRESH 0x02
+#define ADS_BUS_REG_HI_THRESH 0x03
+
+/**
+ * @brief Writes a 16-bit ADS1115 register.
+ * @param port I2C port of the ADC.
+ * @param addr I2C address of the ADC.
+ * @param reg Register address.
+ * @param value Value to write.
+ * @return esp_err_t ESP_OK on success, or the I2C error.
+ */
+esp_err_t ads_bus_write_register(int port, uint8_t addr, uint8_t reg, uint16_t value);
+
+/**
+ * @brief Reads a 16-bit ADS1115 register.
+ * @param port I2C port of the ADC.
+ * @param addr I2C address of the ADC.
+ * @param reg Register address.
+ * @param value Receives the register value.
+ * @return esp_err_t ESP_OK on success, or the I2C error.
+ */
+esp_err_t ads_bus_read_register(int port, uint8_t addr, uint8_t reg, uint16_t *value);
+
+/**
+ * @brief Runs one single-shot conversion and returns the raw result.
+ * The wait sleeps on a one-shot esp_timer for the datasheet conversion time (1/SPS) plus a
+ * margin calibrated per data rate, then checks the OS bit and polls briefly if needed.
+ * Calls must be serialized by the caller (one conversion on the bus at a time).
+ * @param port I2C port of the ADC.
+ * @param address I2C address of the ADC.
+ * @param config Config register value providing PGA and data rate (MUX, OS and MODE are overridden).
+ * @param mux Input multiplexer setting (config register bits 14:12, e.g. 4 for AIN0/GND).
+ * @param raw Receives the conversion result.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_TIMEOUT if the conversion did not finish,
+ *         or the I2C error.
+ */
+esp_err_t ads_bus_convert(int port, uint8_t address, uint16_t config, uint8_t mux, int16_t *raw);
+
+/**
+ * @brief Returns the result of the last bus bring-up and the conversion statistics.
+ * @param out Receives the information.
+ */
+void ads_bus_get_info(ads_bus_info_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ADS_BUS_H_ */
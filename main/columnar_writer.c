@@ -0,0 +1,214 @@
+// columnar_writer.c
+// This file implements the columnar log writer.
+// The chunk buffer holds a chunk header, COLUMNAR_MAX_FRAMES timestamps and one column of
+// COLUMNAR_MAX_FRAMES values per channel. A chunk with fewer frames is compacted in place
+// (columns moved down to follow each other) just before it is appended, so no second buffer is needed.
+
+#include "columnar_writer.h"
+#include <string.h>            // For memcpy, memmove, memset
+#include <time.h>              // For time
+#include "esp_heap_caps.h"     // For heap_caps_malloc
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "sdkconfig.h"         // For CONFIG_LOGGER_COLUMNAR_CHUNK_MS
+#include "columnar.h"          // For the file format
+#include "log_writer.h"        // For log_writer_append
+#include "file_catalog.h"      // For publishing the directory sidecar
+#include "settings.h"          // For NUM_CHANNELS
+
+// --- Module Constants ---
+static const char *TAG = "columnar_writer";
+
+#define COLUMNAR_CHANNELS NUM_CHANNELS
+#ifdef CONFIG_LOGGER_COLUMNAR_CHUNK_MS
+#define COLUMNAR_CHUNK_MS CONFIG_LOGGER_COLUMNAR_CHUNK_MS
+#else
+#define COLUMNAR_CHUNK_MS 1000        // Only used with CONFIG_LOGGER_COLUMNAR_FORMAT; a default keeps the file compiling without it.
+#endif
+#define COLUMNAR_CHUNK_BUFFER_SIZE (sizeof(columnar_chunk_header_t) + COLUMNAR_MAX_FRAMES * sizeof(uint32_t) * (1 + COLUMNAR_CHANNELS))
+#define COLUMNAR_DIR_MAX_ENTRIES 4096 // Chunks indexed per file (64 KB, over an hour at 1 s chunks); later chunks are found by scanning.
+#define COLUMNAR_PATH_MAX 128         // Maximum length of the log file path.
+
+// --- Static Variables ---
+static uint8_t *chunk_buf = NULL;                 // Chunk being collected (header, timestamps, columns at full stride).
+static columnar_dir_entry_t *directory = NULL;    // Offsets of the chunks written so far.
+static uint32_t dir_count = 0;                    // Valid entries in directory.
+static uint32_t frames = 0;                       // Frames in the current chunk.
+static uint32_t chunk_index = 0;                  // Number of the current chunk.
+static uint32_t file_offset = 0;                  // Where the next chunk will start in the file.
+static bool active = false;                       // True between begin and end.
+static uint32_t dropped_chunks = 0;               // Chunks the log writer could not take.
+static char file_path[COLUMNAR_PATH_MAX];         // Path of the current file.
+
+// --- Private Utility Functions ---
+
+static inline uint32_t *timestamps(void)
+{
+    return (uint32_t *)(chunk_buf + sizeof(columnar_chunk_header_t));
+}
+
+static inline float *column(uint32_t channel)
+{
+    return (float *)(chunk_buf + sizeof(columnar_chunk_header_t)) + COLUMNAR_MAX_FRAMES * (1 + channel);
+}
+
+/**
+ * @brief Lays out the current chunk contiguously and appends it to the log file.
+ */
+static void submit_chunk(void)
+{
+    if (frames == 0)
+    {
+        return;
+    }
+
+    columnar_chunk_header_t hdr = {
+        .magic = COLUMNAR_CHUNK_MAGIC,
+        .index = chunk_index,
+        .frames = frames,
+    };
+    memcpy(chunk_buf, &hdr, sizeof(hdr));
+    uint32_t first_ms = timestamps()[0];
+    uint32_t last_ms = timestamps()[frames - 1];
+
+    // Columns move towards lower addresses in channel order, so none is overwritten before it moves.
+    uint8_t *data = chunk_buf + sizeof(columnar_chunk_header_t);
+    size_t block = frames * sizeof(uint32_t);
+    for (uint32_t c = 0; c < COLUMNAR_CHANNELS; c++)
+    {
+        memmove(data + block * (1 + c), column(c), block);
+    }
+
+    size_t size = columnar_chunk_size(frames, COLUMNAR_CHANNELS);
+    if (log_writer_append((const char *)chunk_buf, size) == ESP_OK)
+    {
+        if (dir_count < COLUMNAR_DIR_MAX_ENTRIES)
+        {
+            directory[dir_count++] = (columnar_dir_entry_t){
+                .offset = file_offset,
+                .frames = frames,
+                .t_first_ms = first_ms,
+                .t_last_ms = last_ms,
+            };
+        }
+        file_offset += size;
+    }
+    else
+    {
+        dropped_chunks++;
+    }
+    chunk_index++;
+    frames = 0;
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t columnar_writer_init(void)
+{
+    chunk_buf = heap_caps_malloc(COLUMNAR_CHUNK_BUFFER_SIZE, MALLOC_CAP_8BIT);
+    // The directory is only touched once per chunk, so PSRAM is fine if present.
+    directory = heap_caps_malloc(COLUMNAR_DIR_MAX_ENTRIES * sizeof(columnar_dir_entry_t), MALLOC_CAP_SPIRAM);
+    if (!directory)
+    {
+        directory = heap_caps_malloc(COLUMNAR_DIR_MAX_ENTRIES * sizeof(columnar_dir_entry_t), MALLOC_CAP_8BIT);
+    }
+    if (!chunk_buf || !directory)
+    {
+        ESP_LOGE(TAG, "Failed to allocate chunk buffers");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Columnar logging ready (%d ms chunks, up to %d frames)", COLUMNAR_CHUNK_MS, COLUMNAR_MAX_FRAMES);
+    return ESP_OK;
+}
+
+esp_err_t columnar_writer_begin(FILE *file, const char *path)
+{
+    columnar_file_header_t fh = {
+        .version = COLUMNAR_VERSION,
+        .channels = COLUMNAR_CHANNELS,
+        .chunk_ms = COLUMNAR_CHUNK_MS,
+        .start_epoch = (int64_t)time(NULL),
+    };
+    memcpy(fh.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    if (fwrite(&fh, sizeof(fh), 1, file) != 1)
+    {
+        return ESP_FAIL;
+    }
+
+    snprintf(file_path, sizeof(file_path), "%s", path);
+    file_offset = sizeof(fh);
+    frames = 0;
+    chunk_index = 0;
+    dir_count = 0;
+    dropped_chunks = 0;
+    active = true;
+    return ESP_OK;
+}
+
+esp_err_t columnar_writer_add(uint32_t frame_ms, const float *values, size_t count)
+{
+    if (!active)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // A chunk ends when it spans the configured time, so chunks cover fixed time slices.
+    if (frames > 0 && frame_ms - timestamps()[0] >= COLUMNAR_CHUNK_MS)
+    {
+        submit_chunk();
+    }
+
+    timestamps()[frames] = frame_ms;
+    for (uint32_t c = 0; c < COLUMNAR_CHANNELS; c++)
+    {
+        column(c)[frames] = c < count ? values[c] : 0.0f;
+    }
+    frames++;
+
+    if (frames == COLUMNAR_MAX_FRAMES)
+    {
+        submit_chunk();
+    }
+    return ESP_OK;
+}
+
+void columnar_writer_flush(void)
+{
+    if (active)
+    {
+        submit_chunk();
+    }
+}
+
+void columnar_writer_end(void)
+{
+    if (!active)
+    {
+        return;
+    }
+    active = false;
+
+    char dir_path[COLUMNAR_PATH_MAX + 8];
+    if (columnar_dir_path(file_path, dir_path, sizeof(dir_path)) != ESP_OK)
+    {
+        return;
+    }
+    FILE *f = fopen(dir_path, "wb");
+    if (!f)
+    {
+        ESP_LOGW(TAG, "Could not create chunk directory for %s, readers will scan the file", file_path);
+        return;
+    }
+    fwrite(directory, sizeof(columnar_dir_entry_t), dir_count, f);
+    file_catalog_upsert(dir_path, (uint32_t)ftell(f), time(NULL));
+    fclose(f);
+    if (dropped_chunks > 0)
+    {
+        ESP_LOGW(TAG, "%lu chunks of %s were dropped because the card was too slow",
+                 (unsigned long)dropped_chunks, file_path);
+    }
+    ESP_LOGI(TAG, "%lu chunks indexed for %s", (unsigned long)dir_count, file_path);
+}
+
+uint32_t columnar_writer_dropped_chunks(void)
+{
+    return dropped_chunks;
+}
@@ -0,0 +1,63 @@
+// columnar_writer.h
+// This header defines the public API for writing columnar log files (see columnar.h).
+// Frames are collected in RAM per channel column; when a chunk spans the configured time or is
+// full, it is laid out and handed to the log writer as one append, so a chunk is either written
+// completely or dropped. The offsets of the written chunks are kept in RAM and saved to the
+// directory sidecar when the file is closed.
+
+#ifndef COLUMNAR_WRITER_H_
+#define COLUMNAR_WRITER_H_
+
+#include <stdio.h>     // For FILE
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates the chunk buffer and the chunk directory.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the buffers could not be allocated.
+ */
+esp_err_t columnar_writer_init(void);
+
+/**
+ * @brief Writes the file header to a newly created log file and starts collecting chunks.
+ * Call before log_writer_start(), in place of the CSV header.
+ * @param file Newly created log file.
+ * @param path Full path of the file.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if the header could not be written.
+ */
+esp_err_t columnar_writer_begin(FILE *file, const char *path);
+
+/**
+ * @brief Adds one frame to the current chunk and hands the chunk to the log writer when it is complete.
+ * @param frame_ms Timestamp of the frame (milliseconds since boot).
+ * @param values Channel values.
+ * @param count Number of values (at most the channel count of the file).
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_STATE if no file is active.
+ */
+esp_err_t columnar_writer_add(uint32_t frame_ms, const float *values, size_t count);
+
+/**
+ * @brief Hands the partially filled chunk to the log writer. Call before log_writer_stop().
+ */
+void columnar_writer_flush(void);
+
+/**
+ * @brief Saves the chunk directory sidecar and ends the file. Call after log_writer_stop().
+ */
+void columnar_writer_end(void);
+
+/**
+ * @brief Returns the number of chunks dropped because the log writer was full.
+ */
+uint32_t columnar_writer_dropped_chunks(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* COLUMNAR_WRITER_H_ */
@@ -0,0 +1,237 @@
+// flight_recorder.c
+// This file implements the flight recorder.
+// The record is one RTC_NOINIT structure: a header, a ring of frames and a ring of events.
+// Its contents are undefined after a power-on, so it is only trusted if its magic word and
+// size match. A frame is written into its slot before the head counter is advanced, so after a
+// crash at most the oldest slot (the one being overwritten) is torn; it is left out of the
+// recovery file. The shutdown handler marks an esp_restart() as clean, so only panics and
+// watchdog resets produce a recovery file.
+
+#include "flight_recorder.h"
+#include <stdarg.h>            // For va_list
+#include <stdatomic.h>         // For atomic_signal_fence
+#include <stdio.h>             // For FILE, fprintf, vsnprintf
+#include <stdlib.h>            // For malloc, free
+#include <string.h>            // For memcpy, memset
+#include <time.h>              // For time (catalog modification time)
+#include <sys/stat.h>          // For stat
+#include "freertos/FreeRTOS.h" // For the event spinlock
+#include "esp_attr.h"          // For RTC_NOINIT_ATTR
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "esp_system.h"        // For esp_reset_reason and the shutdown handler
+#include "esp_timer.h"         // For esp_timer_get_time
+#include "file_catalog.h"      // For the next recovery file index
+#include "sdkconfig.h"         // For CONFIG_LOGGER_FLIGHT_RECORDER_FRAMES
+
+// --- Module Constants ---
+static const char *TAG = "flight_rec";
+
+#define FLIGHT_RECORDER_FRAMES CONFIG_LOGGER_FLIGHT_RECORDER_FRAMES
+#define RECORD_MAGIC 0x464C5452u   // "FLTR"
+#define CLEAN_MAGIC 0x434C4E21u    // Set by the shutdown handler ("CLN!").
+#define RECOVERY_STEM "recovery_"  // Recovery files are recovery_N.csv in the card root.
+#define RECOVERY_MAX_INDEX 10000   // Highest recovery file number tried.
+
+/**
+ * @struct rec_frame_t
+ * @brief One recorded frame.
+ */
+typedef struct {
+    uint32_t seq;                  // Frame sequence number.
+    uint32_t ms;                   // Sampling instant, milliseconds since boot (the log time base).
+    float values[NUM_CHANNELS];    // Channel values.
+} rec_frame_t;
+
+/**
+ * @struct rec_event_t
+ * @brief One recorded event.
+ */
+typedef struct {
+    uint32_t ms;                             // Time of the event, milliseconds since boot.
+    char text[FLIGHT_RECORDER_EVENT_MAX];    // Event text.
+} rec_event_t;
+
+/**
+ * @struct record_t
+ * @brief The whole record, as kept in RTC memory.
+ */
+typedef struct {
+    uint32_t magic;                          // RECORD_MAGIC when the record is valid.
+    uint32_t size;                           // sizeof(record_t); a different firmware layout invalidates it.
+    uint32_t clean;                          // CLEAN_MAGIC if the run ended with esp_restart().
+    uint32_t boots;                          // Runs recorded since the last power-on.
+    uint32_t frame_head;                     // Frames recorded (the latest is at (frame_head - 1) % FRAMES).
+    uint32_t event_head;                     // Events recorded.
+    rec_frame_t frames[FLIGHT_RECORDER_FRAMES];
+    rec_event_t events[FLIGHT_RECORDER_EVENTS];
+} record_t;
+
+// --- Static Variables ---
+static RTC_NOINIT_ATTR record_t rec;                           // Survives soft resets.
+static portMUX_TYPE event_lock = portMUX_INITIALIZER_UNLOCKED; // Events come from several tasks.
+static record_t *previous = NULL;                              // Copy of the record to recover, NULL if none.
+static esp_reset_reason_t reset_reason = ESP_RST_UNKNOWN;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Returns a name for a reset reason.
+ */
+static const char *reset_reason_name(esp_reset_reason_t reason)
+{
+    switch (reason)
+    {
+    case ESP_RST_POWERON:   return "power-on";
+    case ESP_RST_EXT:       return "external";
+    case ESP_RST_SW:        return "software";
+    case ESP_RST_PANIC:     return "panic";
+    case ESP_RST_INT_WDT:   return "interrupt watchdog";
+    case ESP_RST_TASK_WDT:  return "task watchdog";
+    case ESP_RST_WDT:       return "watchdog";
+    case ESP_RST_DEEPSLEEP: return "deep sleep";
+    case ESP_RST_BROWNOUT:  return "brownout";
+    case ESP_RST_SDIO:      return "sdio";
+    default:                return "unknown";
+    }
+}
+
+/**
+ * @brief Shutdown handler: marks the run as ended by an orderly restart.
+ */
+static void flight_recorder_shutdown_handler(void)
+{
+    flight_recorder_event("restart");
+    rec.clean = CLEAN_MAGIC;
+}
+
+/**
+ * @brief Writes a record to a stream: header, events and frames, oldest first.
+ */
+static void write_record(FILE *f, const record_t *r)
+{
+    fprintf(f, "# recovery;reset=%s;run=%lu;frames=%lu;events=%lu\n", reset_reason_name(reset_reason),
+            (unsigned long)r->boots, (unsigned long)r->frame_head, (unsigned long)r->event_head);
+
+    fprintf(f, "# events\ntimestamp;event\n");
+    uint32_t n = r->event_head < FLIGHT_RECORDER_EVENTS ? r->event_head : FLIGHT_RECORDER_EVENTS;
+    for (uint32_t i = r->event_head - n; i != r->event_head; i++)
+    {
+        const rec_event_t *e = &r->events[i % FLIGHT_RECORDER_EVENTS];
+        fprintf(f, "%lu;%.*s\n", (unsigned long)e->ms, FLIGHT_RECORDER_EVENT_MAX - 1, e->text);
+    }
+
+    fprintf(f, "# frames\nframe;timestamp");
+    for (int ch = 0; ch < NUM_CHANNELS; ch++)
+    {
+        fprintf(f, ";ch%d", ch);
+    }
+    fprintf(f, "\n");
+    // The oldest slot may have been half overwritten when the run ended; it is left out.
+    n = r->frame_head < FLIGHT_RECORDER_FRAMES ? r->frame_head : FLIGHT_RECORDER_FRAMES - 1;
+    for (uint32_t i = r->frame_head - n; i != r->frame_head; i++)
+    {
+        const rec_frame_t *fr = &r->frames[i % FLIGHT_RECORDER_FRAMES];
+        fprintf(f, "%lu;%lu", (unsigned long)fr->seq, (unsigned long)fr->ms);
+        for (int ch = 0; ch < NUM_CHANNELS; ch++)
+        {
+            fprintf(f, ";%.6f", fr->values[ch]);
+        }
+        fprintf(f, "\n");
+    }
+}
+
+// --- Public Function Implementations ---
+
+void flight_recorder_init(void)
+{
+    reset_reason = esp_reset_reason();
+    bool valid = rec.magic == RECORD_MAGIC && rec.size == sizeof(record_t) && reset_reason != ESP_RST_POWERON;
+    uint32_t boots = valid ? rec.boots + 1 : 1;
+
+    if (valid && rec.clean != CLEAN_MAGIC && (rec.frame_head || rec.event_head))
+    {
+        previous = malloc(sizeof(record_t));
+        if (previous)
+        {
+            memcpy(previous, &rec, sizeof(record_t));
+        }
+        ESP_LOGW(TAG, "Reset (%s) after %lu recorded frame(s); recovery pending", reset_reason_name(reset_reason),
+                 (unsigned long)rec.frame_head);
+    }
+
+    memset(&rec, 0, sizeof(rec));
+    rec.size = sizeof(record_t);
+    rec.boots = boots;
+    rec.magic = RECORD_MAGIC;
+    esp_register_shutdown_handler(flight_recorder_shutdown_handler);
+    flight_recorder_event("boot (reset: %s)", reset_reason_name(reset_reason));
+}
+
+esp_err_t flight_recorder_flush(const char *dir)
+{
+    if (!previous)
+        return ESP_ERR_NOT_FOUND;
+
+    char path[80];
+    int index = file_catalog_max_index(dir, RECOVERY_STEM);
+    index = index < 0 ? 1 : index + 1;
+    struct stat st;
+    // The catalog may not be ready (or may miss files copied to the card), so a taken name is
+    // skipped rather than overwritten: an older recovery file can be the only trace of a crash.
+    for (; index < RECOVERY_MAX_INDEX; index++)
+    {
+        snprintf(path, sizeof(path), "%s/" RECOVERY_STEM "%d.csv", dir, index);
+        if (stat(path, &st) != 0)
+            break;
+    }
+    FILE *f = index < RECOVERY_MAX_INDEX ? fopen(path, "w") : NULL;
+    if (!f)
+    {
+        // No card: at least keep the record in the console log.
+        ESP_LOGE(TAG, "Failed to create %s; recovered events follow", path);
+        uint32_t n = previous->event_head < FLIGHT_RECORDER_EVENTS ? previous->event_head : FLIGHT_RECORDER_EVENTS;
+        for (uint32_t i = previous->event_head - n; i != previous->event_head; i++)
+        {
+            const rec_event_t *e = &previous->events[i % FLIGHT_RECORDER_EVENTS];
+            ESP_LOGW(TAG, "%lu ms: %.*s", (unsigned long)e->ms, FLIGHT_RECORDER_EVENT_MAX - 1, e->text);
+        }
+        free(previous);
+        previous = NULL;
+        return ESP_FAIL;
+    }
+
+    write_record(f, previous);
+    file_catalog_upsert(path, (uint32_t)ftell(f), time(NULL));
+    fclose(f);
+    ESP_LOGW(TAG, "Flight record of the previous run written to %s", path);
+    free(previous);
+    previous = NULL;
+    return ESP_OK;
+}
+
+void flight_recorder_frame(uint32_t seq, int64_t frame_us, const float *values)
+{
+    rec_frame_t *fr = &rec.frames[rec.frame_head % FLIGHT_RECORDER_FRAMES];
+    fr->seq = seq;
+    fr->ms = (uint32_t)(frame_us / 1000);
+    memcpy(fr->values, values, sizeof(fr->values));
+    atomic_signal_fence(memory_order_release); // The slot is stored before the head moves
+    rec.frame_head++;
+}
+
+void flight_recorder_event(const char *fmt, ...)
+{
+    char text[FLIGHT_RECORDER_EVENT_MAX];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(text, sizeof(text), fmt, args);
+    va_end(args);
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+
+    portENTER_CRITICAL(&event_lock);
+    rec_event_t *e = &rec.events[rec.event_head % FLIGHT_RECORDER_EVENTS];
+    e->ms = ms;
+    memcpy(e->text, text, sizeof(e->text));
+    rec.event_head++;
+    portEXIT_CRITICAL(&event_lock);
+}
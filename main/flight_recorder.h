@@ -0,0 +1,61 @@
+// flight_recorder.h
+// This header defines the public API for the flight recorder.
+// The latest frames and events are kept in RTC slow memory, which is not cleared by a panic
+// or a watchdog reset. At the next boot, if the previous run did not end with an orderly
+// restart, they are written to the SD card as recovery_N.csv together with the reset reason,
+// before logging resumes. During normal operation the recorder only writes
+// to RTC memory, never to flash or the card.
+
+#ifndef FLIGHT_RECORDER_H_
+#define FLIGHT_RECORDER_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+#include "settings.h"  // For NUM_CHANNELS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHT_RECORDER_EVENTS 16     ///< Events kept.
+#define FLIGHT_RECORDER_EVENT_MAX 44  ///< Maximum length (including null terminator) of an event text.
+
+/**
+ * @brief Checks what the previous run left in RTC memory and starts a new recording.
+ * A record that needs recovery is copied to the heap first, so it can be written out later
+ * while the new run is already being recorded. Call once, early in app_main().
+ */
+void flight_recorder_init(void);
+
+/**
+ * @brief Writes the record of the previous run to a new recovery_N.csv in the given directory,
+ * if there is one. Call after the SD card is mounted and before logging starts.
+ * @param dir Directory of the recovery file (the mount point).
+ * @return esp_err_t ESP_OK if the file was written, ESP_ERR_NOT_FOUND if there was nothing
+ *         to recover, or ESP_FAIL if the file could not be written (the record is then only
+ *         printed to the console).
+ */
+esp_err_t flight_recorder_flush(const char *dir);
+
+/**
+ * @brief Records a frame. Call from the acquisition task only; copies NUM_CHANNELS values
+ * to RTC memory and never blocks.
+ * @param seq Sequence number of the frame.
+ * @param frame_us Sampling instant of the frame (esp_timer time).
+ * @param values Channel values.
+ */
+void flight_recorder_frame(uint32_t seq, int64_t frame_us, const float *values);
+
+/**
+ * @brief Records an event (log file opened, marker, alarm, ...). Callable from any task;
+ * the text is truncated to FLIGHT_RECORDER_EVENT_MAX - 1 characters.
+ * @param fmt printf-style format.
+ */
+void flight_recorder_event(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FLIGHT_RECORDER_H_ */
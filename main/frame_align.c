@@ -0,0 +1,133 @@
+// frame_align.c
+// This file implements inter-channel skew compensation.
+// Channel i of frame k is sampled at t_i(k), after channel 0 at t_0(k). Because the scan is
+// periodic, t_i(k-1) < t_0(k) < t_i(k), so the value of channel i at t_0(k) is found by linear
+// interpolation between its previous and current sample. This needs one frame of history and
+// adds no delay.
+
+#include "frame_align.h"
+#include <math.h>              // For sqrt
+#include <string.h>            // For memset
+#include "freertos/FreeRTOS.h" // For portMUX_TYPE
+#include "sdkconfig.h"         // For CONFIG_LOGGER_CHANNEL_TIMING_ALIGNED
+
+// --- Module Constants ---
+#define FRAME_ALIGN_MAX_GAP_FACTOR 4 // A frame later than this many periods after the previous one starts over.
+
+#ifdef CONFIG_LOGGER_CHANNEL_TIMING_ALIGNED
+#define FRAME_ALIGN_ENABLED true
+#else
+#define FRAME_ALIGN_ENABLED false
+#endif
+
+// --- Static Variables ---
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the statistics below.
+static frame_align_stats_t stats = {.enabled = FRAME_ALIGN_ENABLED};
+static uint64_t skew_total_us = 0;                              // Sum of all skews, for the average.
+static uint64_t offset_total_us[FRAME_ALIGN_MAX_CHANNELS];      // Sum of the offsets per channel.
+static uint64_t period_total_us = 0;                            // Sum of the frame periods, for the average.
+static double period_sq_total = 0.0;                            // Sum of the squared frame periods, for the deviation.
+
+static bool have_prev = false;                                  // True if the previous frame is usable.
+static int64_t prev_us[FRAME_ALIGN_MAX_CHANNELS];               // Sampling instants of the previous frame.
+static float prev_values[FRAME_ALIGN_MAX_CHANNELS];             // Raw (not interpolated) values of the previous frame.
+
+// --- Public Function Implementations ---
+
+int64_t frame_align_process(const int64_t *sample_us, float *values, size_t count)
+{
+    if (count > FRAME_ALIGN_MAX_CHANNELS)
+        count = FRAME_ALIGN_MAX_CHANNELS;
+    int64_t frame_us = sample_us[0];
+    uint32_t period_us = have_prev ? (uint32_t)(frame_us - prev_us[0]) : 0;
+
+    // After a pause, the previous samples are too old to interpolate from.
+    bool usable = have_prev && stats.frame_period_us > 0 &&
+                  period_us <= stats.frame_period_us * FRAME_ALIGN_MAX_GAP_FACTOR;
+    bool aligned = FRAME_ALIGN_ENABLED && usable;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        float raw = values[i];
+        if (aligned && i > 0 && sample_us[i] > prev_us[i])
+        {
+            float w = (float)(frame_us - prev_us[i]) / (float)(sample_us[i] - prev_us[i]);
+            values[i] = prev_values[i] + w * (raw - prev_values[i]);
+        }
+        prev_values[i] = raw;
+        prev_us[i] = sample_us[i];
+    }
+    have_prev = true;
+
+    uint32_t skew_us = (uint32_t)(sample_us[count - 1] - frame_us);
+    portENTER_CRITICAL(&stats_lock);
+    stats.frames++;
+    if (aligned)
+        stats.aligned_frames++;
+    if (period_us > 0)
+        stats.frame_period_us = period_us;
+    if (usable)
+    {
+        if (stats.periods == 0 || period_us < stats.period_min_us)
+            stats.period_min_us = period_us;
+        if (period_us > stats.period_max_us)
+            stats.period_max_us = period_us;
+        stats.periods++;
+        period_total_us += period_us;
+        period_sq_total += (double)period_us * period_us;
+    }
+    stats.skew_last_us = skew_us;
+    if (skew_us > stats.skew_max_us)
+        stats.skew_max_us = skew_us;
+    skew_total_us += skew_us;
+    stats.skew_avg_us = (uint32_t)(skew_total_us / stats.frames);
+    for (size_t i = 0; i < count; i++)
+    {
+        offset_total_us[i] += (uint64_t)(sample_us[i] - frame_us);
+        stats.offset_avg_us[i] = (uint32_t)(offset_total_us[i] / stats.frames);
+    }
+    portEXIT_CRITICAL(&stats_lock);
+
+    return frame_us;
+}
+
+void frame_align_reset(void)
+{
+    have_prev = false;
+}
+
+bool frame_align_is_enabled(void)
+{
+    return FRAME_ALIGN_ENABLED;
+}
+
+void frame_align_reset_stats(void)
+{
+    portENTER_CRITICAL(&stats_lock);
+    uint32_t period_us = stats.frame_period_us; // Kept: it tells the next frame whether it follows a gap.
+    memset(&stats, 0, sizeof(stats));
+    stats.enabled = FRAME_ALIGN_ENABLED;
+    stats.frame_period_us = period_us;
+    skew_total_us = 0;
+    memset(offset_total_us, 0, sizeof(offset_total_us));
+    period_total_us = 0;
+    period_sq_total = 0.0;
+    portEXIT_CRITICAL(&stats_lock);
+}
+
+void frame_align_get_stats(frame_align_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    uint64_t total_us = period_total_us;
+    double sq_total = period_sq_total;
+    portEXIT_CRITICAL(&stats_lock);
+
+    if (out->periods > 0)
+    {
+        double mean = (double)total_us / out->periods;
+        double var = sq_total / out->periods - mean * mean;
+        out->period_avg_us = (uint32_t)(mean + 0.5);
+        out->period_std_us = var > 0.0 ? (uint32_t)(sqrt(var) + 0.5) : 0;
+    }
+}
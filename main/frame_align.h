@@ -0,0 +1,84 @@
+// frame_align.h
+// This header defines the public API for inter-channel skew compensation.
+// The 8 channels of a frame are converted one after another, so each value was sampled at a
+// slightly different instant. Every conversion carries its own microsecond timestamp; this
+// module measures the spread and, optionally, interpolates each channel linearly between its
+// previous and current sample to the instant of channel 0, so all values of a frame describe
+// the same moment.
+// This header is used by the web server and therefore does not depend on the ADC driver.
+
+#ifndef FRAME_ALIGN_H_
+#define FRAME_ALIGN_H_
+
+#include <stdbool.h>   // For boolean type
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @def FRAME_ALIGN_MAX_CHANNELS
+ * @brief Largest number of channels in one frame.
+ */
+#define FRAME_ALIGN_MAX_CHANNELS 8
+
+/**
+ * @struct frame_align_stats_t
+ * @brief Timing of the scanned frames since the last reset.
+ */
+typedef struct {
+    bool enabled;                                 ///< True if values are interpolated to the frame instant.
+    uint32_t frames;                              ///< Frames processed.
+    uint32_t aligned_frames;                      ///< Frames whose values were interpolated (the first frame after a gap is not).
+    uint32_t skew_last_us;                        ///< Time between the first and last channel of the last frame.
+    uint32_t skew_avg_us;                         ///< Average of skew_last_us.
+    uint32_t skew_max_us;                         ///< Largest skew_last_us.
+    uint32_t frame_period_us;                     ///< Time between the last two frames.
+    uint32_t periods;                             ///< Frame periods in the jitter statistics (gaps are left out).
+    uint32_t period_min_us;                       ///< Shortest frame period.
+    uint32_t period_max_us;                       ///< Longest frame period.
+    uint32_t period_avg_us;                       ///< Average frame period.
+    uint32_t period_std_us;                       ///< Standard deviation of the frame period (acquisition jitter).
+    uint32_t offset_avg_us[FRAME_ALIGN_MAX_CHANNELS]; ///< Average sampling delay of each channel after channel 0.
+} frame_align_stats_t;
+
+/**
+ * @brief Processes one frame: records its timing and, if alignment is enabled, interpolates the
+ * values in place to the sampling instant of the first channel.
+ * The first frame after a reset or a gap (scan paused, read error) is left unchanged because
+ * there is no recent previous sample to interpolate from.
+ * @param sample_us Sampling instant of each value (esp_timer time, microseconds).
+ * @param values Values of the frame, modified in place.
+ * @param count Number of channels (at most FRAME_ALIGN_MAX_CHANNELS).
+ * @return int64_t The frame instant (sampling instant of the first channel).
+ */
+int64_t frame_align_process(const int64_t *sample_us, float *values, size_t count);
+
+/**
+ * @brief Forgets the previous frame, e.g. after a read error. The next frame is not interpolated.
+ */
+void frame_align_reset(void);
+
+/**
+ * @brief Clears the timing statistics, e.g. at the start of a load test, so they cover a known period.
+ */
+void frame_align_reset_stats(void);
+
+/**
+ * @brief Checks whether values are interpolated to the frame instant.
+ */
+bool frame_align_is_enabled(void);
+
+/**
+ * @brief Copies the current timing statistics.
+ * @param out Destination for the statistics.
+ */
+void frame_align_get_stats(frame_align_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* FRAME_ALIGN_H_ */
@@ -0,0 +1,301 @@
+// led_status.c
+// This file implements the LED status service.
+// The task plays a cycle of steps (color and duration). A cycle is either the steady base color,
+// one pending event pattern, or the blink code of one active fault (faults take turns) followed
+// by a pause in the base color. Messages that arrive during a cycle update the state at once;
+// the new state shows from the next step, so a blink code is never cut short.
+
+#include "led_status.h"
+#include <stdint.h>            // For fixed width integer types
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For the status task
+#include "freertos/queue.h"    // For the message queue
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "ws2812.h"            // For the LED itself
+
+// --- Module Constants ---
+static const char *TAG = "led_status";
+
+#define LED_QUEUE_LENGTH 8          // Messages buffered for the task.
+#define LED_TASK_STACK_SIZE 2560    // Stack size of the status task.
+#define LED_TASK_PRIORITY 2         // Below acquisition, the log writer and the HTTP server.
+#define LED_FAULT_PAUSE_MS 1500     // Base color between repetitions of a fault code.
+#define LED_EVENT_PAUSE_MS 400      // Base color after an event pattern.
+#define LED_MAX_BLINKS 5            // Longest blink code (LED_PATTERN_ALARM).
+#define LED_MAX_STEPS (2 * LED_MAX_BLINKS + 1)
+
+/**
+ * @enum led_msg_type_t
+ * @brief Kind of a queued message.
+ */
+typedef enum {
+    LED_MSG_MODE,
+    LED_MSG_FAULT,
+    LED_MSG_SIGNAL,
+} led_msg_type_t;
+
+/**
+ * @struct led_msg_t
+ * @brief One state change, as posted by the reporting tasks.
+ */
+typedef struct {
+    uint8_t type;   // led_msg_type_t
+    uint8_t value;  // led_mode_t or led_pattern_t
+    bool active;    // For faults: raised or cleared.
+} led_msg_t;
+
+/**
+ * @struct led_step_t
+ * @brief One step of a cycle. Base steps show the base color current at the time they are shown.
+ */
+typedef struct {
+    bool base;
+    uint8_t rgb[3];
+    uint16_t ms;    // Duration, 0 = until the next message.
+} led_step_t;
+
+/**
+ * @struct led_pattern_def_t
+ * @brief Color and timing of a blink code.
+ */
+typedef struct {
+    uint8_t r, g, b;
+    uint8_t blinks;
+    uint16_t on_ms;
+    uint16_t off_ms;
+} led_pattern_def_t;
+
+static const led_pattern_def_t pattern_defs[LED_PATTERN_COUNT] = {
+    [LED_PATTERN_SD_FULL]          = {255, 80, 0, 3, 250, 250},
+    [LED_PATTERN_I2C_FAULT]        = {255, 0, 255, 2, 250, 250},
+    [LED_PATTERN_ALARM]            = {255, 0, 0, 5, 100, 100},
+    [LED_PATTERN_OVERRUN]          = {255, 255, 0, 4, 80, 80},
+    [LED_PATTERN_CLIENT_CONNECTED] = {0, 255, 255, 2, 120, 120},
+};
+
+static const uint8_t mode_colors[][3] = {
+    [LED_MODE_BOOT]    = {0, 0, 255},
+    [LED_MODE_STOPPED] = {255, 0, 0},
+    [LED_MODE_LOGGING] = {0, 255, 0},
+    [LED_MODE_WAITING] = {0, 0, 255},
+};
+
+// --- Static Variables ---
+static QueueHandle_t led_queue = NULL;
+
+// Last state posted by the reporting tasks; used only to skip posts that change nothing.
+static portMUX_TYPE filter_lock = portMUX_INITIALIZER_UNLOCKED; // Protects the three filters below.
+static int posted_mode = -1;
+static uint32_t posted_faults = 0;
+static uint32_t posted_signals = 0;            // Cleared by the task once a pattern was played.
+
+// State of the task.
+static led_mode_t mode = LED_MODE_BOOT;
+static uint32_t faults = 0;                    // Active faults (bit = led_pattern_t).
+static uint32_t signals = 0;                   // Events waiting to be played.
+static int last_fault = -1;                    // Fault shown in the previous cycle.
+static led_step_t steps[LED_MAX_STEPS];
+static int step_count = 0;
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Posts a message without blocking. A full queue drops it; the filters are then reset
+ * so the next report of the same state is posted again.
+ */
+static void post(led_msg_type_t type, uint8_t value, bool active)
+{
+    if (!led_queue)
+        return;
+    led_msg_t msg = {.type = type, .value = value, .active = active};
+    if (xQueueSend(led_queue, &msg, 0) != pdTRUE)
+    {
+        portENTER_CRITICAL(&filter_lock);
+        if (type == LED_MSG_MODE)
+            posted_mode = -1;
+        else if (type == LED_MSG_SIGNAL)
+            posted_signals &= ~(1u << value);
+        else
+            posted_faults ^= 1u << value;
+        portEXIT_CRITICAL(&filter_lock);
+    }
+}
+
+/**
+ * @brief Updates a filter and reports whether the state changed, under the filter lock.
+ */
+static bool filter_update(uint32_t *filter, uint32_t bit, bool set)
+{
+    portENTER_CRITICAL(&filter_lock);
+    bool changed = ((*filter & bit) != 0) != set;
+    if (changed)
+        *filter ^= bit;
+    portEXIT_CRITICAL(&filter_lock);
+    return changed;
+}
+
+static void add_step(bool base, const uint8_t *rgb, uint16_t ms)
+{
+    led_step_t *s = &steps[step_count++];
+    s->base = base;
+    for (int i = 0; i < 3; i++)
+        s->rgb[i] = rgb ? rgb[i] : 0;
+    s->ms = ms;
+}
+
+static void add_blinks(led_pattern_t p)
+{
+    const led_pattern_def_t *d = &pattern_defs[p];
+    const uint8_t on[3] = {d->r, d->g, d->b};
+    const uint8_t off[3] = {0, 0, 0};
+    for (int i = 0; i < d->blinks && step_count < LED_MAX_STEPS - 1; i++)
+    {
+        add_step(false, on, d->on_ms);
+        add_step(false, off, d->off_ms);
+    }
+}
+
+/**
+ * @brief Builds the next cycle from the current state.
+ */
+static void build_cycle(void)
+{
+    step_count = 0;
+    if (signals)
+    {
+        int p = __builtin_ctz(signals);
+        signals &= ~(1u << p);
+        filter_update(&posted_signals, 1u << p, false);
+        add_blinks(p);
+        add_step(true, NULL, LED_EVENT_PAUSE_MS);
+    }
+    else if (faults)
+    {
+        // Show the active faults in turn, starting after the one shown last.
+        int p = last_fault;
+        do
+        {
+            p = (p + 1) % LED_PATTERN_COUNT;
+        } while (!(faults & (1u << p)));
+        last_fault = p;
+        add_blinks(p);
+        add_step(true, NULL, LED_FAULT_PAUSE_MS);
+    }
+    else
+    {
+        add_step(true, NULL, 0);
+    }
+}
+
+static void apply(const led_msg_t *msg)
+{
+    switch (msg->type)
+    {
+    case LED_MSG_MODE:
+        mode = (led_mode_t)msg->value;
+        break;
+    case LED_MSG_FAULT:
+        if (msg->active)
+            faults |= 1u << msg->value;
+        else
+            faults &= ~(1u << msg->value);
+        break;
+    case LED_MSG_SIGNAL:
+        signals |= 1u << msg->value;
+        break;
+    }
+}
+
+/**
+ * @brief FreeRTOS task that owns the LED.
+ * @param pvParam Task parameters (not used).
+ */
+static void led_status_task(void *pvParam)
+{
+    int shown = -1; // Last color sent to the LED (0xRRGGBB), to skip redundant updates.
+    led_msg_t msg;
+
+    while (1)
+    {
+        build_cycle();
+        for (int i = 0; i < step_count; i++)
+        {
+            const led_step_t *s = &steps[i];
+            TickType_t start = xTaskGetTickCount();
+            TickType_t duration = pdMS_TO_TICKS(s->ms);
+            bool restart = false;
+
+            while (1)
+            {
+                const uint8_t *rgb = s->base ? mode_colors[mode] : s->rgb;
+                int color = (rgb[0] << 16) | (rgb[1] << 8) | rgb[2];
+                if (color != shown)
+                {
+                    ws2812_set_rgb(rgb[0], rgb[1], rgb[2]);
+                    shown = color;
+                }
+
+                TickType_t wait = portMAX_DELAY;
+                if (s->ms > 0)
+                {
+                    TickType_t elapsed = xTaskGetTickCount() - start;
+                    if (elapsed >= duration)
+                        break;
+                    wait = duration - elapsed;
+                }
+                if (xQueueReceive(led_queue, &msg, wait) != pdTRUE)
+                    break;
+                apply(&msg);
+                // A steady color has nothing to finish: rebuild right away.
+                if (s->ms == 0)
+                {
+                    restart = true;
+                    break;
+                }
+            }
+            if (restart)
+                break;
+        }
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t led_status_init(void)
+{
+    ws2812_init();
+    led_queue = xQueueCreate(LED_QUEUE_LENGTH, sizeof(led_msg_t));
+    if (!led_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create LED queue");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(led_status_task, "led_status", LED_TASK_STACK_SIZE, NULL, LED_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create LED task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void led_status_set_mode(led_mode_t new_mode)
+{
+    portENTER_CRITICAL(&filter_lock);
+    bool changed = posted_mode != (int)new_mode;
+    posted_mode = new_mode;
+    portEXIT_CRITICAL(&filter_lock);
+    if (changed)
+        post(LED_MSG_MODE, new_mode, true);
+}
+
+void led_status_set_fault(led_pattern_t pattern, bool active)
+{
+    if (filter_update(&posted_faults, 1u << pattern, active))
+        post(LED_MSG_FAULT, pattern, active);
+}
+
+void led_status_signal(led_pattern_t pattern)
+{
+    if (filter_update(&posted_signals, 1u << pattern, true))
+        post(LED_MSG_SIGNAL, pattern, true);
+}
@@ -0,0 +1,73 @@
+// led_status.h
+// This header defines the public API for the LED status service.
+// A dedicated low-priority task owns the WS2812 LED. Other tasks only report state changes
+// (logging mode, faults, one-off events) through a queue; the task turns them into colors and
+// blink codes. Reporting is a non-blocking queue post, and repeated reports of an unchanged
+// state are filtered before they reach the queue, so callers in the acquisition path pay
+// almost nothing.
+
+#ifndef LED_STATUS_H_
+#define LED_STATUS_H_
+
+#include <stdbool.h>   // For boolean type
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @enum led_mode_t
+ * @brief Base state, shown as a steady color between blink codes.
+ */
+typedef enum {
+    LED_MODE_BOOT = 0,     ///< Starting up (blue).
+    LED_MODE_STOPPED,      ///< Logging inactive (red).
+    LED_MODE_LOGGING,      ///< Logging to the SD card (green).
+    LED_MODE_WAITING,      ///< Waiting for the next scheduled session (blue).
+} led_mode_t;
+
+/**
+ * @enum led_pattern_t
+ * @brief Blink codes, in decreasing priority.
+ */
+typedef enum {
+    LED_PATTERN_SD_FULL = 0,       ///< Fault: the SD card is full or rejects writes (3 x orange).
+    LED_PATTERN_I2C_FAULT,         ///< Fault: the ADCs do not respond (2 x magenta).
+    LED_PATTERN_ALARM,             ///< Fault: a channel is beyond its alarm limit (5 x red, fast).
+    LED_PATTERN_OVERRUN,           ///< Event: rows were dropped because the card was too slow (4 x yellow, fast).
+    LED_PATTERN_CLIENT_CONNECTED,  ///< Event: a Wi-Fi client joined the access point (2 x cyan).
+    LED_PATTERN_COUNT
+} led_pattern_t;
+
+/**
+ * @brief Initializes the LED and starts the status task.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the queue or task could not be created.
+ */
+esp_err_t led_status_init(void);
+
+/**
+ * @brief Sets the base state.
+ * @param mode New base state.
+ */
+void led_status_set_mode(led_mode_t mode);
+
+/**
+ * @brief Raises or clears a fault. Active faults repeat their blink code until cleared.
+ * @param pattern Fault pattern (LED_PATTERN_SD_FULL, LED_PATTERN_I2C_FAULT or LED_PATTERN_ALARM).
+ * @param active True to raise, false to clear.
+ */
+void led_status_set_fault(led_pattern_t pattern, bool active);
+
+/**
+ * @brief Plays a blink code once (e.g. LED_PATTERN_OVERRUN). Further signals of the same
+ * pattern are ignored until it has been played.
+ * @param pattern Pattern to play.
+ */
+void led_status_signal(led_pattern_t pattern);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LED_STATUS_H_ */
@@ -0,0 +1,299 @@
+// log_writer.c
+// This file implements the buffered SD card log writer.
+// A fixed pool of blocks circulates between two queues: the acquisition task takes an empty
+// block, fills it with rows and passes it to the writer task, which writes it to the card
+// and returns it. The number of full blocks waiting is published to the SD I/O scheduler,
+// which throttles web transfers before the pool can run out. For every block, a CRC record
+// is appended to the file's sidecar (see log_crc.h) so corruption can be detected later.
+
+#include "log_writer.h"
+#include <string.h>            // For memcpy, strncpy
+#include <time.h>              // For time
+#include <unistd.h>            // For fsync
+#include "freertos/FreeRTOS.h" // For FreeRTOS types
+#include "freertos/task.h"     // For tasks
+#include "freertos/queue.h"    // For queues
+#include "freertos/semphr.h"   // For semaphores
+#include "esp_heap_caps.h"     // For heap_caps_malloc
+#include "esp_log.h"           // For ESP_LOGx macros
+#include "sd_io.h"             // For the SD I/O scheduler
+#include "file_catalog.h"      // For publishing the file size
+#include "log_crc.h"           // For the CRC sidecar
+#include "led_status.h"        // For the SD full blink code
+#include "log_tail.h"          // For the checkpoints of followers
+
+// --- Module Constants ---
+static const char *TAG = "log_writer";
+
+#define LOG_WRITER_BLOCK_SIZE 4096       // Size of one block; a multiple of the FAT sector size.
+#define LOG_WRITER_BLOCK_COUNT 8         // Number of blocks in the pool (32 KB, about 3 s of rows at 100 Hz).
+#define LOG_WRITER_FLUSH_MS 1000         // A partially filled block is written after this time at the latest.
+#define LOG_WRITER_STOP_WARN_MS 5000     // Interval of the warnings while the pool drains on stop.
+#define LOG_WRITER_TASK_STACK_SIZE 4096  // Stack size of the writer task.
+#define LOG_WRITER_TASK_PRIORITY 6       // Above the HTTP server (5), so log writes win the SD bus.
+#define LOG_WRITER_PATH_MAX 128          // Maximum length of the log file path.
+
+/**
+ * @struct log_block_t
+ * @brief One buffer of the pool.
+ */
+typedef struct {
+    char *data;       // Block storage (LOG_WRITER_BLOCK_SIZE bytes).
+    size_t len;       // Number of used bytes.
+    size_t boundary;  // End of the last complete append in this block, 0 if none ends here.
+} log_block_t;
+
+// --- Static Variables ---
+static log_block_t blocks[LOG_WRITER_BLOCK_COUNT]; // The block pool.
+static log_block_t sync_marker;                    // Queued on stop; signals that all blocks before it are written.
+static QueueHandle_t free_queue = NULL;            // Empty blocks.
+static QueueHandle_t full_queue = NULL;            // Blocks waiting to be written.
+static SemaphoreHandle_t drained_sem = NULL;       // Given by the writer task when it reaches the sync marker.
+static log_block_t *current = NULL;                // Block being filled by the acquisition task.
+static uint32_t current_started_ms = 0;            // When the current block received its first data.
+static FILE *target = NULL;                        // File the writer task writes to.
+static char target_path[LOG_WRITER_PATH_MAX];      // Path of the target file, for the catalog.
+static FILE *crc_file = NULL;                      // CRC sidecar of the target file.
+static char crc_path[LOG_WRITER_PATH_MAX + 8];     // Path of the CRC sidecar.
+static volatile uint32_t dropped = 0;              // Appends dropped because the pool was exhausted.
+
+// --- Private Utility Functions ---
+
+/**
+ * @brief Gets the current time in milliseconds since boot.
+ */
+static uint32_t now_ms(void) { return xTaskGetTickCount() * portTICK_PERIOD_MS; }
+
+/**
+ * @brief Publishes the writer backlog to the SD I/O scheduler.
+ */
+static void publish_backlog(void)
+{
+    sd_io_set_writer_backlog((uint32_t)uxQueueMessagesWaiting(full_queue),
+                             target ? LOG_WRITER_BLOCK_COUNT : 0);
+}
+
+/**
+ * @brief Hands the current block to the writer task.
+ */
+static void submit_current(void)
+{
+    if (current && current->len > 0)
+    {
+        xQueueSend(full_queue, &current, portMAX_DELAY); // Cannot block: the queue holds the whole pool.
+        current = NULL;
+        publish_backlog();
+    }
+}
+
+/**
+ * @brief FreeRTOS task that writes full blocks to the card.
+ * @param pvParam Task parameters (not used).
+ */
+static void log_writer_task(void *pvParam)
+{
+    log_block_t *block;
+
+    while (1)
+    {
+        if (xQueueReceive(full_queue, &block, portMAX_DELAY) != pdTRUE)
+        {
+            continue;
+        }
+        if (block == &sync_marker)
+        {
+            xSemaphoreGive(drained_sem);
+            continue;
+        }
+
+        if (target)
+        {
+            log_crc_record_t rec;
+            uint32_t offset = (uint32_t)ftell(target);
+            log_crc_make_record(offset, block->data, (uint32_t)block->len, &rec);
+
+            sd_io_writer_begin();
+            size_t written = fwrite(block->data, 1, block->len, target);
+            fflush(target);
+            if (crc_file)
+            {
+                // The record is written after the data, so a record always describes data that reached the card.
+                fwrite(&rec, sizeof(rec), 1, crc_file);
+                fflush(crc_file);
+            }
+            // Make the new size visible to followers, which open the file separately.
+            if (block->boundary > 0 && written == block->len && log_tail_followed())
+            {
+                fsync(fileno(target));
+            }
+            sd_io_writer_end(written);
+            if (block->boundary > 0 && written == block->len)
+            {
+                log_tail_commit(offset + (uint32_t)block->boundary); // Never in the middle of a row
+            }
+            if (written != block->len)
+            {
+                ESP_LOGE(TAG, "Short write to %s (%u of %u bytes)", target_path, (unsigned)written, (unsigned)block->len);
+            }
+            // A short write almost always means the card is full; blink until writes succeed again.
+            led_status_set_fault(LED_PATTERN_SD_FULL, written != block->len);
+            file_catalog_upsert(target_path, (uint32_t)ftell(target), time(NULL)); // Keep /list current
+        }
+
+        block->len = 0;
+        block->boundary = 0;
+        xQueueSend(free_queue, &block, portMAX_DELAY);
+        publish_backlog();
+    }
+}
+
+// --- Public Function Implementations ---
+
+esp_err_t log_writer_init(void)
+{
+    free_queue = xQueueCreate(LOG_WRITER_BLOCK_COUNT, sizeof(log_block_t *));
+    full_queue = xQueueCreate(LOG_WRITER_BLOCK_COUNT + 1, sizeof(log_block_t *)); // +1 for the sync marker
+    drained_sem = xSemaphoreCreateBinary();
+    if (!free_queue || !full_queue || !drained_sem)
+    {
+        ESP_LOGE(TAG, "Failed to create writer queues");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < LOG_WRITER_BLOCK_COUNT; i++)
+    {
+        // Internal RAM keeps the SPI transfers DMA capable without an extra copy.
+        blocks[i].data = heap_caps_malloc(LOG_WRITER_BLOCK_SIZE, MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+        if (!blocks[i].data)
+        {
+            ESP_LOGE(TAG, "Failed to allocate block %d", i);
+            return ESP_ERR_NO_MEM;
+        }
+        blocks[i].len = 0;
+        blocks[i].boundary = 0;
+        log_block_t *block = &blocks[i];
+        xQueueSend(free_queue, &block, 0);
+    }
+
+    if (xTaskCreate(log_writer_task, "log_writer", LOG_WRITER_TASK_STACK_SIZE, NULL, LOG_WRITER_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to create writer task");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "Log writer ready (%d x %d byte blocks)", LOG_WRITER_BLOCK_COUNT, LOG_WRITER_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+void log_writer_start(FILE *file, const char *path)
+{
+    target = file;
+    strncpy(target_path, path, sizeof(target_path) - 1);
+    target_path[sizeof(target_path) - 1] = '\0';
+
+    crc_file = NULL;
+    if (log_crc_sidecar_path(path, crc_path, sizeof(crc_path)) == ESP_OK)
+    {
+        crc_file = fopen(crc_path, "wb");
+    }
+    if (!crc_file)
+    {
+        ESP_LOGW(TAG, "Could not create CRC sidecar for %s, the file will not be verifiable", path);
+    }
+    log_tail_open(path, (uint32_t)ftell(file)); // The header is already in the file
+    publish_backlog();
+}
+
+esp_err_t log_writer_append(const char *data, size_t len)
+{
+    if (!target)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // Appends are all-or-nothing, so a slow card never leaves a torn row (or columnar chunk)
+    // in the file. Only this task takes blocks from free_queue, so the check cannot go stale.
+    size_t available = (current ? LOG_WRITER_BLOCK_SIZE - current->len : 0) +
+                       (size_t)uxQueueMessagesWaiting(free_queue) * LOG_WRITER_BLOCK_SIZE;
+    if (len > available)
+    {
+        // Every block is waiting for the card: drop rather than stall acquisition.
+        dropped++;
+        return ESP_ERR_NO_MEM;
+    }
+
+    while (len > 0)
+    {
+        if (!current)
+        {
+            xQueueReceive(free_queue, &current, 0); // Cannot fail, see the check above.
+            current_started_ms = now_ms();
+        }
+
+        size_t space = LOG_WRITER_BLOCK_SIZE - current->len;
+        size_t n = len < space ? len : space;
+        memcpy(current->data + current->len, data, n);
+        current->len += n;
+        data += n;
+        len -= n;
+        if (len == 0)
+        {
+            current->boundary = current->len; // Followers may read up to here once the block is written
+        }
+
+        if (current->len == LOG_WRITER_BLOCK_SIZE)
+        {
+            submit_current();
+        }
+    }
+
+    // Do not keep rows in RAM for too long, so a power loss costs at most about a second.
+    if (current && now_ms() - current_started_ms >= LOG_WRITER_FLUSH_MS)
+    {
+        submit_current();
+    }
+    return ESP_OK;
+}
+
+void log_writer_stop(void)
+{
+    if (!target)
+    {
+        return;
+    }
+
+    submit_current();
+    xSemaphoreTake(drained_sem, 0); // Discard a stale give, so only this marker can end the wait
+    log_block_t *marker = &sync_marker;
+    xQueueSend(full_queue, &marker, portMAX_DELAY);
+    // The file stays attached until the writer reaches the marker, however long a stuck card takes;
+    // returning earlier would let the caller close a file the writer task is still writing to.
+    uint32_t waited_ms = 0;
+    while (xSemaphoreTake(drained_sem, pdMS_TO_TICKS(LOG_WRITER_STOP_WARN_MS)) != pdTRUE)
+    {
+        waited_ms += LOG_WRITER_STOP_WARN_MS;
+        ESP_LOGW(TAG, "Still draining log blocks for %s after %lu ms", target_path, (unsigned long)waited_ms);
+    }
+
+    if (log_tail_followed())
+    {
+        fsync(fileno(target)); // Followers read the last rows before the file is closed
+    }
+    log_tail_close();
+    target = NULL;
+    if (crc_file)
+    {
+        file_catalog_upsert(crc_path, (uint32_t)ftell(crc_file), time(NULL));
+        fclose(crc_file);
+        crc_file = NULL;
+    }
+    publish_backlog();
+    if (dropped > 0)
+    {
+        ESP_LOGW(TAG, "%lu appends were dropped because the card was too slow", (unsigned long)dropped);
+    }
+}
+
+uint32_t log_writer_dropped(void)
+{
+    return dropped;
+}
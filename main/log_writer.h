@@ -0,0 +1,59 @@
+// log_writer.h
+// This header defines the public API for the buffered SD card log writer.
+// The acquisition task appends formatted rows to in-memory blocks; a separate writer task
+// flushes full blocks to the card through the SD I/O scheduler. Acquisition therefore never
+// blocks on the card, and card stalls (e.g. a concurrent download) are absorbed by the blocks.
+
+#ifndef LOG_WRITER_H_
+#define LOG_WRITER_H_
+
+#include <stdio.h>     // For FILE
+#include <stddef.h>    // For size_t
+#include <stdint.h>    // For fixed width integer types
+#include "esp_err.h"   // For esp_err_t
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates the block pool and starts the writer task.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the pool or task could not be created.
+ */
+esp_err_t log_writer_init(void);
+
+/**
+ * @brief Directs subsequent appends to an open log file.
+ * @param file Open log file. Ownership stays with the caller; close it only after log_writer_stop().
+ * @param path Full path of the file, used to keep the file catalog up to date.
+ */
+void log_writer_start(FILE *file, const char *path);
+
+/**
+ * @brief Appends data to the current block. Never touches the card.
+ * The data is appended as a whole or not at all: if the free blocks cannot hold all of it,
+ * it is dropped and counted. A single append may span several blocks.
+ * @param data Data to append.
+ * @param len Length of the data in bytes.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_NO_MEM if the data was dropped,
+ *         ESP_ERR_INVALID_STATE if no file is active.
+ */
+esp_err_t log_writer_append(const char *data, size_t len);
+
+/**
+ * @brief Writes all buffered data to the card and detaches from the file.
+ * Blocks until the writer task has written every pending block, with a warning every few
+ * seconds on a slow card; when it returns, the writer task no longer uses the file.
+ */
+void log_writer_stop(void);
+
+/**
+ * @brief Returns the number of appends dropped because all blocks were full.
+ */
+uint32_t log_writer_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LOG_WRITER_H_ */
@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/stat.h>
 
 #include "esp_log.h"
 #include "esp_event.h"
@@ -18,16 +21,33 @@
 
 #include "web_server.h"
 #include "settings.h"
+#include "file_catalog.h"
+#include "sd_io.h"
+#include "log_writer.h"
+#include "columnar.h"
+#include "columnar_writer.h"
+#include "adc_bench.h"
+#include "adc_burst.h"
+#include "adc_bus.h"
+#include "ads_bus.h"
+#include "frame_align.h"
+#include "schedule.h"
+#include "session_catalog.h"
+#include "log_control.h"
+#include "live_frame.h"
+#include "flight_recorder.h"
+#include "alarm.h"
+#include "stream_hub.h"
 #include "iot_button.h"
 #include "button_gpio.h"
-#include "ws2812.h"
-#include "driver/rmt.h"
+#include "led_status.h"
 #include "ads1115.h"
 
 // --- Definitions and Constants ---
 
 static const char *TAG = "app_main"; // Tag for ESP logging
 #define MOUNT_POINT "/sdcard"        // Mount point for the SD card
+#define ALARM_LOG_PATH MOUNT_POINT "/alarms.csv" // Alarm state changes, appended across sessions
 
 // Wi-Fi Access Point (AP) configuration
 #define WIFI_SSID "ESP32_SD_AP"
@@ -45,7 +65,7 @@ static const char *TAG = "app_main"; // Tag for ESP logging
 #define I2C_MASTER_SCL_IO 17
 #define I2C_MASTER_SDA_IO 16
 #define I2C_MASTER_NUM I2C_NUM_0
-#define I2C_MASTER_FREQ_HZ 400000 // 400kHz I2C frequency
+#define I2C_MASTER_FREQ_HZ CONFIG_ADS_I2C_CLOCK_HZ // Requested I2C frequency (verified and possibly lowered at startup)
 
 // ADS1115 ADC configuration
 #define ADC1_ADDRESS (0x48)      // ADS1115 ADDR pin to GND
@@ -65,229 +85,566 @@ static const char *TAG = "app_main"; // Tag for ESP logging
 // Logging task parameters
 #define LOGGING_TASK_STACK_SIZE 8192 // Stack size for the ADC logging task
 #define LOGGING_TASK_INTERVAL_MS 10  // Interval between ADC readings in milliseconds
+#define IDLE_TASK_INTERVAL_MS 1000   // Interval between ADC readings while waiting for a scheduled session
+#define LOG_LINE_MAX 224 // Maximum length of one CSV row (timestamp, 8 values and 8 sampling offsets)
+#if CONFIG_LOGGER_COLUMNAR_FORMAT
+#define LOG_FILE_EXTENSION COLUMNAR_EXTENSION // Columnar chunked log files (see columnar.h)
+#else
+#define LOG_FILE_EXTENSION ".csv"
+#endif
 
 
 // --- Global variables for ADS1115 handles ---
 static ads1115_t ads1; // Handle for the first ADS1115 module
 static ads1115_t ads2; // Handle for the second ADS1115 module
+static SemaphoreHandle_t adc_bus_mutex = NULL; // Held while the ADCs are scanned (shared with the self-benchmark)
 
 // Global vars for log file name and its mutex
 #define MAX_LOG_FILE_PATH_LEN 128
+#define MAX_LOG_FILE_INDEX 10000 // Upper bound for the index in log file names
+#define LOG_MIN_VALID_EPOCH 1704067200 // 2024-01-01; an earlier clock has not been set yet
+#define LOG_UNDATED_DIR MOUNT_POINT "/undated" // Date-partitioned logs written before the clock is set
 char g_current_log_filepath[MAX_LOG_FILE_PATH_LEN] = "N/A";
 SemaphoreHandle_t g_log_file_path_mutex = NULL;
 
 
-// --- External Functions (from web_server.c) ---
-extern void set_last_voltages(const float *voltages); // Updates voltages for web server display
-extern bool is_logging_enabled(void);                 // Checks current logging status
-extern void set_logging_active(bool active);          // Sets logging status
-
-
 // --- Callback Functions ---
 
 /**
- * @brief Callback function for the boot button press.
- * Toggles the logging state (active/inactive) and updates the WS2812 LED color.
+ * @brief Callback function for the boot button press (esp_timer task context).
+ * Posts a toggle command; the LED follows when the acquisition task applies it.
  * @param handle Button handle.
  * @param args Additional arguments (not used here).
  */
 static void button_toggle_cb(void *handle, void *args)
 {
-    bool new_state = !is_logging_enabled();
-    set_logging_active(new_state); // Set the new logging state
-    ESP_LOGI(TAG, "Logging state toggled to: %s", new_state ? "ENABLED (ON)" : "DISABLED (OFF)");
+    // Resolved to start or stop by the control plane, in order with all other commands.
+    log_control_post(LOG_CMD_TOGGLE, LOG_SRC_BUTTON, NULL);
 }
 
-// --- Utility Functions ---
+/**
+ * @brief Callback function for the boot button double-click and long press (esp_timer task context).
+ * Posts a marker labelled with the gesture; it is rejected unless a log file is open.
+ * @param handle Button handle.
+ * @param args Marker label.
+ */
+static void button_marker_cb(void *handle, void *args)
+{
+    log_control_post(LOG_CMD_MARKER, LOG_SRC_BUTTON, (const char *)args);
+}
+
+/**
+ * @brief Callback of the schedule engine at the start and end of a scheduled session.
+ * Posting the command wakes the acquisition task, so the log file is opened (or closed)
+ * right at the window boundary instead of after the idle scan interval.
+ * @param active True at the start of a session, false at its end.
+ */
+static void schedule_change_cb(bool active)
+{
+    log_control_post(active ? LOG_CMD_START : LOG_CMD_STOP, LOG_SRC_SCHEDULE, NULL);
+}
 
 /**
- * @brief Gets the current timestamp in milliseconds.
- * @return uint32_t Current time in milliseconds since boot.
+ * @brief Appends one line to the alarm log, creating it with a header if needed.
+ * Runs in the alarm task; alarm changes are rare, so the file is opened for every line. The
+ * line is written as background traffic through the SD I/O scheduler, so it yields to the
+ * log writer like an upload does.
+ * @param line Line without the newline.
  */
-static uint32_t get_timestamp_ms(void) { return xTaskGetTickCount() * portTICK_PERIOD_MS; }
+static void alarm_log_append(const char *line)
+{
+    if (!file_catalog_is_ready())
+        return; // No card
+    FILE *f = fopen(ALARM_LOG_PATH, "a");
+    if (!f)
+    {
+        ESP_LOGE(TAG, "Failed to open %s", ALARM_LOG_PATH);
+        return;
+    }
+    char buf[192];
+    int len = snprintf(buf, sizeof(buf), "%s%s\n", ftell(f) == 0 ? "timestamp;time;channel;from;to;value;limit\n" : "",
+                       line);
+    if (len >= (int)sizeof(buf))
+        len = sizeof(buf) - 1;
+    sd_io_write_background(NULL, buf, (size_t)len, f);
+    file_catalog_upsert(ALARM_LOG_PATH, (uint32_t)ftell(f), time(NULL));
+    fclose(f);
+}
+
+/**
+ * @brief Alarm engine callback (alarm task): shows the change on the LED and the alarm output,
+ * sends it to the live event streams and appends it to the alarm log.
+ */
+static void alarm_event_cb(const alarm_event_t *ev)
+{
+    bool active = ev->active_mask != 0;
+    led_status_set_fault(LED_PATTERN_ALARM, active);
+#if CONFIG_LOGGER_ALARM_GPIO >= 0
+    gpio_set_level(CONFIG_LOGGER_ALARM_GPIO, active ? 1 : 0);
+#endif
+
+    // timestamp as in the log files (ms since boot), time as wall clock (0 until the clock is set)
+    char line[128];
+    snprintf(line, sizeof(line), "%lu;%lld;%u;%s;%s;%.6f;%.6f", (unsigned long)(ev->frame_us / 1000),
+             (long long)time(NULL), ev->channel, alarm_state_name(ev->previous), alarm_state_name(ev->state),
+             ev->value, ev->limit);
+    stream_hub_post_event("alarm", line);
+    flight_recorder_event("alarm ch%u %s -> %s (%.4f)", ev->channel, alarm_state_name(ev->previous),
+                          alarm_state_name(ev->state), ev->value);
+    alarm_log_append(line);
+}
+
+// --- Utility Functions ---
 
 /**
- * @brief Logs ADC values to a file on the SD card in CSV format.
- * @param file Pointer to the opened file.
- * @param timestamp Timestamp for the log entry.
+ * @brief Formats ADC values as a CSV row and hands it to the buffered log writer.
+ * The row is written to the SD card later by the writer task.
+ * The timestamp is the sampling instant of channel 0 in milliseconds since boot. Without
+ * channel alignment, the row also carries the sampling delay of every channel after channel 0.
+ * With the columnar format, the frame is added to the current chunk instead (without the offsets).
+ * @param frame_us Sampling instant of channel 0 (esp_timer time, microseconds).
+ * @param sample_us Sampling instant of each value.
  * @param values Array of ADC float values.
  * @param count Number of values in the array.
- * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if parameters are invalid.
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if parameters are invalid,
+ *         or the error returned by log_writer_append().
  */
-static esp_err_t log_adc_to_sd(FILE *file, uint32_t timestamp, float *values, size_t count)
+static esp_err_t log_adc_to_sd(int64_t frame_us, const int64_t *sample_us, const float *values, size_t count)
 {
-    if (!file || !values)
+    if (!values || !sample_us)
         return ESP_ERR_INVALID_ARG;
 
+#if CONFIG_LOGGER_COLUMNAR_FORMAT
+    return columnar_writer_add((uint32_t)(frame_us / 1000), values, count);
+#else
+    char line[LOG_LINE_MAX];
     // Write timestamp
-    fprintf(file, "%lu", (unsigned long)timestamp);
+    int len = snprintf(line, sizeof(line), "%lu", (unsigned long)(frame_us / 1000));
     // Write each ADC value separated by semicolon
-    for (size_t i = 0; i < count; i++)
+    for (size_t i = 0; i < count && len < (int)sizeof(line); i++)
+    {
+        len += snprintf(line + len, sizeof(line) - len, ";%.6f", values[i]);
+    }
+    if (!frame_align_is_enabled())
+    {
+        // Per-channel sampling offsets, so the skew can be corrected offline.
+        for (size_t i = 0; i < count && len < (int)sizeof(line); i++)
+        {
+            len += snprintf(line + len, sizeof(line) - len, ";%ld", (long)(sample_us[i] - frame_us));
+        }
+    }
+    if (len >= (int)sizeof(line) - 1)
+        return ESP_ERR_INVALID_SIZE;
+    line[len++] = '\n'; // Newline for the next log entry
+    return log_writer_append(line, len);
+#endif
+}
+
+/**
+ * @brief Creates a directory and all of its missing parents (like `mkdir -p`).
+ * @param path Full path of the directory to create.
+ * @return esp_err_t ESP_OK if the directory exists afterwards, ESP_FAIL otherwise.
+ */
+static esp_err_t make_dirs(const char *path)
+{
+    char tmp[MAX_LOG_FILE_PATH_LEN];
+    strncpy(tmp, path, sizeof(tmp) - 1);
+    tmp[sizeof(tmp) - 1] = '\0';
+
+    // Start after the mount point, which always exists.
+    for (char *p = tmp + strlen(MOUNT_POINT) + 1; *p; p++)
     {
-        fprintf(file, ";%.6f", values[i]);
+        if (*p == '/')
+        {
+            *p = '\0';
+            if (mkdir(tmp, 0775) != 0 && errno != EEXIST)
+            {
+                ESP_LOGE(TAG, "Failed to create directory %s (%s)", tmp, strerror(errno));
+                return ESP_FAIL;
+            }
+            *p = '/';
+        }
+    }
+    if (mkdir(tmp, 0775) != 0 && errno != EEXIST)
+    {
+        ESP_LOGE(TAG, "Failed to create directory %s (%s)", tmp, strerror(errno));
+        return ESP_FAIL;
     }
-    fprintf(file, "\n"); // Newline for the next log entry
-    fflush(file); // Flush immediately
     return ESP_OK;
 }
 
 /**
- * @brief Opens the next available log file on the SD card (e.g., log_1.csv, log_2.csv).
- * Adds a CSV header to the new file.
+ * @brief Builds the directory and file name stem for the next log file.
+ * With the date-partitioned layout, files go to MOUNT_POINT/YYYY/MM/DD/session_N.csv so that
+ * no single FAT directory grows large; otherwise they go to MOUNT_POINT/log_N.csv. Until the
+ * clock has been set, a date would be meaningless (1970/01/01), so such logs go to
+ * LOG_UNDATED_DIR instead.
+ * @param dir Buffer receiving the directory (full path).
+ * @param dir_len Length of the dir buffer.
+ * @return const char* File name stem placed before the index.
+ */
+static const char *log_file_location(char *dir, size_t dir_len)
+{
+#if CONFIG_LOGGER_DATE_PARTITIONED_LAYOUT
+    time_t now = time(NULL);
+    if (now < LOG_MIN_VALID_EPOCH)
+    {
+        snprintf(dir, dir_len, LOG_UNDATED_DIR);
+        return "session_";
+    }
+    struct tm tm_now;
+    localtime_r(&now, &tm_now);
+    snprintf(dir, dir_len, MOUNT_POINT "/%04d/%02d/%02d",
+             tm_now.tm_year + 1900, tm_now.tm_mon + 1, tm_now.tm_mday);
+    return "session_";
+#else
+    snprintf(dir, dir_len, MOUNT_POINT);
+    return "log_";
+#endif
+}
+
+/**
+ * @brief Opens the next available log file on the SD card (e.g., log_1.csv, log_2.csv,
+ * or 2025/06/30/session_1.csv with the date-partitioned layout).
+ * The next index is taken from the file catalog, so the card is not probed with fopen()
+ * for every existing file. Adds a CSV header (or, with the columnar format, the file header)
+ * to the new file.
  * @param out_path Buffer to store the full path of the opened file.
  * @param path_len Length of the out_path buffer.
  * @return FILE* Pointer to the opened file, or NULL if unable to open.
  */
 static FILE *open_next_log_file(char *out_path, size_t path_len)
 {
-    for (int i = 1; i < 1000; ++i)
+    char dir[MAX_LOG_FILE_PATH_LEN];
+    const char *stem = log_file_location(dir, sizeof(dir));
+
+    if (strcmp(dir, MOUNT_POINT) != 0 && make_dirs(dir) != ESP_OK)
     {
-        snprintf(out_path, path_len, MOUNT_POINT "/log_%d.csv", i);
-        FILE *test = fopen(out_path, "r"); // Try to open for reading to check existence
-        if (!test)
-        { // If file does not exist, open for writing
-            FILE *f = fopen(out_path, "w");
-            if (f)
-            {
-                // Write CSV header
-                fprintf(f, "timestamp;adc0;adc1;adc2;adc3;adc4;adc5;adc6;adc7\n");
-                fflush(f); // Flush header immediately
-                // NOVO: Pohrani ime datoteke u globalnu varijablu uz mutex zaštitu
-                if (g_log_file_path_mutex && xSemaphoreTake(g_log_file_path_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { // Increased timeout slightly
-                    strncpy(g_current_log_filepath, out_path, MAX_LOG_FILE_PATH_LEN - 1);
-                    g_current_log_filepath[MAX_LOG_FILE_PATH_LEN - 1] = '\0';
-                    xSemaphoreGive(g_log_file_path_mutex);
-                } else {
-                    ESP_LOGE(TAG, "Failed to acquire mutex or mutex not created for log file path in open_next_log_file!");
-                }
-                return f;
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Failed to open new log file: %s", out_path);
-                return NULL;
-            }
+        return NULL;
+    }
+
+    int index = file_catalog_is_ready() ? file_catalog_max_index(dir, stem) + 1 : 1;
+    for (; index > 0 && index < MAX_LOG_FILE_INDEX; ++index)
+    {
+        snprintf(out_path, path_len, "%s/%s%d" LOG_FILE_EXTENSION, dir, stem, index);
+        // The catalog already points past the last known file; the stat() only guards
+        // against files copied to the card since the last scan.
+        struct stat st;
+        if (stat(out_path, &st) == 0)
+        {
+            continue;
         }
-        else
+
+        FILE *f = fopen(out_path, "w");
+        if (!f)
         {
-            fclose(test); // Close the test file handle
+            ESP_LOGE(TAG, "Failed to open new log file: %s", out_path);
+            return NULL;
         }
+#if CONFIG_LOGGER_COLUMNAR_FORMAT
+        // Write the columnar file header
+        if (columnar_writer_begin(f, out_path) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "Failed to write header of log file: %s", out_path);
+            fclose(f);
+            return NULL;
+        }
+#else
+        // Write CSV header
+        fprintf(f, "timestamp;adc0;adc1;adc2;adc3;adc4;adc5;adc6;adc7%s\n",
+                frame_align_is_enabled() ? "" : ";dt0_us;dt1_us;dt2_us;dt3_us;dt4_us;dt5_us;dt6_us;dt7_us");
+#endif
+        fflush(f); // Flush header immediately
+        file_catalog_upsert(out_path, (uint32_t)ftell(f), time(NULL)); // Make the new file visible in /list
+        // NOVO: Pohrani ime datoteke u globalnu varijablu uz mutex zaštitu
+        if (g_log_file_path_mutex && xSemaphoreTake(g_log_file_path_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { // Increased timeout slightly
+            strncpy(g_current_log_filepath, out_path, MAX_LOG_FILE_PATH_LEN - 1);
+            g_current_log_filepath[MAX_LOG_FILE_PATH_LEN - 1] = '\0';
+            xSemaphoreGive(g_log_file_path_mutex);
+        } else {
+            ESP_LOGE(TAG, "Failed to acquire mutex or mutex not created for log file path in open_next_log_file!");
+        }
+        return f;
     }
     ESP_LOGE(TAG, "No available name for log file found!");
     return NULL;
 }
 
+/**
+ * @brief Runs one single-shot conversion on an ADS1115.
+ * PGA and data rate come from the driver's cached config register (kept up to date by
+ * ads1115_set_pga/ads1115_set_sps); the conversion itself uses ads_bus_convert(), which waits
+ * for the datasheet conversion time on a microsecond timer instead of the driver's tick-based wait.
+ * @param ads ADS1115 handle.
+ * @param mux Input to convert.
+ * @param raw Receives the raw conversion result.
+ * @return esp_err_t ESP_OK on success, or the conversion error.
+ */
+static esp_err_t read_channel(ads1115_t *ads, ads1115_mux_t mux, int16_t *raw)
+{
+    // ads1115_mux_t values are the config register MUX field values.
+    return ads_bus_convert(ads->i2c_port, ads->address, ads->config.reg, (uint8_t)mux, raw);
+}
+
+/**
+ * @brief Reads all 8 channels from both ADS1115 modules and applies the scaling factors.
+ * Holds the ADC bus mutex for the whole scan, so the self-benchmark can take the bus over
+ * between two scans. Each value is timestamped at the middle of its conversion.
+ * @param final_values Array receiving the 8 scaled values.
+ * @param sample_us Array receiving the sampling instant of each value (microseconds since boot).
+ * @param configs Channel configurations with the scaling factors.
+ * @return esp_err_t ESP_OK on success, ESP_FAIL if a conversion failed.
+ */
+static esp_err_t read_all_channels(float *final_values, int64_t *sample_us, const channel_config_t *configs)
+{
+    // ADC multiplexer configurations for single-ended readings
+    static const ads1115_mux_t channels[] = {
+        ADS1115_MUX_0_GND,
+        ADS1115_MUX_1_GND,
+        ADS1115_MUX_2_GND,
+        ADS1115_MUX_3_GND};
+    esp_err_t ret = ESP_OK;
+    int16_t raw_adc; // Raw ADC reading
+
+    xSemaphoreTake(adc_bus_mutex, portMAX_DELAY);
+
+    // Read 4 channels from the first ADS1115 (ADC1)
+    for (int i = 0; i < 4; i++)
+    {
+        int64_t t_start = esp_timer_get_time();
+        if (read_channel(&ads1, channels[i], &raw_adc) == ESP_OK) // Check for valid reading
+        {
+            sample_us[i] = t_start + (esp_timer_get_time() - t_start) / 2;
+
+            // Convert raw ADC value to voltage
+            float raw_voltage = (float)raw_adc * VOLTS_PER_BIT;
+
+            // Apply scaling factor from the settings for this specific channel
+            final_values[i] = raw_voltage * configs[i].scaling_factor;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Error reading ADC1 (0x%02X), channel %d", ads1.address, i);
+            ret = ESP_FAIL;
+            goto done;
+        }
+    }
+
+    // Read 4 channels from the second ADS1115 (ADC2)
+    for (int i = 0; i < 4; i++)
+    {
+        int64_t t_start = esp_timer_get_time();
+        if (read_channel(&ads2, channels[i], &raw_adc) == ESP_OK) // Check for valid reading
+        {
+            sample_us[i + 4] = t_start + (esp_timer_get_time() - t_start) / 2;
+
+            // Convert raw ADC value to voltage
+            float raw_voltage = (float)raw_adc * VOLTS_PER_BIT;
+
+            // Apply scaling factor from settings. Note index offset for ADC2 channels.
+            final_values[i + 4] = raw_voltage * configs[i + 4].scaling_factor;
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Error reading ADC2 (0x%02X), channel %d", ads2.address, i);
+            ret = ESP_FAIL;
+            goto done;
+        }
+    }
+
+done:
+    xSemaphoreGive(adc_bus_mutex);
+    return ret;
+}
+
+// --- Log File Actions (run by the control plane in the acquisition task) ---
+
+static FILE *log_file = NULL;                          // Current log file, NULL while not logging
+static char log_path[MAX_LOG_FILE_PATH_LEN];           // Path of the current log file
+static session_summary_t summary;                      // Statistics of the running session
+static double sums[NUM_CHANNELS];                      // Per-channel sums for the session means
+
+/**
+ * @brief Opens a new log file and starts a session on it.
+ * @return esp_err_t ESP_OK if logging can begin, ESP_FAIL if no file could be opened.
+ */
+static esp_err_t log_file_open(void)
+{
+    log_file = open_next_log_file(log_path, sizeof(log_path));
+    if (!log_file)
+    {
+        return ESP_FAIL;
+    }
+    log_writer_start(log_file, log_path); // Rows are written by the log writer task from now on
+    session_catalog_open(log_path);
+    memset(&summary, 0, sizeof(summary));
+    memset(sums, 0, sizeof(sums));
+    ESP_LOGI(TAG, "Log datoteka otvorena: %s", log_path);
+    flight_recorder_event("open %s", log_path);
+    led_status_set_mode(LED_MODE_LOGGING); // Indicate logging is active with green LED
+    return ESP_OK;
+}
+
+/**
+ * @brief Writes out all buffered rows, closes the log file and ends its session.
+ */
+static void log_file_close(void)
+{
+    if (!log_file)
+    {
+        return;
+    }
+    columnar_writer_flush(); // Hand over the last partial chunk (columnar format only)
+    log_writer_stop(); // Write out all buffered rows; the writer task is done with the file after this
+    columnar_writer_end(); // Save the chunk directory (columnar format only)
+    file_catalog_upsert(log_path, (uint32_t)ftell(log_file), time(NULL)); // Publish the final size
+    summary.bytes = (uint32_t)ftell(log_file);
+    for (int i = 0; i < NUM_CHANNELS; i++)
+    {
+        summary.mean[i] = summary.rows ? (float)(sums[i] / summary.rows) : 0.0f;
+    }
+    session_catalog_close(&summary);
+    fclose(log_file);
+    log_file = NULL;
+    ESP_LOGI(TAG, "Log datoteka zatvorena: %s", log_path);
+    flight_recorder_event("close (%lu rows)", (unsigned long)summary.rows);
+    // NOVO: Postavi ime datoteke na "N/A" u globalnoj varijabli uz mutex zaštitu
+    if (g_log_file_path_mutex && xSemaphoreTake(g_log_file_path_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { // Increased timeout slightly
+        strncpy(g_current_log_filepath, "N/A", MAX_LOG_FILE_PATH_LEN - 1);
+        g_current_log_filepath[MAX_LOG_FILE_PATH_LEN - 1] = '\0';
+        xSemaphoreGive(g_log_file_path_mutex);
+    }
+    led_status_set_mode(LED_MODE_STOPPED); // Indicate logging is inactive with red LED
+}
+
+/**
+ * @brief Records a marker for the running log.
+ * Runs between two frames, so the marker is placed exactly before the next frame. It is recorded
+ * in the session catalog only, with the number of rows before it and the sequence number of the
+ * frame after it; the log file itself stays plain data that any CSV reader accepts.
+ * @param text Marker label.
+ * @param posted_us Time the marker was requested (esp_timer time).
+ */
+static void log_file_marker(const char *text, int64_t posted_us)
+{
+    uint32_t ms = (uint32_t)(posted_us / 1000);
+    uint32_t frame = live_frame_latest() + 1;
+
+    session_catalog_add_marker(ms, summary.rows, frame, text);
+    flight_recorder_event("marker %s", text);
+    ESP_LOGI(TAG, "Marker at %lu ms (frame %lu, row %lu) in %s: %s", (unsigned long)ms, (unsigned long)frame,
+             (unsigned long)summary.rows, log_path, text);
+}
+
+/**
+ * @brief Logging may only start while the ADCs are not taken over by the self-benchmark or a burst.
+ */
+static bool log_start_allowed(void)
+{
+    return !adc_bench_is_running() && !adc_burst_is_running();
+}
+
+/**
+ * @brief A start that never opened a log file drops the session prepared for it (tags, note).
+ */
+static void log_start_aborted(void)
+{
+    session_catalog_cancel_pending();
+}
+
+static const log_control_ops_t log_ops = {
+    .open = log_file_open,
+    .close = log_file_close,
+    .marker = log_file_marker,
+    .start_allowed = log_start_allowed,
+    .start_aborted = log_start_aborted,
+};
+
 // --- Main Tasks ---
 
 /**
  * @brief FreeRTOS task for reading ADS1115 data and logging it.
  * This task continuously reads from both ADS1115 modules, applies scaling factors
  * from settings, updates values for the web server, and logs them to an SD card
- * if logging is enabled.
+ * while the control plane is in the logging state. Logging commands are applied here,
+ * between scans, by log_control_process().
  * @param pvParam Task parameters (not used).
  */
 static void ads1115_log_task(void *pvParam)
 {
     float final_values[NUM_CHANNELS] = {0}; // Array for scaled ADC values
-    char log_path[MAX_LOG_FILE_PATH_LEN];                     // Buffer for log file path
-    FILE *file = NULL;                      // File pointer for the current log file
-
-    // ADC multiplexer configurations for single-ended readings
-    ads1115_mux_t channels[] = {
-        ADS1115_MUX_0_GND,
-        ADS1115_MUX_1_GND,
-        ADS1115_MUX_2_GND,
-        ADS1115_MUX_3_GND};
+    int64_t sample_us[NUM_CHANNELS] = {0};  // Sampling instant of each value
+    bool idle = false;                      // True while waiting for a scheduled session
+    bool read_failed = false;               // True while the ADC scans fail
 
     // Get a pointer to the channel configurations from the settings module.
     // This pointer is valid throughout the task's lifetime as settings data is in RAM.
     const channel_config_t *configs = settings_get_channel_configs();
+    log_control_attach(); // Commands wake this task
 
     while (1)
     {
-        int16_t raw_adc; // Raw ADC reading
+        // Apply pending start/stop/rotate commands; a single atomic load when there are none.
+        log_state_t state = log_control_process();
 
-        // Read 4 channels from the first ADS1115 (ADC1)
-        for (int i = 0; i < 4; i++)
+        if (read_all_channels(final_values, sample_us, configs) != ESP_OK)
         {
-            ads1115_set_mux(&ads1, channels[i]);
-            raw_adc = ads1115_get_raw(&ads1);
-            if (raw_adc > -32768) // Check for valid reading (not default error value)
-            {
-                // Convert raw ADC value to voltage
-                float raw_voltage = (float)raw_adc * VOLTS_PER_BIT;
-
-                // Apply scaling factor from the settings for this specific channel
-                final_values[i] = raw_voltage * configs[i].scaling_factor;
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Error reading ADC1 (0x%02X), channel %d", ads1.address, i);
-                goto read_error_cycle; // Jump to error handling
-            }
+            frame_align_reset(); // Do not interpolate across the failed scan
+            if (!read_failed)
+                flight_recorder_event("ADC scan failed");
+            read_failed = true;
+            led_status_set_fault(LED_PATTERN_I2C_FAULT, true);
+            goto read_error_cycle; // Jump to error handling
         }
+        led_status_set_fault(LED_PATTERN_I2C_FAULT, false); // Only posts when the fault clears
+        read_failed = false;
 
-        // Read 4 channels from the second ADS1115 (ADC2)
-        for (int i = 0; i < 4; i++)
-        {
-            ads1115_set_mux(&ads2, channels[i]);
-            raw_adc = ads1115_get_raw(&ads2);
-            if (raw_adc > -32768) // Check for valid reading
-            {
-                // Convert raw ADC value to voltage
-                float raw_voltage = (float)raw_adc * VOLTS_PER_BIT;
+        // Interpolate the channels to the instant of channel 0 (if enabled) and record the skew
+        int64_t frame_us = frame_align_process(sample_us, final_values, NUM_CHANNELS);
 
-                // Apply scaling factor from settings. Note index offset for ADC2 channels.
-                final_values[i + 4] = raw_voltage * configs[i + 4].scaling_factor;
-            }
-            else
-            {
-                ESP_LOGE(TAG, "Error reading ADC2 (0x%02X), channel %d", ads2.address, i);
-                goto read_error_cycle; // Jump to error handling
-            }
-        }
+        // Check the alarm limits (a few comparisons per channel; changes are handled by the alarm task)
+        alarm_evaluate(final_values, frame_us);
+
+        // Publish the frame to the web server for display (never blocks)
+        live_frame_publish(final_values, sample_us, frame_us);
 
-        // Pass the final, scaled values to the web server for display
-        set_last_voltages(final_values);
+        // Keep the latest frames in RTC memory for the recovery file after a crash
+        flight_recorder_frame(live_frame_latest(), frame_us, final_values);
 
         // Logic for logging to SD card
-        if (is_logging_enabled())
+        if (state == LOG_STATE_LOGGING)
         {
-            if (!file) // If no log file is currently open
+            esp_err_t log_ret = log_adc_to_sd(frame_us, sample_us, final_values, NUM_CHANNELS); // Log data
+            if (log_ret == ESP_ERR_NO_MEM)
             {
-                file = open_next_log_file(log_path, sizeof(log_path)); // Open a new one
-                if (file)
-                {
-                    ESP_LOGI(TAG, "Log datoteka otvorena: %s", log_path);
-                    ws2812_set_green(); // Indicate logging is active with green LED
-                }
-                else
-                {
-                    ESP_LOGE(TAG, "Could not open new log file, retrying...");
-                    vTaskDelay(pdMS_TO_TICKS(1000)); // Wait longer on file open error
-                    continue;
-                }
+                led_status_signal(LED_PATTERN_OVERRUN); // The card could not keep up, the row was dropped
             }
-            log_adc_to_sd(file, get_timestamp_ms(), final_values, NUM_CHANNELS); // Log data
-        }
-        else // If logging is disabled
-        {
-            if (file) // If a log file was open, close it
+            else if (log_ret == ESP_OK)
             {
-                fclose(file);
-                ESP_LOGI(TAG, "Log datoteka zatvorena: %s", log_path);
-                // NOVO: Postavi ime datoteke na "N/A" u globalnoj varijabli uz mutex zaštitu
-                if (g_log_file_path_mutex && xSemaphoreTake(g_log_file_path_mutex, pdMS_TO_TICKS(100)) == pdTRUE) { // Increased timeout slightly
-                    strncpy(g_current_log_filepath, "N/A", MAX_LOG_FILE_PATH_LEN - 1);
-                    g_current_log_filepath[MAX_LOG_FILE_PATH_LEN - 1] = '\0';
-                    xSemaphoreGive(g_log_file_path_mutex);
+                for (int i = 0; i < NUM_CHANNELS; i++)
+                {
+                    if (summary.rows == 0 || final_values[i] < summary.min[i])
+                        summary.min[i] = final_values[i];
+                    if (summary.rows == 0 || final_values[i] > summary.max[i])
+                        summary.max[i] = final_values[i];
+                    sums[i] += final_values[i];
                 }
-                file = NULL;           // Reset file pointer
-                ws2812_set_red();      // Indicate logging is inactive with red LED
+                summary.rows++;
             }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(LOGGING_TASK_INTERVAL_MS)); // Delay for the specified interval
+        // Outside of scheduled sessions, scan slowly (live view only); the schedule wakes the task
+        // at the next window start.
+        bool now_idle = state == LOG_STATE_IDLE && schedule_is_idle();
+        if (now_idle != idle)
+        {
+            idle = now_idle;
+            if (idle)
+                led_status_set_mode(LED_MODE_WAITING); // Waiting for the next scheduled session
+            else if (state == LOG_STATE_IDLE)
+                led_status_set_mode(LED_MODE_STOPPED);
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(idle ? IDLE_TASK_INTERVAL_MS : LOGGING_TASK_INTERVAL_MS));
         continue; // Continue to next loop iteration
 
     read_error_cycle:
@@ -296,13 +653,23 @@ static void ads1115_log_task(void *pvParam)
     }
 
     // Clean up if task exits (though it's an infinite loop)
-    if (file)
-        fclose(file);
+    log_file_close();
     vTaskDelete(NULL);
 }
 
 // --- Initialization Functions ---
 
+/**
+ * @brief Wi-Fi event handler; signals on the LED when a client joins the access point.
+ */
+static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED)
+    {
+        led_status_signal(LED_PATTERN_CLIENT_CONNECTED);
+    }
+}
+
 /**
  * @brief Initializes the ESP32 as a Wi-Fi Access Point (AP).
  * @return esp_err_t ESP_OK on success, error code otherwise.
@@ -314,6 +681,7 @@ static esp_err_t wifi_init_softap(void)
     esp_netif_create_default_wifi_ap();
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, WIFI_EVENT_AP_STACONNECTED, wifi_event_handler, NULL));
     wifi_config_t wifi_config = {
         .ap = {
             .ssid = WIFI_SSID,
@@ -402,8 +770,12 @@ static void init_button(void)
     button_handle_t btn;
     ESP_ERROR_CHECK(iot_button_new_gpio_device(&btn_cfg, &gpio_cfg, &btn));
 
-    // Register button callback for press-up event to toggle logging.
-    ESP_ERROR_CHECK(iot_button_register_cb(btn, BUTTON_PRESS_UP, NULL, button_toggle_cb, NULL));
+    // A single click toggles logging. It is reported only once the double-click window has
+    // passed, so a double-click sets a marker without also toggling logging twice.
+    ESP_ERROR_CHECK(iot_button_register_cb(btn, BUTTON_SINGLE_CLICK, NULL, button_toggle_cb, NULL));
+    // Double-click and long press set a marker in the running log.
+    ESP_ERROR_CHECK(iot_button_register_cb(btn, BUTTON_DOUBLE_CLICK, NULL, button_marker_cb, (void *)"double-click"));
+    ESP_ERROR_CHECK(iot_button_register_cb(btn, BUTTON_LONG_PRESS_START, NULL, button_marker_cb, (void *)"long-press"));
 
     ESP_LOGI(TAG, "Button initialized on GPIO%d.", BOOT_BUTTON_NUM);
 }
@@ -430,8 +802,9 @@ static esp_err_t i2c_master_init(void)
 // --- Main Application Entry Point ---
 void app_main(void)
 {
-    ws2812_init();
-    ws2812_set_blue();
+    flight_recorder_init(); // Keep what the previous run left in RTC memory, then start recording
+    ESP_ERROR_CHECK(led_status_init()); // LED task; blue while starting up
+    ESP_ERROR_CHECK(log_control_init(&log_ops)); // Logging commands can be posted from here on
 
     ESP_ERROR_CHECK(nvs_flash_init());
     settings_init(); // Initialize settings module and load stored settings
@@ -450,6 +823,23 @@ void app_main(void)
     {
         ESP_LOGE(TAG, "SD card not mounted. Logging to card will not work.");
     }
+    else if (file_catalog_init(MOUNT_POINT) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to build the SD card file catalog.");
+    }
+    else if (session_catalog_init(MOUNT_POINT) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to load the session catalog.");
+    }
+    // After a crash, write the frames and events of the previous run out before logging resumes.
+    flight_recorder_flush(MOUNT_POINT);
+
+    // The scheduler and the buffered writer keep log writes ahead of web transfers on the SD bus.
+    ESP_ERROR_CHECK(sd_io_init());
+    ESP_ERROR_CHECK(log_writer_init());
+#if CONFIG_LOGGER_COLUMNAR_FORMAT
+    ESP_ERROR_CHECK(columnar_writer_init());
+#endif
 
     ESP_LOGI(TAG, "Initializing I2C for ADS1115...");
     ESP_ERROR_CHECK(i2c_master_init()); // Initialize I2C bus
@@ -459,6 +849,8 @@ void app_main(void)
     ads1 = ads1115_config(I2C_MASTER_NUM, ADC1_ADDRESS);
     ads2 = ads1115_config(I2C_MASTER_NUM, ADC2_ADDRESS);
 
+    // Conversions are done by ads_bus_convert() with a microsecond-timed wait;
+    // max_ticks only bounds the driver's own transfers.
     ads1115_set_max_ticks(&ads1, pdMS_TO_TICKS(50)); // Povećaj timeout na 50ms
     ads1115_set_max_ticks(&ads2, pdMS_TO_TICKS(50)); // Povećaj timeout na 50ms
 
@@ -469,21 +861,67 @@ void app_main(void)
     ads1115_set_pga(&ads2, ADC_GAIN);
     ads1115_set_sps(&ads2, ADC_DATA_RATE);
 
+    // Verify the requested I2C clock with register readback and fall back to a slower one if needed.
+    const uint8_t adc_addresses[] = {ADC1_ADDRESS, ADC2_ADDRESS};
+    if (ads_bus_negotiate(I2C_MASTER_NUM, I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO, I2C_MASTER_FREQ_HZ,
+                          adc_addresses, sizeof(adc_addresses)) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "ADS1115 I2C bus verification failed, readings may be unreliable.");
+    }
+    ads_bus_info_t bus_info;
+    ads_bus_get_info(&bus_info);
+
+    adc_bus_mutex = xSemaphoreCreateMutex();
+    if (adc_bus_mutex == NULL)
+    {
+        ESP_LOGE(TAG, "Failed to create ADC bus mutex!");
+        return;
+    }
+    adc_bus_t adc_bus = {
+        .adc1 = &ads1,
+        .adc2 = &ads2,
+        .bus_mutex = adc_bus_mutex,
+        .port = I2C_MASTER_NUM,
+        .sda_io = I2C_MASTER_SDA_IO,
+        .scl_io = I2C_MASTER_SCL_IO,
+        .clk_hz = bus_info.active_hz,
+        .pga = ADC_GAIN,
+        .sps = ADC_DATA_RATE,
+        .rdy_gpio = {CONFIG_ADS1_RDY_GPIO, CONFIG_ADS2_RDY_GPIO},
+    };
+    adc_bench_init(&adc_bus);
+    adc_burst_init(&adc_bus);
+
     ESP_LOGI(TAG, "Starting Web server...");
     ESP_ERROR_CHECK(start_webserver()); // Start the HTTP web server
 
     init_button(); // Initialize the user button
 
-    // Set initial logging state based on NVS settings and update LED
+#if CONFIG_LOGGER_ALARM_GPIO >= 0
+    gpio_config_t alarm_gpio = {
+        .pin_bit_mask = 1ULL << CONFIG_LOGGER_ALARM_GPIO,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&alarm_gpio);
+    gpio_set_level(CONFIG_LOGGER_ALARM_GPIO, 0);
+#endif
+    // Alarm limits from NVS; state changes go to the LED, the alarm output, the live streams and the card.
+    if (alarm_init(alarm_event_cb) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start the alarm engine");
+    }
+
+    // Set initial logging state based on NVS settings; the LED turns green once the file is open
     if (settings_get_log_on_boot())
     {
-        set_logging_active(true);
-        ws2812_set_green(); // Green LED if logging is enabled on boot
+        log_control_post(LOG_CMD_START, LOG_SRC_BOOT, NULL);
     }
     else
     {
-        set_logging_active(false);
-        ws2812_set_red(); // Red LED if logging is disabled on boot
+        led_status_set_mode(LED_MODE_STOPPED); // Red LED if logging is disabled on boot
         // NOVO: Postavi na N/A ako nije aktivno pri bootu
         if (g_log_file_path_mutex && xSemaphoreTake(g_log_file_path_mutex, pdMS_TO_TICKS(100)) == pdTRUE) {
             strncpy(g_current_log_filepath, "N/A", MAX_LOG_FILE_PATH_LEN - 1);
@@ -496,4 +934,10 @@ void app_main(void)
 
     // Create and start the FreeRTOS task for ADS1115 data logging
     xTaskCreate(&ads1115_log_task, "ads1115_log_task", LOGGING_TASK_STACK_SIZE, NULL, 5, NULL);
+
+    // Start the schedule engine last; if the device boots inside a window, the session starts now.
+    if (schedule_init(schedule_change_cb) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Failed to start the logging schedule");
+    }
 }
\ No newline at end of file
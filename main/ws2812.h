@@ -9,12 +9,22 @@
 
 /**
  * @brief Initializes the WS2812 LED driver.
- * Configures the ESP32's RMT (Remote Control) peripheral to generate the
+ * Configures an RMT (Remote Control) TX channel and encoder to generate the
  * precise timing signals required by WS2812 LEDs. This function must be
  * called once before using any other WS2812 functions.
  */
 void ws2812_init(void);
 
+/**
+ * @brief Sets the WS2812 LED to an arbitrary color.
+ * The frame is queued to the RMT peripheral; the call does not wait for the transmission.
+ * Not thread-safe: all colors should be set from one task (the LED status service).
+ * @param red Red component value (0-255).
+ * @param green Green component value (0-255).
+ * @param blue Blue component value (0-255).
+ */
+void ws2812_set_rgb(uint8_t red, uint8_t green, uint8_t blue);
+
 /**
  * @brief Sets the WS2812 LED to a predefined red color.
  */
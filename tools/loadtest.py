@@ -0,0 +1,306 @@
+#!/usr/bin/env python3
+# loadtest.py
+# HTTP load generator for the ESP32 ADS1115 logger.
+# Simulates a number of clients, each replaying what a browser or script does against the
+# device (live view polling, file list, downloads, uploads), and reports the throughput and
+# latency percentiles per endpoint. The acquisition jitter measured by the device itself over
+# the same period is read from /api/adc/timing and reported alongside.
+# Only the Python standard library is used.
+#
+# Examples:
+#   python3 tools/loadtest.py --host 192.168.4.1 --duration 60 --mix live=4,list=1
+#   python3 tools/loadtest.py --mix live=2,download=2,upload=1 --file log_3.csv --json result.json
+
+import argparse
+import http.client
+import json
+import math
+import random
+import re
+import socket
+import sys
+import threading
+import time
+import urllib.parse
+
+# Client behaviours: name -> description (shown by --help).
+BEHAVIOURS = {
+    "live": "logging page: /adc and /log_status every 0.5 s",
+    "list": "file manager: /list every 5 s",
+    "download": "downloads a log file back to back (--file, or the first file in /list)",
+    "upload": "uploads a file (--upload-kb) and deletes it again, back to back",
+}
+
+LIVE_INTERVAL_S = 0.5   # Same as setInterval() in logging.html.
+LIST_INTERVAL_S = 5.0
+READ_CHUNK = 16384
+
+
+class Recorder:
+    """Collects latency samples and byte counts per endpoint, shared by all clients."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.samples = {}    # endpoint -> list of latencies in seconds
+        self.errors = {}     # endpoint -> error count
+        self.bytes = {}      # endpoint -> bytes received and sent
+        self.frame_ages = [] # age_ms reported by /adc
+        self.seq_repeats = 0 # /adc answers that returned the same frame as the previous poll
+
+    def ok(self, endpoint, latency, nbytes):
+        with self.lock:
+            self.samples.setdefault(endpoint, []).append(latency)
+            self.bytes[endpoint] = self.bytes.get(endpoint, 0) + nbytes
+
+    def error(self, endpoint):
+        with self.lock:
+            self.errors[endpoint] = self.errors.get(endpoint, 0) + 1
+
+    def frame(self, age_ms, repeated):
+        with self.lock:
+            if age_ms is not None:
+                self.frame_ages.append(age_ms)
+            if repeated:
+                self.seq_repeats += 1
+
+
+def percentile(sorted_values, p):
+    """Nearest-rank percentile of an already sorted list."""
+    if not sorted_values:
+        return 0.0
+    rank = max(1, math.ceil(p / 100.0 * len(sorted_values)))
+    return sorted_values[rank - 1]
+
+
+class Client(threading.Thread):
+    """One simulated client with a persistent connection (like a browser tab)."""
+
+    def __init__(self, args, behaviour, index, recorder, stop):
+        super().__init__(daemon=True)
+        self.args = args
+        self.behaviour = behaviour
+        self.index = index
+        self.rec = recorder
+        self.stop = stop
+        self.conn = None
+        self.last_seq = None
+        self.uploads = 0
+
+    def connect(self):
+        if self.conn is None:
+            self.conn = http.client.HTTPConnection(self.args.host, self.args.port, timeout=self.args.timeout)
+            self.conn.connect()
+            # Headers and body go out as separate writes; without this, Nagle's algorithm and the
+            # delayed ACK of the peer add ~40 ms to every upload and distort the measurement.
+            self.conn.sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        return self.conn
+
+    def request(self, endpoint, method, path, body=None, headers=None):
+        """Sends one request and reads the whole response. Returns the body or None on error."""
+        start = time.perf_counter()
+        try:
+            conn = self.connect()
+            conn.request(method, path, body=body, headers=headers or {})
+            resp = conn.getresponse()
+            data = bytearray()
+            while True:
+                chunk = resp.read(READ_CHUNK)
+                if not chunk:
+                    break
+                data += chunk
+            latency = time.perf_counter() - start
+            if resp.status >= 400:
+                self.rec.error(endpoint)
+                return None
+            if resp.getheader("Connection", "").lower() == "close":
+                self.close()
+            self.rec.ok(endpoint, latency, len(data) + (len(body) if body else 0))
+            return bytes(data)
+        except (OSError, http.client.HTTPException):
+            self.rec.error(endpoint)
+            self.close()
+            return None
+
+    def close(self):
+        if self.conn is not None:
+            self.conn.close()
+            self.conn = None
+
+    def pace(self, started, interval):
+        delay = interval - (time.perf_counter() - started)
+        if delay > 0:
+            self.stop.wait(delay)
+
+    def run_live(self):
+        while not self.stop.is_set():
+            started = time.perf_counter()
+            body = self.request("/adc", "GET", "/adc")
+            if body is not None:
+                try:
+                    frame = json.loads(body)
+                    seq = frame.get("seq")
+                    self.rec.frame(frame.get("age_ms"), seq is not None and seq == self.last_seq)
+                    self.last_seq = seq
+                except ValueError:
+                    pass
+            self.request("/log_status", "GET", "/log_status")
+            self.pace(started, LIVE_INTERVAL_S)
+
+    def run_list(self):
+        while not self.stop.is_set():
+            started = time.perf_counter()
+            self.request("/list", "GET", "/list")
+            self.pace(started, LIST_INTERVAL_S)
+
+    def run_download(self):
+        path = "/download?file=" + urllib.parse.quote(self.args.file)
+        while not self.stop.is_set():
+            self.request("/download", "GET", path)
+
+    def run_upload(self):
+        payload = bytes(random.getrandbits(8) for _ in range(self.args.upload_kb * 1024))
+        boundary = "----loadtest%08x" % random.getrandbits(32)
+        while not self.stop.is_set():
+            name = "lt_%d_%d.bin" % (self.index, self.uploads)
+            self.uploads += 1
+            body = (("--%s\r\nContent-Disposition: form-data; name=\"file\"; filename=\"%s\"\r\n"
+                     "Content-Type: application/octet-stream\r\n\r\n" % (boundary, name)).encode()
+                    + payload + ("\r\n--%s--\r\n" % boundary).encode())
+            headers = {"Content-Type": "multipart/form-data; boundary=" + boundary}
+            if self.request("/upload", "POST", "/upload", body, headers) is not None:
+                self.request("/delete", "GET", "/delete?file=" + urllib.parse.quote(name))
+
+    def run(self):
+        getattr(self, "run_" + self.behaviour)()
+        self.close()
+
+
+def fetch_json(args, path):
+    """Single request outside of the measurement, e.g. for the device statistics."""
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+    try:
+        conn.request("GET", path)
+        resp = conn.getresponse()
+        data = resp.read()
+        return json.loads(data) if resp.status == 200 else None
+    except (OSError, http.client.HTTPException, ValueError):
+        return None
+    finally:
+        conn.close()
+
+
+def first_log_file(args):
+    conn = http.client.HTTPConnection(args.host, args.port, timeout=args.timeout)
+    try:
+        conn.request("GET", "/list")
+        html = conn.getresponse().read().decode("utf-8", "replace")
+    except (OSError, http.client.HTTPException):
+        return None
+    finally:
+        conn.close()
+    match = re.search(r"/download\?file=([^\"'&]+)", html)
+    return urllib.parse.unquote(match.group(1)) if match else None
+
+
+def parse_mix(text):
+    mix = {}
+    for part in text.split(","):
+        if not part:
+            continue
+        name, _, count = part.partition("=")
+        if name not in BEHAVIOURS:
+            raise argparse.ArgumentTypeError("unknown client type '%s'" % name)
+        mix[name] = int(count or 1)
+    return mix
+
+
+def report(rec, duration, timing):
+    result = {"duration_s": round(duration, 1), "endpoints": {}, "device": timing}
+    print("\n%-12s %8s %6s %8s %8s %8s %8s %8s %8s" %
+          ("endpoint", "requests", "errors", "req/s", "KB/s", "p50 ms", "p95 ms", "p99 ms", "max ms"))
+    for endpoint in sorted(set(rec.samples) | set(rec.errors)):
+        lat = sorted(rec.samples.get(endpoint, []))
+        ms = [v * 1000.0 for v in lat]
+        row = {
+            "requests": len(lat),
+            "errors": rec.errors.get(endpoint, 0),
+            "req_per_s": len(lat) / duration,
+            "kb_per_s": rec.bytes.get(endpoint, 0) / 1024.0 / duration,
+            "p50_ms": percentile(ms, 50),
+            "p95_ms": percentile(ms, 95),
+            "p99_ms": percentile(ms, 99),
+            "max_ms": ms[-1] if ms else 0.0,
+        }
+        result["endpoints"][endpoint] = row
+        print("%-12s %8d %6d %8.1f %8.1f %8.1f %8.1f %8.1f %8.1f" %
+              (endpoint, row["requests"], row["errors"], row["req_per_s"], row["kb_per_s"],
+               row["p50_ms"], row["p95_ms"], row["p99_ms"], row["max_ms"]))
+
+    if rec.frame_ages:
+        ages = sorted(rec.frame_ages)
+        result["frame_age_ms"] = {"p50": percentile(ages, 50), "p95": percentile(ages, 95), "max": ages[-1],
+                                  "repeated_frames": rec.seq_repeats}
+        print("\n/adc frame age: p50 %d ms, p95 %d ms, max %d ms; %d polls returned an already seen frame" %
+              (percentile(ages, 50), percentile(ages, 95), ages[-1], rec.seq_repeats))
+
+    if timing:
+        print("device acquisition over the run: %d frames, period avg %d us, min %d us, max %d us, "
+              "jitter (std) %d us, skew max %d us" %
+              (timing.get("periods", 0), timing.get("period_avg_us", 0), timing.get("period_min_us", 0),
+               timing.get("period_max_us", 0), timing.get("period_std_us", 0), timing.get("skew_max_us", 0)))
+    else:
+        print("device acquisition statistics not available (/api/adc/timing)")
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="HTTP load test for the ESP32 ADS1115 logger.",
+        epilog="client types: " + "; ".join("%s = %s" % kv for kv in BEHAVIOURS.items()))
+    parser.add_argument("--host", default="192.168.4.1", help="device address (default: the access point address)")
+    parser.add_argument("--port", type=int, default=80)
+    parser.add_argument("--duration", type=float, default=30.0, help="test length in seconds")
+    parser.add_argument("--mix", type=parse_mix, default=parse_mix("live=2,list=1"),
+                        help="clients per type, e.g. live=4,list=1,download=1,upload=1")
+    parser.add_argument("--file", help="log file for the download clients (default: first file in /list)")
+    parser.add_argument("--upload-kb", type=int, default=64, help="size of each uploaded file")
+    parser.add_argument("--timeout", type=float, default=10.0, help="socket timeout in seconds")
+    parser.add_argument("--json", help="also write the results to this file")
+    args = parser.parse_args()
+
+    if args.mix.get("download") and not args.file:
+        args.file = first_log_file(args)
+        if not args.file:
+            sys.exit("no file to download: pass --file or put a log file on the card")
+
+    # Clear the device statistics so they cover exactly the test period.
+    fetch_json(args, "/api/adc/timing?reset=1")
+
+    rec = Recorder()
+    stop = threading.Event()
+    clients = [Client(args, name, i, rec, stop)
+               for name, count in args.mix.items() for i in range(count)]
+    print("%d clients (%s) against %s:%d for %.0f s" %
+          (len(clients), ", ".join("%s=%d" % kv for kv in args.mix.items()), args.host, args.port, args.duration))
+
+    started = time.perf_counter()
+    for c in clients:
+        c.start()
+    try:
+        stop.wait(args.duration)
+    except KeyboardInterrupt:
+        pass
+    stop.set()
+    for c in clients:
+        c.join(args.timeout + 1.0)
+    duration = time.perf_counter() - started
+
+    timing = fetch_json(args, "/api/adc/timing?reset=1")
+    result = report(rec, duration, timing)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=2)
+
+
+if __name__ == "__main__":
+    main()